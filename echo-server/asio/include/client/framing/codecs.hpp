@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <client/framing/delimiter.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @enum Framing
+ * @brief Framing of the messages echoed by the Session.
+ */
+enum class Framing
+{
+  kNewline,        ///< Messages terminated with '\n'.
+  kU16Length,      ///< Messages prefixed with their length as big-endian 16-bit integer.
+  kU32Length,      ///< Messages prefixed with their length as big-endian 32-bit integer.
+  kVarintLength,   ///< Messages prefixed with their length as LEB128 varint.
+  kFixedSize       ///< Messages of the same size.
+};
+
+/**
+ * @brief Number of framed bytes reported for data that can never form a valid frame.
+ */
+inline constexpr std::size_t kMalformedFrame{std::numeric_limits<std::size_t>::max()};
+
+/**
+ * @class NewlineCodec
+ * @brief Codec of the '\n' terminated messages.
+ * @details Every codec exposes the same interface, so the Session is
+ *          instantiated with the codec as a template parameter and the
+ *          framing is inlined into the read path:
+ *          - Frame(data, size, scanned) returns the number of bytes at the
+ *            beginning of data that form complete frames (0 if there are
+ *            none yet) or kMalformedFrame. The first scanned bytes were
+ *            passed to the previous call and did not complete a frame;
+ *          - Count(data, framed_bytes) returns the number of frames in the
+ *            framed bytes returned by Frame(), the messages the rate
+ *            limits are charged with;
+ *          - BufferSize() returns the capacity of the read buffer needed
+ *            for the largest valid frame.
+ */
+class NewlineCodec final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for NewlineCodec class.
+   *
+   * @param[in] max_frame_size Maximal length of the line including the delimiter.
+   */
+  explicit NewlineCodec(std::size_t max_frame_size) noexcept
+    : max_frame_size_{max_frame_size}
+  { }
+
+  auto Frame(
+    const char* data,  //
+    std::size_t size,
+    std::size_t scanned
+  ) const noexcept -> std::size_t
+  {
+    // The scanned bytes hold no delimiter, so the last one is looked for among the new bytes only.
+    const char* last_delimiter{FindLastDelimiter(data + scanned, data + size, '\n')};
+    if (last_delimiter != nullptr)
+    {
+      return static_cast<std::size_t>(last_delimiter + 1 - data);
+    }
+    return size >= max_frame_size_ ? kMalformedFrame : 0;
+  }
+
+  auto Count(
+    const char* data,  //
+    std::size_t framed_bytes
+  ) const noexcept -> std::size_t
+  {
+    return static_cast<std::size_t>(std::count(data, data + framed_bytes, '\n'));
+  }
+
+  auto BufferSize() const noexcept -> std::size_t
+  {
+    return max_frame_size_;
+  }
+
+ private:
+  std::size_t max_frame_size_;
+};
+
+/**
+ * @struct U16LengthHeader
+ * @brief Big-endian 16-bit length header.
+ */
+struct U16LengthHeader
+{
+  static constexpr std::size_t kMaxSize{2};
+
+  /**
+   * @brief Decodes the header at the beginning of the data.
+   *
+   * @param[in] data Beginning of the header.
+   * @param[in] size Number of available bytes.
+   * @param[out] header_size Size of the decoded header.
+   * @param[out] length Decoded length of the payload.
+   * @return False if the header is incomplete.
+   */
+  static auto Decode(
+    const unsigned char* data,  //
+    std::size_t size,
+    std::size_t& header_size,
+    std::uint64_t& length
+  ) noexcept -> bool
+  {
+    if (size < kMaxSize)
+    {
+      return false;
+    }
+    header_size = kMaxSize;
+    length = static_cast<std::uint64_t>(data[0]) << 8 | data[1];
+    return true;
+  }
+};
+
+/**
+ * @struct U32LengthHeader
+ * @brief Big-endian 32-bit length header.
+ */
+struct U32LengthHeader
+{
+  static constexpr std::size_t kMaxSize{4};
+
+  static auto Decode(
+    const unsigned char* data,  //
+    std::size_t size,
+    std::size_t& header_size,
+    std::uint64_t& length
+  ) noexcept -> bool
+  {
+    if (size < kMaxSize)
+    {
+      return false;
+    }
+    header_size = kMaxSize;
+    length = static_cast<std::uint64_t>(data[0]) << 24 | static_cast<std::uint64_t>(data[1]) << 16 |
+             static_cast<std::uint64_t>(data[2]) << 8 | data[3];
+    return true;
+  }
+};
+
+/**
+ * @struct VarintLengthHeader
+ * @brief LEB128 length header: 7 bits per byte, least significant group first.
+ * @details A header longer than kMaxSize bytes decodes to a length above
+ *          any frame limit, so it is reported as a malformed frame.
+ */
+struct VarintLengthHeader
+{
+  static constexpr std::size_t kMaxSize{10};
+
+  static auto Decode(
+    const unsigned char* data,  //
+    std::size_t size,
+    std::size_t& header_size,
+    std::uint64_t& length
+  ) noexcept -> bool
+  {
+    length = 0;
+    for (std::size_t i = 0; i < kMaxSize; ++i)
+    {
+      if (i == size)
+      {
+        return false;
+      }
+      length |= static_cast<std::uint64_t>(data[i] & 0x7F) << (7 * i);
+      if ((data[i] & 0x80) == 0)
+      {
+        header_size = i + 1;
+        return true;
+      }
+    }
+    header_size = kMaxSize;
+    length = std::numeric_limits<std::uint64_t>::max();
+    return true;
+  }
+};
+
+/**
+ * @class LengthPrefixedCodec
+ * @brief Codec of the messages prefixed with the length of their payload.
+ *
+ * @tparam Header Header policy: U16LengthHeader, U32LengthHeader or VarintLengthHeader.
+ */
+template<typename Header>
+class LengthPrefixedCodec final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for LengthPrefixedCodec class.
+   *
+   * @param[in] max_frame_size Maximal length of the payload, longer frames are malformed.
+   */
+  explicit LengthPrefixedCodec(std::size_t max_frame_size) noexcept
+    : max_frame_size_{max_frame_size}
+  { }
+
+  auto Frame(
+    const char* data,  //
+    std::size_t size,
+    std::size_t
+  ) const noexcept -> std::size_t
+  {
+    const unsigned char* bytes{reinterpret_cast<const unsigned char*>(data)};
+    std::size_t framed_bytes{0};
+    for (;;)
+    {
+      std::size_t header_size;
+      std::uint64_t length;
+      if (!Header::Decode(bytes + framed_bytes, size - framed_bytes, header_size, length))
+      {
+        return framed_bytes;
+      }
+      if (length > max_frame_size_)
+      {
+        return framed_bytes == 0 ? kMalformedFrame : framed_bytes;
+      }
+      if (size - framed_bytes - header_size < length)
+      {
+        return framed_bytes;
+      }
+      framed_bytes += header_size + static_cast<std::size_t>(length);
+    }
+  }
+
+  auto Count(
+    const char* data,  //
+    std::size_t framed_bytes
+  ) const noexcept -> std::size_t
+  {
+    // The frames were validated by Frame(), only their headers are decoded again.
+    const unsigned char* bytes{reinterpret_cast<const unsigned char*>(data)};
+    std::size_t frames{0};
+    for (std::size_t offset = 0; offset != framed_bytes; ++frames)
+    {
+      std::size_t header_size;
+      std::uint64_t length;
+      if (!Header::Decode(bytes + offset, framed_bytes - offset, header_size, length))
+      {
+        break;
+      }
+      offset += header_size + static_cast<std::size_t>(length);
+    }
+    return frames;
+  }
+
+  auto BufferSize() const noexcept -> std::size_t
+  {
+    return Header::kMaxSize + max_frame_size_;
+  }
+
+ private:
+  std::size_t max_frame_size_;
+};
+
+/**
+ * @class FixedSizeCodec
+ * @brief Codec of the messages of the same size.
+ */
+class FixedSizeCodec final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for FixedSizeCodec class.
+   *
+   * @param[in] frame_size Size of every frame.
+   */
+  explicit FixedSizeCodec(std::size_t frame_size) noexcept
+    : frame_size_{frame_size == 0 ? 1 : frame_size}
+  { }
+
+  auto Frame(
+    const char*,  //
+    std::size_t size,
+    std::size_t
+  ) const noexcept -> std::size_t
+  {
+    return size - size % frame_size_;
+  }
+
+  auto Count(
+    const char*,  //
+    std::size_t framed_bytes
+  ) const noexcept -> std::size_t
+  {
+    return framed_bytes / frame_size_;
+  }
+
+  auto BufferSize() const noexcept -> std::size_t
+  {
+    return frame_size_;
+  }
+
+ private:
+  std::size_t frame_size_;
+};
+
+using U16LengthCodec = LengthPrefixedCodec<U16LengthHeader>;
+using U32LengthCodec = LengthPrefixedCodec<U32LengthHeader>;
+using VarintLengthCodec = LengthPrefixedCodec<VarintLengthHeader>;
+
+}  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @brief Returns the last occurrence of the delimiter in [begin, end) or nullptr if there is none.
+ * @details Everything up to the returned position consists of complete
+ *          frames, so the whole batch is extracted with a single scan
+ *          that stops at the first delimiter found from the end. The scan
+ *          compares 32 bytes at once with AVX2 or 16 bytes with SSE2,
+ *          whichever the CPU supports (selected once at runtime), and
+ *          falls back to a scalar loop on other architectures.
+ *
+ * @param[in] begin Beginning of the scanned data.
+ * @param[in] end End of the scanned data.
+ * @param[in] delimiter Delimiter to look for.
+ */
+auto FindLastDelimiter(
+  const char* begin,  //
+  const char* end,
+  char delimiter
+) noexcept -> const char*;
+
+}  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class HandlerMemory
+ * @brief Storage for the memory of a single outstanding asynchronous operation.
+ * @details Asio allocates the state of every asynchronous operation with
+ *          the allocator associated with its completion handler. Handlers
+ *          wrapped by MakeCustomAllocHandler() place that state into this
+ *          storage, so a chain of operations where only one is outstanding
+ *          at a time never touches the heap. Oversized or overlapping
+ *          requests fall back to the global operator new.
+ */
+class HandlerMemory final
+{
+ public:
+  HandlerMemory() noexcept
+    : in_use_{false}
+  { }
+
+  HandlerMemory(const HandlerMemory&) = delete;
+  auto operator=(const HandlerMemory&) -> HandlerMemory& = delete;
+
+  /**
+   * @public
+   * @brief Returns memory for the operation state.
+   *
+   * @param[in] size Size in bytes of the requested memory.
+   */
+  auto Allocate(std::size_t size) -> void*
+  {
+    if (size <= sizeof(storage_) && !in_use_.exchange(true, std::memory_order_acquire))
+    {
+      return storage_;
+    }
+    return ::operator new(size);
+  }
+
+  /**
+   * @public
+   * @brief Releases memory returned by Allocate().
+   *
+   * @param[in] pointer Memory to release.
+   */
+  auto Deallocate(void* pointer) noexcept -> void
+  {
+    if (pointer == storage_)
+    {
+      in_use_.store(false, std::memory_order_release);
+      return;
+    }
+    ::operator delete(pointer);
+  }
+
+ private:
+  static constexpr std::size_t kStorageSize{512};
+
+  alignas(std::max_align_t) unsigned char storage_[kStorageSize];
+  std::atomic<bool> in_use_;
+};
+
+/**
+ * @class HandlerAllocator
+ * @brief Standard allocator over HandlerMemory associated with the completion handlers.
+ *
+ * @tparam T Type of the allocated objects.
+ */
+template<typename T>
+class HandlerAllocator
+{
+ public:
+  using value_type = T;
+
+  explicit HandlerAllocator(HandlerMemory& memory) noexcept
+    : memory_{memory}
+  { }
+
+  template<typename U>
+  HandlerAllocator(const HandlerAllocator<U>& other) noexcept
+    : memory_{other.memory_}
+  { }
+
+  auto allocate(std::size_t n) const -> T*
+  {
+    return static_cast<T*>(memory_.Allocate(sizeof(T) * n));
+  }
+
+  auto deallocate(
+    T* pointer,  //
+    std::size_t
+  ) const noexcept -> void
+  {
+    memory_.Deallocate(pointer);
+  }
+
+  template<typename U>
+  auto operator==(const HandlerAllocator<U>& other) const noexcept -> bool
+  {
+    return &memory_ == &other.memory_;
+  }
+
+  template<typename U>
+  auto operator!=(const HandlerAllocator<U>& other) const noexcept -> bool
+  {
+    return &memory_ != &other.memory_;
+  }
+
+ private:
+  template<typename>
+  friend class HandlerAllocator;
+
+  HandlerMemory& memory_;
+};
+
+/**
+ * @class CustomAllocHandler
+ * @brief Completion handler wrapper that associates HandlerAllocator with the handler.
+ *
+ * @tparam Handler Type of the wrapped completion handler.
+ */
+template<typename Handler>
+class CustomAllocHandler
+{
+ public:
+  using allocator_type = HandlerAllocator<Handler>;
+
+  CustomAllocHandler(
+    HandlerMemory& memory,  //
+    Handler handler
+  )
+    : memory_{memory}  //
+    , handler_{std::move(handler)}
+  { }
+
+  auto get_allocator() const noexcept -> allocator_type
+  {
+    return allocator_type{memory_};
+  }
+
+  template<typename... Args>
+  auto operator()(Args&&... args) -> void
+  {
+    handler_(std::forward<Args>(args)...);
+  }
+
+ private:
+  HandlerMemory& memory_;
+  Handler handler_;
+};
+
+/**
+ * @brief Wraps the handler so that its asynchronous operation uses the specified memory.
+ *
+ * @param[in] memory Memory for the state of the asynchronous operation.
+ * @param[in] handler Completion handler to wrap.
+ */
+template<typename Handler>
+inline auto MakeCustomAllocHandler(
+  HandlerMemory& memory,  //
+  Handler&& handler
+) -> CustomAllocHandler<std::decay_t<Handler>>
+{
+  return CustomAllocHandler<std::decay_t<Handler>>{memory, std::forward<Handler>(handler)};
+}
+
+}  // namespace tcp
\ No newline at end of file
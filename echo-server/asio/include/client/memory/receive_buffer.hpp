@@ -0,0 +1,105 @@
+#pragma once
+
+#include <client/memory/slab_pool.hpp>
+#include <cstddef>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @brief Size in bytes the receive buffer grows to while the reads keep filling it.
+ */
+inline constexpr std::size_t kMaxReceiveBufferSize{64 * 1024};
+
+/**
+ * @class ReceiveBuffer
+ * @brief Receive buffer of a session sized after the data the session receives.
+ * @details The buffer is allocated when the socket becomes readable and
+ *          freed when the session goes idle with no incomplete frame, so
+ *          idle sessions hold no receive memory. Its size starts at one
+ *          slab, doubles while the reads fill it and halves while they use
+ *          less than a quarter of it; it stays between kSlabSize and the
+ *          larger of the longest frame and kMaxReceiveBufferSize. The
+ *          allocated bytes are reserved from the process memory budget.
+ */
+class ReceiveBuffer final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for ReceiveBuffer class.
+   *
+   * @param[in] frame_size Capacity needed for the longest valid frame.
+   */
+  explicit ReceiveBuffer(std::size_t frame_size) noexcept;
+
+  ReceiveBuffer(const ReceiveBuffer&) = delete;
+  auto operator=(const ReceiveBuffer&) -> ReceiveBuffer& = delete;
+
+  ~ReceiveBuffer();
+
+  /**
+   * @public
+   * @brief Allocates the buffer unless it is allocated already.
+   * @return False if the buffer does not fit into the memory budget.
+   */
+  auto Allocate() -> bool;
+
+  /**
+   * @public
+   * @brief Frees the buffer, its content is lost.
+   */
+  auto Free() noexcept -> void;
+
+  /**
+   * @public
+   * @brief Returns true if the buffer may grow to fit a longer frame.
+   */
+  auto Growable() const noexcept -> bool;
+
+  /**
+   * @public
+   * @brief Doubles the allocated buffer.
+   *
+   * @param[in] used Number of bytes at the beginning of the buffer to keep.
+   * @return False if the larger buffer does not fit into the memory budget.
+   */
+  auto Grow(std::size_t used) -> bool;
+
+  /**
+   * @public
+   * @brief Sizes the next allocations after the number of bytes held by the buffer after a read.
+   *
+   * @param[in] used Number of bytes held by the buffer.
+   */
+  auto Adapt(std::size_t used) noexcept -> void;
+
+  /**
+   * @public
+   * @brief Returns true if the buffer is allocated.
+   */
+  auto Allocated() const noexcept -> bool;
+
+  /**
+   * @public
+   * @brief Returns the beginning of the allocated buffer.
+   */
+  auto Data() noexcept -> char*;
+
+  /**
+   * @public
+   * @brief Returns the size of the allocated buffer.
+   */
+  auto Size() const noexcept -> std::size_t;
+
+ private:
+  char* data_;
+  std::size_t size_;
+  std::size_t next_size_;
+  std::size_t max_size_;
+};
+
+}  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class RecyclingAllocator
+ * @brief Standard allocator that recycles single objects through a per-thread free list.
+ * @details Used with std::allocate_shared() so that the storage of a
+ *          destroyed object (together with its shared_ptr control block)
+ *          is reused by the next object created on the same thread.
+ *
+ * @tparam T Type of the allocated objects.
+ */
+template<typename T>
+class RecyclingAllocator
+{
+ public:
+  using value_type = T;
+
+  RecyclingAllocator() noexcept = default;
+
+  template<typename U>
+  RecyclingAllocator(const RecyclingAllocator<U>&) noexcept
+  { }
+
+  auto allocate(std::size_t n) -> T*
+  {
+    FreeList& free_list{LocalFreeList()};
+    if (n != 1 || free_list.head_ == nullptr)
+    {
+      return std::allocator<T>{}.allocate(n);
+    }
+    FreeNode* node{free_list.head_};
+    free_list.head_ = node->next_;
+    --free_list.size_;
+    return reinterpret_cast<T*>(node);
+  }
+
+  auto deallocate(
+    T* pointer,  //
+    std::size_t n
+  ) noexcept -> void
+  {
+    FreeList& free_list{LocalFreeList()};
+    if (n != 1 || free_list.size_ == kMaxCachedObjects)
+    {
+      std::allocator<T>{}.deallocate(pointer, n);
+      return;
+    }
+    free_list.head_ = ::new (static_cast<void*>(pointer)) FreeNode{free_list.head_};
+    ++free_list.size_;
+  }
+
+  template<typename U>
+  auto operator==(const RecyclingAllocator<U>&) const noexcept -> bool
+  {
+    return true;
+  }
+
+  template<typename U>
+  auto operator!=(const RecyclingAllocator<U>&) const noexcept -> bool
+  {
+    return false;
+  }
+
+ private:
+  static constexpr std::size_t kMaxCachedObjects{4096};
+
+  struct FreeNode
+  {
+    FreeNode* next_;
+  };
+
+  static_assert(sizeof(T) >= sizeof(FreeNode), "RecyclingAllocator: object is too small to be recycled");
+
+  struct FreeList
+  {
+    ~FreeList()
+    {
+      while (head_ != nullptr)
+      {
+        FreeNode* node{head_};
+        head_ = node->next_;
+        std::allocator<T>{}.deallocate(reinterpret_cast<T*>(node), 1);
+      }
+    }
+
+    FreeNode* head_{nullptr};
+    std::size_t size_{0};
+  };
+
+  static auto LocalFreeList() -> FreeList&
+  {
+    thread_local FreeList free_list;
+    return free_list;
+  }
+};
+
+}  // namespace tcp
\ No newline at end of file
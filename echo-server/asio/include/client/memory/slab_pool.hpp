@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @brief Size in bytes of every slab handed out by SlabPool.
+ */
+inline constexpr std::size_t kSlabSize{4096};
+
+/**
+ * @class SlabPool
+ * @brief Per-thread cache of fixed-size memory slabs.
+ * @details Released slabs are kept in the intrusive free list of the
+ *          releasing thread and handed out again without touching the
+ *          heap. The pool is not thread-safe: every thread owns its own
+ *          instance returned by Local(), so a slab must be released on
+ *          the thread of the io_context that uses it.
+ */
+class SlabPool final
+{
+ public:
+  SlabPool(const SlabPool&) = delete;
+  auto operator=(const SlabPool&) -> SlabPool& = delete;
+
+  ~SlabPool();
+
+  /**
+   * @public
+   * @brief Returns the pool of the calling thread.
+   */
+  static auto Local() -> SlabPool&;
+
+  /**
+   * @public
+   * @brief Returns slab of kSlabSize bytes.
+   */
+  auto Allocate() -> void*;
+
+  /**
+   * @public
+   * @brief Returns the slab to the pool.
+   *
+   * @param[in] slab Slab previously returned by Allocate().
+   */
+  auto Deallocate(void* slab) noexcept -> void;
+
+ private:
+  SlabPool() noexcept;
+
+ private:
+  struct FreeSlab
+  {
+    FreeSlab* next_;
+  };
+
+  FreeSlab* free_slabs_;
+  std::size_t cached_slabs_;
+};
+
+/**
+ * @class SlabAllocator
+ * @brief Standard allocator that serves requests fitting into a slab from SlabPool.
+ * @details Larger requests fall back to std::allocator.
+ *
+ * @tparam T Type of the allocated objects.
+ */
+template<typename T>
+class SlabAllocator
+{
+ public:
+  using value_type = T;
+
+  SlabAllocator() noexcept = default;
+
+  template<typename U>
+  SlabAllocator(const SlabAllocator<U>&) noexcept
+  { }
+
+  auto allocate(std::size_t n) -> T*
+  {
+    if (n * sizeof(T) <= kSlabSize && alignof(T) <= alignof(std::max_align_t))
+    {
+      return static_cast<T*>(SlabPool::Local().Allocate());
+    }
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  auto deallocate(
+    T* pointer,  //
+    std::size_t n
+  ) noexcept -> void
+  {
+    if (n * sizeof(T) <= kSlabSize && alignof(T) <= alignof(std::max_align_t))
+    {
+      SlabPool::Local().Deallocate(pointer);
+      return;
+    }
+    std::allocator<T>{}.deallocate(pointer, n);
+  }
+
+  template<typename U>
+  auto operator==(const SlabAllocator<U>&) const noexcept -> bool
+  {
+    return true;
+  }
+
+  template<typename U>
+  auto operator!=(const SlabAllocator<U>&) const noexcept -> bool
+  {
+    return false;
+  }
+};
+
+}  // namespace tcp
\ No newline at end of file
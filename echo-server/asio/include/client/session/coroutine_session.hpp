@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <boost/asio.hpp>
+#include <client/memory/receive_buffer.hpp>
+#include <client/session/outbound_queue.hpp>
+#include <client/session/rate_limiter.hpp>
+#include <client/session/session_link.hpp>
+#include <client/session/session.hpp>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class CoroutineSession
+ * @brief Session written as C++20 coroutines on top of boost::asio::awaitable.
+ * @details Echoes the peer the same way as Session: the frames found by
+ *          the codec in every read are queued at once, input waiting in
+ *          the socket is read ahead up to the flush threshold, reading
+ *          pauses while the outbound queue is over the high-water mark and
+ *          an idle session waits for the input without a receive buffer.
+ *
+ *          The CoroutineSession object lives on the frame of the reading
+ *          coroutine, not on the heap behind a shared_ptr: the suspended
+ *          coroutines refer to it directly, so reads and writes cost no
+ *          reference count updates. Coroutine frames and the state of the
+ *          awaited operations come from the recycling allocator of the
+ *          asio thread.
+ *
+ *          Writing is done by a second coroutine living as long as the
+ *          reader. While it is idle the reader first tries to send the
+ *          frames it queued with a nonblocking write and wakes the writer
+ *          only for what the socket did not take, so a short echo costs no
+ *          extra resumption. The reader waits on a timer for the writer to
+ *          drain the queue below the low-water mark, and for the writer to
+ *          finish before the session ends. Zero-copy sends are not
+ *          supported.
+ *
+ *          A reader over its rate limits is parked in the Pacer of its
+ *          thread and waits on the same timer until the pacer resumes it.
+ *
+ * @tparam Codec Codec splitting the received data into frames (see NewlineCodec).
+ */
+template<typename Codec>
+class CoroutineSession final
+{
+ public:
+  /**
+   * @public
+   * @brief Spawns the coroutine running the session on the context of the socket.
+   *
+   * @param[in] socket Socket for communication with peer.
+   * @param[in] options Tunables of the framing and outbound queue.
+   */
+  static auto Start(
+    boost::asio::ip::tcp::socket&& socket,  //
+    const SessionOptions& options
+  ) -> void;
+
+  /**
+   * @public
+   * @brief Parameterized contructor for CoroutineSession class.
+   *
+   * @param[in] socket Socket for communication with peer.
+   * @param[in] options Tunables of the framing and outbound queue.
+   */
+  CoroutineSession(
+    boost::asio::ip::tcp::socket&& socket,  //
+    const SessionOptions& options
+  );
+
+  CoroutineSession(const CoroutineSession&) = delete;
+  auto operator=(const CoroutineSession&) -> CoroutineSession& = delete;
+
+  /**
+   * @public
+   * @brief Destructor for CoroutineSession class.
+   * @details Records the closed connection and its duration in the metrics.
+   */
+  ~CoroutineSession();
+
+ private:
+  /**
+   * @private
+   * @brief Reading coroutine, owns the session.
+   */
+  static auto Run(
+    boost::asio::ip::tcp::socket socket,  //
+    SessionOptions options
+  ) -> boost::asio::awaitable<void>;
+
+  /**
+   * @private
+   * @brief Reads and queues the frames until the peer closes the connection or sends a malformed frame.
+   */
+  auto Read() -> boost::asio::awaitable<void>;
+
+  /**
+   * @private
+   * @brief Writes the outbound queue with gathered writes, sleeps while it is empty, until the reader is done.
+   */
+  auto Write() -> boost::asio::awaitable<void>;
+
+  /**
+   * @private
+   * @brief Suspends the reader until the writer wakes it up.
+   */
+  auto Wait() -> boost::asio::awaitable<void>;
+
+  /**
+   * @private
+   * @brief Resumes the reader suspended in Wait().
+   */
+  auto Notify() -> void;
+
+  /**
+   * @private
+   * @brief Resumes the reader parked for its rate limits.
+   *
+   * @param[in] session Session of the parked reader.
+   */
+  static auto ResumeRead(void* session) -> void;
+
+  /**
+   * @private
+   * @brief Frames the received bytes and moves the complete frames into the outbound queue.
+   *
+   * @param[in] processed_bytes Number of bytes read behind the incomplete tail of the receive buffer.
+   * @return False if the receive buffer holds a malformed frame.
+   */
+  auto QueueFrames(std::size_t processed_bytes) -> bool;
+
+  /**
+   * @private
+   * @brief Reads the input that is already waiting in the socket until the flush threshold is reached.
+   *
+   * @param[in] filled Whether the last read filled the free space of the receive buffer.
+   * @return False if the receive buffer holds a malformed frame.
+   */
+  auto ReadAhead(bool filled) -> bool;
+
+  /**
+   * @private
+   * @brief Sends the queued frames right away if the writer is idle and wakes it up for the rest.
+   */
+  auto StartWriting() -> void;
+
+  /**
+   * @private
+   * @brief Closes the connection whose data does not fit into the memory budget.
+   */
+  auto Shed() -> void;
+
+ private:
+  static constexpr std::size_t kMaxGatheredBuffers{16};
+
+  boost::asio::ip::tcp::socket socket_;
+  SessionLink link_;
+  boost::asio::steady_timer signal_;
+  boost::asio::steady_timer write_signal_;
+  Codec codec_;
+  ReceiveBuffer read_buffer_;
+  std::size_t read_size_;
+  RateLimiter rate_limiter_;
+  OutboundQueue write_queue_;
+  std::array<boost::asio::const_buffer, kMaxGatheredBuffers> gathered_buffers_;
+  std::size_t high_water_mark_;
+  std::size_t flush_threshold_;
+  std::size_t write_quantum_;
+  std::uint64_t accepted_at_;
+  bool writing_;
+  bool waiting_;
+  bool write_idle_;
+  bool reader_done_;
+};
+
+}  // namespace tcp
\ No newline at end of file
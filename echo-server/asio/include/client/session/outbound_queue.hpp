@@ -0,0 +1,139 @@
+#pragma once
+
+#include <boost/asio/buffer.hpp>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class OutboundQueue
+ * @brief Byte queue of the data waiting to be written to the peer.
+ * @details Data is stored in a singly linked list of slabs from SlabPool,
+ *          so appending never reallocates or moves the queued bytes and
+ *          the buffers returned by Front() and Gather() stay valid while
+ *          more data is appended behind them.
+ *
+ *          Bytes sent with MSG_ZEROCOPY are still referenced by the kernel
+ *          after the send completes. Chunks holding such bytes are pinned
+ *          with the zero-copy id of the send and are not reused until
+ *          Release() reports that id as completed; the chunks still pinned
+ *          when the queue is destroyed are never reused.
+ */
+class OutboundQueue final
+{
+ public:
+  OutboundQueue() noexcept;
+
+  OutboundQueue(const OutboundQueue&) = delete;
+  auto operator=(const OutboundQueue&) -> OutboundQueue& = delete;
+
+  ~OutboundQueue();
+
+  /**
+   * @public
+   * @brief Copies the data to the end of the queue.
+   *
+   * @param[in] data Data to append.
+   * @param[in] size Size of the data in bytes.
+   */
+  auto Append(
+    const char* data,  //
+    std::size_t size
+  ) -> void;
+
+  /**
+   * @public
+   * @brief Returns the contiguous region at the front of the queue.
+   */
+  auto Front() const noexcept -> boost::asio::const_buffer;
+
+  /**
+   * @public
+   * @brief Fills the array with the regions at the front of the queue.
+   *
+   * @param[out] buffers Array to fill.
+   * @param[in] max_buffers Size of the array.
+   * @param[in] max_bytes Number of bytes the regions may hold together, the last one is cut short.
+   * @return Number of filled regions.
+   */
+  auto Gather(
+    boost::asio::const_buffer* buffers,  //
+    std::size_t max_buffers,
+    std::size_t max_bytes
+  ) const noexcept -> std::size_t;
+
+  /**
+   * @public
+   * @brief Removes bytes from the front of the queue.
+   *
+   * @param[in] size Number of bytes to remove, at most Size().
+   */
+  auto Consume(std::size_t size) noexcept -> void;
+
+  /**
+   * @public
+   * @brief Removes bytes sent with MSG_ZEROCOPY from the front of the queue.
+   * @details The chunks holding the bytes stay pinned until Release() covers the id.
+   *
+   * @param[in] size Number of bytes to remove, at most Size().
+   * @param[in] zero_copy_id Zero-copy id of the send that transmitted the bytes.
+   */
+  auto ConsumeZeroCopy(
+    std::size_t size,  //
+    std::uint32_t zero_copy_id
+  ) noexcept -> void;
+
+  /**
+   * @public
+   * @brief Reports all zero-copy sends up to the specified id (inclusive) as completed.
+   *
+   * @param[in] zero_copy_id Last completed zero-copy id.
+   */
+  auto Release(std::uint32_t zero_copy_id) noexcept -> void;
+
+  /**
+   * @public
+   * @brief Returns true if some chunks are still referenced by incomplete zero-copy sends.
+   */
+  auto Pinned() const noexcept -> bool;
+
+  /**
+   * @public
+   * @brief Returns true if the queue holds no data.
+   */
+  auto Empty() const noexcept -> bool;
+
+  /**
+   * @public
+   * @brief Returns the number of queued bytes.
+   */
+  auto Size() const noexcept -> std::size_t;
+
+ private:
+  struct Chunk;
+
+  auto Consume(
+    std::size_t size,  //
+    bool zero_copy,
+    std::uint32_t zero_copy_id
+  ) noexcept -> void;
+
+  auto IsCompleted(const Chunk* chunk) const noexcept -> bool;
+
+  auto Retire(Chunk* chunk) noexcept -> void;
+
+ private:
+  Chunk* head_;
+  Chunk* tail_;
+  Chunk* retired_head_;
+  Chunk* retired_tail_;
+  std::size_t size_;
+  std::uint32_t completed_zero_copy_ids_;
+};
+
+}  // namespace tcp
\ No newline at end of file
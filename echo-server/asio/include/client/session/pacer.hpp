@@ -0,0 +1,117 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <client/memory/handler_memory.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class Pacer
+ * @brief Per-thread scheduler of the sessions waiting for their rate limits.
+ * @details The sessions of a thread that ran over their token buckets are
+ *          parked in the min-heap of the pacer ordered by the time the
+ *          buckets allow them to read again, and a single timer of the
+ *          thread is armed for the earliest of them. A parked session costs
+ *          a heap entry instead of a timer of its own, and the expired
+ *          sessions are resumed by one timer completion.
+ *
+ *          The pacer is not thread-safe: every thread owns its own instance
+ *          returned by Local(), created on the first call with the executor
+ *          of the io_context the thread runs.
+ */
+class Pacer final
+{
+ public:
+  /**
+   * @struct Waiter
+   * @brief Intrusive heap entry of a parked session, owned by the session.
+   */
+  struct Waiter
+  {
+    static constexpr std::size_t kNotParked{std::numeric_limits<std::size_t>::max()};
+
+    std::uint64_t due{0};                       ///< Time to resume at, GetRateLimitClock() nanoseconds.
+    std::size_t index{kNotParked};              ///< Position in the heap.
+    void (*resume)(void* target){nullptr};      ///< Called on the thread of the pacer once the time has come.
+    void* target{nullptr};                      ///< Argument of resume.
+    std::shared_ptr<void> keep_alive{nullptr};  ///< Keeps the session alive while it is parked.
+  };
+
+  Pacer(const Pacer&) = delete;
+  auto operator=(const Pacer&) -> Pacer& = delete;
+
+  /**
+   * @public
+   * @brief Drops the parked sessions without resuming them.
+   */
+  ~Pacer();
+
+  /**
+   * @public
+   * @brief Returns the pacer of the calling thread.
+   *
+   * @param[in] executor Executor of the io_context the thread runs, used on the first call only.
+   */
+  static auto Local(const boost::asio::any_io_executor& executor) -> Pacer&;
+
+  /**
+   * @public
+   * @brief Parks the waiter until its due time.
+   *
+   * @param[in] waiter Waiter with the due time and the resume callback set, not parked yet.
+   */
+  auto Park(Waiter& waiter) -> void;
+
+  /**
+   * @public
+   * @brief Removes the waiter from the heap without resuming it, does nothing if it is not parked.
+   *
+   * @param[in] waiter Waiter to remove.
+   */
+  auto Unpark(Waiter& waiter) noexcept -> void;
+
+ private:
+  explicit Pacer(const boost::asio::any_io_executor& executor);
+
+  /**
+   * @private
+   * @brief Arms the timer for the earliest waiter unless it is armed for it already.
+   */
+  auto Arm() -> void;
+
+  /**
+   * @private
+   * @brief Resumes the waiters whose time has come and rearms the timer.
+   */
+  auto Expire() -> void;
+
+  auto Remove(std::size_t index) noexcept -> void;
+
+  auto SiftUp(std::size_t index) noexcept -> void;
+
+  auto SiftDown(std::size_t index) noexcept -> void;
+
+  auto Place(
+    Waiter* waiter,  //
+    std::size_t index
+  ) noexcept -> void;
+
+ private:
+  static constexpr std::uint64_t kNotArmed{std::numeric_limits<std::uint64_t>::max()};
+
+  HandlerMemory handler_memory_;
+  boost::asio::steady_timer timer_;
+  std::vector<Waiter*> heap_;
+  std::uint64_t armed_due_;
+};
+
+}  // namespace tcp
\ No newline at end of file
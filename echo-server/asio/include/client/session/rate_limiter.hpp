@@ -0,0 +1,133 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <client/session/pacer.hpp>
+#include <common/rate_limit/rate_limit.h>
+#include <cstddef>
+#include <memory>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class RateLimiter
+ * @brief Token buckets of a session and of its peer address.
+ * @details The buckets are charged with the bytes and the frames of every
+ *          read once it completes. A session over its limits is parked in
+ *          the Pacer of its thread until the buckets allow the next read.
+ *          A session that finds the buckets of its peer in debt books its
+ *          next read in them (see PeerBuckets), so the sessions of a peer
+ *          take turns instead of racing for the refill.
+ *
+ *          The peer buckets are looked up only when the peer limits are
+ *          set; IPv6 peers are limited by the buckets of the session only.
+ */
+class RateLimiter final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for RateLimiter class.
+   *
+   * @param[in] socket Connected socket of the session.
+   * @param[in] limits Limits of the session.
+   * @param[in] peer_limits Limits of all the sessions of the peer address.
+   */
+  RateLimiter(
+    const boost::asio::ip::tcp::socket& socket,  //
+    const RateLimits& limits,
+    const RateLimits& peer_limits
+  );
+
+  RateLimiter(const RateLimiter&) = delete;
+  auto operator=(const RateLimiter&) -> RateLimiter& = delete;
+
+  /**
+   * @public
+   * @brief Destructor for RateLimiter class.
+   * @details Unparks the session, returns its booking and releases the peer buckets.
+   */
+  ~RateLimiter();
+
+  /**
+   * @public
+   * @brief Returns true if any limit applies to the session.
+   */
+  auto Enabled() const noexcept -> bool
+  {
+    return enabled_;
+  }
+
+  /**
+   * @public
+   * @brief Returns true if the frames of the reads have to be counted.
+   */
+  auto CountsMessages() const noexcept -> bool
+  {
+    return limits_.messages_per_second_ != kUnlimitedRate ||
+           (peer_buckets_ != nullptr && peer_limits_.messages_per_second_ != kUnlimitedRate);
+  }
+
+  /**
+   * @public
+   * @brief Returns true if the session is parked.
+   */
+  auto Parked() const noexcept -> bool
+  {
+    return waiter_.index != Pacer::Waiter::kNotParked;
+  }
+
+  /**
+   * @public
+   * @brief Returns true if the buckets do not allow a read now; neither books nor parks.
+   */
+  auto Throttled() const -> bool;
+
+  /**
+   * @public
+   * @brief Returns true if the session may read now, otherwise parks it.
+   * @details The parked session is resumed with resume(target) on its
+   *          thread once the buckets allow the read; keep_alive is held
+   *          until then.
+   *
+   * @param[in] read_limit Number of bytes the read may return.
+   * @param[in] executor Executor of the session.
+   * @param[in] resume Callback resuming the session.
+   * @param[in] target Argument of the callback.
+   * @param[in] keep_alive Owner of the session, may be empty if the session outlives the parking otherwise.
+   */
+  auto Admit(
+    std::size_t read_limit,  //
+    const boost::asio::any_io_executor& executor,
+    void (*resume)(void*),
+    void* target,
+    std::shared_ptr<void> keep_alive
+  ) -> bool;
+
+  /**
+   * @public
+   * @brief Charges the buckets with the completed read.
+   *
+   * @param[in] bytes Number of bytes read.
+   * @param[in] messages Number of frames the read completed.
+   */
+  auto Charge(
+    std::size_t bytes,  //
+    std::size_t messages
+  ) -> void;
+
+ private:
+  RateLimits limits_;
+  RateLimits peer_limits_;
+  TokenBuckets buckets_;
+  PeerBuckets* peer_buckets_;
+  std::size_t peer_booked_bytes_;
+  bool enabled_;
+  Pacer* pacer_;
+  Pacer::Waiter waiter_;
+};
+
+}  // namespace tcp
\ No newline at end of file
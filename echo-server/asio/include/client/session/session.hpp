@@ -1,6 +1,15 @@
 #pragma once
 
+#include <array>
 #include <boost/asio.hpp>
+#include <client/framing/codecs.hpp>
+#include <client/memory/handler_memory.hpp>
+#include <client/memory/receive_buffer.hpp>
+#include <client/session/outbound_queue.hpp>
+#include <client/session/rate_limiter.hpp>
+#include <client/session/session_link.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 
 /**
@@ -9,48 +18,281 @@
 namespace tcp
 {
 
+/**
+ * @struct SessionOptions
+ * @brief Tunables of the Session framing and outbound queue.
+ */
+struct SessionOptions
+{
+  /**
+   * @brief Number of queued outbound bytes above which the Session stops reading.
+   * @details Reading is resumed once the queue drains to the half of this value.
+   *          Zero degrades the Session to half-duplex read-then-write mode.
+   */
+  std::size_t high_water_mark{64 * 1024};
+
+  /**
+   * @brief Number of queued outbound bytes from which writes are sent with MSG_ZEROCOPY.
+   * @details Smaller writes use the regular copying send, since pinning the
+   *          pages and reading the completion costs more than the copy.
+   *          Zero disables zero-copy sends.
+   */
+  std::size_t zero_copy_threshold{0};
+
+  /**
+   * @brief Framing of the messages, selects the codec the Session is instantiated with.
+   */
+  Framing framing{Framing::kNewline};
+
+  /**
+   * @brief Largest accepted message (payload of the length-prefixed frames), the size of the fixed-size frames.
+   * @details A message over the limit ends the read side of the Session.
+   */
+  std::size_t max_frame_size{kSlabSize};
+
+  /**
+   * @brief Number of queued outbound bytes the Session collects from readable input before it writes.
+   * @details While a read fills the whole receive buffer more input is
+   *          likely waiting in the socket, so the Session reads it right
+   *          away with nonblocking reads and echoes the frames of several
+   *          reads with one gathered write. The write is started as soon
+   *          as the socket runs dry, so the threshold never delays an echo.
+   *          The threshold is capped by the high-water mark, zero writes
+   *          after every read.
+   */
+  std::size_t flush_threshold{0};
+
+  /**
+   * @brief Disables Nagle's algorithm on the socket (TCP_NODELAY).
+   * @details The Session coalesces the echoed frames itself, so delaying
+   *          the small writes in the kernel only adds latency.
+   */
+  bool no_delay{false};
+
+  /**
+   * @brief Time in microseconds a read on the socket busy polls the device queue before it sleeps, zero disables.
+   * @details Set with SO_BUSY_POLL and SO_PREFER_BUSY_POLL on the acceptors,
+   *          the accepted sockets inherit it. Values above net.core.busy_read
+   *          need CAP_NET_ADMIN.
+   */
+  std::uint32_t busy_poll{0};
+
+  /**
+   * @brief Token buckets of every Session, paced by the bytes and the frames it reads; zero rates are unlimited.
+   */
+  RateLimits rate_limits{kUnlimitedRate, kUnlimitedRate, kDefaultRateBurst};
+
+  /**
+   * @brief Token buckets shared by the sessions of every IPv4 peer address.
+   */
+  RateLimits peer_rate_limits{kUnlimitedRate, kUnlimitedRate, kDefaultRateBurst};
+
+  /**
+   * @brief Number of queued outbound bytes a Session writes per turn of its io_context, zero does not cap the writes.
+   * @details The sessions of an io_context take turns in the order their
+   *          previous writes completed, so a quantum makes them share the
+   *          thread round robin instead of in proportion to their backlog.
+   */
+  std::size_t write_quantum{0};
+
+  /**
+   * @brief Runs the sessions as C++20 coroutines (CoroutineSession) instead of the callback chains of Session.
+   * @details The coroutine sessions do not support zero-copy sends.
+   */
+  bool coroutine{false};
+};
+
 /**
  * @class Session
  * @brief Session provides abstraction of client-server communication.
+ * @details Session is full-duplex: it keeps reading new messages while the
+ *          previously received ones are written back to the peer. Every
+ *          read is framed at once by the codec: all the complete frames it
+ *          carries are moved into the bounded outbound queue as one batch
+ *          and the incomplete tail waits for the next read. The queued
+ *          frames are written with a single gathered write; when the queue
+ *          exceeds the high-water mark reading is paused until the peer
+ *          consumes the echoed data.
+ *
+ *          In the steady state Session does not touch the heap: the
+ *          receive buffer and the outbound queue are built from SlabPool
+ *          slabs and the state of the read/write operations lives in the
+ *          per-session HandlerMemory. Sessions are expected to be created
+ *          with std::allocate_shared() and RecyclingAllocator on the
+ *          thread of their io_context.
+ *
+ *          An idle Session holds no receive buffer: it waits for the
+ *          socket to become readable and takes the buffer only for the
+ *          read (see ReceiveBuffer). The receive buffer and the queued
+ *          outbound bytes are reserved from the memory budget; a Session
+ *          whose data does not fit into the budget is closed.
+ *
+ *          With zero-copy enabled large writes are gathered from the
+ *          outbound queue and sent with MSG_ZEROCOPY; the sent chunks stay
+ *          pinned until the completion is read from the socket error
+ *          queue. A Session with pinned chunks is shut down instead of
+ *          closed, so the completions still arrive. When the kernel reports that it had to copy the data
+ *          anyway (e.g. on loopback) the Session falls back to regular
+ *          sends.
+ *
+ *          A Session over its rate limits does not start the next read:
+ *          it is parked in the Pacer of its thread, which holds a reference
+ *          to it until the token buckets allow the read, and the read
+ *          ahead stops as soon as the buckets run out.
+ *
+ * @tparam Codec Codec splitting the received data into frames (see NewlineCodec).
  */
-class Session final : public std::enable_shared_from_this<Session>
+template<typename Codec>
+class Session final : public std::enable_shared_from_this<Session<Codec>>
 {
  public:
   /**
    * @public
    * @brief Parameterized contructor for Session class.
-   * 
+   *
    * @param[in] socket Socket for communication with peer.
+   * @param[in] options Tunables of the framing and outbound queue.
+   */
+  Session(
+    boost::asio::ip::tcp::socket&& socket,  //
+    const SessionOptions& options
+  );
+
+  /**
+   * @public
+   * @brief Destructor for Session class.
+   * @details Records the closed connection and its duration in the metrics.
    */
-  Session(boost::asio::ip::tcp::socket&& socket);
+  ~Session();
 
  private:
   /**
    * @private
    * @brief Class method that initiates async read operation.
-   * @details After successful read operaation this method
-   *          initiates async write to the peer.
+   * @details After successful read operation this method lets the codec
+   *          find the end of the last complete frame, queues all the
+   *          complete frames at once, reads ahead up to the flush
+   *          threshold, initiates async write if it is not in progress and
+   *          continues reading unless the outbound queue is over the
+   *          high-water mark. A malformed frame ends the read side of the
+   *          session.
    */
   auto AsyncRead() -> void;
 
+  /**
+   * @private
+   * @brief Resumes the read of the Session parked for its rate limits.
+   *
+   * @param[in] session Parked Session.
+   */
+  static auto ResumeRead(void* session) -> void;
+
+  /**
+   * @private
+   * @brief Reads the input of the readable socket into a newly allocated receive buffer.
+   */
+  auto ReadAvailable() -> void;
+
+  /**
+   * @private
+   * @brief Handles the completed read: frames and queues the data, writes it and continues reading.
+   *
+   * @param[in] error_code Result of the read.
+   * @param[in] processed_bytes Number of bytes read.
+   */
+  auto HandleRead(
+    boost::system::error_code error_code,  //
+    std::size_t processed_bytes
+  ) -> void;
+
+  /**
+   * @private
+   * @brief Closes the connection whose data does not fit into the memory budget.
+   */
+  auto Shed() -> void;
+
+  /**
+   * @private
+   * @brief Closes the socket, or only shuts it down while zero-copy sends are incomplete.
+   */
+  auto Close() -> void;
+
+  /**
+   * @private
+   * @brief Frames the received bytes and moves the complete frames into the outbound queue.
+   *
+   * @param[in] processed_bytes Number of bytes read behind the incomplete tail of the receive buffer.
+   * @return False if the receive buffer holds a malformed frame.
+   */
+  auto QueueFrames(std::size_t processed_bytes) -> bool;
+
+  /**
+   * @private
+   * @brief Reads the input that is already waiting in the socket until the flush threshold is reached.
+   *
+   * @param[in] filled Whether the last read filled the free space of the receive buffer.
+   * @return False if the receive buffer holds a malformed frame.
+   */
+  auto ReadAhead(bool filled) -> bool;
+
   /**
    * @private
    * @brief Class method that initiates async write operation.
-   * @details After successful write operation this method
-   *          initiates async read operation to the peer.
+   * @details Writes the chunks of the outbound queue gathered into one
+   *          buffer sequence. After successful write operation this method
+   *          continues with the data queued meanwhile and resumes paused
+   *          reading once the queue is drained below the low-water mark.
    */
   auto AsyncWrite() -> void;
 
+  /**
+   * @private
+   * @brief Sends the front of the outbound queue with MSG_ZEROCOPY.
+   */
+  auto AsyncWriteZeroCopy() -> void;
+
+  /**
+   * @private
+   * @brief Waits for zero-copy completions while some chunks are pinned.
+   */
+  auto AsyncWaitZeroCopyCompletions() -> void;
+
+  /**
+   * @private
+   * @brief Drains the zero-copy completions from the socket error queue.
+   */
+  auto ReadZeroCopyCompletions() -> void;
+
  public:
   /**
    * @public
-   * @brief Starts the half-duplex communication.
+   * @brief Starts the full-duplex communication.
    */
   auto Start() -> void;
 
  private:
+  static constexpr std::size_t kMaxGatheredBuffers{16};
+
   boost::asio::ip::tcp::socket socket_;
-  boost::asio::streambuf buffer_;
+  SessionLink link_;
+  Codec codec_;
+  ReceiveBuffer read_buffer_;
+  std::size_t read_size_;
+  RateLimiter rate_limiter_;
+  OutboundQueue write_queue_;
+  std::array<boost::asio::const_buffer, kMaxGatheredBuffers> gathered_buffers_;
+  HandlerMemory read_handler_memory_;
+  HandlerMemory write_handler_memory_;
+  HandlerMemory completion_handler_memory_;
+  std::size_t high_water_mark_;
+  std::size_t flush_threshold_;
+  std::size_t write_quantum_;
+  std::size_t zero_copy_threshold_;
+  std::uint32_t zero_copy_next_id_;
+  std::uint64_t accepted_at_;
+  bool reading_;
+  bool writing_;
+  bool waiting_completions_;
 };
 
 }  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <chrono>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class SessionLink
+ * @brief Registers the socket of a session in the intrusive list of the sessions of its thread.
+ * @details Every kind of session holds a link for its lifetime, so the
+ *          sessions of a context can be drained from its thread without
+ *          any synchronization. Draining shuts the receive side of the
+ *          sockets down: the sessions still echo the input they have
+ *          received, then read the end of the stream, finish their writes
+ *          and close as after a peer shutdown. Sessions started on a
+ *          drained thread are shut down right away.
+ *
+ *          With the activity tracked (TrackActivity()) a session moves its
+ *          link to the front of the list whenever it reads (Touch()), so
+ *          the link at the back belongs to the session idle for the longest
+ *          time, the first one EvictIdle() closes.
+ */
+class SessionLink final
+{
+ public:
+  /**
+   * @public
+   * @brief Links the socket into the list of the calling thread.
+   *
+   * @param[in] socket Socket of the session, has to outlive the link.
+   */
+  explicit SessionLink(boost::asio::ip::tcp::socket& socket) noexcept;
+
+  SessionLink(const SessionLink&) = delete;
+  auto operator=(const SessionLink&) -> SessionLink& = delete;
+
+  /**
+   * @public
+   * @brief Unlinks the socket.
+   */
+  ~SessionLink();
+
+  /**
+   * @public
+   * @brief Shuts the receive side of every session of the calling thread down, including the ones started later.
+   */
+  static auto DrainThread() -> void;
+
+  /**
+   * @public
+   * @brief Makes Touch() order the links by activity; has to be called before the contexts run.
+   */
+  static auto TrackActivity() noexcept -> void;
+
+  /**
+   * @public
+   * @brief Shuts the session idle for the longest time on the calling thread down.
+   *
+   * @param[in] idle_time Time the session has to be idle for.
+   * @return Whether a session idle for at least idle_time was shut down.
+   */
+  static auto EvictIdle(std::chrono::milliseconds idle_time) -> bool;
+
+  /**
+   * @public
+   * @brief Records that the session made progress, a no-op unless the activity is tracked.
+   */
+  auto Touch() noexcept -> void
+  {
+    if (tracks_activity_)
+    {
+      MoveToFront();
+    }
+  }
+
+ private:
+  /**
+   * @private
+   * @brief Moves the link to the front of the list and stamps it with the current time.
+   */
+  auto MoveToFront() noexcept -> void;
+
+  /**
+   * @private
+   * @brief Removes the link from the list.
+   */
+  auto Unlink() noexcept -> void;
+
+  /**
+   * @private
+   * @brief Inserts the link at the front of the list.
+   */
+  auto LinkFirst() noexcept -> void;
+
+  /**
+   * @private
+   * @brief Shuts the receive side of the socket down.
+   */
+  auto Drain() noexcept -> void;
+
+ private:
+  static thread_local SessionLink* first_;
+  static thread_local SessionLink* last_;
+  static thread_local bool draining_;
+  static bool tracks_activity_;
+
+  boost::asio::ip::tcp::socket& socket_;
+  SessionLink* prev_;
+  SessionLink* next_;
+  std::chrono::steady_clock::time_point active_at_;
+};
+
+}  // namespace tcp
\ No newline at end of file
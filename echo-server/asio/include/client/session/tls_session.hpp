@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <boost/asio.hpp>
+#include <client/memory/receive_buffer.hpp>
+#include <client/session/outbound_queue.hpp>
+#include <client/session/rate_limiter.hpp>
+#include <client/session/session.hpp>
+#include <client/session/session_link.hpp>
+#include <client/tls/tls_stream.hpp>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class TlsSession
+ * @brief Session echoing the peer over a TLS connection the kernel does not encrypt.
+ * @details Used when the kernel TLS did not take over both directions of
+ *          the connection after the handshake (the tls module is not
+ *          loaded, or OpenSSL cannot offload the receiving side of TLS 1.3
+ *          before 3.2). Records are decrypted by OpenSSL; when only the
+ *          sending side is offloaded OpenSSL writes the echoed plaintext
+ *          for the kernel to encrypt.
+ *
+ *          The session is half-duplex: the frames found by the codec in a
+ *          read are written back before the session reads again, so the
+ *          outbound queue never holds more than the decrypted input of one
+ *          round. Input OpenSSL has decrypted already is read ahead up to
+ *          the flush threshold and echoed with the same round of writes.
+ *          An idle session waits for the input without a receive buffer.
+ *
+ *          A session over its rate limits is parked in the Pacer of its
+ *          thread and waits on a timer the pacer cancels once the buckets
+ *          allow the read. With a write quantum the session lets the other
+ *          sessions of its thread run between the quanta it writes.
+ *
+ *          The TlsSession object lives on the frame of the coroutine
+ *          running it, next to the TlsStream and the socket it refers to.
+ *
+ * @tparam Codec Codec splitting the received data into frames (see NewlineCodec).
+ */
+template<typename Codec>
+class TlsSession final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized contructor for TlsSession class.
+   *
+   * @param[in] socket Socket the stream runs on.
+   * @param[in] stream TLS connection with the completed handshake.
+   * @param[in] link Link of the socket in the sessions of the thread.
+   * @param[in] options Tunables of the framing and outbound queue.
+   */
+  TlsSession(
+    boost::asio::ip::tcp::socket& socket,  //
+    TlsStream& stream,
+    SessionLink& link,
+    const SessionOptions& options
+  );
+
+  TlsSession(const TlsSession&) = delete;
+  auto operator=(const TlsSession&) -> TlsSession& = delete;
+
+  /**
+   * @public
+   * @brief Destructor for TlsSession class.
+   * @details Records the closed connection and its duration in the metrics.
+   */
+  ~TlsSession();
+
+  /**
+   * @public
+   * @brief Echoes the peer until it closes the connection or sends a malformed frame.
+   */
+  auto Run() -> boost::asio::awaitable<void>;
+
+ private:
+  /**
+   * @private
+   * @brief Frames the received bytes and moves the complete frames into the outbound queue.
+   *
+   * @param[in] processed_bytes Number of bytes read behind the incomplete tail of the receive buffer.
+   * @return False if the receive buffer holds a malformed frame.
+   */
+  auto QueueFrames(std::size_t processed_bytes) -> bool;
+
+  /**
+   * @private
+   * @brief Resumes the session parked for its rate limits.
+   *
+   * @param[in] session Parked session.
+   */
+  static auto ResumeRead(void* session) -> void;
+
+  /**
+   * @private
+   * @brief Writes the whole outbound queue.
+   *
+   * @return False if the write failed.
+   */
+  auto Flush() -> boost::asio::awaitable<bool>;
+
+  /**
+   * @private
+   * @brief Records the connection whose data does not fit into the memory budget, the caller closes it.
+   */
+  auto Shed() -> void;
+
+ private:
+  static constexpr std::size_t kMaxGatheredBuffers{16};
+
+  TlsStream& stream_;
+  SessionLink& link_;
+  boost::asio::steady_timer signal_;
+  Codec codec_;
+  ReceiveBuffer read_buffer_;
+  std::size_t read_size_;
+  RateLimiter rate_limiter_;
+  OutboundQueue write_queue_;
+  std::array<boost::asio::const_buffer, kMaxGatheredBuffers> gathered_buffers_;
+  std::size_t flush_threshold_;
+  std::size_t write_quantum_;
+  std::uint64_t accepted_at_;
+};
+
+}  // namespace tcp
\ No newline at end of file
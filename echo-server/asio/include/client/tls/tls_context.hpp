@@ -0,0 +1,55 @@
+#pragma once
+
+#include <boost/asio/ssl/context.hpp>
+#include <string>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class TlsContext
+ * @brief Server side TLS configuration shared by all the TLS sessions.
+ * @details Accepts TLS 1.2 and 1.3 with the AEAD ciphers the kernel TLS
+ *          can take over (AES-GCM and ChaCha20-Poly1305) and asks OpenSSL
+ *          to move the record encryption of every connection to the
+ *          kernel once the handshake is done.
+ *
+ *          Returning clients resume their sessions from the single ticket
+ *          issued after every full handshake, so a reconnecting client
+ *          skips the certificate and key exchange. The ticket keys live in
+ *          the context and are shared by all the threads. OpenSSL frees
+ *          the record buffers of idle connections.
+ */
+class TlsContext final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for TlsContext class.
+   * @details Throws boost::system::system_error if the certificate or the key cannot be loaded.
+   *
+   * @param[in] certificate_chain_file PEM file with the server certificate followed by the intermediate ones.
+   * @param[in] private_key_file PEM file with the private key of the certificate.
+   */
+  TlsContext(
+    const std::string& certificate_chain_file,  //
+    const std::string& private_key_file
+  );
+
+  TlsContext(const TlsContext&) = delete;
+  auto operator=(const TlsContext&) -> TlsContext& = delete;
+
+  /**
+   * @public
+   * @brief Returns the OpenSSL context the connections are created from.
+   */
+  auto NativeHandle() noexcept -> SSL_CTX*;
+
+ private:
+  boost::asio::ssl::context context_;
+};
+
+}  // namespace tcp
\ No newline at end of file
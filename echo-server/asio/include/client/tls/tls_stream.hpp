@@ -0,0 +1,131 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <client/tls/tls_context.hpp>
+#include <cstddef>
+#include <openssl/ssl.h>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class TlsStream
+ * @brief Server side TLS connection over a nonblocking socket.
+ * @details OpenSSL reads and writes the socket itself and the stream
+ *          waits for the readiness OpenSSL asks for. Unlike
+ *          boost::asio::ssl::stream, which passes the records through
+ *          memory BIOs, this lets OpenSSL hand the record encryption over
+ *          to the kernel TLS after the handshake. When it did so in both
+ *          directions the socket carries plaintext from then on and the
+ *          stream is no longer needed (see Offloaded()).
+ *
+ *          The stream refers to the socket, which has to outlive it.
+ *          Destroying the stream does not close the socket nor send the
+ *          close_notify alert.
+ */
+class TlsStream final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for TlsStream class.
+   * @details Throws std::bad_alloc if OpenSSL cannot create the connection.
+   *
+   * @param[in] socket Accepted socket, switched to nonblocking mode.
+   * @param[in] context TLS configuration of the server.
+   */
+  TlsStream(
+    boost::asio::ip::tcp::socket& socket,  //
+    TlsContext& context
+  );
+
+  TlsStream(const TlsStream&) = delete;
+  auto operator=(const TlsStream&) -> TlsStream& = delete;
+
+  ~TlsStream();
+
+  /**
+   * @public
+   * @brief Performs the server side of the handshake.
+   *
+   * @param[out] error_code Set if the handshake failed.
+   */
+  auto Handshake(boost::system::error_code& error_code) -> boost::asio::awaitable<void>;
+
+  /**
+   * @public
+   * @brief Reads and decrypts some data.
+   *
+   * @param[in] data Buffer for the decrypted data.
+   * @param[in] size Size of the buffer.
+   * @param[out] error_code Set if the read failed, eof when the peer sent close_notify.
+   * @return Number of bytes read.
+   */
+  auto ReadSome(
+    char* data,  //
+    std::size_t size,
+    boost::system::error_code& error_code
+  ) -> boost::asio::awaitable<std::size_t>;
+
+  /**
+   * @public
+   * @brief Encrypts and writes the whole buffer.
+   *
+   * @param[in] data Data to write.
+   * @param[in] size Size of the data.
+   * @param[out] error_code Set if the write failed.
+   */
+  auto Write(
+    const char* data,  //
+    std::size_t size,
+    boost::system::error_code& error_code
+  ) -> boost::asio::awaitable<void>;
+
+  /**
+   * @public
+   * @brief Waits for the socket to become readable.
+   *
+   * @param[out] error_code Set if the wait failed.
+   */
+  auto WaitReadable(boost::system::error_code& error_code) -> boost::asio::awaitable<void>;
+
+  /**
+   * @public
+   * @brief Returns true if OpenSSL holds received data that has not been read yet.
+   */
+  auto Pending() const noexcept -> bool;
+
+  /**
+   * @public
+   * @brief Returns true if the handshake resumed an earlier session.
+   */
+  auto Resumed() const noexcept -> bool;
+
+  /**
+   * @public
+   * @brief Returns true if the kernel encrypts and decrypts the records and the socket may be used directly.
+   */
+  auto Offloaded() const noexcept -> bool;
+
+ private:
+  /**
+   * @private
+   * @brief Waits for the readiness the failed OpenSSL call asked for.
+   *
+   * @param[in] result Return value of the failed call.
+   * @param[out] error_code Set if the call failed for another reason or the wait failed.
+   */
+  auto Wait(
+    int result,  //
+    boost::system::error_code& error_code
+  ) -> boost::asio::awaitable<void>;
+
+ private:
+  boost::asio::ip::tcp::socket& socket_;
+  SSL* ssl_;
+};
+
+}  // namespace tcp
\ No newline at end of file
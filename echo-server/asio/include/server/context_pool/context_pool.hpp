@@ -0,0 +1,111 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class ContextPool
+ * @brief Pool of single-threaded io_context objects.
+ * @details Every io_context in the pool is driven by exactly one thread,
+ *          so handlers of the sessions bound to the same context never
+ *          run concurrently and need no strands. Optionally every thread
+ *          is pinned to its own CPU.
+ *
+ *          With a spin time the threads do not sleep in the reactor as
+ *          soon as they run out of handlers: they keep polling the context
+ *          and sleep only once no handler has run for the spin time, which
+ *          saves the wakeup latency at the cost of a busy CPU per context.
+ *
+ *          Once drained the contexts are no longer kept running without
+ *          work: every thread exits as soon as its context runs out of
+ *          handlers, and the ones still busy at the deadline are stopped.
+ */
+class ContextPool final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for ContextPool class.
+   *
+   * @param[in] size Number of io_context objects (and threads) in the pool.
+   * @param[in] pin_threads Pin the thread of the i-th context to the i-th CPU.
+   * @param[in] spin_time Time a thread keeps polling its idle context before it sleeps, zero never spins.
+   */
+  ContextPool(
+    std::size_t size,  //
+    bool pin_threads,
+    std::chrono::microseconds spin_time = std::chrono::microseconds::zero()
+  );
+
+  ContextPool(const ContextPool&) = delete;
+  auto operator=(const ContextPool&) -> ContextPool& = delete;
+
+  /**
+   * @public
+   * @brief Returns the next context in round-robin order.
+   */
+  auto NextContext() -> boost::asio::io_context&;
+
+  /**
+   * @public
+   * @brief Returns the context with the specified index.
+   *
+   * @param[in] index Index of the context in range [0, Size()).
+   */
+  auto Context(std::size_t index) -> boost::asio::io_context&;
+
+  /**
+   * @public
+   * @brief Returns the number of contexts in the pool.
+   */
+  auto Size() const noexcept -> std::size_t;
+
+  /**
+   * @public
+   * @brief Runs every context on its own thread and blocks until all of them are stopped.
+   */
+  auto Run() -> void;
+
+  /**
+   * @public
+   * @brief Stops all the contexts in the pool.
+   */
+  auto Stop() -> void;
+
+  /**
+   * @public
+   * @brief Lets the contexts finish their work and stops the ones still running after the timeout.
+   *
+   * @param[in] timeout Time the contexts get to run out of work.
+   */
+  auto Drain(std::chrono::milliseconds timeout) -> void;
+
+ private:
+  using WorkGuard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+  std::vector<std::unique_ptr<boost::asio::io_context>> contexts_;
+  std::vector<WorkGuard> work_guards_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable threads_finished_;
+  std::size_t running_threads_;
+  bool draining_;
+  std::chrono::steady_clock::time_point drain_deadline_;
+  std::size_t next_context_;
+  bool pin_threads_;
+  std::chrono::microseconds spin_time_;
+};
+
+}  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @class HotRestart
+ * @brief Passes the listening sockets from the running server to its successor over a Unix control socket.
+ * @details A server started with the control path of a running one takes
+ *          its listeners over before it binds anything (TakeOver()), starts
+ *          accepting on them and confirms the takeover (Listen()). The
+ *          predecessor learns that it has been replaced and drains, while
+ *          the successor listens on the control path for the next restart.
+ *          The listening sockets stay open all along, so no connection is
+ *          refused during the restart (see common/restart/restart.h).
+ *
+ *          The control socket is served on the context passed to the
+ *          constructor, every call has to be made on its thread.
+ */
+class HotRestart final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for HotRestart class.
+   *
+   * @param[in] context Context serving the control socket.
+   * @param[in] path Path of the Unix control socket.
+   */
+  HotRestart(
+    boost::asio::io_context& context,  //
+    std::string path
+  );
+
+  HotRestart(const HotRestart&) = delete;
+  auto operator=(const HotRestart&) -> HotRestart& = delete;
+
+  /**
+   * @public
+   * @brief Destructor for HotRestart class.
+   * @details Drops the connection to a predecessor the takeover was not confirmed to.
+   */
+  ~HotRestart();
+
+  /**
+   * @public
+   * @brief Receives the listening sockets of the server running on the control path.
+   * @details Throws boost::system::system_error if the handover fails.
+   *
+   * @return Native handles of the listeners, owned by the caller; empty if no server runs on the path.
+   */
+  auto TakeOver() -> std::vector<int>;
+
+  /**
+   * @public
+   * @brief Confirms the takeover to the predecessor and waits for a successor on the control path.
+   * @details Throws boost::system::system_error if the control socket cannot be created.
+   *
+   * @param[in] listeners Native handles of the listening sockets to pass to the successor.
+   * @param[in] on_taken_over Called on the context once the successor has confirmed the takeover.
+   */
+  auto Listen(
+    std::vector<int> listeners,  //
+    std::function<void()> on_taken_over
+  ) -> void;
+
+  /**
+   * @public
+   * @brief Stops waiting for a successor.
+   *
+   * @param[in] taken_over Whether a successor has replaced the control path, otherwise it is removed.
+   */
+  auto Close(bool taken_over) -> void;
+
+ private:
+  /**
+   * @private
+   * @brief Waits for a successor connecting to the control socket and hands the listeners over to it.
+   */
+  auto AsyncAcceptSuccessor() -> void;
+
+  /**
+   * @private
+   * @brief Waits for the confirmation of the successor.
+   */
+  auto AsyncWaitTakeover() -> void;
+
+ private:
+  std::string path_;
+  int predecessor_;
+  boost::asio::posix::stream_descriptor control_socket_;
+  boost::asio::posix::stream_descriptor successor_;
+  std::vector<int> listeners_;
+  std::function<void()> on_taken_over_;
+};
+
+}  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <client/memory/handler_memory.hpp>
+
+/**
+ * @namespace tcp
+ */
+namespace tcp
+{
+
+/**
+ * @brief Interval between two probes of the lag of a context.
+ */
+inline constexpr std::chrono::milliseconds kLoadProbeInterval{10};
+
+/**
+ * @class LoadMonitor
+ * @brief Measures how far the thread of a context falls behind its handlers.
+ * @details The monitor keeps a timer armed kLoadProbeInterval ahead on the
+ *          context. The lag of a probe is how late its handler runs past
+ *          the expiry: the time every handler queued at that moment waited
+ *          for the thread. The lag is smoothed over the probes, and the
+ *          context counts as overloaded while the smoothed lag is at least
+ *          the maximum. An idle context keeps probing, so its lag decays
+ *          once it catches up.
+ *
+ *          Start() and Stop() have to be called on the thread of the
+ *          context; Overloaded() is safe to call from any thread.
+ */
+class LoadMonitor final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for LoadMonitor class.
+   *
+   * @param[in] context Context to monitor.
+   * @param[in] max_loop_lag Lag from which the context is overloaded.
+   */
+  LoadMonitor(
+    boost::asio::io_context& context,  //
+    std::chrono::milliseconds max_loop_lag
+  );
+
+  LoadMonitor(const LoadMonitor&) = delete;
+  auto operator=(const LoadMonitor&) -> LoadMonitor& = delete;
+
+  /**
+   * @public
+   * @brief Starts probing the context.
+   */
+  auto Start() -> void;
+
+  /**
+   * @public
+   * @brief Stops probing, so the drained context can run out of work.
+   */
+  auto Stop() -> void;
+
+  /**
+   * @public
+   * @brief Returns true if the context is overloaded.
+   */
+  auto Overloaded() const noexcept -> bool
+  {
+    return overloaded_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  /**
+   * @private
+   * @brief Arms the timer of the next probe.
+   */
+  auto AsyncProbe() -> void;
+
+ private:
+  boost::asio::steady_timer timer_;
+  std::chrono::microseconds max_loop_lag_;
+  std::chrono::microseconds loop_lag_;
+  std::atomic<bool> overloaded_;
+  bool stopped_;
+  HandlerMemory handler_memory_;
+};
+
+}  // namespace tcp
\ No newline at end of file
@@ -1,7 +1,16 @@
 #pragma once
 
+#include <atomic>
 #include <boost/asio.hpp>
-#include <optional>
+#include <chrono>
+#include <client/memory/handler_memory.hpp>
+#include <client/session/session.hpp>
+#include <client/tls/tls_context.hpp>
+#include <memory>
+#include <server/context_pool/context_pool.hpp>
+#include <server/load_monitor/load_monitor.hpp>
+#include <span>
+#include <vector>
 
 /**
  * @namespace tcp
@@ -9,14 +18,108 @@
 namespace tcp
 {
 
+/**
+ * @enum AcceptMode
+ * @brief Strategy that Server uses to spread connections over the ContextPool.
+ */
+enum class AcceptMode
+{
+  kDistribute,  ///< Single acceptor, accepted sockets are assigned round-robin to the contexts.
+  kReusePort    ///< One SO_REUSEPORT acceptor per context, the kernel balances connections.
+};
+
+/**
+ * @struct ListenerOptions
+ * @brief Socket options of the acceptors.
+ */
+struct ListenerOptions
+{
+  /**
+   * @brief Length of the queue of pending connections of every acceptor.
+   */
+  int backlog{boost::asio::socket_base::max_listen_connections};
+
+  /**
+   * @brief SO_RCVBUF and SO_SNDBUF of the acceptors in bytes, zero keeps the kernel autotuning.
+   * @details The accepted sockets inherit the sizes. A fixed size turns the
+   *          autotuning of that buffer off for the connection.
+   */
+  int receive_buffer_size{0};
+  int send_buffer_size{0};
+
+  /**
+   * @brief Seconds a connection may wait for its first data before it is accepted anyway (TCP_DEFER_ACCEPT).
+   * @details Zero accepts the connections as soon as the handshake completes.
+   */
+  int defer_accept{0};
+};
+
+/**
+ * @enum OverloadAction
+ * @brief What Server does with the new connections while the contexts are overloaded.
+ */
+enum class OverloadAction
+{
+  kPause,     ///< The listeners stop accepting, the connections wait in the backlogs.
+  kReject,    ///< The connections are accepted and reset at once.
+  kCloseIdle  ///< The connection idle for the longest time makes room, the new one is reset if none is idle.
+};
+
+/**
+ * @struct OverloadOptions
+ * @brief Admission control of the new connections.
+ */
+struct OverloadOptions
+{
+  /**
+   * @brief Lag of a context from which it is overloaded (see LoadMonitor), zero turns the admission control off.
+   */
+  std::chrono::milliseconds max_loop_lag{0};
+
+  OverloadAction action{OverloadAction::kPause};
+
+  /**
+   * @brief Time a connection has to be idle for to be closed in favor of a new one.
+   */
+  std::chrono::milliseconds evict_idle{1000};
+};
+
+/**
+ * @brief Time the listener waits before accepting again after running out of descriptors.
+ */
+inline constexpr std::chrono::milliseconds kAcceptRetryDelay{100};
+
 /**
  * @class Server
  * @brief Class that provides abstraction over network communication.
  * @details Server uses tcp sockets for communication. It initializes
- *          acceptor on <localhost>:<10000> and listens for new connections.
+ *          acceptor on the configured endpoint and listens for new
+ *          connections. A failed accept does not stop the acceptor: when
+ *          the process runs out of descriptors the listener backs off for
+ *          kAcceptRetryDelay before it accepts again.
  *          It uses nonblocking async read/write implementation of Session
  *          class to abstract low level I/O operations. Server echoes all
- *          the messages back to the peer.
+ *          the messages back to the peer. Sessions are spread over the
+ *          contexts of the ContextPool according to the AcceptMode.
+ *
+ *          With a TlsContext every session starts with the TLS handshake.
+ *          When the kernel took the encryption over in both directions the
+ *          socket is passed to the plaintext session of the configured
+ *          kind, otherwise the connection is served by TlsSession.
+ *
+ *          Stop() closes the acceptors and drains the sessions (see
+ *          SessionLink). The acceptors can be passed to another process on
+ *          a restart and adopted from the listeners of the previous one, so
+ *          the listening sockets are never closed in between.
+ *
+ *          With the admission control on every context has a LoadMonitor.
+ *          In the distributing mode the connections skip the overloaded
+ *          contexts; once the context of a connection is overloaded anyway
+ *          the OverloadAction applies. A paused listener checks the load
+ *          again every kLoadProbeInterval.
+ *
+ *          The session options can be replaced while the server runs
+ *          (Reconfigure()); every session keeps the options it started with.
  */
 class Server final
 {
@@ -24,25 +127,187 @@ class Server final
   /**
    * @public
    * @brief Parameterized constructor for Server class.
-   * 
-   * @param[in] context Context to use for I/O operations.
-   * @param[in] port Port that server will use for binding.
+   *
+   * @param[in] pool Pool of contexts to use for I/O operations.
+   * @param[in] endpoint Address and port that server will use for binding.
+   * @param[in] listener_options Socket options of the acceptors.
+   * @param[in] overload_options Admission control of the new connections.
+   * @param[in] mode Strategy of connections distribution over the contexts.
+   * @param[in] session_options Options of every accepted Session.
+   * @param[in] tls_context TLS configuration of the sessions, null for plaintext sessions.
+   * @param[in] inherited_listeners Listening sockets of the previous server, one per acceptor; the server owns
+   *                                them. Sockets that do not match the endpoint and the mode are closed and the
+   *                                acceptors are bound anew.
    */
   Server(
-    boost::asio::io_context& context,  //
-    boost::asio::ip::port_type port
+    ContextPool& pool,  //
+    const boost::asio::ip::tcp::endpoint& endpoint,
+    const ListenerOptions& listener_options,
+    const OverloadOptions& overload_options,
+    AcceptMode mode,
+    const SessionOptions& session_options,
+    TlsContext* tls_context = nullptr,
+    std::span<const int> inherited_listeners = {}
   );
 
   /**
    * @public
-   * @brief Starts the async accept operation.
+   * @brief Starts the async accept operation on every acceptor and the load monitors of the contexts.
    */
   auto AsyncAccept() -> void;
 
+  /**
+   * @public
+   * @brief Closes the acceptors, stops the load monitors and drains the sessions of every context.
+   * @details The acceptors are closed and the sessions drained on the
+   *          threads of their contexts, the call returns at once.
+   */
+  auto Stop() -> void;
+
+  /**
+   * @public
+   * @brief Returns the native handles of the acceptors to pass them to the next server.
+   */
+  auto NativeListeners() -> std::vector<int>;
+
+  /**
+   * @public
+   * @brief Replaces the options of the sessions accepted from now on; safe to call from any thread.
+   * @details The busy polling is set on the acceptors and keeps its start value.
+   *
+   * @param[in] session_options New options of the sessions.
+   */
+  auto Reconfigure(const SessionOptions& session_options) -> void;
+
+ private:
+  /**
+   * @private
+   * @struct Listener
+   * @brief Acceptor together with the memory of its completion handlers.
+   */
+  struct Listener
+  {
+    Listener(
+      boost::asio::io_context& context,  //
+      boost::asio::ip::tcp::acceptor&& acceptor
+    );
+
+    boost::asio::io_context& context_;
+    boost::asio::ip::tcp::acceptor acceptor_;
+    boost::asio::steady_timer retry_timer_;
+    HandlerMemory accept_handler_memory_;
+    HandlerMemory handoff_handler_memory_;
+    bool paused_;
+  };
+
+  /**
+   * @private
+   * @brief Starts the async accept operation on the specified listener.
+   *
+   * @param[in] listener Listener to wait for the new connection on.
+   */
+  auto AsyncAccept(Listener& listener) -> void;
+
+  /**
+   * @private
+   * @brief Resumes accepting on the listener after the delay.
+   *
+   * @param[in] listener Listener that ran out of descriptors or is paused.
+   * @param[in] delay Time to wait before accepting again.
+   */
+  auto AsyncRetryAccept(
+    Listener& listener,  //
+    std::chrono::milliseconds delay
+  ) -> void;
+
+  /**
+   * @private
+   * @brief Returns the context the next connection of the listener goes to, null if all of them are overloaded.
+   *
+   * @param[in] listener Listener to accept the connection on.
+   */
+  auto PickContext(Listener& listener) -> boost::asio::io_context*;
+
+  /**
+   * @private
+   * @brief Returns true if the context is overloaded; false with the admission control off.
+   *
+   * @param[in] context Context of the pool.
+   */
+  auto Overloaded(const boost::asio::io_context& context) const -> bool;
+
+  /**
+   * @private
+   * @brief Starts the session unless its context is overloaded and no idle session makes room for it.
+   * @details Called on the thread of the context, where the idle sessions are.
+   *
+   * @param[in] context Context of the session.
+   * @param[in] socket Accepted socket.
+   */
+  auto AdmitSession(
+    const boost::asio::io_context& context,  //
+    boost::asio::ip::tcp::socket&& socket
+  ) -> void;
+
+  /**
+   * @private
+   * @brief Creates and starts Session with the codec of the configured framing on the calling thread.
+   *
+   * @param[in] socket Accepted socket.
+   */
+  auto StartSession(boost::asio::ip::tcp::socket&& socket) -> void;
+
+  /**
+   * @private
+   * @brief Creates and starts Session with the specified codec on the calling thread.
+   *
+   * @tparam Codec Codec of the Session.
+   * @param[in] socket Accepted socket.
+   * @param[in] options Options of the Session.
+   */
+  template<typename Codec>
+  auto StartSession(
+    boost::asio::ip::tcp::socket&& socket,  //
+    const SessionOptions& options
+  ) -> void;
+
+  /**
+   * @private
+   * @brief Creates and starts the plaintext Session with the specified codec on the calling thread.
+   *
+   * @tparam Codec Codec of the Session.
+   * @param[in] socket Accepted socket.
+   * @param[in] options Options of the Session.
+   */
+  template<typename Codec>
+  auto StartPlainSession(
+    boost::asio::ip::tcp::socket&& socket,  //
+    const SessionOptions& options
+  ) -> void;
+
+  /**
+   * @private
+   * @brief Performs the TLS handshake and serves the connection with the specified codec.
+   *
+   * @tparam Codec Codec of the Session.
+   * @param[in] socket Accepted socket.
+   * @param[in] options Options of the Session.
+   */
+  template<typename Codec>
+  auto RunTlsSession(
+    boost::asio::ip::tcp::socket socket,  //
+    SessionOptions options
+  ) -> boost::asio::awaitable<void>;
+
  private:
-  boost::asio::io_context& context_;
-  boost::asio::ip::tcp::acceptor acceptor_;
-  std::optional<boost::asio::ip::tcp::socket> socket_;
+  ContextPool& pool_;
+  AcceptMode mode_;
+  std::uint32_t busy_poll_;
+  OverloadOptions overload_options_;
+  std::atomic<std::shared_ptr<const SessionOptions>> session_options_;
+  TlsContext* tls_context_;
+  std::vector<std::unique_ptr<Listener>> listeners_;
+  std::vector<std::unique_ptr<LoadMonitor>> monitors_;
 };
 
 }  // namespace tcp
\ No newline at end of file
@@ -1,17 +1,549 @@
+#include <algorithm>
+#include <array>
 #include <boost/asio.hpp>
 #include <fmt/core.h>
 #include <chrono>
+#include <common/config/config.h>
+#include <common/logger/logger.h>
+#include <common/memory/memory_budget.h>
+#include <common/metrics/metrics.h>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <csignal>
 #include <optional>
 #include <server/server.hpp>
+#include <server/context_pool/context_pool.hpp>
+#include <server/hot_restart/hot_restart.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace net = boost::asio;
 
 namespace
 {
 
-constexpr int kConcurrencyHint{1};
+constexpr std::string_view kPortFlag{"--port="};
+constexpr std::string_view kThreadsFlag{"--threads="};
+constexpr std::string_view kPinThreadsFlag{"--pin-threads"};
+constexpr std::string_view kReusePortFlag{"--reuse-port"};
+constexpr std::string_view kHalfDuplexFlag{"--half-duplex"};
+constexpr std::string_view kZeroCopyFlag{"--zero-copy"};
+constexpr std::string_view kMetricsPortFlag{"--metrics-port="};
+constexpr std::string_view kMetricsAddressFlag{"--metrics-address="};
+constexpr std::string_view kFramingFlag{"--framing="};
+constexpr std::string_view kMaxFrameSizeFlag{"--max-frame-size="};
+constexpr std::string_view kFlushThresholdFlag{"--flush-threshold="};
+constexpr std::string_view kNoDelayFlag{"--no-delay"};
+constexpr std::string_view kCoroutinesFlag{"--coroutines"};
+constexpr std::string_view kAddressFlag{"--address="};
+constexpr std::string_view kBacklogFlag{"--backlog="};
+constexpr std::string_view kReceiveBufferFlag{"--rcvbuf="};
+constexpr std::string_view kSendBufferFlag{"--sndbuf="};
+constexpr std::string_view kDeferAcceptFlag{"--defer-accept="};
+constexpr std::string_view kMemoryBudgetFlag{"--memory-budget="};
+constexpr std::string_view kBusyPollFlag{"--busy-poll="};
+constexpr std::string_view kTlsCertificateFlag{"--tls-cert="};
+constexpr std::string_view kTlsKeyFlag{"--tls-key="};
+constexpr std::string_view kRestartPathFlag{"--restart-path="};
+constexpr std::string_view kDrainTimeoutFlag{"--drain-timeout="};
+constexpr std::string_view kWriteQuantumFlag{"--write-quantum="};
+constexpr std::string_view kRateBytesFlag{"--rate-bytes="};
+constexpr std::string_view kRateMessagesFlag{"--rate-messages="};
+constexpr std::string_view kPeerRateBytesFlag{"--peer-rate-bytes="};
+constexpr std::string_view kPeerRateMessagesFlag{"--peer-rate-messages="};
+constexpr std::string_view kRateBurstFlag{"--rate-burst="};
+constexpr std::string_view kMaxLoopLagFlag{"--max-loop-lag="};
+constexpr std::string_view kOverloadActionFlag{"--overload-action="};
+constexpr std::string_view kEvictIdleFlag{"--evict-idle="};
+constexpr std::string_view kFlagPrefix{"--"};
+constexpr std::array<std::pair<std::string_view, tcp::Framing>, 5> kFramings{
+  {{"newline", tcp::Framing::kNewline},
+   {"u16", tcp::Framing::kU16Length},
+   {"u32", tcp::Framing::kU32Length},
+   {"varint", tcp::Framing::kVarintLength},
+   {"fixed", tcp::Framing::kFixedSize}}
+};
+constexpr std::array<std::pair<std::string_view, tcp::OverloadAction>, 3> kOverloadActions{
+  {{"pause", tcp::OverloadAction::kPause},
+   {"reject", tcp::OverloadAction::kReject},
+   {"close-idle", tcp::OverloadAction::kCloseIdle}}
+};
+constexpr std::size_t kZeroCopyThreshold{16 * 1024};
+constexpr std::chrono::milliseconds kDefaultDrainTimeout{10000};
+constexpr std::uint64_t kNanosecondsPerMillisecond{1000000};
+constexpr std::uint64_t kMaxRateBurst{std::numeric_limits<std::uint64_t>::max() / kNanosecondsPerMillisecond};
+
+/**
+ * @brief Everything the command line and the configuration file set.
+ */
+struct Settings
+{
+  net::ip::port_type port{0};
+  std::size_t threads_count{std::max(std::thread::hardware_concurrency(), 1U)};
+  bool pin_threads{false};
+  net::ip::address_v4 address{net::ip::address_v4::any()};
+  tcp::ListenerOptions listener_options;
+  tcp::OverloadOptions overload_options;
+  std::uint16_t metrics_port{0};
+  net::ip::address_v4 metrics_address{net::ip::address_v4::loopback()};
+  std::uint64_t memory_budget{kUnlimitedMemoryBudget};
+  tcp::AcceptMode accept_mode{tcp::AcceptMode::kDistribute};
+  tcp::SessionOptions session_options;
+  std::string tls_certificate_file;
+  std::string tls_key_file;
+  std::string restart_path;
+  std::chrono::milliseconds drain_timeout{kDefaultDrainTimeout};
+};
+
+auto PrintUsage(const char* program) -> void
+{
+  fmt::print(
+    stderr,
+    "Usage: {} <port> [threads] [{}PATH] [{}PORT] [{}N] [{}ADDRESS] [{}N] [{}BYTES] [{}BYTES] [{}SEC] [{}] [{}] "
+    "[{}] [{}] [{}PORT] [{}ADDRESS] [{}newline|u16|u32|varint|fixed] [{}BYTES] [{}BYTES] [{}] [{}] [{}BYTES] [{}USEC] "
+    "[{}PEM {}PEM] [{}PATH] [{}MS] [{}BYTES] [{}N] [{}N] [{}N] [{}N] [{}MS] [{}MS] [{}pause|reject|close-idle] "
+    "[{}MS]\n",
+    program,
+    kConfigFlag,
+    kPortFlag,
+    kThreadsFlag,
+    kAddressFlag,
+    kBacklogFlag,
+    kReceiveBufferFlag,
+    kSendBufferFlag,
+    kDeferAcceptFlag,
+    kPinThreadsFlag,
+    kReusePortFlag,
+    kHalfDuplexFlag,
+    kZeroCopyFlag,
+    kMetricsPortFlag,
+    kMetricsAddressFlag,
+    kFramingFlag,
+    kMaxFrameSizeFlag,
+    kFlushThresholdFlag,
+    kNoDelayFlag,
+    kCoroutinesFlag,
+    kMemoryBudgetFlag,
+    kBusyPollFlag,
+    kTlsCertificateFlag,
+    kTlsKeyFlag,
+    kRestartPathFlag,
+    kDrainTimeoutFlag,
+    kWriteQuantumFlag,
+    kRateBytesFlag,
+    kRateMessagesFlag,
+    kPeerRateBytesFlag,
+    kPeerRateMessagesFlag,
+    kRateBurstFlag,
+    kMaxLoopLagFlag,
+    kOverloadActionFlag,
+    kEvictIdleFlag
+  );
+}
+
+/**
+ * @brief Parses the numeric value of an argument with ParseConfigNumber.
+ * @details Prints the argument to stderr unless the value is a decimal number up to the maximum.
+ *
+ * @param[in] argument Argument holding the value.
+ * @param[in] prefix_size Size of the flag in front of the value.
+ * @param[out] number Parsed number, left alone on failure.
+ * @param[in] max Largest valid value.
+ * @return Whether the value is valid.
+ */
+template<typename Number>
+auto ParseNumber(
+  std::string_view argument,  //
+  std::size_t prefix_size,
+  Number& number,
+  Number max = std::numeric_limits<Number>::max()
+) -> bool
+{
+  std::uint64_t parsed{0};
+  if (ParseConfigNumber(argument.data() + prefix_size, static_cast<std::uint64_t>(max), &parsed) ==
+      kConfigNumberInvalid)
+  {
+    fmt::print(stderr, "Invalid value: {}\n", argument);
+    return false;
+  }
+  number = static_cast<Number>(parsed);
+  return true;
+}
+
+/**
+ * @brief Parses a duration in milliseconds, see ParseNumber().
+ */
+auto ParseMilliseconds(
+  std::string_view argument,  //
+  std::size_t prefix_size,
+  std::chrono::milliseconds& duration
+) -> bool
+{
+  std::chrono::milliseconds::rep count{0};
+  if (!ParseNumber(argument, prefix_size, count))
+  {
+    return false;
+  }
+  duration = std::chrono::milliseconds{count};
+  return true;
+}
+
+/**
+ * @brief Parses the arguments over the defaults: the port and the threads count either positional or as flags.
+ * @details Prints the reason to stderr on an unknown flag or an invalid combination of settings.
+ *
+ * @param[in] arguments Arguments without the program name.
+ * @param[out] settings Parsed settings.
+ * @return Whether the settings are valid.
+ */
+auto ParseSettings(
+  std::span<char* const> arguments,  //
+  Settings& settings
+) -> bool
+{
+  std::size_t positional_arguments{0};
+  for (const char* raw_argument : arguments)
+  {
+    std::string_view argument{raw_argument};
+    if (!argument.starts_with(kFlagPrefix))
+    {
+      if (positional_arguments == 0)
+      {
+        if (!ParseNumber(argument, 0, settings.port))
+        {
+          return false;
+        }
+      }
+      else if (positional_arguments == 1)
+      {
+        if (!ParseNumber(argument, 0, settings.threads_count))
+        {
+          return false;
+        }
+      }
+      else
+      {
+        fmt::print(stderr, "Unexpected argument: {}\n", argument);
+        return false;
+      }
+      ++positional_arguments;
+    }
+    else if (argument.starts_with(kPortFlag))
+    {
+      if (!ParseNumber(argument, kPortFlag.size(), settings.port))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kThreadsFlag))
+    {
+      if (!ParseNumber(argument, kThreadsFlag.size(), settings.threads_count))
+      {
+        return false;
+      }
+    }
+    else if (argument == kPinThreadsFlag)
+    {
+      settings.pin_threads = true;
+    }
+    else if (argument == kReusePortFlag)
+    {
+      settings.accept_mode = tcp::AcceptMode::kReusePort;
+    }
+    else if (argument == kHalfDuplexFlag)
+    {
+      settings.session_options.high_water_mark = 0;
+    }
+    else if (argument == kZeroCopyFlag)
+    {
+      settings.session_options.zero_copy_threshold = kZeroCopyThreshold;
+    }
+    else if (argument.starts_with(kFramingFlag))
+    {
+      const std::string_view name{argument.substr(kFramingFlag.size())};
+      const auto framing{std::ranges::find_if(
+        kFramings,
+        [name](const std::pair<std::string_view, tcp::Framing>& entry) -> bool
+        {
+          return entry.first == name;
+        }
+      )};
+      if (framing == kFramings.end())
+      {
+        fmt::print(stderr, "Unknown framing: {}\n", name);
+        return false;
+      }
+      settings.session_options.framing = framing->second;
+    }
+    else if (argument.starts_with(kMaxFrameSizeFlag))
+    {
+      if (!ParseNumber(argument, kMaxFrameSizeFlag.size(), settings.session_options.max_frame_size))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kFlushThresholdFlag))
+    {
+      if (!ParseNumber(argument, kFlushThresholdFlag.size(), settings.session_options.flush_threshold))
+      {
+        return false;
+      }
+    }
+    else if (argument == kNoDelayFlag)
+    {
+      settings.session_options.no_delay = true;
+    }
+    else if (argument == kCoroutinesFlag)
+    {
+      settings.session_options.coroutine = true;
+    }
+    else if (argument.starts_with(kAddressFlag))
+    {
+      boost::system::error_code error_code;
+      settings.address = net::ip::make_address_v4(raw_argument + kAddressFlag.size(), error_code);
+      if (error_code)
+      {
+        fmt::print(stderr, "Invalid address: {}\n", argument.substr(kAddressFlag.size()));
+        return false;
+      }
+    }
+    else if (argument.starts_with(kBacklogFlag))
+    {
+      if (!ParseNumber(argument, kBacklogFlag.size(), settings.listener_options.backlog))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kReceiveBufferFlag))
+    {
+      if (!ParseNumber(argument, kReceiveBufferFlag.size(), settings.listener_options.receive_buffer_size))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kSendBufferFlag))
+    {
+      if (!ParseNumber(argument, kSendBufferFlag.size(), settings.listener_options.send_buffer_size))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kDeferAcceptFlag))
+    {
+      if (!ParseNumber(argument, kDeferAcceptFlag.size(), settings.listener_options.defer_accept))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kMemoryBudgetFlag))
+    {
+      if (!ParseNumber(argument, kMemoryBudgetFlag.size(), settings.memory_budget))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kBusyPollFlag))
+    {
+      if (!ParseNumber(argument, kBusyPollFlag.size(), settings.session_options.busy_poll))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kTlsCertificateFlag))
+    {
+      settings.tls_certificate_file = argument.substr(kTlsCertificateFlag.size());
+    }
+    else if (argument.starts_with(kTlsKeyFlag))
+    {
+      settings.tls_key_file = argument.substr(kTlsKeyFlag.size());
+    }
+    else if (argument.starts_with(kRestartPathFlag))
+    {
+      settings.restart_path = argument.substr(kRestartPathFlag.size());
+    }
+    else if (argument.starts_with(kDrainTimeoutFlag))
+    {
+      if (!ParseMilliseconds(argument, kDrainTimeoutFlag.size(), settings.drain_timeout))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kWriteQuantumFlag))
+    {
+      if (!ParseNumber(argument, kWriteQuantumFlag.size(), settings.session_options.write_quantum))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kRateBytesFlag))
+    {
+      if (!ParseNumber(argument, kRateBytesFlag.size(), settings.session_options.rate_limits.bytes_per_second_))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kRateMessagesFlag))
+    {
+      if (!ParseNumber(argument, kRateMessagesFlag.size(), settings.session_options.rate_limits.messages_per_second_))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kPeerRateBytesFlag))
+    {
+      RateLimits& peer_rate_limits{settings.session_options.peer_rate_limits};
+      if (!ParseNumber(argument, kPeerRateBytesFlag.size(), peer_rate_limits.bytes_per_second_))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kPeerRateMessagesFlag))
+    {
+      RateLimits& peer_rate_limits{settings.session_options.peer_rate_limits};
+      if (!ParseNumber(argument, kPeerRateMessagesFlag.size(), peer_rate_limits.messages_per_second_))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kRateBurstFlag))
+    {
+      std::uint64_t burst_ms{0};
+      if (!ParseNumber(argument, kRateBurstFlag.size(), burst_ms, kMaxRateBurst))
+      {
+        return false;
+      }
+      const std::uint64_t burst_ns{burst_ms * kNanosecondsPerMillisecond};
+      settings.session_options.rate_limits.burst_ns_ = burst_ns;
+      settings.session_options.peer_rate_limits.burst_ns_ = burst_ns;
+    }
+    else if (argument.starts_with(kMaxLoopLagFlag))
+    {
+      if (!ParseMilliseconds(argument, kMaxLoopLagFlag.size(), settings.overload_options.max_loop_lag))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kOverloadActionFlag))
+    {
+      const std::string_view name{argument.substr(kOverloadActionFlag.size())};
+      const auto action{std::ranges::find_if(
+        kOverloadActions,
+        [name](const std::pair<std::string_view, tcp::OverloadAction>& entry) -> bool
+        {
+          return entry.first == name;
+        }
+      )};
+      if (action == kOverloadActions.end())
+      {
+        fmt::print(stderr, "Unknown overload action: {}\n", name);
+        return false;
+      }
+      settings.overload_options.action = action->second;
+    }
+    else if (argument.starts_with(kEvictIdleFlag))
+    {
+      if (!ParseMilliseconds(argument, kEvictIdleFlag.size(), settings.overload_options.evict_idle))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kMetricsPortFlag))
+    {
+      if (!ParseNumber(argument, kMetricsPortFlag.size(), settings.metrics_port))
+      {
+        return false;
+      }
+    }
+    else if (argument.starts_with(kMetricsAddressFlag))
+    {
+      boost::system::error_code error_code;
+      settings.metrics_address = net::ip::make_address_v4(raw_argument + kMetricsAddressFlag.size(), error_code);
+      if (error_code)
+      {
+        fmt::print(stderr, "Invalid address: {}\n", argument.substr(kMetricsAddressFlag.size()));
+        return false;
+      }
+    }
+    else
+    {
+      fmt::print(stderr, "Unknown flag: {}\n", argument);
+      return false;
+    }
+  }
+
+  if (settings.port == 0)
+  {
+    fmt::print(stderr, "The port is not set\n");
+    return false;
+  }
+  if (settings.threads_count == 0)
+  {
+    settings.threads_count = std::max(std::thread::hardware_concurrency(), 1U);
+  }
+  if (settings.listener_options.receive_buffer_size < 0 || settings.listener_options.send_buffer_size < 0 ||
+      settings.listener_options.defer_accept < 0)
+  {
+    fmt::print(stderr, "Buffer sizes and the defer accept time cannot be negative\n");
+    return false;
+  }
+  if (settings.session_options.coroutine && settings.session_options.zero_copy_threshold != 0)
+  {
+    fmt::print(stderr, "{} does not support {}\n", kCoroutinesFlag, kZeroCopyFlag);
+    return false;
+  }
+  if (settings.tls_certificate_file.empty() != settings.tls_key_file.empty())
+  {
+    fmt::print(stderr, "{} and {} go together\n", kTlsCertificateFlag, kTlsKeyFlag);
+    return false;
+  }
+  // The kernel TLS does not take MSG_ZEROCOPY sends.
+  if (!settings.tls_certificate_file.empty() && settings.session_options.zero_copy_threshold != 0)
+  {
+    fmt::print(stderr, "TLS does not support {}\n", kZeroCopyFlag);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Reads the configuration file named on the command line and parses it together with the command line.
+ *
+ * @param[in] argc Number of the command line arguments.
+ * @param[in] argv Command line arguments.
+ * @param[out] settings Parsed settings.
+ * @return Whether the settings are loaded and valid.
+ */
+auto LoadSettings(
+  int argc,  //
+  char* argv[],
+  Settings& settings
+) -> bool
+{
+  ConfigArguments arguments;
+  if (LoadConfigArguments(argc, argv, &arguments) == kConfigLoadFailed)
+  {
+    fmt::print(
+      stderr,
+      "Configuration load failed at line {}: {}\n",
+      arguments.error_line_,
+      std::error_code{errno, std::generic_category()}.message()
+    );
+    return false;
+  }
+  const bool parsed{ParseSettings(
+    std::span<char* const>{arguments.argv_ + 1, static_cast<std::size_t>(arguments.argc_ - 1)},
+    settings
+  )};
+  FreeConfigArguments(&arguments);
+  return parsed;
+}
 
 }
 
@@ -20,15 +552,201 @@ auto main(
   char* argv[]
 ) -> int
 {
-  if (argc != 2 || std::string_view{argv[1]} == "--help")
+  if (argc < 2 || std::string_view{argv[1]} == "--help")
+  {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  Settings settings;
+  if (!LoadSettings(argc, argv, settings))
   {
-    fmt::print(stderr, "Usage: {} <port>\n", argv[0]);
+    fmt::print(stderr, "Server initialization failed: invalid settings\n");
     return 1;
   }
-  net::ip::port_type server_port{static_cast<net::ip::port_type>(atoi(argv[1]))};
-  net::io_context context{kConcurrencyHint};
-  tcp::Server server{context, server_port};
+
+  std::optional<tcp::TlsContext> tls_context;
+  if (!settings.tls_certificate_file.empty())
+  {
+    try
+    {
+      tls_context.emplace(settings.tls_certificate_file, settings.tls_key_file);
+    }
+    catch (const boost::system::system_error& error)
+    {
+      fmt::print(stderr, "Server initialization failed: TLS setup failed: {}\n", error.what());
+      return 1;
+    }
+  }
+
+  SetMemoryBudget(settings.memory_budget);
+
+  if (StartLogger() == kLoggerStartFailed)
+  {
+    fmt::print(stderr, "Server initialization failed: logger start failed\n");
+    return 1;
+  }
+
+  tcp::ContextPool pool{
+    settings.threads_count,
+    settings.pin_threads,
+    std::chrono::microseconds{settings.session_options.busy_poll}
+  };
+  for (std::size_t i = 0; i < pool.Size(); ++i)
+  {
+    net::post(
+      pool.Context(i),
+      [i]() -> void
+      {
+        AttachMetrics(fmt::format("context-{}", i).c_str());
+      }
+    );
+  }
+  if (settings.metrics_port != 0 &&
+      StartMetricsServer(in_addr{htonl(settings.metrics_address.to_uint())}, settings.metrics_port) ==
+        kMetricsServerStartFailed)
+  {
+    LOG_FATAL("Server initialization failed: metrics server start failed on port %u", settings.metrics_port);
+  }
+  if (settings.metrics_port != 0 &&
+      RegisterMetricGauge(
+        "echo_server_memory_reserved_bytes",
+        "Number of bytes of session buffers reserved from the memory budget.",
+        "",
+        [](void*) -> std::uint64_t
+        {
+          return GetReservedMemory();
+        },
+        nullptr
+      ) == kMetricGaugeRegisterFailed)
+  {
+    LOG_WARNING("Server initialization: memory budget gauge is not registered");
+  }
+  std::optional<tcp::HotRestart> hot_restart;
+  std::vector<int> inherited_listeners;
+  if (!settings.restart_path.empty())
+  {
+    hot_restart.emplace(pool.Context(0), settings.restart_path);
+    try
+    {
+      inherited_listeners = hot_restart->TakeOver();
+    }
+    catch (const boost::system::system_error& error)
+    {
+      LOG_FATAL("Server initialization failed: listeners takeover failed: %s", error.what());
+    }
+  }
+  tcp::Server server{
+    pool,
+    net::ip::tcp::endpoint{settings.address, settings.port},
+    settings.listener_options,
+    settings.overload_options,
+    settings.accept_mode,
+    settings.session_options,
+    tls_context ? &*tls_context : nullptr,
+    inherited_listeners
+  };
   server.AsyncAccept();
-  context.run();
+
+  // The handlers run on the thread of the first context, like the control socket of the restart.
+  net::signal_set signals{pool.Context(0), SIGINT, SIGTERM};
+  net::signal_set reload_signals{pool.Context(0), SIGHUP};
+  bool draining{false};
+  const auto drain{[&](bool taken_over) -> void
+                   {
+                     if (draining)
+                     {
+                       return;
+                     }
+                     draining = true;
+                     signals.cancel();
+                     reload_signals.cancel();
+                     if (hot_restart)
+                     {
+                       hot_restart->Close(taken_over);
+                     }
+                     server.Stop();
+                     pool.Drain(settings.drain_timeout);
+                   }};
+  signals.async_wait(
+    [&drain](boost::system::error_code error_code, int signal_number) -> void
+    {
+      if (error_code)
+      {
+        return;
+      }
+      LOG_INFO("Server received signal %d, shutting down", signal_number);
+      drain(false);
+    }
+  );
+  // Only the settings that do not need new sockets or threads are applied, the others wait for a restart.
+  std::function<void()> async_wait_reload;
+  async_wait_reload = [&]() -> void
+  {
+    reload_signals.async_wait(
+      [&](boost::system::error_code error_code, int) -> void
+      {
+        if (error_code)
+        {
+          return;
+        }
+        LOG_INFO("Server received SIGHUP, reloading the configuration");
+        Settings reloaded;
+        if (!LoadSettings(argc, argv, reloaded))
+        {
+          LOG_WARNING("Server received error: configuration reload failed: invalid settings");
+        }
+        else if (tls_context && reloaded.session_options.zero_copy_threshold != 0)
+        {
+          LOG_WARNING("Server received error: configuration reload failed: TLS does not support zero-copy");
+        }
+        else
+        {
+          SetMemoryBudget(reloaded.memory_budget);
+          settings.drain_timeout = reloaded.drain_timeout;
+          server.Reconfigure(reloaded.session_options);
+          LOG_INFO(
+            "Server configuration reloaded: max frame size %zu, flush threshold %zu, memory budget %llu, "
+            "rate %llu B/s %llu msg/s, peer rate %llu B/s %llu msg/s, write quantum %zu",  //
+            reloaded.session_options.max_frame_size,
+            reloaded.session_options.flush_threshold,
+            static_cast<unsigned long long>(reloaded.memory_budget),
+            static_cast<unsigned long long>(reloaded.session_options.rate_limits.bytes_per_second_),
+            static_cast<unsigned long long>(reloaded.session_options.rate_limits.messages_per_second_),
+            static_cast<unsigned long long>(reloaded.session_options.peer_rate_limits.bytes_per_second_),
+            static_cast<unsigned long long>(reloaded.session_options.peer_rate_limits.messages_per_second_),
+            reloaded.session_options.write_quantum
+          );
+        }
+        async_wait_reload();
+      }
+    );
+  };
+  async_wait_reload();
+  if (hot_restart)
+  {
+    try
+    {
+      hot_restart->Listen(
+        server.NativeListeners(),
+        [&drain]() -> void
+        {
+          LOG_INFO("Server listeners are taken over, shutting down");
+          drain(true);
+        }
+      );
+    }
+    catch (const boost::system::system_error& error)
+    {
+      LOG_FATAL("Server initialization failed: restart control socket failed: %s", error.what());
+    }
+  }
+  LOG_INFO(
+    "Server started on port %u with %zu threads (%s accept%s)",  //
+    static_cast<unsigned>(settings.port),
+    settings.threads_count,
+    settings.accept_mode == tcp::AcceptMode::kReusePort ? "reuse-port" : "distributing",
+    tls_context ? ", TLS" : ""
+  );
+  pool.Run();
   return 0;
 }
\ No newline at end of file
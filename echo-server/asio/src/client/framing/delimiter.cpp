@@ -0,0 +1,107 @@
+#include <client/framing/delimiter.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+#endif
+
+#define func auto
+
+namespace
+{
+
+using FindFunction = const char* (*) (const char*, const char*, char) noexcept;
+
+func FindLastScalar(
+  const char* begin,  //
+  const char* end,
+  char delimiter
+) noexcept -> const char*
+{
+  while (end != begin)
+  {
+    if (*--end == delimiter)
+    {
+      return end;
+    }
+  }
+  return nullptr;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse2")))
+func FindLastSse2(
+  const char* begin,  //
+  const char* end,
+  char delimiter
+) noexcept -> const char*
+{
+  const __m128i needle{_mm_set1_epi8(delimiter)};
+  while (end - begin >= 16)
+  {
+    end -= 16;
+    const __m128i block{_mm_loadu_si128(reinterpret_cast<const __m128i*>(end))};
+    const unsigned mask{static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)))};
+    if (mask != 0)
+    {
+      return end + (31 - __builtin_clz(mask));
+    }
+  }
+  return FindLastScalar(begin, end, delimiter);
+}
+
+__attribute__((target("avx2")))
+func FindLastAvx2(
+  const char* begin,  //
+  const char* end,
+  char delimiter
+) noexcept -> const char*
+{
+  const __m256i needle{_mm256_set1_epi8(delimiter)};
+  while (end - begin >= 32)
+  {
+    end -= 32;
+    const __m256i block{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(end))};
+    const unsigned mask{static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)))};
+    if (mask != 0)
+    {
+      return end + (31 - __builtin_clz(mask));
+    }
+  }
+  return FindLastSse2(begin, end, delimiter);
+}
+
+#endif
+
+func SelectFindLast() noexcept -> FindFunction
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return &FindLastAvx2;
+  }
+  if (__builtin_cpu_supports("sse2"))
+  {
+    return &FindLastSse2;
+  }
+#endif
+  return &FindLastScalar;
+}
+
+}  // namespace
+
+namespace tcp
+{
+
+func FindLastDelimiter(
+  const char* begin,  //
+  const char* end,
+  char delimiter
+) noexcept -> const char*
+{
+  static const FindFunction find_last{SelectFindLast()};
+  return find_last(begin, end, delimiter);
+}
+
+}  // namespace tcp
\ No newline at end of file
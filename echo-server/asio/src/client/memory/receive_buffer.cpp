@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <bit>
+#include <client/memory/receive_buffer.hpp>
+#include <common/memory/memory_budget.h>
+#include <cstring>
+
+#define func auto
+
+namespace tcp
+{
+
+ReceiveBuffer::ReceiveBuffer(std::size_t frame_size) noexcept
+  : data_{nullptr}  //
+  , size_{0}
+  , next_size_{kSlabSize}
+  , max_size_{std::bit_ceil(std::max({kSlabSize, frame_size, kMaxReceiveBufferSize}))}
+{ }
+
+ReceiveBuffer::~ReceiveBuffer()
+{
+  Free();
+}
+
+func ReceiveBuffer::Allocate() -> bool
+{
+  if (data_ != nullptr)
+  {
+    return true;
+  }
+  if (!ReserveMemory(next_size_))
+  {
+    return false;
+  }
+  data_ = SlabAllocator<char>{}.allocate(next_size_);
+  size_ = next_size_;
+  return true;
+}
+
+func ReceiveBuffer::Free() noexcept -> void
+{
+  if (data_ == nullptr)
+  {
+    return;
+  }
+  SlabAllocator<char>{}.deallocate(data_, size_);
+  ReleaseMemory(size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+func ReceiveBuffer::Growable() const noexcept -> bool
+{
+  return size_ < max_size_;
+}
+
+func ReceiveBuffer::Grow(std::size_t used) -> bool
+{
+  const std::size_t size{size_ * 2};
+  if (!ReserveMemory(size))
+  {
+    return false;
+  }
+  char* data{SlabAllocator<char>{}.allocate(size)};
+  std::memcpy(data, data_, used);
+  Free();
+  data_ = data;
+  size_ = size;
+  next_size_ = std::max(next_size_, size);
+  return true;
+}
+
+func ReceiveBuffer::Adapt(std::size_t used) noexcept -> void
+{
+  if (used == size_ && next_size_ < max_size_)
+  {
+    next_size_ *= 2;
+  }
+  else if (used < next_size_ / 4 && next_size_ > kSlabSize)
+  {
+    next_size_ /= 2;
+  }
+}
+
+func ReceiveBuffer::Allocated() const noexcept -> bool
+{
+  return data_ != nullptr;
+}
+
+func ReceiveBuffer::Data() noexcept -> char*
+{
+  return data_;
+}
+
+func ReceiveBuffer::Size() const noexcept -> std::size_t
+{
+  return size_;
+}
+
+}  // namespace tcp
\ No newline at end of file
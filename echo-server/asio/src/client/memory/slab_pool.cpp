@@ -0,0 +1,60 @@
+#include <client/memory/slab_pool.hpp>
+
+#define func auto
+
+namespace
+{
+
+constexpr std::size_t kMaxCachedSlabs{4096};
+constexpr std::align_val_t kSlabAlignment{alignof(std::max_align_t)};
+
+}  // namespace
+
+namespace tcp
+{
+
+SlabPool::SlabPool() noexcept
+  : free_slabs_{nullptr}  //
+  , cached_slabs_{0}
+{ }
+
+SlabPool::~SlabPool()
+{
+  while (free_slabs_ != nullptr)
+  {
+    FreeSlab* slab{free_slabs_};
+    free_slabs_ = slab->next_;
+    ::operator delete(slab, kSlabAlignment);
+  }
+}
+
+func SlabPool::Local() -> SlabPool&
+{
+  thread_local SlabPool pool;
+  return pool;
+}
+
+func SlabPool::Allocate() -> void*
+{
+  if (free_slabs_ == nullptr)
+  {
+    return ::operator new(kSlabSize, kSlabAlignment);
+  }
+  FreeSlab* slab{free_slabs_};
+  free_slabs_ = slab->next_;
+  --cached_slabs_;
+  return slab;
+}
+
+func SlabPool::Deallocate(void* slab) noexcept -> void
+{
+  if (cached_slabs_ == kMaxCachedSlabs)
+  {
+    ::operator delete(slab, kSlabAlignment);
+    return;
+  }
+  free_slabs_ = ::new (slab) FreeSlab{free_slabs_};
+  ++cached_slabs_;
+}
+
+}  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <client/session/coroutine_session.hpp>
+#include <common/memory/memory_budget.h>
+#include <common/metrics/metrics.h>
+#include <cstring>
+#include <limits>
+#include <span>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace tcp
+{
+
+template<typename Codec>
+func CoroutineSession<Codec>::Start(
+  net::ip::tcp::socket&& socket,  //
+  const SessionOptions& options
+) -> void
+{
+  const net::any_io_executor executor{socket.get_executor()};
+  net::co_spawn(executor, Run(std::move(socket), options), net::detached);
+}
+
+template<typename Codec>
+CoroutineSession<Codec>::CoroutineSession(
+  net::ip::tcp::socket&& socket,  //
+  const SessionOptions& options
+)
+  : socket_{std::move(socket)}  //
+  , link_{socket_}
+  , signal_{socket_.get_executor(), net::steady_timer::time_point::max()}
+  , write_signal_{socket_.get_executor(), net::steady_timer::time_point::max()}
+  , codec_{options.max_frame_size}
+  , read_buffer_{codec_.BufferSize()}
+  , read_size_{0}
+  , rate_limiter_{socket_, options.rate_limits, options.peer_rate_limits}
+  , high_water_mark_{options.high_water_mark}
+  , flush_threshold_{std::min(options.flush_threshold, options.high_water_mark)}
+  , write_quantum_{options.write_quantum == 0 ? std::numeric_limits<std::size_t>::max() : options.write_quantum}
+  , accepted_at_{GetMetricsTimestamp()}
+  , writing_{false}
+  , waiting_{false}
+  , write_idle_{false}
+  , reader_done_{false}
+{
+  boost::system::error_code error_code;
+  if (options.no_delay)
+  {
+    socket_.set_option(net::ip::tcp::no_delay{true}, error_code);
+  }
+  socket_.non_blocking(true, error_code);
+}
+
+template<typename Codec>
+CoroutineSession<Codec>::~CoroutineSession()
+{
+  ReleaseMemory(write_queue_.Size());
+  AddMetric(kMetricClosedConnections, 1);
+  RecordMetric(kMetricConnectionDuration, GetMetricsTimestamp() - accepted_at_);
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::Run(
+  net::ip::tcp::socket socket,  //
+  SessionOptions options
+) -> net::awaitable<void>
+{
+  CoroutineSession session{std::move(socket), options};
+  session.writing_ = true;
+  net::co_spawn(session.socket_.get_executor(), session.Write(), net::detached);
+  co_await session.Read();
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::Read() -> net::awaitable<void>
+{
+  for (;;)
+  {
+    if (rate_limiter_.Enabled())
+    {
+      const std::size_t read_limit{read_buffer_.Allocated() ? read_buffer_.Size() - read_size_ : codec_.BufferSize()};
+      if (!rate_limiter_.Admit(read_limit, socket_.get_executor(), &CoroutineSession::ResumeRead, this, nullptr))
+      {
+        // The writer wakes the reader up as well, the reader keeps waiting until the pacer has resumed it.
+        do
+        {
+          co_await Wait();
+        } while (rate_limiter_.Parked());
+        continue;
+      }
+    }
+    boost::system::error_code error_code;
+    std::size_t free_bytes{read_buffer_.Size() - read_size_};
+    std::size_t processed_bytes;
+    if (read_buffer_.Allocated())
+    {
+      processed_bytes = co_await socket_.async_read_some(
+        net::buffer(read_buffer_.Data() + read_size_, free_bytes),
+        net::redirect_error(net::use_awaitable, error_code)
+      );
+    }
+    else
+    {
+      co_await socket_.async_wait(
+        net::socket_base::wait_read,
+        net::redirect_error(net::use_awaitable, error_code)
+      );
+      if (error_code)
+      {
+        break;
+      }
+      if (!read_buffer_.Allocate())
+      {
+        Shed();
+        break;
+      }
+      free_bytes = read_buffer_.Size();
+      processed_bytes = socket_.read_some(net::buffer(read_buffer_.Data(), free_bytes), error_code);
+      if (error_code == net::error::would_block)
+      {
+        read_buffer_.Free();
+        continue;
+      }
+    }
+    if (error_code)
+    {
+      break;
+    }
+    const bool framed{QueueFrames(processed_bytes) && ReadAhead(processed_bytes == free_bytes)};
+    StartWriting();
+    if (!framed)
+    {
+      break;
+    }
+    // A read that did not fill the buffer most likely drained the socket, the session goes idle without the buffer.
+    if (read_size_ == 0 && processed_bytes != free_bytes)
+    {
+      read_buffer_.Free();
+    }
+    if (write_queue_.Size() > high_water_mark_)
+    {
+      do
+      {
+        co_await Wait();
+      } while (writing_ && write_queue_.Size() > high_water_mark_ / 2);
+    }
+  }
+  reader_done_ = true;
+  if (write_idle_)
+  {
+    write_signal_.cancel();
+  }
+  // The session lives on the frame of this coroutine, the writer has to be done with it first.
+  while (writing_)
+  {
+    co_await Wait();
+  }
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::Write() -> net::awaitable<void>
+{
+  for (;;)
+  {
+    if (write_queue_.Empty())
+    {
+      if (reader_done_)
+      {
+        break;
+      }
+      write_idle_ = true;
+      // Woken up by cancelling the wait, the error is expected.
+      boost::system::error_code error_code;
+      write_signal_.expires_at(net::steady_timer::time_point::max());
+      co_await write_signal_.async_wait(net::redirect_error(net::use_awaitable, error_code));
+      write_idle_ = false;
+      continue;
+    }
+    const std::size_t buffers_count{write_queue_.Gather(gathered_buffers_.data(), gathered_buffers_.size(), write_quantum_)};
+    boost::system::error_code error_code;
+    const std::size_t processed_bytes{co_await net::async_write(
+      socket_,
+      std::span<const net::const_buffer>{gathered_buffers_.data(), buffers_count},
+      net::redirect_error(net::use_awaitable, error_code)
+    )};
+    if (error_code)
+    {
+      // The peer is gone, closing aborts the pending read.
+      socket_.close(error_code);
+      break;
+    }
+    AddMetric(kMetricSentBytes, processed_bytes);
+    write_queue_.Consume(processed_bytes);
+    ReleaseMemory(processed_bytes);
+    if (write_queue_.Size() <= high_water_mark_ / 2)
+    {
+      Notify();
+    }
+  }
+  writing_ = false;
+  Notify();
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::Wait() -> net::awaitable<void>
+{
+  waiting_ = true;
+  signal_.expires_at(net::steady_timer::time_point::max());
+  boost::system::error_code error_code;
+  co_await signal_.async_wait(net::redirect_error(net::use_awaitable, error_code));
+  waiting_ = false;
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::Notify() -> void
+{
+  if (waiting_)
+  {
+    signal_.cancel();
+  }
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::ResumeRead(void* session) -> void
+{
+  static_cast<CoroutineSession*>(session)->Notify();
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::QueueFrames(std::size_t processed_bytes) -> bool
+{
+  AddMetric(kMetricReceivedBytes, processed_bytes);
+  RecordMetric(kMetricReadSize, processed_bytes);
+  link_.Touch();
+
+  char* data{read_buffer_.Data()};
+  const std::size_t scanned_bytes{read_size_};
+  read_size_ += processed_bytes;
+  read_buffer_.Adapt(read_size_);
+  const std::size_t framed_bytes{codec_.Frame(data, read_size_, scanned_bytes)};
+  if (framed_bytes == kMalformedFrame)
+  {
+    return false;
+  }
+  rate_limiter_.Charge(processed_bytes, rate_limiter_.CountsMessages() ? codec_.Count(data, framed_bytes) : 0);
+  if (framed_bytes == 0 && read_size_ == read_buffer_.Size())
+  {
+    // The incomplete frame fills the buffer: it is longer than any valid frame unless the buffer may still grow.
+    if (!read_buffer_.Growable())
+    {
+      return false;
+    }
+    if (!read_buffer_.Grow(read_size_))
+    {
+      Shed();
+      return false;
+    }
+    return true;
+  }
+  if (framed_bytes != 0)
+  {
+    if (!ReserveMemory(framed_bytes))
+    {
+      Shed();
+      return false;
+    }
+    write_queue_.Append(data, framed_bytes);
+    read_size_ -= framed_bytes;
+    std::memmove(data, data + framed_bytes, read_size_);
+  }
+  return true;
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::ReadAhead(bool filled) -> bool
+{
+  while (filled && write_queue_.Size() < flush_threshold_ && !rate_limiter_.Throttled())
+  {
+    // The socket is nonblocking: the read fails with would_block once the input is drained, any other error is
+    // reported again to the next async read.
+    const std::size_t free_bytes{read_buffer_.Size() - read_size_};
+    boost::system::error_code error_code;
+    const std::size_t processed_bytes{
+      socket_.read_some(net::buffer(read_buffer_.Data() + read_size_, free_bytes), error_code)
+    };
+    if (error_code)
+    {
+      return true;
+    }
+    filled = processed_bytes == free_bytes;
+    if (!QueueFrames(processed_bytes))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::StartWriting() -> void
+{
+  if (!write_idle_ || write_queue_.Empty())
+  {
+    return;
+  }
+  const std::size_t buffers_count{write_queue_.Gather(gathered_buffers_.data(), gathered_buffers_.size(), write_quantum_)};
+  boost::system::error_code error_code;
+  const std::size_t processed_bytes{
+    socket_.write_some(std::span<const net::const_buffer>{gathered_buffers_.data(), buffers_count}, error_code)
+  };
+  if (!error_code)
+  {
+    AddMetric(kMetricSentBytes, processed_bytes);
+    write_queue_.Consume(processed_bytes);
+    ReleaseMemory(processed_bytes);
+  }
+  if (!write_queue_.Empty())
+  {
+    write_signal_.cancel();
+  }
+}
+
+template<typename Codec>
+func CoroutineSession<Codec>::Shed() -> void
+{
+  AddMetric(kMetricShedConnections, 1);
+  // Closing aborts the pending operations of both coroutines.
+  boost::system::error_code error_code;
+  socket_.close(error_code);
+}
+
+template class CoroutineSession<NewlineCodec>;
+template class CoroutineSession<U16LengthCodec>;
+template class CoroutineSession<U32LengthCodec>;
+template class CoroutineSession<VarintLengthCodec>;
+template class CoroutineSession<FixedSizeCodec>;
+
+}  // namespace tcp
\ No newline at end of file
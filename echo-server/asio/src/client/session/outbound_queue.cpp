@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <client/memory/slab_pool.hpp>
+#include <client/session/outbound_queue.hpp>
+#include <cstring>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace tcp
+{
+
+struct OutboundQueue::Chunk
+{
+  // Header: next_, begin_, end_ and the zero-copy id together with the pinned flag.
+  static constexpr std::size_t kCapacity{kSlabSize - 3 * sizeof(std::size_t) - sizeof(Chunk*)};
+
+  static func Create() -> Chunk*
+  {
+    static_assert(sizeof(Chunk) <= kSlabSize, "OutboundQueue: chunk does not fit into the slab");
+    Chunk* chunk{::new (SlabPool::Local().Allocate()) Chunk};
+    chunk->next_ = nullptr;
+    chunk->begin_ = chunk->end_ = 0;
+    chunk->zero_copy_id_ = 0;
+    chunk->pinned_ = false;
+    return chunk;
+  }
+
+  Chunk* next_;
+  std::size_t begin_;
+  std::size_t end_;
+  std::uint32_t zero_copy_id_;
+  bool pinned_;
+  char data_[kCapacity];
+};
+
+OutboundQueue::OutboundQueue() noexcept
+  : head_{nullptr}  //
+  , tail_{nullptr}
+  , retired_head_{nullptr}
+  , retired_tail_{nullptr}
+  , size_{0}
+  , completed_zero_copy_ids_{0}
+{ }
+
+OutboundQueue::~OutboundQueue()
+{
+  for (Chunk* list : {head_, retired_head_})
+  {
+    while (list != nullptr)
+    {
+      Chunk* chunk{list};
+      list = chunk->next_;
+      // Without the completion the kernel may still send from the chunk: reused, it would carry the data of another
+      // connection. The slab is given up instead.
+      if (!chunk->pinned_ || IsCompleted(chunk))
+      {
+        SlabPool::Local().Deallocate(chunk);
+      }
+    }
+  }
+}
+
+func OutboundQueue::Append(
+  const char* data,  //
+  std::size_t size
+) -> void
+{
+  size_ += size;
+  while (size != 0)
+  {
+    if (tail_ == nullptr)
+    {
+      head_ = tail_ = Chunk::Create();
+    }
+    else if (tail_->end_ == Chunk::kCapacity)
+    {
+      tail_ = tail_->next_ = Chunk::Create();
+    }
+    std::size_t copied_bytes{std::min(size, Chunk::kCapacity - tail_->end_)};
+    std::memcpy(tail_->data_ + tail_->end_, data, copied_bytes);
+    tail_->end_ += copied_bytes;
+    data += copied_bytes;
+    size -= copied_bytes;
+  }
+}
+
+func OutboundQueue::Front() const noexcept -> net::const_buffer
+{
+  if (head_ == nullptr)
+  {
+    return {};
+  }
+  return net::const_buffer{head_->data_ + head_->begin_, head_->end_ - head_->begin_};
+}
+
+func OutboundQueue::Gather(
+  net::const_buffer* buffers,  //
+  std::size_t max_buffers,
+  std::size_t max_bytes
+) const noexcept -> std::size_t
+{
+  std::size_t count{0};
+  for (const Chunk* chunk{head_}; chunk != nullptr && count != max_buffers && max_bytes != 0; chunk = chunk->next_)
+  {
+    if (chunk->begin_ != chunk->end_)
+    {
+      const std::size_t size{std::min(chunk->end_ - chunk->begin_, max_bytes)};
+      buffers[count++] = net::const_buffer{chunk->data_ + chunk->begin_, size};
+      max_bytes -= size;
+    }
+  }
+  return count;
+}
+
+func OutboundQueue::Consume(std::size_t size) noexcept -> void
+{
+  Consume(size, false, 0);
+}
+
+func OutboundQueue::ConsumeZeroCopy(
+  std::size_t size,  //
+  std::uint32_t zero_copy_id
+) noexcept -> void
+{
+  Consume(size, true, zero_copy_id);
+}
+
+func OutboundQueue::Release(std::uint32_t zero_copy_id) noexcept -> void
+{
+  if (static_cast<std::int32_t>(zero_copy_id + 1 - completed_zero_copy_ids_) > 0)
+  {
+    completed_zero_copy_ids_ = zero_copy_id + 1;
+  }
+  while (retired_head_ != nullptr && IsCompleted(retired_head_))
+  {
+    Chunk* chunk{retired_head_};
+    retired_head_ = chunk->next_;
+    SlabPool::Local().Deallocate(chunk);
+  }
+  if (retired_head_ == nullptr)
+  {
+    retired_tail_ = nullptr;
+  }
+}
+
+func OutboundQueue::Pinned() const noexcept -> bool
+{
+  return retired_head_ != nullptr || (head_ != nullptr && head_->pinned_ && !IsCompleted(head_));
+}
+
+func OutboundQueue::Empty() const noexcept -> bool
+{
+  return size_ == 0;
+}
+
+func OutboundQueue::Size() const noexcept -> std::size_t
+{
+  return size_;
+}
+
+func OutboundQueue::Consume(
+  std::size_t size,  //
+  bool zero_copy,
+  std::uint32_t zero_copy_id
+) noexcept -> void
+{
+  size_ -= size;
+  while (size != 0)
+  {
+    Chunk* chunk{head_};
+    std::size_t consumed_bytes{std::min(size, chunk->end_ - chunk->begin_)};
+    chunk->begin_ += consumed_bytes;
+    size -= consumed_bytes;
+    if (zero_copy)
+    {
+      chunk->pinned_ = true;
+      chunk->zero_copy_id_ = zero_copy_id;
+    }
+    if (chunk->begin_ != chunk->end_)
+    {
+      return;
+    }
+
+    bool referenced{chunk->pinned_ && !IsCompleted(chunk)};
+    if (chunk == tail_ && !referenced)
+    {
+      chunk->begin_ = chunk->end_ = 0;
+      chunk->pinned_ = false;
+      return;
+    }
+    head_ = chunk->next_;
+    if (chunk == tail_)
+    {
+      tail_ = nullptr;
+    }
+    if (referenced)
+    {
+      // The kernel may still read from the chunk, keep it until the send completes.
+      Retire(chunk);
+    }
+    else
+    {
+      SlabPool::Local().Deallocate(chunk);
+    }
+  }
+}
+
+func OutboundQueue::IsCompleted(const Chunk* chunk) const noexcept -> bool
+{
+  // Zero-copy ids are 32-bit counters, compare them modulo 2^32.
+  return static_cast<std::int32_t>(chunk->zero_copy_id_ - completed_zero_copy_ids_) < 0;
+}
+
+func OutboundQueue::Retire(Chunk* chunk) noexcept -> void
+{
+  chunk->next_ = nullptr;
+  if (retired_tail_ == nullptr)
+  {
+    retired_head_ = retired_tail_ = chunk;
+  }
+  else
+  {
+    retired_tail_ = retired_tail_->next_ = chunk;
+  }
+}
+
+}  // namespace tcp
\ No newline at end of file
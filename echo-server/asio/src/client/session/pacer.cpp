@@ -0,0 +1,159 @@
+#include <chrono>
+#include <client/session/pacer.hpp>
+#include <common/rate_limit/rate_limit.h>
+#include <utility>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace tcp
+{
+
+Pacer::Pacer(const net::any_io_executor& executor)
+  : timer_{executor}  //
+  , armed_due_{kNotArmed}
+{ }
+
+Pacer::~Pacer()
+{
+  for (Waiter* waiter : heap_)
+  {
+    waiter->index = Waiter::kNotParked;
+  }
+  // Releasing a session may unpark another waiter, so the heap is emptied before any of them is released.
+  std::vector<Waiter*> waiters{std::move(heap_)};
+  heap_.clear();
+  for (Waiter* waiter : waiters)
+  {
+    std::shared_ptr<void> keep_alive{std::move(waiter->keep_alive)};
+  }
+}
+
+func Pacer::Local(const net::any_io_executor& executor) -> Pacer&
+{
+  thread_local Pacer pacer{executor};
+  return pacer;
+}
+
+func Pacer::Park(Waiter& waiter) -> void
+{
+  heap_.push_back(&waiter);
+  Place(&waiter, heap_.size() - 1);
+  SiftUp(waiter.index);
+  Arm();
+}
+
+func Pacer::Unpark(Waiter& waiter) noexcept -> void
+{
+  if (waiter.index == Waiter::kNotParked)
+  {
+    return;
+  }
+  // The timer stays armed, an expiry with no waiter due is a no-op.
+  Remove(waiter.index);
+}
+
+func Pacer::Arm() -> void
+{
+  if (heap_.empty() || heap_.front()->due >= armed_due_)
+  {
+    return;
+  }
+  // Rearming aborts the wait armed for a later waiter, its handler returns without touching the pacer.
+  armed_due_ = heap_.front()->due;
+  const std::uint64_t now{GetRateLimitClock()};
+  timer_.expires_after(std::chrono::nanoseconds{armed_due_ > now ? armed_due_ - now : 0});
+  timer_.async_wait(MakeCustomAllocHandler(
+    handler_memory_,
+    [this](boost::system::error_code error_code) -> void
+    {
+      if (error_code == net::error::operation_aborted)
+      {
+        return;
+      }
+      armed_due_ = kNotArmed;
+      Expire();
+    }
+  ));
+}
+
+func Pacer::Expire() -> void
+{
+  const std::uint64_t now{GetRateLimitClock()};
+  while (!heap_.empty() && heap_.front()->due <= now)
+  {
+    Waiter* waiter{heap_.front()};
+    Remove(0);
+    // The session may park again while it resumes, the reference is dropped only after the callback.
+    std::shared_ptr<void> keep_alive{std::move(waiter->keep_alive)};
+    waiter->resume(waiter->target);
+  }
+  Arm();
+}
+
+func Pacer::Remove(std::size_t index) noexcept -> void
+{
+  Waiter* removed{heap_[index]};
+  Waiter* last{heap_.back()};
+  heap_.pop_back();
+  removed->index = Waiter::kNotParked;
+  if (last == removed)
+  {
+    return;
+  }
+  Place(last, index);
+  SiftUp(index);
+  SiftDown(last->index);
+}
+
+func Pacer::SiftUp(std::size_t index) noexcept -> void
+{
+  Waiter* waiter{heap_[index]};
+  while (index != 0)
+  {
+    const std::size_t parent{(index - 1) / 2};
+    if (heap_[parent]->due <= waiter->due)
+    {
+      break;
+    }
+    Place(heap_[parent], index);
+    index = parent;
+  }
+  Place(waiter, index);
+}
+
+func Pacer::SiftDown(std::size_t index) noexcept -> void
+{
+  Waiter* waiter{heap_[index]};
+  for (;;)
+  {
+    std::size_t child{2 * index + 1};
+    if (child >= heap_.size())
+    {
+      break;
+    }
+    if (child + 1 < heap_.size() && heap_[child + 1]->due < heap_[child]->due)
+    {
+      ++child;
+    }
+    if (waiter->due <= heap_[child]->due)
+    {
+      break;
+    }
+    Place(heap_[child], index);
+    index = child;
+  }
+  Place(waiter, index);
+}
+
+func Pacer::Place(
+  Waiter* waiter,  //
+  std::size_t index
+) noexcept -> void
+{
+  heap_[index] = waiter;
+  waiter->index = index;
+}
+
+}  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <arpa/inet.h>
+#include <client/session/rate_limiter.hpp>
+#include <common/metrics/metrics.h>
+#include <utility>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace tcp
+{
+
+RateLimiter::RateLimiter(
+  const net::ip::tcp::socket& socket,  //
+  const RateLimits& limits,
+  const RateLimits& peer_limits
+)
+  : limits_{limits}  //
+  , peer_limits_{peer_limits}
+  , buckets_{}
+  , peer_buckets_{nullptr}
+  , peer_booked_bytes_{0}
+  , enabled_{false}
+  , pacer_{nullptr}
+{
+  InitializeTokenBuckets(&buckets_);
+  if (IsRateLimited(&peer_limits_))
+  {
+    boost::system::error_code error_code;
+    const net::ip::tcp::endpoint peer{socket.remote_endpoint(error_code)};
+    if (!error_code && peer.address().is_v4())
+    {
+      peer_buckets_ = AcquirePeerBuckets(htonl(peer.address().to_v4().to_uint()));
+      if (IsOverflowPeerBuckets(peer_buckets_))
+      {
+        AddMetric(kMetricOverflowPeerConnections, 1);
+      }
+    }
+  }
+  enabled_ = IsRateLimited(&limits_) || peer_buckets_ != nullptr;
+}
+
+RateLimiter::~RateLimiter()
+{
+  // The pacer of the thread is gone once the thread exits, it unparks its waiters first.
+  if (Parked())
+  {
+    pacer_->Unpark(waiter_);
+  }
+  if (peer_buckets_ == nullptr)
+  {
+    return;
+  }
+  if (peer_booked_bytes_ != 0)
+  {
+    SettlePeerBuckets(peer_buckets_, &peer_limits_, peer_booked_bytes_, 1, 0, 0, GetRateLimitClock());
+  }
+  ReleasePeerBuckets(peer_buckets_);
+}
+
+func RateLimiter::Throttled() const -> bool
+{
+  if (!enabled_)
+  {
+    return false;
+  }
+  const std::uint64_t now{GetRateLimitClock()};
+  return GetTokenBucketsDelay(&buckets_, &limits_, now) != 0 ||
+         (peer_buckets_ != nullptr && peer_booked_bytes_ == 0 &&
+          GetPeerBucketsDelay(peer_buckets_, &peer_limits_, now) != 0);
+}
+
+func RateLimiter::Admit(
+  std::size_t read_limit,  //
+  const net::any_io_executor& executor,
+  void (*resume)(void*),
+  void* target,
+  std::shared_ptr<void> keep_alive
+) -> bool
+{
+  if (!enabled_)
+  {
+    return true;
+  }
+  const std::uint64_t now{GetRateLimitClock()};
+  std::uint64_t delay{GetTokenBucketsDelay(&buckets_, &limits_, now)};
+  if (delay == 0 && peer_buckets_ != nullptr && peer_booked_bytes_ == 0 &&
+      GetPeerBucketsDelay(peer_buckets_, &peer_limits_, now) != 0)
+  {
+    peer_booked_bytes_ = read_limit;
+    delay = BookPeerBuckets(peer_buckets_, &peer_limits_, read_limit, 1, now);
+  }
+  if (delay == 0)
+  {
+    return true;
+  }
+
+  AddMetric(kMetricThrottledReads, 1);
+  if (pacer_ == nullptr)
+  {
+    pacer_ = &Pacer::Local(executor);
+  }
+  waiter_.due = now + delay;
+  waiter_.resume = resume;
+  waiter_.target = target;
+  waiter_.keep_alive = std::move(keep_alive);
+  pacer_->Park(waiter_);
+  return false;
+}
+
+func RateLimiter::Charge(
+  std::size_t bytes,  //
+  std::size_t messages
+) -> void
+{
+  if (!enabled_)
+  {
+    return;
+  }
+  const std::uint64_t now{GetRateLimitClock()};
+  ChargeTokenBuckets(&buckets_, &limits_, bytes, messages, now);
+  if (peer_buckets_ == nullptr)
+  {
+    return;
+  }
+  if (peer_booked_bytes_ != 0)
+  {
+    SettlePeerBuckets(peer_buckets_, &peer_limits_, peer_booked_bytes_, 1, bytes, messages, now);
+    peer_booked_bytes_ = 0;
+  }
+  else
+  {
+    ChargePeerBuckets(peer_buckets_, &peer_limits_, bytes, messages, now);
+  }
+}
+
+}  // namespace tcp
\ No newline at end of file
@@ -1,56 +1,446 @@
+#include <algorithm>
 #include <client/session/session.hpp>
+#include <common/memory/memory_budget.h>
+#include <common/metrics/metrics.h>
+#include <cstring>
+#include <limits>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <span>
+#include <sys/socket.h>
 
 #define func auto
 
 namespace net = boost::asio;
 
+namespace
+{
+
+using ZeroCopy = net::detail::socket_option::boolean<SOL_SOCKET, SO_ZEROCOPY>;
+
+constexpr int kRecvFailed{-1};
+
+}
+
 namespace tcp
 {
 
-Session::Session(
-  net::ip::tcp::socket&& socket
+template<typename Codec>
+Session<Codec>::Session(
+  net::ip::tcp::socket&& socket,  //
+  const SessionOptions& options
 )
   : socket_{std::move(socket)}  //
-  , buffer_{1024}
-{ }
+  , link_{socket_}
+  , codec_{options.max_frame_size}
+  , read_buffer_{codec_.BufferSize()}
+  , read_size_{0}
+  , rate_limiter_{socket_, options.rate_limits, options.peer_rate_limits}
+  , high_water_mark_{options.high_water_mark}
+  , flush_threshold_{std::min(options.flush_threshold, options.high_water_mark)}
+  , write_quantum_{options.write_quantum == 0 ? std::numeric_limits<std::size_t>::max() : options.write_quantum}
+  , zero_copy_threshold_{options.zero_copy_threshold}
+  , zero_copy_next_id_{0}
+  , accepted_at_{GetMetricsTimestamp()}
+  , reading_{false}
+  , writing_{false}
+  , waiting_completions_{false}
+{
+  if (options.no_delay)
+  {
+    boost::system::error_code error_code;
+    socket_.set_option(net::ip::tcp::no_delay{true}, error_code);
+  }
+}
 
-func Session::AsyncRead() -> void
+template<typename Codec>
+Session<Codec>::~Session()
 {
-  net::async_read_until(
-    socket_,
-    buffer_,
-    '\n',
-    [self = shared_from_this()](boost::system::error_code error_code, size_t processed_bytes) -> void
+  // The last chance to see the completions, the queue keeps the chunks still pinned out of the pool.
+  if (write_queue_.Pinned())
+  {
+    ReadZeroCopyCompletions();
+  }
+  ReleaseMemory(write_queue_.Size());
+  AddMetric(kMetricClosedConnections, 1);
+  RecordMetric(kMetricConnectionDuration, GetMetricsTimestamp() - accepted_at_);
+}
+
+template<typename Codec>
+func Session<Codec>::AsyncRead() -> void
+{
+  reading_ = true;
+  if (rate_limiter_.Enabled())
+  {
+    // reading_ stays set while the session is parked, so finished writes do not start another read.
+    const std::size_t read_limit{read_buffer_.Allocated() ? read_buffer_.Size() - read_size_ : codec_.BufferSize()};
+    if (!rate_limiter_.Admit(read_limit, socket_.get_executor(), &Session::ResumeRead, this, this->shared_from_this()))
     {
-      if (error_code)
+      return;
+    }
+  }
+  if (!read_buffer_.Allocated())
+  {
+    socket_.async_wait(
+      net::socket_base::wait_read,
+      MakeCustomAllocHandler(
+        read_handler_memory_,
+        [self = this->shared_from_this()](boost::system::error_code error_code) -> void
+        {
+          if (error_code)
+          {
+            // reading_ stays set: the read side is finished and must not be resumed.
+            return;
+          }
+          self->ReadAvailable();
+        }
+      )
+    );
+    return;
+  }
+  socket_.async_read_some(
+    net::buffer(read_buffer_.Data() + read_size_, read_buffer_.Size() - read_size_),
+    MakeCustomAllocHandler(
+      read_handler_memory_,
+      [self = this->shared_from_this()](boost::system::error_code error_code, size_t processed_bytes) -> void
       {
-        return;
+        self->HandleRead(error_code, processed_bytes);
       }
-      self->AsyncWrite();
-    }
+    )
   );
 }
 
-func Session::AsyncWrite() -> void
+template<typename Codec>
+func Session<Codec>::ResumeRead(void* session) -> void
+{
+  static_cast<Session*>(session)->AsyncRead();
+}
+
+template<typename Codec>
+func Session<Codec>::ReadAvailable() -> void
+{
+  if (!read_buffer_.Allocate())
+  {
+    Shed();
+    return;
+  }
+  boost::system::error_code error_code;
+  const std::size_t processed_bytes{
+    socket_.read_some(net::buffer(read_buffer_.Data(), read_buffer_.Size()), error_code)
+  };
+  if (error_code == net::error::would_block)
+  {
+    read_buffer_.Free();
+    AsyncRead();
+    return;
+  }
+  HandleRead(error_code, processed_bytes);
+}
+
+template<typename Codec>
+func Session<Codec>::HandleRead(
+  boost::system::error_code error_code,  //
+  std::size_t processed_bytes
+) -> void
+{
+  if (error_code)
+  {
+    // reading_ stays set: the read side is finished and must not be resumed.
+    return;
+  }
+  const bool filled{processed_bytes == read_buffer_.Size() - read_size_};
+  if (!QueueFrames(processed_bytes) || !ReadAhead(filled))
+  {
+    // reading_ stays set: the frame can never be completed, the read side is finished.
+    return;
+  }
+  if (!writing_ && !write_queue_.Empty())
+  {
+    AsyncWrite();
+  }
+  reading_ = false;
+  // A read that did not fill the buffer most likely drained the socket, the session goes idle without the buffer.
+  if (read_size_ == 0 && !filled)
+  {
+    read_buffer_.Free();
+  }
+
+  if (write_queue_.Size() <= high_water_mark_)
+  {
+    AsyncRead();
+  }
+}
+
+template<typename Codec>
+func Session<Codec>::Shed() -> void
+{
+  AddMetric(kMetricShedConnections, 1);
+  Close();
+}
+
+template<typename Codec>
+func Session<Codec>::Close() -> void
+{
+  boost::system::error_code error_code;
+  if (write_queue_.Pinned())
+  {
+    // Closing would drop the zero-copy completions while the kernel may still send from the pinned chunks. The
+    // shutdown ends the reads and writes instead, and the wait for the completions keeps the socket open.
+    socket_.shutdown(net::socket_base::shutdown_both, error_code);
+    return;
+  }
+  // Closing aborts the pending operations, the session is destroyed with the last of them.
+  socket_.close(error_code);
+}
+
+template<typename Codec>
+func Session<Codec>::QueueFrames(std::size_t processed_bytes) -> bool
+{
+  AddMetric(kMetricReceivedBytes, processed_bytes);
+  RecordMetric(kMetricReadSize, processed_bytes);
+  link_.Touch();
+
+  char* data{read_buffer_.Data()};
+  const std::size_t scanned_bytes{read_size_};
+  read_size_ += processed_bytes;
+  read_buffer_.Adapt(read_size_);
+  const std::size_t framed_bytes{codec_.Frame(data, read_size_, scanned_bytes)};
+  if (framed_bytes == kMalformedFrame)
+  {
+    return false;
+  }
+  rate_limiter_.Charge(processed_bytes, rate_limiter_.CountsMessages() ? codec_.Count(data, framed_bytes) : 0);
+  if (framed_bytes == 0 && read_size_ == read_buffer_.Size())
+  {
+    // The incomplete frame fills the buffer: it is longer than any valid frame unless the buffer may still grow.
+    if (!read_buffer_.Growable())
+    {
+      return false;
+    }
+    if (!read_buffer_.Grow(read_size_))
+    {
+      Shed();
+      return false;
+    }
+    return true;
+  }
+  if (framed_bytes != 0)
+  {
+    if (!ReserveMemory(framed_bytes))
+    {
+      Shed();
+      return false;
+    }
+    write_queue_.Append(data, framed_bytes);
+    read_size_ -= framed_bytes;
+    std::memmove(data, data + framed_bytes, read_size_);
+  }
+  return true;
+}
+
+template<typename Codec>
+func Session<Codec>::ReadAhead(bool filled) -> bool
+{
+  while (filled && write_queue_.Size() < flush_threshold_ && !rate_limiter_.Throttled())
+  {
+    // The socket is nonblocking: the read fails with would_block once the input is drained, any other error is
+    // reported again to the next async read.
+    const std::size_t free_bytes{read_buffer_.Size() - read_size_};
+    boost::system::error_code error_code;
+    const std::size_t processed_bytes{
+      socket_.read_some(net::buffer(read_buffer_.Data() + read_size_, free_bytes), error_code)
+    };
+    if (error_code)
+    {
+      return true;
+    }
+    filled = processed_bytes == free_bytes;
+    if (!QueueFrames(processed_bytes))
+    {
+      if (!writing_ && !write_queue_.Empty())
+      {
+        AsyncWrite();
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+template<typename Codec>
+func Session<Codec>::AsyncWrite() -> void
 {
+  writing_ = true;
+  if (zero_copy_threshold_ != 0 && write_queue_.Size() >= zero_copy_threshold_)
+  {
+    AsyncWriteZeroCopy();
+    return;
+  }
+  std::size_t buffers_count{write_queue_.Gather(gathered_buffers_.data(), gathered_buffers_.size(), write_quantum_)};
   net::async_write(
     socket_,
-    buffer_,
-    [self = shared_from_this()](boost::system::error_code error_code, size_t processed_bytes) -> void
+    std::span<const net::const_buffer>{gathered_buffers_.data(), buffers_count},
+    MakeCustomAllocHandler(
+      write_handler_memory_,
+      [self = this->shared_from_this()](boost::system::error_code error_code, size_t processed_bytes) -> void
+      {
+        if (error_code)
+        {
+          // writing_ stays set: the peer is gone, closing aborts the pending read.
+          self->Close();
+          return;
+        }
+        self->writing_ = false;
+        AddMetric(kMetricSentBytes, processed_bytes);
+
+        self->write_queue_.Consume(processed_bytes);
+        ReleaseMemory(processed_bytes);
+
+        if (!self->write_queue_.Empty())
+        {
+          self->AsyncWrite();
+        }
+        if (!self->reading_ && self->write_queue_.Size() <= self->high_water_mark_ / 2)
+        {
+          self->AsyncRead();
+        }
+      }
+    )
+  );
+}
+
+template<typename Codec>
+func Session<Codec>::AsyncWriteZeroCopy() -> void
+{
+  std::size_t buffers_count{write_queue_.Gather(gathered_buffers_.data(), gathered_buffers_.size(), write_quantum_)};
+  socket_.async_send(
+    std::span<const net::const_buffer>{gathered_buffers_.data(), buffers_count},
+    MSG_ZEROCOPY,
+    MakeCustomAllocHandler(
+      write_handler_memory_,
+      [self = this->shared_from_this()](boost::system::error_code error_code, size_t processed_bytes) -> void
+      {
+        if (error_code)
+        {
+          self->Close();
+          return;
+        }
+        self->writing_ = false;
+        AddMetric(kMetricSentBytes, processed_bytes);
+
+        // Every successful MSG_ZEROCOPY send gets the next id of the per-socket counter.
+        self->write_queue_.ConsumeZeroCopy(processed_bytes, self->zero_copy_next_id_++);
+        ReleaseMemory(processed_bytes);
+        if (!self->waiting_completions_)
+        {
+          self->AsyncWaitZeroCopyCompletions();
+        }
+
+        if (!self->write_queue_.Empty())
+        {
+          self->AsyncWrite();
+        }
+        if (!self->reading_ && self->write_queue_.Size() <= self->high_water_mark_ / 2)
+        {
+          self->AsyncRead();
+        }
+      }
+    )
+  );
+}
+
+template<typename Codec>
+func Session<Codec>::AsyncWaitZeroCopyCompletions() -> void
+{
+  // Completions queued before the wait is armed do not raise a new EPOLLERR edge.
+  ReadZeroCopyCompletions();
+  if (!write_queue_.Pinned())
+  {
+    return;
+  }
+  waiting_completions_ = true;
+  socket_.async_wait(
+    net::socket_base::wait_error,
+    MakeCustomAllocHandler(
+      completion_handler_memory_,
+      [self = this->shared_from_this()](boost::system::error_code error_code) -> void
+      {
+        self->waiting_completions_ = false;
+        if (error_code)
+        {
+          return;
+        }
+        self->AsyncWaitZeroCopyCompletions();
+      }
+    )
+  );
+}
+
+template<typename Codec>
+func Session<Codec>::ReadZeroCopyCompletions() -> void
+{
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err))];
+  for (;;)
+  {
+    msghdr message;
+    std::memset(&message, 0, sizeof(msghdr));
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (recvmsg(socket_.native_handle(), &message, MSG_ERRQUEUE | MSG_DONTWAIT) == kRecvFailed)
+    {
+      return;
+    }
+
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
     {
-      if (error_code)
+      bool is_ip_error{header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR};
+      bool is_ipv6_error{header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR};
+      if (!is_ip_error && !is_ipv6_error)
+      {
+        continue;
+      }
+      sock_extended_err error;
+      std::memcpy(&error, CMSG_DATA(header), sizeof(sock_extended_err));
+      if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0)
+      {
+        continue;
+      }
+      if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
       {
-        return;
+        // The device could not send from user pages, pinning them buys nothing.
+        zero_copy_threshold_ = 0;
       }
-      self->buffer_.consume(processed_bytes);
-      self->AsyncRead();
+      // The notification covers the ids in [ee_info, ee_data].
+      write_queue_.Release(error.ee_data);
     }
-  );
+  }
 }
 
-func Session::Start() -> void
+template<typename Codec>
+func Session<Codec>::Start() -> void
 {
+  // Reads after the readiness wait and the reads ahead must not block.
+  boost::system::error_code error_code;
+  socket_.non_blocking(true, error_code);
+  if (error_code)
+  {
+    return;
+  }
+  if (zero_copy_threshold_ != 0)
+  {
+    socket_.set_option(ZeroCopy{true}, error_code);
+    if (error_code)
+    {
+      zero_copy_threshold_ = 0;
+    }
+  }
   AsyncRead();
 }
 
+template class Session<NewlineCodec>;
+template class Session<U16LengthCodec>;
+template class Session<U32LengthCodec>;
+template class Session<VarintLengthCodec>;
+template class Session<FixedSizeCodec>;
+
 }  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <client/session/session_link.hpp>
+#include <common/logger/logger.h>
+#include <common/metrics/metrics.h>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace tcp
+{
+
+thread_local SessionLink* SessionLink::first_{nullptr};
+thread_local SessionLink* SessionLink::last_{nullptr};
+thread_local bool SessionLink::draining_{false};
+bool SessionLink::tracks_activity_{false};
+
+SessionLink::SessionLink(net::ip::tcp::socket& socket) noexcept
+  : socket_{socket}  //
+  , prev_{nullptr}
+  , next_{nullptr}
+  , active_at_{tracks_activity_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}}
+{
+  LinkFirst();
+  if (draining_)
+  {
+    Drain();
+  }
+}
+
+SessionLink::~SessionLink()
+{
+  Unlink();
+}
+
+func SessionLink::DrainThread() -> void
+{
+  draining_ = true;
+  for (SessionLink* link = first_; link != nullptr; link = link->next_)
+  {
+    link->Drain();
+  }
+}
+
+func SessionLink::TrackActivity() noexcept -> void
+{
+  tracks_activity_ = true;
+}
+
+func SessionLink::EvictIdle(std::chrono::milliseconds idle_time) -> bool
+{
+  SessionLink* link{last_};
+  if (link == nullptr || std::chrono::steady_clock::now() - link->active_at_ < idle_time)
+  {
+    return false;
+  }
+  LOG_INFO("[MESSAGE] Connection evicted to admit a new one: %d", link->socket_.native_handle());
+  AddMetric(kMetricEvictedConnections, 1);
+  // The session closes as after a failed read; until then its link is out of the way of the next eviction.
+  boost::system::error_code error_code;
+  link->socket_.shutdown(net::socket_base::shutdown_both, error_code);
+  link->MoveToFront();
+  return true;
+}
+
+func SessionLink::MoveToFront() noexcept -> void
+{
+  active_at_ = std::chrono::steady_clock::now();
+  if (first_ == this)
+  {
+    return;
+  }
+  Unlink();
+  LinkFirst();
+}
+
+func SessionLink::Unlink() noexcept -> void
+{
+  if (prev_ != nullptr)
+  {
+    prev_->next_ = next_;
+  }
+  else
+  {
+    first_ = next_;
+  }
+  if (next_ != nullptr)
+  {
+    next_->prev_ = prev_;
+  }
+  else
+  {
+    last_ = prev_;
+  }
+}
+
+func SessionLink::LinkFirst() noexcept -> void
+{
+  prev_ = nullptr;
+  next_ = first_;
+  if (next_ != nullptr)
+  {
+    next_->prev_ = this;
+  }
+  else
+  {
+    last_ = this;
+  }
+  first_ = this;
+}
+
+func SessionLink::Drain() noexcept -> void
+{
+  // Wakes the pending read up, the socket of a closed session fails the call harmlessly.
+  boost::system::error_code error_code;
+  socket_.shutdown(net::socket_base::shutdown_receive, error_code);
+}
+
+}  // namespace tcp
\ No newline at end of file
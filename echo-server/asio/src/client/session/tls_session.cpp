@@ -0,0 +1,192 @@
+#include <client/session/tls_session.hpp>
+#include <common/memory/memory_budget.h>
+#include <common/metrics/metrics.h>
+#include <cstring>
+#include <limits>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace tcp
+{
+
+template<typename Codec>
+TlsSession<Codec>::TlsSession(
+  net::ip::tcp::socket& socket,  //
+  TlsStream& stream,
+  SessionLink& link,
+  const SessionOptions& options
+)
+  : stream_{stream}  //
+  , link_{link}
+  , signal_{socket.get_executor(), net::steady_timer::time_point::max()}
+  , codec_{options.max_frame_size}
+  , read_buffer_{codec_.BufferSize()}
+  , read_size_{0}
+  , rate_limiter_{socket, options.rate_limits, options.peer_rate_limits}
+  , flush_threshold_{options.flush_threshold}
+  , write_quantum_{options.write_quantum}
+  , accepted_at_{GetMetricsTimestamp()}
+{ }
+
+template<typename Codec>
+TlsSession<Codec>::~TlsSession()
+{
+  ReleaseMemory(write_queue_.Size());
+  AddMetric(kMetricClosedConnections, 1);
+  RecordMetric(kMetricConnectionDuration, GetMetricsTimestamp() - accepted_at_);
+}
+
+template<typename Codec>
+func TlsSession<Codec>::Run() -> net::awaitable<void>
+{
+  for (;;)
+  {
+    boost::system::error_code error_code;
+    if (rate_limiter_.Enabled())
+    {
+      const std::size_t read_limit{read_buffer_.Allocated() ? read_buffer_.Size() - read_size_ : codec_.BufferSize()};
+      if (!rate_limiter_.Admit(read_limit, signal_.get_executor(), &TlsSession::ResumeRead, this, nullptr))
+      {
+        // Woken up by the pacer cancelling the wait, the error is expected.
+        signal_.expires_at(net::steady_timer::time_point::max());
+        co_await signal_.async_wait(net::redirect_error(net::use_awaitable, error_code));
+        continue;
+      }
+    }
+    if (!read_buffer_.Allocated())
+    {
+      co_await stream_.WaitReadable(error_code);
+      if (error_code)
+      {
+        break;
+      }
+      if (!read_buffer_.Allocate())
+      {
+        Shed();
+        break;
+      }
+    }
+    const std::size_t processed_bytes{
+      co_await stream_.ReadSome(read_buffer_.Data() + read_size_, read_buffer_.Size() - read_size_, error_code)
+    };
+    if (error_code)
+    {
+      break;
+    }
+    const bool framed{QueueFrames(processed_bytes)};
+    // The records OpenSSL has decrypted already are echoed with the same round of writes.
+    if (framed && stream_.Pending() && write_queue_.Size() < flush_threshold_)
+    {
+      continue;
+    }
+    if (!co_await Flush() || !framed)
+    {
+      break;
+    }
+    if (read_size_ == 0 && !stream_.Pending())
+    {
+      read_buffer_.Free();
+    }
+  }
+}
+
+template<typename Codec>
+func TlsSession<Codec>::QueueFrames(std::size_t processed_bytes) -> bool
+{
+  AddMetric(kMetricReceivedBytes, processed_bytes);
+  RecordMetric(kMetricReadSize, processed_bytes);
+  link_.Touch();
+
+  char* data{read_buffer_.Data()};
+  const std::size_t scanned_bytes{read_size_};
+  read_size_ += processed_bytes;
+  read_buffer_.Adapt(read_size_);
+  const std::size_t framed_bytes{codec_.Frame(data, read_size_, scanned_bytes)};
+  if (framed_bytes == kMalformedFrame)
+  {
+    return false;
+  }
+  rate_limiter_.Charge(processed_bytes, rate_limiter_.CountsMessages() ? codec_.Count(data, framed_bytes) : 0);
+  if (framed_bytes == 0 && read_size_ == read_buffer_.Size())
+  {
+    // The incomplete frame fills the buffer: it is longer than any valid frame unless the buffer may still grow.
+    if (!read_buffer_.Growable())
+    {
+      return false;
+    }
+    if (!read_buffer_.Grow(read_size_))
+    {
+      Shed();
+      return false;
+    }
+    return true;
+  }
+  if (framed_bytes != 0)
+  {
+    if (!ReserveMemory(framed_bytes))
+    {
+      Shed();
+      return false;
+    }
+    write_queue_.Append(data, framed_bytes);
+    read_size_ -= framed_bytes;
+    std::memmove(data, data + framed_bytes, read_size_);
+  }
+  return true;
+}
+
+template<typename Codec>
+func TlsSession<Codec>::ResumeRead(void* session) -> void
+{
+  static_cast<TlsSession*>(session)->signal_.cancel();
+}
+
+template<typename Codec>
+func TlsSession<Codec>::Flush() -> net::awaitable<bool>
+{
+  const std::size_t max_bytes{write_quantum_ == 0 ? std::numeric_limits<std::size_t>::max() : write_quantum_};
+  while (!write_queue_.Empty())
+  {
+    const std::size_t buffers_count{write_queue_.Gather(gathered_buffers_.data(), gathered_buffers_.size(), max_bytes)};
+    std::size_t processed_bytes{0};
+    for (std::size_t i = 0; i < buffers_count; ++i)
+    {
+      boost::system::error_code error_code;
+      co_await stream_.Write(
+        static_cast<const char*>(gathered_buffers_[i].data()),
+        gathered_buffers_[i].size(),
+        error_code
+      );
+      if (error_code)
+      {
+        co_return false;
+      }
+      processed_bytes += gathered_buffers_[i].size();
+    }
+    AddMetric(kMetricSentBytes, processed_bytes);
+    write_queue_.Consume(processed_bytes);
+    ReleaseMemory(processed_bytes);
+    if (write_quantum_ != 0 && !write_queue_.Empty())
+    {
+      // OpenSSL writes to a writable socket without suspending, the other sessions of the thread run in between.
+      co_await net::post(signal_.get_executor(), net::use_awaitable);
+    }
+  }
+  co_return true;
+}
+
+template<typename Codec>
+func TlsSession<Codec>::Shed() -> void
+{
+  AddMetric(kMetricShedConnections, 1);
+}
+
+template class TlsSession<NewlineCodec>;
+template class TlsSession<U16LengthCodec>;
+template class TlsSession<U32LengthCodec>;
+template class TlsSession<VarintLengthCodec>;
+template class TlsSession<FixedSizeCodec>;
+
+}  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include <boost/asio/ssl/error.hpp>
+#include <client/tls/tls_context.hpp>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <string_view>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace
+{
+
+constexpr const char* kTls12Ciphers{"ECDHE+AESGCM:ECDHE+CHACHA20"};
+constexpr std::string_view kSessionIdContext{"echo-server"};
+constexpr std::size_t kNewSessionTickets{1};
+
+}  // namespace
+
+namespace tcp
+{
+
+TlsContext::TlsContext(
+  const std::string& certificate_chain_file,  //
+  const std::string& private_key_file
+)
+  : context_{net::ssl::context::tls_server}
+{
+  context_.set_options(
+    net::ssl::context::default_workarounds | net::ssl::context::no_sslv2 | net::ssl::context::no_sslv3 |
+    net::ssl::context::no_tlsv1 | net::ssl::context::no_tlsv1_1 | net::ssl::context::single_dh_use
+  );
+  context_.use_certificate_chain_file(certificate_chain_file);
+  context_.use_private_key_file(private_key_file, net::ssl::context::pem);
+
+  SSL_CTX* native_context{context_.native_handle()};
+  // TLS 1.3 has only AEAD suites, TLS 1.2 is limited to the ones the kernel can encrypt.
+  if (SSL_CTX_set_cipher_list(native_context, kTls12Ciphers) != 1)
+  {
+    throw boost::system::system_error{
+      boost::system::error_code{static_cast<int>(ERR_get_error()), net::error::get_ssl_category()},
+      "SSL_CTX_set_cipher_list"
+    };
+  }
+#if !defined(OPENSSL_NO_KTLS)
+  SSL_CTX_set_options(native_context, SSL_OP_ENABLE_KTLS);
+#endif
+  SSL_CTX_set_options(native_context, SSL_OP_NO_RENEGOTIATION);
+  SSL_CTX_set_mode(native_context, SSL_MODE_RELEASE_BUFFERS);
+  SSL_CTX_set_session_cache_mode(native_context, SSL_SESS_CACHE_SERVER);
+  SSL_CTX_set_session_id_context(
+    native_context,
+    reinterpret_cast<const unsigned char*>(kSessionIdContext.data()),
+    static_cast<unsigned>(kSessionIdContext.size())
+  );
+  SSL_CTX_set_num_tickets(native_context, kNewSessionTickets);
+}
+
+func TlsContext::NativeHandle() noexcept -> SSL_CTX*
+{
+  return context_.native_handle();
+}
+
+}  // namespace tcp
\ No newline at end of file
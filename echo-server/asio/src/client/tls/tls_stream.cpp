@@ -0,0 +1,157 @@
+#include <boost/asio/ssl/error.hpp>
+#include <cerrno>
+#include <client/tls/tls_stream.hpp>
+#include <new>
+#include <openssl/err.h>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace tcp
+{
+
+TlsStream::TlsStream(
+  net::ip::tcp::socket& socket,  //
+  TlsContext& context
+)
+  : socket_{socket}  //
+  , ssl_{SSL_new(context.NativeHandle())}
+{
+  if (ssl_ == nullptr)
+  {
+    throw std::bad_alloc{};
+  }
+  boost::system::error_code error_code;
+  socket_.non_blocking(true, error_code);
+  SSL_set_fd(ssl_, socket_.native_handle());
+  SSL_set_accept_state(ssl_);
+}
+
+TlsStream::~TlsStream()
+{
+  SSL_free(ssl_);
+}
+
+func TlsStream::Handshake(boost::system::error_code& error_code) -> net::awaitable<void>
+{
+  error_code.clear();
+  while (!error_code)
+  {
+    ERR_clear_error();
+    const int result{SSL_do_handshake(ssl_)};
+    if (result == 1)
+    {
+      co_return;
+    }
+    co_await Wait(result, error_code);
+  }
+}
+
+func TlsStream::ReadSome(
+  char* data,  //
+  std::size_t size,
+  boost::system::error_code& error_code
+) -> net::awaitable<std::size_t>
+{
+  error_code.clear();
+  while (!error_code)
+  {
+    ERR_clear_error();
+    std::size_t processed_bytes;
+    const int result{SSL_read_ex(ssl_, data, size, &processed_bytes)};
+    if (result == 1)
+    {
+      co_return processed_bytes;
+    }
+    co_await Wait(result, error_code);
+  }
+  co_return 0;
+}
+
+func TlsStream::Write(
+  const char* data,  //
+  std::size_t size,
+  boost::system::error_code& error_code
+) -> net::awaitable<void>
+{
+  error_code.clear();
+  while (!error_code)
+  {
+    // A write that has to wait is retried with the same arguments, OpenSSL has encrypted the record already.
+    ERR_clear_error();
+    std::size_t processed_bytes;
+    const int result{SSL_write_ex(ssl_, data, size, &processed_bytes)};
+    if (result == 1)
+    {
+      co_return;
+    }
+    co_await Wait(result, error_code);
+  }
+}
+
+func TlsStream::WaitReadable(boost::system::error_code& error_code) -> net::awaitable<void>
+{
+  co_await socket_.async_wait(net::socket_base::wait_read, net::redirect_error(net::use_awaitable, error_code));
+}
+
+func TlsStream::Pending() const noexcept -> bool
+{
+  return SSL_has_pending(ssl_) == 1;
+}
+
+func TlsStream::Resumed() const noexcept -> bool
+{
+  return SSL_session_reused(ssl_) == 1;
+}
+
+func TlsStream::Offloaded() const noexcept -> bool
+{
+#if !defined(OPENSSL_NO_KTLS)
+  return BIO_get_ktls_send(SSL_get_wbio(ssl_)) && BIO_get_ktls_recv(SSL_get_rbio(ssl_)) && !Pending();
+#else
+  return false;
+#endif
+}
+
+func TlsStream::Wait(
+  int result,  //
+  boost::system::error_code& error_code
+) -> net::awaitable<void>
+{
+  const int system_error{errno};
+  switch (SSL_get_error(ssl_, result))
+  {
+    case SSL_ERROR_WANT_READ :
+    {
+      co_await socket_.async_wait(net::socket_base::wait_read, net::redirect_error(net::use_awaitable, error_code));
+      break;
+    }
+    case SSL_ERROR_WANT_WRITE :
+    {
+      co_await socket_.async_wait(net::socket_base::wait_write, net::redirect_error(net::use_awaitable, error_code));
+      break;
+    }
+    case SSL_ERROR_ZERO_RETURN :
+    {
+      error_code = net::error::eof;
+      break;
+    }
+    case SSL_ERROR_SYSCALL :
+    {
+      error_code = system_error != 0 ? boost::system::error_code{system_error, boost::system::system_category()}
+                                     : boost::system::error_code{net::ssl::error::stream_truncated};
+      break;
+    }
+    default :
+    {
+      const unsigned long ssl_error{ERR_get_error()};
+      error_code = ssl_error != 0
+                   ? boost::system::error_code{static_cast<int>(ssl_error), net::error::get_ssl_category()}
+                   : boost::system::error_code{net::error::connection_aborted};
+      break;
+    }
+  }
+}
+
+}  // namespace tcp
\ No newline at end of file
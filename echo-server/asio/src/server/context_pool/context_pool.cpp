@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <server/context_pool/context_pool.hpp>
+
+#if defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace
+{
+
+constexpr int kConcurrencyHint{1};
+
+func PinCurrentThread(std::size_t index) -> void
+{
+#if defined(__linux__)
+  const unsigned cpus_count{std::max(std::thread::hardware_concurrency(), 1U)};
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(index % cpus_count, &cpu_set);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+#else
+  static_cast<void>(index);
+#endif
+}
+
+func RunSpinning(
+  net::io_context& context,  //
+  std::chrono::microseconds spin_time
+) -> void
+{
+  using Clock = std::chrono::steady_clock;
+  while (!context.stopped())
+  {
+    // poll() also polls the reactor without blocking, so the loop picks up new I/O as well as posted handlers.
+    Clock::time_point idle_since{Clock::now()};
+    while (!context.stopped())
+    {
+      if (context.poll() != 0)
+      {
+        idle_since = Clock::now();
+      }
+      else if (Clock::now() - idle_since >= spin_time)
+      {
+        break;
+      }
+    }
+    context.run_one();
+  }
+}
+
+}  // namespace
+
+namespace tcp
+{
+
+ContextPool::ContextPool(
+  std::size_t size,  //
+  bool pin_threads,
+  std::chrono::microseconds spin_time
+)
+  : running_threads_{0}  //
+  , draining_{false}
+  , next_context_{0}
+  , pin_threads_{pin_threads}
+  , spin_time_{spin_time}
+{
+  size = std::max<std::size_t>(size, 1);
+  contexts_.reserve(size);
+  work_guards_.reserve(size);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    contexts_.push_back(std::make_unique<net::io_context>(kConcurrencyHint));
+    work_guards_.push_back(net::make_work_guard(*contexts_.back()));
+  }
+}
+
+func ContextPool::NextContext() -> net::io_context&
+{
+  net::io_context& context{*contexts_[next_context_]};
+  next_context_ = (next_context_ + 1) % contexts_.size();
+  return context;
+}
+
+func ContextPool::Context(std::size_t index) -> net::io_context&
+{
+  return *contexts_.at(index);
+}
+
+func ContextPool::Size() const noexcept -> std::size_t
+{
+  return contexts_.size();
+}
+
+func ContextPool::Run() -> void
+{
+  running_threads_ = contexts_.size();
+  threads_.reserve(contexts_.size());
+  for (std::size_t i = 0; i < contexts_.size(); ++i)
+  {
+    threads_.emplace_back(
+      [this, i]() -> void
+      {
+        if (pin_threads_)
+        {
+          PinCurrentThread(i);
+        }
+        if (spin_time_ == std::chrono::microseconds::zero())
+        {
+          contexts_[i]->run();
+        }
+        else
+        {
+          RunSpinning(*contexts_[i], spin_time_);
+        }
+        const std::lock_guard<std::mutex> lock{mutex_};
+        --running_threads_;
+        threads_finished_.notify_all();
+      }
+    );
+  }
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+    threads_finished_.wait(
+      lock,
+      [this]() -> bool
+      {
+        return draining_ || running_threads_ == 0;
+      }
+    );
+    const bool finished{threads_finished_.wait_until(
+      lock,
+      drain_deadline_,
+      [this]() -> bool
+      {
+        return running_threads_ == 0;
+      }
+    )};
+    if (!finished)
+    {
+      for (std::unique_ptr<net::io_context>& context : contexts_)
+      {
+        context->stop();
+      }
+    }
+  }
+  for (std::thread& thread : threads_)
+  {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+func ContextPool::Stop() -> void
+{
+  const std::lock_guard<std::mutex> lock{mutex_};
+  for (WorkGuard& work_guard : work_guards_)
+  {
+    work_guard.reset();
+  }
+  for (std::unique_ptr<net::io_context>& context : contexts_)
+  {
+    context->stop();
+  }
+}
+
+func ContextPool::Drain(std::chrono::milliseconds timeout) -> void
+{
+  const std::lock_guard<std::mutex> lock{mutex_};
+  draining_ = true;
+  drain_deadline_ = std::chrono::steady_clock::now() + timeout;
+  for (WorkGuard& work_guard : work_guards_)
+  {
+    work_guard.reset();
+  }
+  threads_finished_.notify_all();
+}
+
+}  // namespace tcp
\ No newline at end of file
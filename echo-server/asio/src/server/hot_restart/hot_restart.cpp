@@ -0,0 +1,148 @@
+#include <cerrno>
+#include <common/logger/logger.h>
+#include <common/restart/restart.h>
+#include <cstring>
+#include <server/hot_restart/hot_restart.hpp>
+#include <unistd.h>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace
+{
+
+constexpr int kNoDescriptor{-1};
+
+[[noreturn]] func ThrowRestartError(const char* what) -> void
+{
+  throw boost::system::system_error{boost::system::error_code{errno, boost::system::system_category()}, what};
+}
+
+}  // namespace
+
+namespace tcp
+{
+
+HotRestart::HotRestart(
+  net::io_context& context,  //
+  std::string path
+)
+  : path_{std::move(path)}  //
+  , predecessor_{kNoDescriptor}
+  , control_socket_{context}
+  , successor_{context}
+{ }
+
+HotRestart::~HotRestart()
+{
+  if (predecessor_ != kNoDescriptor)
+  {
+    ::close(predecessor_);
+  }
+}
+
+func HotRestart::TakeOver() -> std::vector<int>
+{
+  std::vector<int> listeners(RESTART_MAX_LISTENERS);
+  std::size_t listeners_count{0};
+  const int predecessor{TakeOverListeners(path_.c_str(), listeners.data(), listeners.size(), &listeners_count)};
+  if (predecessor == kNoPredecessor)
+  {
+    return {};
+  }
+  if (predecessor == kRestartFailed)
+  {
+    ThrowRestartError("TakeOverListeners");
+  }
+  predecessor_ = predecessor;
+  listeners.resize(listeners_count);
+  return listeners;
+}
+
+func HotRestart::Listen(
+  std::vector<int> listeners,  //
+  std::function<void()> on_taken_over
+) -> void
+{
+  listeners_ = std::move(listeners);
+  on_taken_over_ = std::move(on_taken_over);
+  if (predecessor_ != kNoDescriptor)
+  {
+    const int predecessor{predecessor_};
+    predecessor_ = kNoDescriptor;
+    if (ConfirmTakeover(predecessor) == kRestartFailed)
+    {
+      LOG_WARNING("Server received error: takeover confirmation failed: [%d](%s)", errno, strerror(errno));
+    }
+  }
+  const int control_socket{ListenForSuccessor(path_.c_str())};
+  if (control_socket == kRestartFailed)
+  {
+    ThrowRestartError("ListenForSuccessor");
+  }
+  control_socket_.assign(control_socket);
+  AsyncAcceptSuccessor();
+}
+
+func HotRestart::Close(bool taken_over) -> void
+{
+  if (!control_socket_.is_open())
+  {
+    return;
+  }
+  boost::system::error_code error_code;
+  control_socket_.close(error_code);
+  successor_.close(error_code);
+  if (!taken_over)
+  {
+    ::unlink(path_.c_str());
+  }
+}
+
+func HotRestart::AsyncAcceptSuccessor() -> void
+{
+  control_socket_.async_wait(
+    net::posix::descriptor_base::wait_read,
+    [this](boost::system::error_code error_code) -> void
+    {
+      if (error_code)
+      {
+        return;
+      }
+      const int successor{HandOverListeners(control_socket_.native_handle(), listeners_.data(), listeners_.size())};
+      if (successor == kRestartFailed)
+      {
+        LOG_WARNING("Server received error: listeners handover failed: [%d](%s)", errno, strerror(errno));
+        AsyncAcceptSuccessor();
+        return;
+      }
+      successor_.assign(successor);
+      AsyncWaitTakeover();
+    }
+  );
+}
+
+func HotRestart::AsyncWaitTakeover() -> void
+{
+  successor_.async_wait(
+    net::posix::descriptor_base::wait_read,
+    [this](boost::system::error_code error_code) -> void
+    {
+      if (error_code)
+      {
+        return;
+      }
+      if (ReceiveTakeover(successor_.release()) == kRestartFailed)
+      {
+        // The successor went away without serving, the listeners are still ours.
+        LOG_WARNING("Server received error: successor failed to take over: [%d](%s)", errno, strerror(errno));
+        AsyncAcceptSuccessor();
+        return;
+      }
+      on_taken_over_();
+    }
+  );
+}
+
+}  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include <server/load_monitor/load_monitor.hpp>
+#include <common/metrics/metrics.h>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace
+{
+
+// Weight of the latest probe in the smoothed lag is 1/kLoopLagWeight.
+constexpr std::chrono::microseconds::rep kLoopLagWeight{4};
+
+}  // namespace
+
+namespace tcp
+{
+
+LoadMonitor::LoadMonitor(
+  net::io_context& context,  //
+  std::chrono::milliseconds max_loop_lag
+)
+  : timer_{context}  //
+  , max_loop_lag_{max_loop_lag}
+  , loop_lag_{0}
+  , overloaded_{false}
+  , stopped_{false}
+{ }
+
+func LoadMonitor::Start() -> void
+{
+  stopped_ = false;
+  AsyncProbe();
+}
+
+func LoadMonitor::Stop() -> void
+{
+  stopped_ = true;
+  timer_.cancel();
+  overloaded_.store(false, std::memory_order_relaxed);
+}
+
+func LoadMonitor::AsyncProbe() -> void
+{
+  timer_.expires_after(kLoadProbeInterval);
+  timer_.async_wait(MakeCustomAllocHandler(
+    handler_memory_,
+    [this](boost::system::error_code error_code) -> void
+    {
+      if (error_code || stopped_)
+      {
+        return;
+      }
+      const auto probe_lag{
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - timer_.expiry())
+      };
+      RecordMetric(kMetricLoopLag, static_cast<std::uint64_t>(probe_lag.count()));
+      loop_lag_ += (probe_lag - loop_lag_) / kLoopLagWeight;
+      overloaded_.store(loop_lag_ >= max_loop_lag_, std::memory_order_relaxed);
+      AsyncProbe();
+    }
+  ));
+}
+
+}  // namespace tcp
\ No newline at end of file
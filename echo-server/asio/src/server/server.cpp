@@ -1,36 +1,524 @@
 #include <server/server.hpp>
+#include <client/memory/recycling_allocator.hpp>
+#include <client/session/coroutine_session.hpp>
 #include <client/session/session.hpp>
+#include <client/session/session_link.hpp>
+#include <client/session/tls_session.hpp>
+#include <client/tls/tls_stream.hpp>
+#include <common/logger/logger.h>
+#include <common/memory/memory_budget.h>
+#include <common/metrics/metrics.h>
+#include <memory>
+#include <netinet/tcp.h>
+#include <optional>
+#include <unistd.h>
 
 #define func auto
 
 namespace net = boost::asio;
 
+namespace
+{
+
+using ReusePort = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+using BusyPoll = net::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>;
+using PreferBusyPoll = net::detail::socket_option::boolean<SOL_SOCKET, SO_PREFER_BUSY_POLL>;
+using DeferAccept = net::detail::socket_option::integer<IPPROTO_TCP, TCP_DEFER_ACCEPT>;
+
+func MakeAcceptor(
+  net::io_context& context,  //
+  const net::ip::tcp::endpoint& endpoint,
+  const tcp::ListenerOptions& options,
+  bool reuse_port,
+  std::uint32_t busy_poll
+) -> net::ip::tcp::acceptor
+{
+  net::ip::tcp::acceptor acceptor{context};
+  acceptor.open(endpoint.protocol());
+  acceptor.set_option(net::socket_base::reuse_address{true});
+  if (reuse_port)
+  {
+    acceptor.set_option(ReusePort{true});
+  }
+  if (busy_poll != 0)
+  {
+    // The accepted sockets inherit the busy polling of the acceptor.
+    acceptor.set_option(BusyPoll{static_cast<int>(busy_poll)});
+    acceptor.set_option(PreferBusyPoll{true});
+  }
+  // The accepted sockets inherit the buffer sizes as well.
+  if (options.receive_buffer_size != 0)
+  {
+    acceptor.set_option(net::socket_base::receive_buffer_size{options.receive_buffer_size});
+  }
+  if (options.send_buffer_size != 0)
+  {
+    acceptor.set_option(net::socket_base::send_buffer_size{options.send_buffer_size});
+  }
+  if (options.defer_accept != 0)
+  {
+    acceptor.set_option(DeferAccept{options.defer_accept});
+  }
+  acceptor.bind(endpoint);
+  acceptor.listen(options.backlog);
+  return acceptor;
+}
+
+func AdoptAcceptor(
+  net::io_context& context,  //
+  const net::ip::tcp::endpoint& endpoint,
+  int native_listener
+) -> std::optional<net::ip::tcp::acceptor>
+{
+  boost::system::error_code error_code;
+  net::ip::tcp::acceptor acceptor{context};
+  acceptor.assign(endpoint.protocol(), native_listener, error_code);
+  if (error_code)
+  {
+    ::close(native_listener);
+    return std::nullopt;
+  }
+  if (acceptor.local_endpoint(error_code) != endpoint || error_code)
+  {
+    return std::nullopt;
+  }
+  return acceptor;
+}
+
+func LogAcceptedConnection(net::ip::tcp::socket& socket) -> void
+{
+  boost::system::error_code error_code;
+  const net::ip::tcp::endpoint peer{socket.remote_endpoint(error_code)};
+  if (error_code)
+  {
+    return;
+  }
+  // The acceptors are IPv4 only; the address is logged from its bytes to keep accept allocation-free.
+  const net::ip::address_v4::bytes_type address{peer.address().to_v4().to_bytes()};
+  LOG_INFO(
+    "Server accepted connection on: %d\n\taddress: %u.%u.%u.%u;\n\tport: %u",  //
+    socket.native_handle(),
+    address[0],
+    address[1],
+    address[2],
+    address[3],
+    static_cast<unsigned>(peer.port())
+  );
+}
+
+func RejectConnection(net::ip::tcp::socket& socket) -> void
+{
+  // With a zero linger the close resets the connection, the peer learns at once that it has to come back later.
+  boost::system::error_code error_code;
+  socket.set_option(net::socket_base::linger{true, 0}, error_code);
+  socket.close(error_code);
+  AddMetric(kMetricRejectedConnections, 1);
+  AddMetric(kMetricClosedConnections, 1);
+}
+
+}  // namespace
+
 namespace tcp
 {
 
 Server::Server(
+  ContextPool& pool,  //
+  const net::ip::tcp::endpoint& endpoint,
+  const ListenerOptions& listener_options,
+  const OverloadOptions& overload_options,
+  AcceptMode mode,
+  const SessionOptions& session_options,
+  TlsContext* tls_context,
+  std::span<const int> inherited_listeners
+)
+  : pool_{pool}  //
+  , mode_{mode}
+  , busy_poll_{session_options.busy_poll}
+  , overload_options_{overload_options}
+  , session_options_{std::make_shared<const SessionOptions>(session_options)}
+  , tls_context_{tls_context}
+{
+  const std::size_t listeners_count{mode_ == AcceptMode::kReusePort ? pool_.Size() : 1};
+  std::vector<net::ip::tcp::acceptor> inherited_acceptors;
+  if (inherited_listeners.size() == listeners_count)
+  {
+    for (std::size_t i = 0; i < listeners_count; ++i)
+    {
+      std::optional<net::ip::tcp::acceptor> acceptor{AdoptAcceptor(pool_.Context(i), endpoint, inherited_listeners[i])};
+      if (acceptor)
+      {
+        inherited_acceptors.push_back(std::move(*acceptor));
+      }
+    }
+  }
+  else
+  {
+    for (const int native_listener : inherited_listeners)
+    {
+      ::close(native_listener);
+    }
+  }
+  // A partial set is dropped: with SO_REUSEPORT the new acceptors bind next to the inherited ones until these close.
+  if (inherited_acceptors.size() != listeners_count)
+  {
+    inherited_acceptors.clear();
+  }
+
+  listeners_.reserve(listeners_count);
+  for (std::size_t i = 0; i < listeners_count; ++i)
+  {
+    listeners_.push_back(std::make_unique<Listener>(
+      pool_.Context(i),
+      inherited_acceptors.empty()
+        ? MakeAcceptor(pool_.Context(i), endpoint, listener_options, mode_ == AcceptMode::kReusePort, busy_poll_)
+        : std::move(inherited_acceptors[i])
+    ));
+  }
+
+  if (overload_options_.max_loop_lag.count() == 0)
+  {
+    return;
+  }
+  monitors_.reserve(pool_.Size());
+  for (std::size_t i = 0; i < pool_.Size(); ++i)
+  {
+    monitors_.push_back(std::make_unique<LoadMonitor>(pool_.Context(i), overload_options_.max_loop_lag));
+  }
+  if (overload_options_.action == OverloadAction::kCloseIdle)
+  {
+    SessionLink::TrackActivity();
+  }
+}
+
+Server::Listener::Listener(
   net::io_context& context,  //
-  net::ip::port_type port
+  net::ip::tcp::acceptor&& acceptor
 )
   : context_{context}  //
-  , acceptor_{context, net::ip::tcp::endpoint{net::ip::tcp::v4(), port}}
+  , acceptor_{std::move(acceptor)}
+  , retry_timer_{context}
+  , paused_{false}
 { }
 
 func Server::AsyncAccept() -> void
 {
-  socket_.emplace(context_);
-  acceptor_.async_accept(
-    *socket_,
-    [this](boost::system::error_code error_code) -> void
+  for (std::size_t i = 0; i < monitors_.size(); ++i)
+  {
+    net::post(
+      pool_.Context(i),
+      [&monitor = *monitors_[i]]() -> void
+      {
+        monitor.Start();
+      }
+    );
+  }
+  for (std::unique_ptr<Listener>& listener : listeners_)
+  {
+    AsyncAccept(*listener);
+  }
+}
+
+func Server::Stop() -> void
+{
+  for (std::unique_ptr<Listener>& listener : listeners_)
+  {
+    net::post(
+      listener->context_,
+      [&listener = *listener]() -> void
+      {
+        boost::system::error_code error_code;
+        listener.acceptor_.close(error_code);
+        listener.retry_timer_.cancel();
+      }
+    );
+  }
+  for (std::size_t i = 0; i < monitors_.size(); ++i)
+  {
+    net::post(
+      pool_.Context(i),
+      [&monitor = *monitors_[i]]() -> void
+      {
+        monitor.Stop();
+      }
+    );
+  }
+  // Sessions handed off to a context after its drain are shut down as they start.
+  for (std::size_t i = 0; i < pool_.Size(); ++i)
+  {
+    net::post(pool_.Context(i), &SessionLink::DrainThread);
+  }
+}
+
+func Server::NativeListeners() -> std::vector<int>
+{
+  std::vector<int> native_listeners;
+  native_listeners.reserve(listeners_.size());
+  for (std::unique_ptr<Listener>& listener : listeners_)
+  {
+    native_listeners.push_back(listener->acceptor_.native_handle());
+  }
+  return native_listeners;
+}
+
+func Server::Reconfigure(const SessionOptions& session_options) -> void
+{
+  SessionOptions options{session_options};
+  options.busy_poll = busy_poll_;
+  session_options_.store(std::make_shared<const SessionOptions>(options), std::memory_order_release);
+}
+
+func Server::AsyncAccept(Listener& listener) -> void
+{
+  net::io_context* picked_context{PickContext(listener)};
+  if (picked_context == nullptr && overload_options_.action == OverloadAction::kPause)
+  {
+    if (!listener.paused_)
+    {
+      listener.paused_ = true;
+      AddMetric(kMetricAcceptPauses, 1);
+      LOG_INFO("Server is overloaded, accepting is paused");
+    }
+    AsyncRetryAccept(listener, kLoadProbeInterval);
+    return;
+  }
+  if (listener.paused_)
+  {
+    listener.paused_ = false;
+    LOG_INFO("Server caught up, accepting is resumed");
+  }
+  if (picked_context == nullptr)
+  {
+    // Without a context to spare the connection meets the overload action on its round-robin one.
+    picked_context = mode_ == AcceptMode::kReusePort ? &listener.context_ : &pool_.NextContext();
+  }
+  net::io_context& context{*picked_context};
+  listener.acceptor_.async_accept(
+    context,
+    MakeCustomAllocHandler(
+      listener.accept_handler_memory_,
+      [this, &listener, &context](boost::system::error_code error_code, net::ip::tcp::socket socket) -> void
+      {
+        if (error_code == net::error::operation_aborted)
+        {
+          return;
+        }
+        if (error_code)
+        {
+          AddMetric(kMetricAcceptErrors, 1);
+          LOG_WARNING(
+            "Server received error: accept failed: [%d](%s)",  //
+            error_code.value(),
+            error_code.message().c_str()
+          );
+          // Without free descriptors the pending connection fails again at once, the listener waits for some to close.
+          if (error_code == net::error::no_descriptors ||
+              error_code == boost::system::errc::too_many_files_open_in_system)
+          {
+            AsyncRetryAccept(listener, kAcceptRetryDelay);
+          }
+          else
+          {
+            AsyncAccept(listener);
+          }
+          return;
+        }
+        AddMetric(kMetricAcceptedConnections, 1);
+        LogAcceptedConnection(socket);
+        if (IsMemoryBudgetExhausted())
+        {
+          // The socket is closed on return.
+          AddMetric(kMetricShedConnections, 1);
+          AddMetric(kMetricClosedConnections, 1);
+          AsyncAccept(listener);
+          return;
+        }
+        if (overload_options_.action == OverloadAction::kReject && Overloaded(context))
+        {
+          RejectConnection(socket);
+          AsyncAccept(listener);
+          return;
+        }
+        if (&context == &listener.context_)
+        {
+          AdmitSession(context, std::move(socket));
+        }
+        else
+        {
+          // The session (and all its pooled memory) has to be created on the thread of its own context.
+          net::post(
+            context,
+            MakeCustomAllocHandler(
+              listener.handoff_handler_memory_,
+              [this, &context, socket = std::move(socket)]() mutable -> void
+              {
+                AdmitSession(context, std::move(socket));
+              }
+            )
+          );
+        }
+        AsyncAccept(listener);
+      }
+    )
+  );
+}
+
+func Server::AsyncRetryAccept(
+  Listener& listener,  //
+  std::chrono::milliseconds delay
+) -> void
+{
+  listener.retry_timer_.expires_after(delay);
+  listener.retry_timer_.async_wait(
+    [this, &listener](boost::system::error_code error_code) -> void
     {
-      if (error_code)
+      if (!error_code)
       {
-        return;
+        AsyncAccept(listener);
       }
-      std::make_shared<tcp::Session>(std::move(*socket_))->Start();
-      AsyncAccept();
     }
   );
 }
 
+func Server::PickContext(Listener& listener) -> net::io_context*
+{
+  if (mode_ == AcceptMode::kReusePort)
+  {
+    return Overloaded(listener.context_) ? nullptr : &listener.context_;
+  }
+  for (std::size_t i = 0; i < pool_.Size(); ++i)
+  {
+    net::io_context& context{pool_.NextContext()};
+    if (!Overloaded(context))
+    {
+      return &context;
+    }
+  }
+  return nullptr;
+}
+
+func Server::Overloaded(const net::io_context& context) const -> bool
+{
+  for (std::size_t i = 0; i < monitors_.size(); ++i)
+  {
+    if (&pool_.Context(i) == &context)
+    {
+      return monitors_[i]->Overloaded();
+    }
+  }
+  return false;
+}
+
+func Server::AdmitSession(
+  const net::io_context& context,  //
+  net::ip::tcp::socket&& socket
+) -> void
+{
+  if (overload_options_.action == OverloadAction::kCloseIdle && Overloaded(context) &&
+      !SessionLink::EvictIdle(overload_options_.evict_idle))
+  {
+    RejectConnection(socket);
+    return;
+  }
+  StartSession(std::move(socket));
+}
+
+func Server::StartSession(net::ip::tcp::socket&& socket) -> void
+{
+  const std::shared_ptr<const SessionOptions> options{session_options_.load(std::memory_order_acquire)};
+  switch (options->framing)
+  {
+    case Framing::kNewline :
+    {
+      StartSession<NewlineCodec>(std::move(socket), *options);
+      break;
+    }
+    case Framing::kU16Length :
+    {
+      StartSession<U16LengthCodec>(std::move(socket), *options);
+      break;
+    }
+    case Framing::kU32Length :
+    {
+      StartSession<U32LengthCodec>(std::move(socket), *options);
+      break;
+    }
+    case Framing::kVarintLength :
+    {
+      StartSession<VarintLengthCodec>(std::move(socket), *options);
+      break;
+    }
+    case Framing::kFixedSize :
+    {
+      StartSession<FixedSizeCodec>(std::move(socket), *options);
+      break;
+    }
+  }
+}
+
+template<typename Codec>
+func Server::StartSession(
+  net::ip::tcp::socket&& socket,  //
+  const SessionOptions& options
+) -> void
+{
+  if (tls_context_ != nullptr)
+  {
+    const net::any_io_executor executor{socket.get_executor()};
+    net::co_spawn(executor, RunTlsSession<Codec>(std::move(socket), options), net::detached);
+    return;
+  }
+  StartPlainSession<Codec>(std::move(socket), options);
+}
+
+template<typename Codec>
+func Server::StartPlainSession(
+  net::ip::tcp::socket&& socket,  //
+  const SessionOptions& options
+) -> void
+{
+  if (options.coroutine)
+  {
+    CoroutineSession<Codec>::Start(std::move(socket), options);
+    return;
+  }
+  using CodecSession = Session<Codec>;
+  std::allocate_shared<CodecSession>(RecyclingAllocator<CodecSession>{}, std::move(socket), options)->Start();
+}
+
+template<typename Codec>
+func Server::RunTlsSession(
+  net::ip::tcp::socket socket,  //
+  SessionOptions options
+) -> net::awaitable<void>
+{
+  boost::system::error_code error_code;
+  if (options.no_delay)
+  {
+    socket.set_option(net::ip::tcp::no_delay{true}, error_code);
+  }
+  SessionLink link{socket};
+  TlsStream stream{socket, *tls_context_};
+  co_await stream.Handshake(error_code);
+  if (error_code)
+  {
+    AddMetric(kMetricTlsFailedHandshakes, 1);
+    AddMetric(kMetricClosedConnections, 1);
+    co_return;
+  }
+  AddMetric(kMetricTlsHandshakes, 1);
+  if (stream.Resumed())
+  {
+    AddMetric(kMetricTlsResumedHandshakes, 1);
+  }
+  if (stream.Offloaded())
+  {
+    // The kernel encrypts and decrypts the records, the plaintext session keeps its send paths.
+    AddMetric(kMetricTlsOffloadedConnections, 1);
+    StartPlainSession<Codec>(std::move(socket), options);
+    co_return;
+  }
+  TlsSession<Codec> session{socket, stream, link, options};
+  co_await session.Run();
+}
+
 }  // namespace tcp
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include <array>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <netinet/in.h>
+#include <new>
+#include <server/context_pool/context_pool.hpp>
+#include <server/server.hpp>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+
+namespace net = boost::asio;
+
+namespace
+{
+
+constexpr std::size_t kWarmupRoundTrips{100};
+constexpr std::size_t kMeasuredRoundTrips{1000};
+constexpr std::size_t kWarmupConnections{100};
+constexpr std::size_t kMeasuredConnections{500};
+constexpr std::string_view kMessage{"steady state echo\n"};
+
+// Only the allocations of the thread of the context are counted, and only while the client measures.
+thread_local bool counted_thread{false};
+std::atomic<bool> measuring{false};
+std::atomic<std::uint64_t> allocations{0};
+
+auto CountAllocation() noexcept -> void
+{
+  if (counted_thread && measuring.load(std::memory_order_relaxed))
+  {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+auto ListenerPort(tcp::Server& server) -> net::ip::port_type
+{
+  sockaddr_storage address{};
+  socklen_t length{sizeof(address)};
+  ::getsockname(server.NativeListeners().front(), reinterpret_cast<sockaddr*>(&address), &length);
+  return ntohs(reinterpret_cast<const sockaddr_in&>(address).sin_port);
+}
+
+auto RoundTrip(net::ip::tcp::socket& socket) -> bool
+{
+  std::array<char, kMessage.size()> echo{};
+  boost::system::error_code error_code;
+  net::write(socket, net::buffer(kMessage), error_code);
+  net::read(socket, net::buffer(echo), error_code);
+  return !error_code && std::string_view{echo.data(), echo.size()} == kMessage;
+}
+
+// Waits for the server to close its side, so the session is gone before the next connection is accepted.
+auto Disconnect(net::ip::tcp::socket& socket) -> void
+{
+  boost::system::error_code error_code;
+  socket.shutdown(net::socket_base::shutdown_send, error_code);
+  char byte{};
+  net::read(socket, net::buffer(&byte, 1), error_code);
+  socket.close(error_code);
+}
+
+auto Measure(
+  const char* name,  //
+  std::uint64_t rounds,
+  const auto& round
+) -> bool
+{
+  allocations.store(0, std::memory_order_relaxed);
+  measuring.store(true, std::memory_order_relaxed);
+  bool echoed{true};
+  for (std::uint64_t i = 0; i < rounds && echoed; ++i)
+  {
+    echoed = round();
+  }
+  measuring.store(false, std::memory_order_relaxed);
+  const std::uint64_t counted{allocations.load(std::memory_order_relaxed)};
+  std::printf(
+    "%s: %llu rounds, %llu allocations\n",
+    name,
+    static_cast<unsigned long long>(rounds),
+    static_cast<unsigned long long>(counted)
+  );
+  return echoed && counted == 0;
+}
+
+auto Connect(
+  net::io_context& context,  //
+  const net::ip::tcp::endpoint& endpoint
+) -> net::ip::tcp::socket
+{
+  net::ip::tcp::socket socket{context};
+  boost::system::error_code error_code;
+  socket.connect(endpoint, error_code);
+  return socket;
+}
+
+auto RunClient(const net::ip::tcp::endpoint& endpoint) -> bool
+{
+  net::io_context context;
+  net::ip::tcp::socket socket{Connect(context, endpoint)};
+  for (std::size_t i = 0; i < kWarmupRoundTrips; ++i)
+  {
+    RoundTrip(socket);
+  }
+  const bool round_trips{Measure(
+    "round trips",
+    kMeasuredRoundTrips,
+    [&socket]() -> bool
+    {
+      return RoundTrip(socket);
+    }
+  )};
+  Disconnect(socket);
+
+  const auto cycle{[&context, &endpoint]() -> bool
+                   {
+                     net::ip::tcp::socket cycled{Connect(context, endpoint)};
+                     const bool echoed{RoundTrip(cycled)};
+                     Disconnect(cycled);
+                     return echoed;
+                   }};
+  for (std::size_t i = 0; i < kWarmupConnections; ++i)
+  {
+    cycle();
+  }
+  const bool connections{Measure("connections", kMeasuredConnections, cycle)};
+  return round_trips && connections;
+}
+
+}  // namespace
+
+auto operator new(std::size_t size) -> void*
+{
+  CountAllocation();
+  if (void* pointer = std::malloc(size == 0 ? 1 : size))
+  {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+auto operator new(
+  std::size_t size,  //
+  std::align_val_t alignment
+) -> void*
+{
+  CountAllocation();
+  const auto align{static_cast<std::size_t>(alignment)};
+  if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align))
+  {
+    return pointer;
+  }
+  throw std::bad_alloc{};
+}
+
+[[gnu::noinline]] auto operator delete(void* pointer) noexcept -> void
+{
+  std::free(pointer);
+}
+
+[[gnu::noinline]] auto operator delete(
+  void* pointer,  //
+  std::size_t
+) noexcept -> void
+{
+  std::free(pointer);
+}
+
+[[gnu::noinline]] auto operator delete(
+  void* pointer,  //
+  std::align_val_t
+) noexcept -> void
+{
+  std::free(pointer);
+}
+
+[[gnu::noinline]] auto operator delete(
+  void* pointer,  //
+  std::size_t,
+  std::align_val_t
+) noexcept -> void
+{
+  std::free(pointer);
+}
+
+/**
+ * @brief Echoes through a Server on a single context and checks that, once
+ *        the pools are primed, neither round trips on an open connection nor
+ *        whole connect/echo/close cycles allocate on the thread of the context.
+ */
+auto main() -> int
+{
+  tcp::ContextPool pool{1, false};
+  tcp::Server server{
+    pool,
+    net::ip::tcp::endpoint{net::ip::address_v4::loopback(), 0},
+    tcp::ListenerOptions{},
+    tcp::OverloadOptions{},
+    tcp::AcceptMode::kDistribute,
+    tcp::SessionOptions{}
+  };
+  net::post(
+    pool.Context(0),
+    []() -> void
+    {
+      counted_thread = true;
+    }
+  );
+  server.AsyncAccept();
+  const net::ip::tcp::endpoint endpoint{net::ip::address_v4::loopback(), ListenerPort(server)};
+
+  bool passed{false};
+  std::thread client{[&]() -> void
+                     {
+                       passed = RunClient(endpoint);
+                       server.Stop();
+                       pool.Stop();
+                     }};
+  pool.Run();
+  client.join();
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include <client/framing/codecs.hpp>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <string>
+
+#define EXPECT_EQ(actual, expected) Expect((actual) == (expected), #actual " == " #expected, __LINE__)
+
+namespace
+{
+
+constexpr std::size_t kMaxFrameSize{16};
+
+int failures{0};
+
+auto Expect(
+  bool passed,  //
+  const char* expression,
+  int line
+) -> void
+{
+  if (!passed)
+  {
+    std::fprintf(stderr, "codecs_test.cpp:%d: expected %s\n", line, expression);
+    ++failures;
+  }
+}
+
+/**
+ * @brief Frames the data the way the session does: as one read after the
+ *        first scanned bytes that did not complete a frame.
+ */
+template<typename Codec>
+auto Frame(
+  const Codec& codec,  //
+  const std::string& data,
+  std::size_t scanned = 0
+) -> std::size_t
+{
+  return codec.Frame(data.data(), data.size(), scanned);
+}
+
+auto Bytes(std::initializer_list<unsigned char> bytes) -> std::string
+{
+  return std::string{bytes.begin(), bytes.end()};
+}
+
+auto NewlineTests() -> void
+{
+  const tcp::NewlineCodec codec{kMaxFrameSize};
+
+  // A frame split across reads completes with the read holding the delimiter.
+  EXPECT_EQ(Frame(codec, "hel"), 0U);
+  EXPECT_EQ(Frame(codec, "hello\n", 3), 6U);
+
+  // Several frames in one read are framed up to the last delimiter, the tail waits for the next read.
+  const std::string frames{"a\nbb\nccc"};
+  EXPECT_EQ(Frame(codec, frames), 5U);
+  EXPECT_EQ(codec.Count(frames.data(), 5), 2U);
+
+  // The limit includes the delimiter: the buffer holds no more, a full one without it is one byte over.
+  EXPECT_EQ(Frame(codec, std::string(kMaxFrameSize - 1, 'x') + "\n"), kMaxFrameSize);
+  EXPECT_EQ(Frame(codec, std::string(kMaxFrameSize - 1, 'x')), 0U);
+  EXPECT_EQ(Frame(codec, std::string(kMaxFrameSize, 'x')), tcp::kMalformedFrame);
+}
+
+template<typename Codec>
+auto LengthPrefixedTests(std::string (*header)(std::size_t length)) -> void
+{
+  const Codec codec{kMaxFrameSize};
+  const std::string frame{header(5) + "hello"};
+
+  // A frame split across reads, in the header and in the payload.
+  EXPECT_EQ(Frame(codec, frame.substr(0, 1)), 0U);
+  EXPECT_EQ(Frame(codec, frame.substr(0, frame.size() - 1)), 0U);
+  EXPECT_EQ(Frame(codec, frame), frame.size());
+
+  // Several frames in one read, the partial one after them waits for the next read.
+  const std::string frames{frame + header(0) + frame + frame.substr(0, 3)};
+  EXPECT_EQ(Frame(codec, frames), 2 * frame.size() + header(0).size());
+  EXPECT_EQ(codec.Count(frames.data(), 2 * frame.size() + header(0).size()), 3U);
+
+  // The limit is the length of the payload.
+  const std::string longest{header(kMaxFrameSize) + std::string(kMaxFrameSize, 'x')};
+  EXPECT_EQ(Frame(codec, longest), longest.size());
+  EXPECT_EQ(codec.BufferSize() >= longest.size(), true);
+  EXPECT_EQ(Frame(codec, header(kMaxFrameSize + 1)), tcp::kMalformedFrame);
+  // The frames before the oversized one are still echoed, the next call reports it.
+  EXPECT_EQ(Frame(codec, frame + header(kMaxFrameSize + 1)), frame.size());
+  EXPECT_EQ(Frame(codec, header(kMaxFrameSize + 1) + frame), tcp::kMalformedFrame);
+}
+
+auto U16Header(std::size_t length) -> std::string
+{
+  return Bytes({static_cast<unsigned char>(length >> 8), static_cast<unsigned char>(length)});
+}
+
+auto U32Header(std::size_t length) -> std::string
+{
+  return Bytes(
+    {static_cast<unsigned char>(length >> 24),
+     static_cast<unsigned char>(length >> 16),
+     static_cast<unsigned char>(length >> 8),
+     static_cast<unsigned char>(length)}
+  );
+}
+
+auto VarintHeader(std::size_t length) -> std::string
+{
+  std::string header;
+  do
+  {
+    header.push_back(static_cast<char>((length & 0x7F) | (length > 0x7F ? 0x80 : 0)));
+    length >>= 7;
+  } while (length != 0);
+  return header;
+}
+
+auto VarintTests() -> void
+{
+  const tcp::VarintLengthCodec codec{1024};
+
+  // A varint truncated after a byte with the continuation bit waits for the rest of the header.
+  EXPECT_EQ(Frame(codec, Bytes({0xAC})), 0U);
+  EXPECT_EQ(Frame(codec, Bytes({0xAC, 0x02})), 0U);
+  EXPECT_EQ(Frame(codec, Bytes({0xAC, 0x02}) + std::string(300, 'x')), 302U);
+  EXPECT_EQ(Frame(codec, std::string(9, '\x80')), 0U);
+
+  // A header longer than ten bytes can never end, neither can a length overflowing 64 bits.
+  EXPECT_EQ(Frame(codec, std::string(10, '\x80')), tcp::kMalformedFrame);
+  EXPECT_EQ(Frame(codec, std::string(10, '\x80') + Bytes({0x00})), tcp::kMalformedFrame);
+  EXPECT_EQ(Frame(codec, std::string(9, '\xFF') + Bytes({0x7F})), tcp::kMalformedFrame);
+
+  // Redundant continuation bytes are valid as long as the header fits.
+  EXPECT_EQ(Frame(codec, Bytes({0x85, 0x80, 0x00}) + "hello"), 8U);
+}
+
+auto FixedSizeTests() -> void
+{
+  const tcp::FixedSizeCodec codec{kMaxFrameSize};
+
+  // A frame split across reads.
+  EXPECT_EQ(Frame(codec, std::string(kMaxFrameSize - 1, 'x')), 0U);
+  EXPECT_EQ(Frame(codec, std::string(kMaxFrameSize, 'x'), kMaxFrameSize - 1), kMaxFrameSize);
+
+  // Several frames in one read, the byte over them starts the next frame.
+  const std::string frames(2 * kMaxFrameSize + 1, 'x');
+  EXPECT_EQ(Frame(codec, frames), 2 * kMaxFrameSize);
+  EXPECT_EQ(codec.Count(frames.data(), 2 * kMaxFrameSize), 2U);
+  EXPECT_EQ(Frame(codec, std::string(kMaxFrameSize + 1, 'x')), kMaxFrameSize);
+
+  // A zero size would never frame anything, the codec takes single bytes instead.
+  EXPECT_EQ(Frame(tcp::FixedSizeCodec{0}, "abc"), 3U);
+}
+
+}  // namespace
+
+/**
+ * @brief Checks the framing of every codec on reads that split, batch and
+ *        overrun the frames.
+ */
+auto main() -> int
+{
+  NewlineTests();
+  LengthPrefixedTests<tcp::U16LengthCodec>(&U16Header);
+  LengthPrefixedTests<tcp::U32LengthCodec>(&U32Header);
+  LengthPrefixedTests<tcp::VarintLengthCodec>(&VarintHeader);
+  VarintTests();
+  FixedSizeTests();
+  if (failures != 0)
+  {
+    std::fprintf(stderr, "%d expectations failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
\ No newline at end of file
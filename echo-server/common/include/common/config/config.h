@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Configuration file of the servers. Every line holds one setting named
+ * like the command line flag without the leading dashes: "workers = 4"
+ * stands for --workers=4 and a bare "reuse-port" for --reuse-port. Blank
+ * lines and lines starting with '#' are skipped.
+ *
+ * The settings of the file are placed in front of the command line
+ * arguments, so the servers parse both with the same code and a flag
+ * given on the command line overrides the file.
+ */
+extern const int kConfigLoadFailed;
+extern const int kConfigNumberInvalid;
+extern const char* const kConfigFlag;
+
+/*
+ * Arguments of the server: the program name, the settings of the file and
+ * the command line arguments except the --config= flag. error_line_ is
+ * the line of the file that failed to parse, zero for other failures.
+ */
+struct ConfigArguments
+{
+  int argc_;
+  char** argv_;
+  size_t file_arguments_count_;
+  size_t error_line_;
+};
+
+/*
+ * Builds the arguments from the command line and the configuration file
+ * named by its --config=PATH flag, if there is one. Can be called again
+ * to reload the file. Fails with EINVAL on a malformed line.
+ */
+// clang-format off
+__attribute__((nonnull(2, 3))) __attribute__((warn_unused_result))
+extern int LoadConfigArguments(
+  int argc,  //
+  char* const argv[],
+  struct ConfigArguments* arguments
+);  // clang-format on
+
+__attribute__((nonnull(1)))
+extern void FreeConfigArguments(struct ConfigArguments* arguments);
+
+/*
+ * Parses the value of a numeric setting. The whole value has to be a
+ * decimal number no larger than max: unlike atoi and strtoull this fails
+ * with EINVAL on an empty value, a sign or a suffix such as "16k" and
+ * with ERANGE above max, so a typo cannot turn a limit into zero.
+ */
+// clang-format off
+__attribute__((nonnull(1, 3))) __attribute__((warn_unused_result))
+extern int ParseConfigNumber(
+  const char* value,  //
+  uint64_t max,
+  uint64_t* number
+);  // clang-format on
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+enum LogLevel
+{
+  kLogDebug,
+  kLogInfo,
+  kLogWarning,
+  kLogFatal
+};
+
+extern const int kLoggerStartFailed;
+
+/*
+ * Starts the background thread that formats and writes the records.
+ * Records written before the start are kept in the per-thread rings
+ * (or dropped once a ring is full) and written after the start.
+ */
+__attribute__((warn_unused_result))
+extern int StartLogger(void);
+
+/*
+ * Writes out every record queued so far. Called on exit and before the
+ * process is terminated by a fatal record.
+ */
+extern void FlushLogger(void);
+
+/*
+ * Returns the number of records dropped because the ring of the writing
+ * thread was full.
+ */
+extern uint64_t GetDroppedLogRecords(void);
+
+/*
+ * Queues the record into the lock-free ring of the calling thread; the
+ * arguments are captured in binary form and formatted by the background
+ * thread. Supported conversions are the integer, floating point, %c, %s
+ * and %p ones without '*' width or precision. Strings are copied into the
+ * record and truncated if they do not fit.
+ *
+ * A record is dropped if the ring is full, except for fatal ones: they are
+ * always written, after which the process exits.
+ */
+// clang-format off
+__attribute__((nonnull(2))) __attribute__((format(printf, 2, 3)))
+extern void WriteLog(
+  enum LogLevel level,  //
+  const char* format,
+  ...
+);  // clang-format on
+
+#define LOG_INFO(...) WriteLog(kLogInfo, __VA_ARGS__)
+#define LOG_WARNING(...) WriteLog(kLogWarning, __VA_ARGS__)
+#define LOG_FATAL(...) WriteLog(kLogFatal, __VA_ARGS__)
+
+#ifndef NDEBUG
+  #define LOG_DEBUG(...) WriteLog(kLogDebug, __VA_ARGS__)
+#else
+  #define LOG_DEBUG(...) do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
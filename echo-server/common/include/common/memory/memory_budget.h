@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define MEMORY_BUDGET_CHUNK_SIZE (64 * 1024)
+
+/*
+ * Process-wide cap of the bytes buffered by the connections: the receive
+ * buffers they hold between reads and the echoed data waiting for the
+ * socket. Reserving memory that would push the total over the budget
+ * fails, and the caller sheds the connection instead of buffering more.
+ *
+ * Threads do not touch the shared counter on every reservation: every
+ * thread reserves MEMORY_BUDGET_CHUNK_SIZE bytes at a time and serves the
+ * small reservations from its own credit, so the budget may be exceeded
+ * by the credit held by the threads, at most two chunks each.
+ */
+extern const uint64_t kUnlimitedMemoryBudget;
+
+/*
+ * Sets the budget, zero lifts the cap. The budget may be changed while the
+ * connections run: memory reserved over a lowered budget is kept, new
+ * reservations fail until the total drops below it.
+ */
+extern void SetMemoryBudget(uint64_t budget);
+
+/*
+ * Returns false if the reservation does not fit into the budget.
+ */
+__attribute__((warn_unused_result))
+extern bool ReserveMemory(size_t bytes);
+
+extern void ReleaseMemory(size_t bytes);
+
+/*
+ * Returns true while the reserved memory is over the budget, new
+ * connections are not accepted until it drops.
+ */
+extern bool IsMemoryBudgetExhausted(void);
+
+/*
+ * Number of bytes reserved from the budget, including the credit held by
+ * the threads.
+ */
+extern uint64_t GetReservedMemory(void);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define METRICS_HISTOGRAM_BUCKETS 32
+#define METRICS_THREAD_NAME_SIZE 32
+
+enum MetricCounter
+{
+  kMetricAcceptedConnections,
+  kMetricClosedConnections,
+  kMetricExpiredConnections,
+  kMetricAcceptErrors,
+  kMetricReceivedBytes,
+  kMetricSentBytes,
+  kMetricReceivedPackets,
+  kMetricSentPackets,
+  kMetricStolenConnections,
+  kMetricShedConnections,
+  kMetricTlsHandshakes,
+  kMetricTlsResumedHandshakes,
+  kMetricTlsFailedHandshakes,
+  kMetricTlsOffloadedConnections,
+  kMetricThrottledReads,
+  kMetricRejectedConnections,
+  kMetricEvictedConnections,
+  kMetricAcceptPauses,
+  kMetricOverflowPeerConnections,
+  kMetricCountersCount
+};
+
+/*
+ * Histograms have power of two buckets: the value v is counted in the
+ * bucket with index of the highest bit of v plus one.
+ */
+enum MetricHistogram
+{
+  kMetricConnectionDuration,
+  kMetricReadSize,
+  kMetricLoopLag,
+  kMetricHistogramsCount
+};
+
+/*
+ * Metrics of a single thread. Only the owning thread writes to the block,
+ * so an event costs one relaxed load and store of a counter that no other
+ * thread writes; the alignment keeps the blocks of different threads on
+ * different cache lines. The admin thread reads the blocks with relaxed
+ * loads and sums them up on scrape.
+ */
+struct MetricsBlock
+{
+  uint64_t counters_[kMetricCountersCount];
+  uint64_t buckets_[kMetricHistogramsCount][METRICS_HISTOGRAM_BUCKETS];
+  uint64_t sums_[kMetricHistogramsCount];
+  char thread_name_[METRICS_THREAD_NAME_SIZE];
+} __attribute__((aligned(64)));
+
+/*
+ * Block of the calling thread. Threads that did not call AttachMetrics
+ * share a common block whose updates may be lost when they race.
+ */
+extern __thread struct MetricsBlock* current_metrics_block;
+
+typedef uint64_t (*MetricGaugeCallback)(void* context);
+
+extern const int kMetricsServerStartFailed;
+extern const int kMetricGaugeRegisterFailed;
+
+/*
+ * Gives the calling thread its own metrics block, reported with the
+ * thread="<thread_name>" label.
+ */
+__attribute__((nonnull(1)))
+extern void AttachMetrics(const char* thread_name);
+
+/*
+ * Registers a gauge computed by the callback on every scrape; labels are
+ * written between the braces as is (e.g. worker="0"). Gauges with the same
+ * name have to be registered one after another.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2, 3, 4))) __attribute__((warn_unused_result))
+extern int RegisterMetricGauge(
+  const char* name,  //
+  const char* help,
+  const char* labels,
+  MetricGaugeCallback callback,
+  void* context
+);  // clang-format on
+
+/*
+ * Starts the admin thread serving the metrics in the Prometheus text
+ * format on GET /metrics. The admin port is bound to an address of its
+ * own, the loopback unless configured, so enabling it does not expose the
+ * internals wherever the echo port is reachable.
+ */
+__attribute__((warn_unused_result))
+extern int StartMetricsServer(
+  struct in_addr address,  //
+  uint16_t port
+);
+
+static inline void AddMetric(
+  enum MetricCounter counter,  //
+  uint64_t value
+)
+{
+  uint64_t* slot = &current_metrics_block->counters_[counter];
+  __atomic_store_n(slot, __atomic_load_n(slot, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+static inline void RecordMetric(
+  enum MetricHistogram histogram,  //
+  uint64_t value
+)
+{
+  unsigned bucket = 64U - (unsigned) __builtin_clzll(value | 1U);
+  bucket = bucket < METRICS_HISTOGRAM_BUCKETS ? bucket : METRICS_HISTOGRAM_BUCKETS - 1;
+  uint64_t* slot = &current_metrics_block->buckets_[histogram][bucket];
+  __atomic_store_n(slot, __atomic_load_n(slot, __ATOMIC_RELAXED) + 1U, __ATOMIC_RELAXED);
+  slot = &current_metrics_block->sums_[histogram];
+  __atomic_store_n(slot, __atomic_load_n(slot, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+/*
+ * Returns CLOCK_MONOTONIC in microseconds, the unit of the connection
+ * duration histogram.
+ */
+static inline uint64_t GetMetricsTimestamp(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000U + (uint64_t) now.tv_nsec / 1000U;
+}
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
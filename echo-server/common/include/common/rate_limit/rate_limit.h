@@ -0,0 +1,167 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define RATE_LIMIT_MAX_PEERS 4096
+
+/*
+ * Rates of a pair of token buckets, in bytes and messages per second;
+ * zero leaves the corresponding rate unlimited. Each bucket holds burst_ns_
+ * worth of its rate, the amount a client that has been quiet may send at
+ * once before it is paced.
+ */
+struct RateLimits
+{
+  uint64_t bytes_per_second_;
+  uint64_t messages_per_second_;
+  uint64_t burst_ns_;
+};
+
+/*
+ * Token buckets of one connection, used by the thread serving it only.
+ *
+ * A bucket is kept as the time its debt is paid off (the theoretical
+ * arrival time of GCRA) rather than as a count of tokens: a charge pushes
+ * that time forward by the time the rate needs for the amount, and the
+ * bucket allows the next read once the time is at most the burst ahead of
+ * now. Nothing has to refill the buckets, so a throttled connection costs
+ * neither a timer nor any work until its owner looks at it again.
+ *
+ * The size of a read is known only after it completes, so reads are
+ * charged afterwards and may push the buckets into debt; the debt delays
+ * the next read by the time the rate needs to pay it off.
+ */
+struct TokenBuckets
+{
+  uint64_t bytes_paid_at_;
+  uint64_t messages_paid_at_;
+};
+
+/*
+ * Token buckets shared by all connections from one IPv4 address, across
+ * threads. The process keeps a table of RATE_LIMIT_MAX_PEERS of them; the
+ * buckets of an address outlive its connections, so reconnecting does not
+ * clear its debt, until the slot is reused for another address.
+ *
+ * Connections that wait for shared buckets would all be woken up at the
+ * time the debt is paid off, and the first to read would take the whole
+ * refill again. Instead a connection that finds the buckets in debt books
+ * its read: the booking is charged at once and the connection waits for
+ * its own turn, so the connections of a peer take their turns in the
+ * order they ran out of tokens. The read settles the booking with the
+ * amount actually read.
+ */
+struct PeerBuckets;
+
+extern const uint64_t kUnlimitedRate;
+extern const uint64_t kDefaultRateBurst;
+
+/*
+ * Returns CLOCK_MONOTONIC in nanoseconds, the time the buckets are kept in.
+ */
+extern uint64_t GetRateLimitClock(void);
+
+__attribute__((nonnull(1)))
+extern bool IsRateLimited(const struct RateLimits* limits);
+
+__attribute__((nonnull(1)))
+extern void InitializeTokenBuckets(struct TokenBuckets* buckets);
+
+/*
+ * Returns the nanoseconds the connection has to wait before it reads
+ * again, zero if it may read now.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+extern uint64_t GetTokenBucketsDelay(
+  const struct TokenBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t now
+);  // clang-format on
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+extern void ChargeTokenBuckets(
+  struct TokenBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t bytes,
+  uint64_t messages,
+  uint64_t now
+);  // clang-format on
+
+/*
+ * Returns the buckets of the address (in network byte order) and counts
+ * the connection in. If every slot the address may take is held by the
+ * connections of other addresses, returns the overflow buckets shared by
+ * all such connections: they stay limited to the peer rates together
+ * rather than not at all.
+ */
+__attribute__((returns_nonnull, warn_unused_result))
+extern struct PeerBuckets* AcquirePeerBuckets(uint32_t address);
+
+/*
+ * Returns true for the overflow buckets returned when the table is full
+ * around an address.
+ */
+__attribute__((nonnull(1)))
+extern bool IsOverflowPeerBuckets(const struct PeerBuckets* buckets);
+
+__attribute__((nonnull(1)))
+extern void ReleasePeerBuckets(struct PeerBuckets* buckets);
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+extern uint64_t GetPeerBucketsDelay(
+  const struct PeerBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t now
+);  // clang-format on
+
+/*
+ * Books the read and returns the nanoseconds until the buckets allow it.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+extern uint64_t BookPeerBuckets(
+  struct PeerBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t bytes,
+  uint64_t messages,
+  uint64_t now
+);  // clang-format on
+
+/*
+ * Charges the read made on a booking with the difference between the
+ * amounts read and booked, returning the part of the booking left unused.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+extern void SettlePeerBuckets(
+  struct PeerBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t booked_bytes,
+  uint64_t booked_messages,
+  uint64_t bytes,
+  uint64_t messages,
+  uint64_t now
+);  // clang-format on
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+extern void ChargePeerBuckets(
+  struct PeerBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t bytes,
+  uint64_t messages,
+  uint64_t now
+);  // clang-format on
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
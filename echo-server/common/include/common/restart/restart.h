@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define RESTART_MAX_LISTENERS 16
+
+/*
+ * Zero-downtime restart: the running server listens on a Unix control
+ * socket, and a new server started with the same control path takes its
+ * listening sockets over before it starts serving:
+ *
+ * 1. the successor connects to the control socket and receives the
+ *    listening sockets of the predecessor (SCM_RIGHTS);
+ * 2. it starts accepting on them and confirms the takeover;
+ * 3. the predecessor stops accepting, drains its connections and exits,
+ *    while the successor listens on the control path for the next one.
+ *
+ * The listening sockets stay open all along, so clients connecting
+ * during the restart are accepted by one process or the other instead of
+ * being refused.
+ */
+extern const int kRestartFailed;
+extern const int kNoPredecessor;
+
+/*
+ * Connects to the control socket and receives up to capacity listening
+ * sockets of the predecessor. Returns the connection to confirm the
+ * takeover on, or kNoPredecessor if no server listens on the path.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2, 4))) __attribute__((warn_unused_result))
+extern int TakeOverListeners(
+  const char* path,  //
+  int* listeners,
+  size_t capacity,
+  size_t* count
+);  // clang-format on
+
+/*
+ * Tells the predecessor that the successor is serving and closes the
+ * connection.
+ */
+__attribute__((warn_unused_result))
+extern int ConfirmTakeover(int connection);
+
+/*
+ * Replaces a stale control socket on the path and listens for the
+ * successor. The socket is nonblocking.
+ */
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+extern int ListenForSuccessor(const char* path);
+
+/*
+ * Accepts the successor waiting on the control socket and sends it the
+ * listening sockets. Returns the nonblocking connection the confirmation
+ * arrives on.
+ */
+// clang-format off
+__attribute__((warn_unused_result))
+extern int HandOverListeners(
+  int control_socket,  //
+  const int* listeners,
+  size_t count
+);  // clang-format on
+
+/*
+ * Reads the confirmation from the readable connection and closes it.
+ * Fails if the successor went away without confirming.
+ */
+__attribute__((warn_unused_result))
+extern int ReceiveTakeover(int connection);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,252 @@
+#define _GNU_SOURCE
+
+#include <common/config/config.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MALLOC_FAILED NULL
+#define FOPEN_FAILED NULL
+
+const int kConfigLoadFailed = -1;
+const int kConfigNumberInvalid = -1;
+const char* const kConfigFlag = "--config=";
+
+static const char kCommentMark = '#';
+static const char kValueSeparator = '=';
+static const char* const kFlagPrefix = "--";
+static const char* const kConfigName = "config";
+static const ssize_t kGetlineFailed = -1;
+static const int kDecimalBase = 10;
+
+// clang-format off
+__attribute__((nonnull(1)))
+static char* TrimSpaces(
+  char* begin,  //
+  char* end
+)  // clang-format on
+{
+  while (begin != end && isspace((unsigned char) *begin))
+  {
+    ++begin;
+  }
+  while (end != begin && isspace((unsigned char) end[-1]))
+  {
+    --end;
+  }
+  *end = '\0';
+  return begin;
+}
+
+static bool IsValidName(
+  const char* name
+)
+{
+  // A file naming another file would make the reload order ambiguous.
+  if (*name == '\0' || *name == '-' || strcmp(name, kConfigName) == 0)
+  {
+    return false;
+  }
+  for (; *name != '\0'; ++name)
+  {
+    if (isspace((unsigned char) *name))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Turns the line into the flag it stands for. Returns NULL with errno set
+ * to EINVAL if the line is malformed.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static char* ParseSetting(
+  char* line,  //
+  size_t line_size
+)  // clang-format on
+{
+  char* separator = memchr(line, kValueSeparator, line_size);
+  char* name = TrimSpaces(line, separator != NULL ? separator : line + line_size);
+  const char* value = separator != NULL ? TrimSpaces(separator + 1, line + line_size) : NULL;
+  if (!IsValidName(name))
+  {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  char* flag;
+  int flag_size = value != NULL ? asprintf(&flag, "%s%s=%s", kFlagPrefix, name, value)
+                                : asprintf(&flag, "%s%s", kFlagPrefix, name);
+  return flag_size < 0 ? NULL : flag;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static int AppendArgument(
+  struct ConfigArguments* arguments,  //
+  char* argument,
+  size_t* capacity
+)  // clang-format on
+{
+  if ((size_t) arguments->argc_ == *capacity)
+  {
+    size_t new_capacity = *capacity * 2;
+    char** argv = realloc(arguments->argv_, new_capacity * sizeof(char*));
+    if (argv == MALLOC_FAILED)
+    {
+      return kConfigLoadFailed;
+    }
+    arguments->argv_ = argv;
+    *capacity = new_capacity;
+  }
+  arguments->argv_[arguments->argc_++] = argument;
+  return 0;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2, 3)))
+static int ReadConfigFile(
+  const char* path,  //
+  struct ConfigArguments* arguments,
+  size_t* capacity
+)  // clang-format on
+{
+  FILE* file = fopen(path, "re");
+  if (file == FOPEN_FAILED)
+  {
+    return kConfigLoadFailed;
+  }
+  char* line = NULL;
+  size_t line_capacity = 0;
+  size_t line_number = 0;
+  ssize_t line_size;
+  int error_code = 0;
+  while ((line_size = getline(&line, &line_capacity, file)) != kGetlineFailed)
+  {
+    ++line_number;
+    char* setting = TrimSpaces(line, line + line_size);
+    if (*setting == '\0' || *setting == kCommentMark)
+    {
+      continue;
+    }
+    char* flag = ParseSetting(setting, strlen(setting));
+    if (flag == NULL)
+    {
+      arguments->error_line_ = errno == EINVAL ? line_number : 0;
+      error_code = kConfigLoadFailed;
+      break;
+    }
+    if (AppendArgument(arguments, flag, capacity) == kConfigLoadFailed)
+    {
+      free(flag);
+      error_code = kConfigLoadFailed;
+      break;
+    }
+    ++arguments->file_arguments_count_;
+  }
+  int error = errno;
+  free(line);
+  fclose(file);
+  errno = error;
+  return error_code;
+}
+
+int LoadConfigArguments(
+  int argc,  //
+  char* const argv[],
+  struct ConfigArguments* arguments
+)
+{
+  size_t capacity = (size_t) argc + 1;
+  arguments->argc_ = 0;
+  arguments->file_arguments_count_ = 0;
+  arguments->error_line_ = 0;
+  arguments->argv_ = malloc(capacity * sizeof(char*));
+  if (arguments->argv_ == MALLOC_FAILED)
+  {
+    return kConfigLoadFailed;
+  }
+  arguments->argv_[arguments->argc_++] = argv[0];
+
+  const char* path = NULL;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strncmp(argv[i], kConfigFlag, strlen(kConfigFlag)) == 0)
+    {
+      path = argv[i] + strlen(kConfigFlag);
+    }
+  }
+  if (path != NULL && ReadConfigFile(path, arguments, &capacity) == kConfigLoadFailed)
+  {
+    int error = errno;
+    FreeConfigArguments(arguments);
+    errno = error;
+    return kConfigLoadFailed;
+  }
+
+  for (int i = 1; i < argc; ++i)
+  {
+    if (strncmp(argv[i], kConfigFlag, strlen(kConfigFlag)) != 0 &&
+        AppendArgument(arguments, argv[i], &capacity) == kConfigLoadFailed)
+    {
+      FreeConfigArguments(arguments);
+      return kConfigLoadFailed;
+    }
+  }
+  arguments->argv_[arguments->argc_] = NULL;
+  return 0;
+}
+
+void FreeConfigArguments(
+  struct ConfigArguments* arguments
+)
+{
+  if (arguments->argv_ == NULL)
+  {
+    return;
+  }
+  for (size_t i = 0; i < arguments->file_arguments_count_; ++i)
+  {
+    free(arguments->argv_[i + 1]);
+  }
+  free(arguments->argv_);
+  arguments->argv_ = NULL;
+  arguments->argc_ = 0;
+  arguments->file_arguments_count_ = 0;
+}
+
+int ParseConfigNumber(
+  const char* value,  //
+  uint64_t max,
+  uint64_t* number
+)
+{
+  // strtoull skips leading spaces and takes a sign, "-1" would wrap around to the largest number.
+  if (!isdigit((unsigned char) value[0]))
+  {
+    errno = EINVAL;
+    return kConfigNumberInvalid;
+  }
+  char* end;
+  errno = 0;
+  unsigned long long parsed = strtoull(value, &end, kDecimalBase);
+  if (*end != '\0')
+  {
+    errno = EINVAL;
+    return kConfigNumberInvalid;
+  }
+  if (errno == ERANGE || parsed > max)
+  {
+    errno = ERANGE;
+    return kConfigNumberInvalid;
+  }
+  *number = (uint64_t) parsed;
+  return 0;
+}
\ No newline at end of file
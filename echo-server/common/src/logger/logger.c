@@ -0,0 +1,635 @@
+#define _GNU_SOURCE
+
+#include <common/logger/logger.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MALLOC_FAILED NULL
+#define LOG_RING_CAPACITY 1024
+#define LOG_MAX_RINGS 256
+#define LOG_MAX_ARGUMENTS 8
+#define LOG_TEXT_SIZE 160
+#define LOG_SPEC_SIZE 16
+#define LOG_TIME_SIZE 32
+#define LOG_LINE_SIZE 1024
+#define LOG_OUTPUT_SIZE (64 * 1024)
+
+const int kLoggerStartFailed = -1;
+
+static const long kDrainIntervalNanoseconds = 10000000L;
+static const uint64_t kNanosecondsPerSecond = 1000000000U;
+static const int kPthreadCreateSuccess = 0;
+static const ssize_t kWriteFailed = -1;
+static const char* const kLevelNames[] = {"DEBUG", "INFO", "WARNING", "FATAL"};
+
+/*
+ * Binary form of a log record. The format string is the record id: it is
+ * a literal, so only the pointer is stored. Integer, floating point and
+ * pointer arguments are stored as 64-bit values, string arguments are
+ * copied into the text area and stored as offsets.
+ */
+struct LogRecord
+{
+  const char* format_;
+  uint64_t timestamp_;
+  uint64_t arguments_[LOG_MAX_ARGUMENTS];
+  uint32_t thread_id_;
+  uint8_t level_;
+  uint8_t arguments_count_;
+  uint16_t text_size_;
+  char text_[LOG_TEXT_SIZE];
+};
+
+/*
+ * Single-producer single-consumer ring of a writing thread. The ring is
+ * released when the thread exits and reused by a new thread once drained.
+ */
+struct LogRing
+{
+  _Alignas(64) atomic_size_t head_;
+  _Alignas(64) atomic_size_t tail_;
+  atomic_uint_fast64_t dropped_;
+  atomic_bool in_use_;
+  struct LogRecord records_[LOG_RING_CAPACITY];
+};
+
+/*
+ * Conversion specification parsed from the format string.
+ */
+struct LogConversion
+{
+  const char* begin_;
+  const char* end_;
+  char length_;
+  char specifier_;
+};
+
+static struct LogRing* log_rings[LOG_MAX_RINGS];
+static atomic_size_t log_rings_count;
+static atomic_uint_fast64_t ringless_dropped;
+static atomic_uint_fast64_t cached_time;
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static pthread_t drainer_thread;
+
+static __thread struct LogRing* local_ring;
+static __thread uint32_t local_thread_id;
+
+// Accessed by the thread holding drain_mutex only.
+static char output_buffer[LOG_OUTPUT_SIZE];
+static size_t output_size;
+static uint64_t reported_dropped;
+static time_t formatted_second = -1;
+static char formatted_time[LOG_TIME_SIZE];
+
+static uint64_t ReadClock(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (uint64_t) now.tv_sec * kNanosecondsPerSecond + (uint64_t) now.tv_nsec;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void ReleaseRing(
+  void* ring
+)  // clang-format on
+{
+  atomic_store_explicit(&((struct LogRing*) ring)->in_use_, false, memory_order_release);
+}
+
+static void CreateRingKey(void)
+{
+  pthread_key_create(&ring_key, &ReleaseRing);
+}
+
+static struct LogRing* AcquireRing(void)
+{
+  pthread_once(&ring_key_once, &CreateRingKey);
+  pthread_mutex_lock(&registry_mutex);
+
+  struct LogRing* ring = NULL;
+  size_t rings_count = atomic_load_explicit(&log_rings_count, memory_order_relaxed);
+  for (size_t i = 0; i < rings_count && ring == NULL; ++i)
+  {
+    // Only drained rings are reused, the records of the exited thread are not to be dropped.
+    if (!atomic_load_explicit(&log_rings[i]->in_use_, memory_order_acquire) &&
+        atomic_load_explicit(&log_rings[i]->head_, memory_order_acquire) ==
+          atomic_load_explicit(&log_rings[i]->tail_, memory_order_relaxed))
+    {
+      ring = log_rings[i];
+    }
+  }
+  if (ring == NULL && rings_count != LOG_MAX_RINGS)
+  {
+    ring = aligned_alloc(_Alignof(struct LogRing), sizeof(struct LogRing));
+    if (ring != MALLOC_FAILED)
+    {
+      atomic_init(&ring->head_, 0);
+      atomic_init(&ring->tail_, 0);
+      atomic_init(&ring->dropped_, 0);
+      atomic_init(&ring->in_use_, false);
+      log_rings[rings_count] = ring;
+      atomic_store_explicit(&log_rings_count, rings_count + 1, memory_order_release);
+    }
+  }
+  if (ring != NULL)
+  {
+    atomic_store_explicit(&ring->in_use_, true, memory_order_relaxed);
+    pthread_setspecific(ring_key, ring);
+  }
+
+  pthread_mutex_unlock(&registry_mutex);
+  return ring;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static const char* ParseConversion(
+  const char* format,  //
+  struct LogConversion* conversion
+)  // clang-format on
+{
+  // format points to '%'; returns the position after the specifier.
+  conversion->begin_ = format++;
+  while (*format != '\0' && strchr("-+ #0", *format) != NULL)
+  {
+    ++format;
+  }
+  while (*format >= '0' && *format <= '9')
+  {
+    ++format;
+  }
+  if (*format == '.')
+  {
+    ++format;
+    while (*format >= '0' && *format <= '9')
+    {
+      ++format;
+    }
+  }
+
+  conversion->length_ = '\0';
+  if (*format == 'h' || *format == 'l')
+  {
+    conversion->length_ = *format++;
+    if (*format == conversion->length_)
+    {
+      // hh and ll are stored as their upper-case variant.
+      conversion->length_ = conversion->length_ == 'h' ? 'H' : 'L';
+      ++format;
+    }
+  }
+  else if (*format == 'z' || *format == 'j' || *format == 't' || *format == 'L')
+  {
+    conversion->length_ = *format++;
+  }
+
+  conversion->specifier_ = *format;
+  if (*format != '\0')
+  {
+    ++format;
+  }
+  conversion->end_ = format;
+  return format;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2, 3)))
+static void CaptureArgument(
+  struct LogRecord* record,  //
+  const struct LogConversion* conversion,
+  va_list* arguments
+)  // clang-format on
+{
+  uint64_t* argument = record->arguments_ + record->arguments_count_++;
+  switch (conversion->specifier_)
+  {
+    case 'd' :
+    case 'i' :
+    {
+      switch (conversion->length_)
+      {
+        case 'l' : *argument = (uint64_t) va_arg(*arguments, long); break;
+        case 'L' : *argument = (uint64_t) va_arg(*arguments, long long); break;
+        case 'z' : *argument = (uint64_t) va_arg(*arguments, ssize_t); break;
+        case 'j' : *argument = (uint64_t) va_arg(*arguments, intmax_t); break;
+        case 't' : *argument = (uint64_t) va_arg(*arguments, ptrdiff_t); break;
+        default : *argument = (uint64_t) va_arg(*arguments, int); break;
+      }
+      break;
+    }
+    case 'u' :
+    case 'x' :
+    case 'X' :
+    case 'o' :
+    {
+      switch (conversion->length_)
+      {
+        case 'l' : *argument = va_arg(*arguments, unsigned long); break;
+        case 'L' : *argument = va_arg(*arguments, unsigned long long); break;
+        case 'z' : *argument = va_arg(*arguments, size_t); break;
+        case 'j' : *argument = va_arg(*arguments, uintmax_t); break;
+        case 't' : *argument = (uint64_t) va_arg(*arguments, ptrdiff_t); break;
+        default : *argument = va_arg(*arguments, unsigned); break;
+      }
+      break;
+    }
+    case 'c' :
+    {
+      *argument = (uint64_t) va_arg(*arguments, int);
+      break;
+    }
+    case 'p' :
+    {
+      *argument = (uint64_t) (uintptr_t) va_arg(*arguments, void*);
+      break;
+    }
+    case 's' :
+    {
+      const char* string = va_arg(*arguments, const char*);
+      if (string == NULL)
+      {
+        string = "(null)";
+      }
+      if (record->text_size_ == LOG_TEXT_SIZE)
+      {
+        // No space left, the argument refers to the terminator of the previous string.
+        *argument = LOG_TEXT_SIZE - 1;
+        break;
+      }
+      size_t length = strnlen(string, LOG_TEXT_SIZE - 1 - record->text_size_);
+      *argument = record->text_size_;
+      memcpy(record->text_ + record->text_size_, string, length);
+      record->text_size_ += (uint16_t) length;
+      record->text_[record->text_size_++] = '\0';
+      break;
+    }
+    default :
+    {
+      double value = conversion->length_ == 'L' ? (double) va_arg(*arguments, long double)
+                                                : va_arg(*arguments, double);
+      memcpy(argument, &value, sizeof(double));
+      break;
+    }
+  }
+}
+
+// clang-format off
+__attribute__((nonnull(1, 3, 4)))
+static size_t FormatArgument(
+  char* buffer,  //
+  size_t size,
+  const struct LogRecord* record,
+  const struct LogConversion* conversion,
+  uint64_t argument
+)  // clang-format on
+{
+  char spec[LOG_SPEC_SIZE];
+  size_t spec_size = (size_t) (conversion->end_ - conversion->begin_);
+  if (spec_size >= LOG_SPEC_SIZE)
+  {
+    return 0;
+  }
+  memcpy(spec, conversion->begin_, spec_size);
+  spec[spec_size] = '\0';
+
+  int written;
+  switch (conversion->specifier_)
+  {
+    case 'd' :
+    case 'i' :
+    case 'u' :
+    case 'x' :
+    case 'X' :
+    case 'o' :
+    {
+      switch (conversion->length_)
+      {
+        case 'l' : written = snprintf(buffer, size, spec, (long) argument); break;
+        case 'L' : written = snprintf(buffer, size, spec, (long long) argument); break;
+        case 'z' : written = snprintf(buffer, size, spec, (size_t) argument); break;
+        case 'j' : written = snprintf(buffer, size, spec, (intmax_t) argument); break;
+        case 't' : written = snprintf(buffer, size, spec, (ptrdiff_t) argument); break;
+        default : written = snprintf(buffer, size, spec, (int) argument); break;
+      }
+      break;
+    }
+    case 'c' :
+    {
+      written = snprintf(buffer, size, spec, (int) argument);
+      break;
+    }
+    case 'p' :
+    {
+      written = snprintf(buffer, size, spec, (void*) (uintptr_t) argument);
+      break;
+    }
+    case 's' :
+    {
+      written = snprintf(buffer, size, spec, record->text_ + argument);
+      break;
+    }
+    default :
+    {
+      double value;
+      memcpy(&value, &argument, sizeof(double));
+      if (conversion->length_ == 'L')
+      {
+        written = snprintf(buffer, size, spec, (long double) value);
+      }
+      else
+      {
+        written = snprintf(buffer, size, spec, value);
+      }
+      break;
+    }
+  }
+
+  if (written < 0)
+  {
+    return 0;
+  }
+  return (size_t) written < size ? (size_t) written : size - 1;
+}
+
+static void WriteOutput(void)
+{
+  size_t written_bytes = 0;
+  while (written_bytes != output_size)
+  {
+    ssize_t bytes = write(STDOUT_FILENO, output_buffer + written_bytes, output_size - written_bytes);
+    if (bytes == kWriteFailed)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    written_bytes += (size_t) bytes;
+  }
+  output_size = 0;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void AppendOutput(
+  const char* line,  //
+  size_t size
+)  // clang-format on
+{
+  if (output_size + size > LOG_OUTPUT_SIZE)
+  {
+    WriteOutput();
+  }
+  memcpy(output_buffer + output_size, line, size);
+  output_size += size;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static size_t FormatHeader(
+  char* line,  //
+  uint64_t timestamp,
+  uint8_t level,
+  uint32_t thread_id
+)  // clang-format on
+{
+  time_t second = (time_t) (timestamp / kNanosecondsPerSecond);
+  if (second != formatted_second)
+  {
+    struct tm broken_time;
+    localtime_r(&second, &broken_time);
+    strftime(formatted_time, LOG_TIME_SIZE, "%F/%H:%M:%S", &broken_time);
+    formatted_second = second;
+  }
+  int written = snprintf(line, LOG_LINE_SIZE, "[LOG][%s][%s] ID:%u |\n", kLevelNames[level], formatted_time, thread_id);
+  return written < 0 ? 0 : (size_t) written;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void FormatRecord(
+  const struct LogRecord* record
+)  // clang-format on
+{
+  char line[LOG_LINE_SIZE];
+  size_t size = FormatHeader(line, record->timestamp_, record->level_, record->thread_id_);
+  uint8_t argument_index = 0;
+
+  for (const char* format = record->format_; *format != '\0' && size < LOG_LINE_SIZE - 2;)
+  {
+    if (*format != '%')
+    {
+      line[size++] = *format++;
+      continue;
+    }
+    if (format[1] == '%')
+    {
+      line[size++] = '%';
+      format += 2;
+      continue;
+    }
+
+    struct LogConversion conversion;
+    format = ParseConversion(format, &conversion);
+    if (argument_index == record->arguments_count_)
+    {
+      break;
+    }
+    size += FormatArgument(
+      line + size,  //
+      LOG_LINE_SIZE - 1 - size,
+      record,
+      &conversion,
+      record->arguments_[argument_index++]
+    );
+  }
+
+  line[size++] = '\n';
+  AppendOutput(line, size);
+}
+
+static void ReportDroppedRecords(void)
+{
+  uint64_t dropped = GetDroppedLogRecords();
+  if (dropped == reported_dropped)
+  {
+    return;
+  }
+
+  char line[LOG_LINE_SIZE];
+  size_t size = FormatHeader(line, atomic_load_explicit(&cached_time, memory_order_relaxed), kLogWarning, (uint32_t) gettid());
+  int written = snprintf(
+    line + size,  //
+    LOG_LINE_SIZE - size,
+    "Logger dropped %llu records (%llu in total)\n",
+    (unsigned long long) (dropped - reported_dropped),
+    (unsigned long long) dropped
+  );
+  if (written > 0)
+  {
+    size += (size_t) written < LOG_LINE_SIZE - size ? (size_t) written : LOG_LINE_SIZE - size - 1;
+    AppendOutput(line, size);
+  }
+  reported_dropped = dropped;
+}
+
+static size_t DrainRings(void)
+{
+  size_t drained_records = 0;
+  size_t rings_count = atomic_load_explicit(&log_rings_count, memory_order_acquire);
+  for (size_t i = 0; i < rings_count; ++i)
+  {
+    struct LogRing* ring = log_rings[i];
+    size_t head = atomic_load_explicit(&ring->head_, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail_, memory_order_acquire);
+    for (; head != tail; ++head)
+    {
+      FormatRecord(ring->records_ + (head & (LOG_RING_CAPACITY - 1)));
+      ++drained_records;
+    }
+    atomic_store_explicit(&ring->head_, head, memory_order_release);
+  }
+
+  ReportDroppedRecords();
+  WriteOutput();
+  return drained_records;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void* DrainerFunction(
+  void* arg
+)  // clang-format on
+{
+  (void) arg;
+  struct timespec interval = {0, kDrainIntervalNanoseconds};
+  while (true)
+  {
+    atomic_store_explicit(&cached_time, ReadClock(), memory_order_relaxed);
+
+    pthread_mutex_lock(&drain_mutex);
+    size_t drained_records = DrainRings();
+    pthread_mutex_unlock(&drain_mutex);
+
+    if (drained_records == 0)
+    {
+      nanosleep(&interval, NULL);
+    }
+  }
+  return NULL;
+}
+
+int StartLogger(void)
+{
+  atomic_store_explicit(&cached_time, ReadClock(), memory_order_relaxed);
+  int error_code = pthread_create(&drainer_thread, NULL, &DrainerFunction, NULL);
+  if (error_code != kPthreadCreateSuccess)
+  {
+    errno = error_code;
+    return kLoggerStartFailed;
+  }
+  atexit(&FlushLogger);
+  return 0;
+}
+
+void FlushLogger(void)
+{
+  pthread_mutex_lock(&drain_mutex);
+  DrainRings();
+  pthread_mutex_unlock(&drain_mutex);
+}
+
+uint64_t GetDroppedLogRecords(void)
+{
+  uint64_t dropped = atomic_load_explicit(&ringless_dropped, memory_order_relaxed);
+  size_t rings_count = atomic_load_explicit(&log_rings_count, memory_order_acquire);
+  for (size_t i = 0; i < rings_count; ++i)
+  {
+    dropped += atomic_load_explicit(&log_rings[i]->dropped_, memory_order_relaxed);
+  }
+  return dropped;
+}
+
+void WriteLog(
+  enum LogLevel level,  //
+  const char* format,
+  ...
+)
+{
+  struct LogRing* ring = local_ring;
+  if (ring == NULL)
+  {
+    ring = local_ring = AcquireRing();
+    local_thread_id = (uint32_t) gettid();
+  }
+
+  if (ring != NULL)
+  {
+    size_t tail = atomic_load_explicit(&ring->tail_, memory_order_relaxed);
+    while (tail - atomic_load_explicit(&ring->head_, memory_order_acquire) == LOG_RING_CAPACITY)
+    {
+      if (level != kLogFatal)
+      {
+        atomic_fetch_add_explicit(&ring->dropped_, 1, memory_order_relaxed);
+        return;
+      }
+      FlushLogger();
+    }
+
+    struct LogRecord* record = ring->records_ + (tail & (LOG_RING_CAPACITY - 1));
+    uint64_t timestamp = atomic_load_explicit(&cached_time, memory_order_relaxed);
+    record->format_ = format;
+    record->timestamp_ = timestamp != 0 ? timestamp : ReadClock();
+    record->thread_id_ = local_thread_id;
+    record->level_ = (uint8_t) level;
+    record->arguments_count_ = 0;
+    record->text_size_ = 0;
+
+    va_list arguments;
+    va_start(arguments, format);
+    for (const char* position = format; *position != '\0' && record->arguments_count_ != LOG_MAX_ARGUMENTS;)
+    {
+      if (*position++ != '%')
+      {
+        continue;
+      }
+      if (*position == '%')
+      {
+        ++position;
+        continue;
+      }
+      struct LogConversion conversion;
+      position = ParseConversion(position - 1, &conversion);
+      CaptureArgument(record, &conversion, &arguments);
+    }
+    va_end(arguments);
+
+    atomic_store_explicit(&ring->tail_, tail + 1, memory_order_release);
+  }
+  else
+  {
+    atomic_fetch_add_explicit(&ringless_dropped, 1, memory_order_relaxed);
+  }
+
+  if (level == kLogFatal)
+  {
+    FlushLogger();
+    fputs("[MESSAGE][FATAL] Logger received fatal status.\nExiting...\n", stderr);
+    exit(EXIT_FAILURE);
+  }
+}
\ No newline at end of file
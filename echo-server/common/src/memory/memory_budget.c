@@ -0,0 +1,66 @@
+#include <common/memory/memory_budget.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+const uint64_t kUnlimitedMemoryBudget = 0;
+
+static atomic_uint_least64_t memory_budget = 0;
+static _Alignas(64) atomic_uint_least64_t reserved_memory = 0;
+static __thread size_t memory_credit = 0;
+
+void SetMemoryBudget(
+  uint64_t budget
+)
+{
+  atomic_store_explicit(&memory_budget, budget, memory_order_relaxed);
+}
+
+bool ReserveMemory(
+  size_t bytes
+)
+{
+  if (bytes <= memory_credit)
+  {
+    memory_credit -= bytes;
+    return true;
+  }
+
+  size_t missing_bytes = bytes - memory_credit;
+  size_t chunk = (missing_bytes + MEMORY_BUDGET_CHUNK_SIZE - 1) / MEMORY_BUDGET_CHUNK_SIZE * MEMORY_BUDGET_CHUNK_SIZE;
+  uint64_t reserved = atomic_fetch_add_explicit(&reserved_memory, chunk, memory_order_relaxed) + chunk;
+  uint64_t budget = atomic_load_explicit(&memory_budget, memory_order_relaxed);
+  if (budget != kUnlimitedMemoryBudget && reserved > budget)
+  {
+    atomic_fetch_sub_explicit(&reserved_memory, chunk, memory_order_relaxed);
+    return false;
+  }
+  memory_credit += chunk - bytes;
+  return true;
+}
+
+void ReleaseMemory(
+  size_t bytes
+)
+{
+  memory_credit += bytes;
+  // The credit is returned above two chunks only, so a thread going back and forth around a chunk boundary does
+  // not touch the shared counter every time.
+  if (memory_credit > 2 * MEMORY_BUDGET_CHUNK_SIZE)
+  {
+    atomic_fetch_sub_explicit(&reserved_memory, memory_credit - MEMORY_BUDGET_CHUNK_SIZE, memory_order_relaxed);
+    memory_credit = MEMORY_BUDGET_CHUNK_SIZE;
+  }
+}
+
+bool IsMemoryBudgetExhausted(void)
+{
+  uint64_t budget = atomic_load_explicit(&memory_budget, memory_order_relaxed);
+  return budget != kUnlimitedMemoryBudget && atomic_load_explicit(&reserved_memory, memory_order_relaxed) >= budget;
+}
+
+uint64_t GetReservedMemory(void)
+{
+  return atomic_load_explicit(&reserved_memory, memory_order_relaxed);
+}
\ No newline at end of file
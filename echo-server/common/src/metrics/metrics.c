@@ -0,0 +1,470 @@
+#define _GNU_SOURCE
+
+#include <common/logger/logger.h>
+#include <common/metrics/metrics.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MALLOC_FAILED NULL
+#define METRICS_MAX_BLOCKS 256
+#define METRICS_MAX_GAUGES 64
+#define METRICS_NAME_SIZE 64
+#define METRICS_HELP_SIZE 128
+#define METRICS_LABELS_SIZE 64
+#define METRICS_REQUEST_SIZE 4096
+
+const int kMetricsServerStartFailed = -1;
+const int kMetricGaugeRegisterFailed = -1;
+
+static const int kSocketFailed = -1;
+static const int kBindFailed = -1;
+static const int kListenFailed = -1;
+static const int kAcceptFailed = -1;
+static const ssize_t kIoFailed = -1;
+static const int kPthreadCreateSuccess = 0;
+static const int kPendingConnections = 16;
+static const int kDefaultSocketProtocol = 0;
+static const time_t kRequestTimeoutSeconds = 1;
+static const struct timespec kAcceptRetryDelay = {0, 100000000L};
+static const size_t kInitialOutputSize = 16 * 1024;
+
+static const char* const kCounterNames[kMetricCountersCount] = {
+  "echo_server_accepted_connections_total",
+  "echo_server_closed_connections_total",
+  "echo_server_expired_connections_total",
+  "echo_server_accept_errors_total",
+  "echo_server_received_bytes_total",
+  "echo_server_sent_bytes_total",
+  "echo_server_received_packets_total",
+  "echo_server_sent_packets_total",
+  "echo_server_stolen_connections_total",
+  "echo_server_shed_connections_total",
+  "echo_server_tls_handshakes_total",
+  "echo_server_tls_resumed_handshakes_total",
+  "echo_server_tls_failed_handshakes_total",
+  "echo_server_tls_offloaded_connections_total",
+  "echo_server_throttled_reads_total",
+  "echo_server_rejected_connections_total",
+  "echo_server_evicted_connections_total",
+  "echo_server_accept_pauses_total",
+  "echo_server_overflow_peer_connections_total"
+};
+static const char* const kCounterHelps[kMetricCountersCount] = {
+  "Number of accepted connections.",
+  "Number of closed connections.",
+  "Number of connections closed by the idle or lifetime timeout.",
+  "Number of failed accepts.",
+  "Number of bytes received from the clients.",
+  "Number of bytes echoed to the clients.",
+  "Number of UDP datagrams received from the clients, GRO segments counted one by one.",
+  "Number of UDP datagrams echoed to the clients, GSO segments counted one by one.",
+  "Number of connections taken over from the handoff queue of a busy worker by an idle one.",
+  "Number of connections closed because their buffers did not fit into the memory budget.",
+  "Number of completed TLS handshakes.",
+  "Number of TLS handshakes that resumed an earlier session from a ticket.",
+  "Number of TLS handshakes that failed.",
+  "Number of TLS connections whose encryption is done by the kernel in both directions.",
+  "Number of reads postponed because the connection or its peer address ran over its rate limit.",
+  "Number of connections reset right after the accept because the server was overloaded.",
+  "Number of idle connections closed to make room for new ones while the server was overloaded.",
+  "Number of times a listener stopped accepting because the server was overloaded.",
+  "Number of connections limited by the shared overflow buckets because the peer table was full around their address."
+};
+static const char* const kHistogramNames[kMetricHistogramsCount] = {
+  "echo_server_connection_duration_seconds",
+  "echo_server_read_size_bytes",
+  "echo_server_loop_lag_seconds"
+};
+static const char* const kHistogramHelps[kMetricHistogramsCount] = {
+  "Time from the accept of a connection until it was closed.",
+  "Number of bytes handed to the echo path by a single read.",
+  "Time an event loop took to get back to waiting for events, or by which its probe timer ran late."
+};
+// Histograms of durations are recorded in microseconds and exported in seconds.
+static const double kHistogramScales[kMetricHistogramsCount] = {1e-6, 1.0, 1e-6};
+
+struct MetricGauge
+{
+  char name_[METRICS_NAME_SIZE];
+  char help_[METRICS_HELP_SIZE];
+  char labels_[METRICS_LABELS_SIZE];
+  MetricGaugeCallback callback_;
+  void* context_;
+};
+
+/*
+ * Growing buffer the scrape response is formatted into.
+ */
+struct MetricsOutput
+{
+  char* data_;
+  size_t size_;
+  size_t capacity_;
+};
+
+static struct MetricsBlock shared_block = {.thread_name_ = "unattached"};
+static struct MetricsBlock* metrics_blocks[METRICS_MAX_BLOCKS];
+static size_t metrics_blocks_count;
+static struct MetricGauge metric_gauges[METRICS_MAX_GAUGES];
+static size_t metric_gauges_count;
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t server_thread;
+static int server_socket;
+
+__thread struct MetricsBlock* current_metrics_block = &shared_block;
+
+void AttachMetrics(
+  const char* thread_name
+)
+{
+  struct MetricsBlock* block = aligned_alloc(_Alignof(struct MetricsBlock), sizeof(struct MetricsBlock));
+  if (block == MALLOC_FAILED)
+  {
+    return;
+  }
+  memset(block, 0, sizeof(struct MetricsBlock));
+  snprintf(block->thread_name_, METRICS_THREAD_NAME_SIZE, "%s", thread_name);
+
+  pthread_mutex_lock(&registry_mutex);
+  if (metrics_blocks_count == METRICS_MAX_BLOCKS)
+  {
+    pthread_mutex_unlock(&registry_mutex);
+    free(block);
+    return;
+  }
+  metrics_blocks[metrics_blocks_count++] = block;
+  pthread_mutex_unlock(&registry_mutex);
+
+  current_metrics_block = block;
+}
+
+int RegisterMetricGauge(
+  const char* name,  //
+  const char* help,
+  const char* labels,
+  MetricGaugeCallback callback,
+  void* context
+)
+{
+  pthread_mutex_lock(&registry_mutex);
+  if (metric_gauges_count == METRICS_MAX_GAUGES)
+  {
+    pthread_mutex_unlock(&registry_mutex);
+    return kMetricGaugeRegisterFailed;
+  }
+  struct MetricGauge* gauge = metric_gauges + metric_gauges_count++;
+  snprintf(gauge->name_, METRICS_NAME_SIZE, "%s", name);
+  snprintf(gauge->help_, METRICS_HELP_SIZE, "%s", help);
+  snprintf(gauge->labels_, METRICS_LABELS_SIZE, "%s", labels);
+  gauge->callback_ = callback;
+  gauge->context_ = context;
+  pthread_mutex_unlock(&registry_mutex);
+  return 0;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2))) __attribute__((format(printf, 2, 3)))
+static void AppendOutput(
+  struct MetricsOutput* output,  //
+  const char* format,
+  ...
+)  // clang-format on
+{
+  while (output->data_ != MALLOC_FAILED)
+  {
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(output->data_ + output->size_, output->capacity_ - output->size_, format, arguments);
+    va_end(arguments);
+    if (length < 0)
+    {
+      return;
+    }
+    if ((size_t) length < output->capacity_ - output->size_)
+    {
+      output->size_ += (size_t) length;
+      return;
+    }
+
+    char* data = realloc(output->data_, output->capacity_ * 2);
+    if (data == MALLOC_FAILED)
+    {
+      free(output->data_);
+    }
+    output->data_ = data;
+    output->capacity_ *= 2;
+  }
+}
+
+static uint64_t ReadMetric(
+  const uint64_t* slot
+)
+{
+  return __atomic_load_n(slot, __ATOMIC_RELAXED);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void AppendCounters(
+  struct MetricsOutput* output
+)  // clang-format on
+{
+  struct MetricsBlock* blocks[METRICS_MAX_BLOCKS + 1];
+  size_t blocks_count = 0;
+  blocks[blocks_count++] = &shared_block;
+  for (size_t i = 0; i < metrics_blocks_count; ++i)
+  {
+    blocks[blocks_count++] = metrics_blocks[i];
+  }
+
+  uint64_t totals[kMetricCountersCount] = {0};
+  for (int counter = 0; counter < kMetricCountersCount; ++counter)
+  {
+    AppendOutput(
+      output,  //
+      "# HELP %s %s\n# TYPE %s counter\n",
+      kCounterNames[counter],
+      kCounterHelps[counter],
+      kCounterNames[counter]
+    );
+    for (size_t i = 0; i < blocks_count; ++i)
+    {
+      uint64_t value = ReadMetric(&blocks[i]->counters_[counter]);
+      totals[counter] += value;
+      AppendOutput(
+        output,  //
+        "%s{thread=\"%s\"} %" PRIu64 "\n",
+        kCounterNames[counter],
+        blocks[i]->thread_name_,
+        value
+      );
+    }
+  }
+
+  // Connections are accepted and closed by different threads, so only the total is meaningful.
+  uint64_t closed = totals[kMetricClosedConnections];
+  uint64_t accepted = totals[kMetricAcceptedConnections];
+  AppendOutput(
+    output,  //
+    "# HELP echo_server_active_connections Number of open connections.\n"
+    "# TYPE echo_server_active_connections gauge\n"
+    "echo_server_active_connections %" PRIu64 "\n",
+    accepted > closed ? accepted - closed : 0
+  );
+
+  for (int histogram = 0; histogram < kMetricHistogramsCount; ++histogram)
+  {
+    const char* name = kHistogramNames[histogram];
+    AppendOutput(output, "# HELP %s %s\n# TYPE %s histogram\n", name, kHistogramHelps[histogram], name);
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    for (int bucket = 0; bucket < METRICS_HISTOGRAM_BUCKETS; ++bucket)
+    {
+      for (size_t i = 0; i < blocks_count; ++i)
+      {
+        count += ReadMetric(&blocks[i]->buckets_[histogram][bucket]);
+      }
+      if (bucket == 0)
+      {
+        continue;
+      }
+      if (bucket == METRICS_HISTOGRAM_BUCKETS - 1)
+      {
+        AppendOutput(output, "%s_bucket{le=\"+Inf\"} %" PRIu64 "\n", name, count);
+        break;
+      }
+      double upper_bound = (double) ((1ULL << bucket) - 1U) * kHistogramScales[histogram];
+      AppendOutput(output, "%s_bucket{le=\"%.10g\"} %" PRIu64 "\n", name, upper_bound, count);
+    }
+    for (size_t i = 0; i < blocks_count; ++i)
+    {
+      sum += ReadMetric(&blocks[i]->sums_[histogram]);
+    }
+    AppendOutput(
+      output,  //
+      "%s_sum %.15g\n%s_count %" PRIu64 "\n",
+      name,
+      (double) sum * kHistogramScales[histogram],
+      name,
+      count
+    );
+  }
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void AppendGauges(
+  struct MetricsOutput* output
+)  // clang-format on
+{
+  for (size_t i = 0; i < metric_gauges_count; ++i)
+  {
+    const struct MetricGauge* gauge = metric_gauges + i;
+    if (i == 0 || strcmp(gauge->name_, metric_gauges[i - 1].name_) != 0)
+    {
+      AppendOutput(output, "# HELP %s %s\n# TYPE %s gauge\n", gauge->name_, gauge->help_, gauge->name_);
+    }
+    AppendOutput(output, "%s{%s} %" PRIu64 "\n", gauge->name_, gauge->labels_, gauge->callback_(gauge->context_));
+  }
+}
+
+// clang-format off
+__attribute__((nonnull(2)))
+static void SendAll(
+  int clientfd,  //
+  const char* data,
+  size_t size
+)  // clang-format on
+{
+  while (size != 0)
+  {
+    ssize_t bytes = send(clientfd, data, size, MSG_NOSIGNAL);
+    if (bytes == kIoFailed)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return;
+    }
+    data += bytes;
+    size -= (size_t) bytes;
+  }
+}
+
+static void ServeScrape(
+  int clientfd
+)
+{
+  char request[METRICS_REQUEST_SIZE];
+  size_t request_size = 0;
+  while (request_size < sizeof(request) - 1)
+  {
+    ssize_t bytes = recv(clientfd, request + request_size, sizeof(request) - 1 - request_size, 0);
+    if (bytes == kIoFailed || bytes == 0)
+    {
+      return;
+    }
+    request_size += (size_t) bytes;
+    request[request_size] = '\0';
+    if (strstr(request, "\r\n\r\n") != NULL)
+    {
+      break;
+    }
+  }
+
+  static const char kMetricsRequest[] = "GET /metrics ";
+  if (strncmp(request, kMetricsRequest, sizeof(kMetricsRequest) - 1) != 0)
+  {
+    static const char kNotFound[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    SendAll(clientfd, kNotFound, sizeof(kNotFound) - 1);
+    return;
+  }
+
+  struct MetricsOutput output = {malloc(kInitialOutputSize), 0, kInitialOutputSize};
+  pthread_mutex_lock(&registry_mutex);
+  AppendCounters(&output);
+  AppendGauges(&output);
+  pthread_mutex_unlock(&registry_mutex);
+  if (output.data_ == MALLOC_FAILED)
+  {
+    return;
+  }
+
+  char header[256];
+  int header_size = snprintf(
+    header,  //
+    sizeof(header),
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+    "Content-Length: %zu\r\n"
+    "Connection: close\r\n\r\n",
+    output.size_
+  );
+  SendAll(clientfd, header, (size_t) header_size);
+  SendAll(clientfd, output.data_, output.size_);
+  free(output.data_);
+}
+
+static void* MetricsServerFunction(
+  void* arg
+)
+{
+  (void) arg;
+  while (true)
+  {
+    int clientfd = accept4(server_socket, NULL, NULL, SOCK_CLOEXEC);
+    if (clientfd == kAcceptFailed)
+    {
+      if (errno != EINTR && errno != ECONNABORTED)
+      {
+        LOG_WARNING(
+          "Metrics server received error: accept failed: [%d](%s)",  //
+          errno,
+          strerror(errno)
+        );
+        // Errors such as EMFILE persist for a while, retrying at once would only flood the log.
+        nanosleep(&kAcceptRetryDelay, NULL);
+      }
+      continue;
+    }
+
+    // A stuck scraper must not block the next ones for long.
+    struct timeval timeout = {kRequestTimeoutSeconds, 0};
+    setsockopt(clientfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(clientfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    ServeScrape(clientfd);
+    close(clientfd);
+  }
+
+  return NULL;
+}
+
+int StartMetricsServer(
+  struct in_addr address,  //
+  uint16_t port
+)
+{
+  server_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, kDefaultSocketProtocol);
+  if (server_socket == kSocketFailed)
+  {
+    return kMetricsServerStartFailed;
+  }
+  int enable = 1;
+  setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  struct sockaddr_in server_address;
+  memset(&server_address, 0, sizeof(struct sockaddr_in));
+  server_address.sin_family = AF_INET;
+  server_address.sin_addr = address;
+  server_address.sin_port = htons(port);
+  if (bind(server_socket, (struct sockaddr*) &server_address, sizeof(struct sockaddr_in)) == kBindFailed ||
+      listen(server_socket, kPendingConnections) == kListenFailed)
+  {
+    close(server_socket);
+    return kMetricsServerStartFailed;
+  }
+
+  int error_code = pthread_create(&server_thread, NULL, &MetricsServerFunction, NULL);
+  if (error_code != kPthreadCreateSuccess)
+  {
+    close(server_socket);
+    errno = error_code;
+    return kMetricsServerStartFailed;
+  }
+  pthread_detach(server_thread);
+  return 0;
+}
\ No newline at end of file
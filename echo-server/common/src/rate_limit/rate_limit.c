@@ -0,0 +1,316 @@
+#include <common/rate_limit/rate_limit.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Slot of the peer table. The address and the connection count change
+ * under the table mutex only, the buckets are charged by the threads of
+ * the connections concurrently.
+ */
+struct PeerBuckets
+{
+  uint32_t address_;
+  uint32_t connections_;
+  atomic_uint_least64_t bytes_paid_at_;
+  atomic_uint_least64_t messages_paid_at_;
+};
+
+const uint64_t kUnlimitedRate = 0;
+const uint64_t kDefaultRateBurst = 1000000000U;
+
+static const uint32_t kFibonacciMultiplier = 2654435769U;
+static const unsigned kHashBits = 32;
+static const size_t kPeerProbes = 16;
+static const uint64_t kNanosecondsPerSecond = 1000000000U;
+
+static struct PeerBuckets peers[RATE_LIMIT_MAX_PEERS];
+static struct PeerBuckets overflow_peers;
+static pthread_mutex_t peers_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t GetBucketDelay(
+  uint64_t paid_at,  //
+  uint64_t rate,
+  uint64_t burst_ns,
+  uint64_t now
+)
+{
+  if (rate == kUnlimitedRate || paid_at <= now + burst_ns)
+  {
+    return 0;
+  }
+  return paid_at - now - burst_ns;
+}
+
+static uint64_t GetCost(
+  uint64_t amount,  //
+  uint64_t rate
+)
+{
+  return (uint64_t) ((unsigned __int128) amount * kNanosecondsPerSecond / rate);
+}
+
+static uint64_t ChargeBucket(
+  uint64_t paid_at,  //
+  uint64_t rate,
+  uint64_t amount,
+  uint64_t now
+)
+{
+  if (rate == kUnlimitedRate)
+  {
+    return paid_at;
+  }
+  // A bucket that has been paid off for a while does not bank more than its burst.
+  uint64_t paid_from = paid_at > now ? paid_at : now;
+  return paid_from + GetCost(amount, rate);
+}
+
+/*
+ * Charges the shared bucket and returns the time it was paid off at before.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static uint64_t ChargeSharedBucket(
+  atomic_uint_least64_t* bucket,  //
+  uint64_t rate,
+  uint64_t amount,
+  uint64_t now
+)  // clang-format on
+{
+  uint64_t paid_at = atomic_load_explicit(bucket, memory_order_relaxed);
+  if (rate == kUnlimitedRate)
+  {
+    return paid_at;
+  }
+  while (!atomic_compare_exchange_weak_explicit(
+    bucket,  //
+    &paid_at,
+    ChargeBucket(paid_at, rate, amount, now),
+    memory_order_relaxed,
+    memory_order_relaxed
+  ))
+  {
+  }
+  return paid_at;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void RefundSharedBucket(
+  atomic_uint_least64_t* bucket,  //
+  uint64_t rate,
+  uint64_t amount
+)  // clang-format on
+{
+  if (rate == kUnlimitedRate)
+  {
+    return;
+  }
+  uint64_t refund = GetCost(amount, rate);
+  uint64_t paid_at = atomic_load_explicit(bucket, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(
+    bucket,  //
+    &paid_at,
+    paid_at > refund ? paid_at - refund : 0,
+    memory_order_relaxed,
+    memory_order_relaxed
+  ))
+  {
+  }
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void SettleSharedBucket(
+  atomic_uint_least64_t* bucket,  //
+  uint64_t rate,
+  uint64_t booked,
+  uint64_t amount,
+  uint64_t now
+)  // clang-format on
+{
+  if (amount > booked)
+  {
+    ChargeSharedBucket(bucket, rate, amount - booked, now);
+  }
+  else if (amount < booked)
+  {
+    RefundSharedBucket(bucket, rate, booked - amount);
+  }
+}
+
+uint64_t GetRateLimitClock(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * kNanosecondsPerSecond + (uint64_t) now.tv_nsec;
+}
+
+bool IsRateLimited(
+  const struct RateLimits* limits
+)
+{
+  return limits->bytes_per_second_ != kUnlimitedRate || limits->messages_per_second_ != kUnlimitedRate;
+}
+
+void InitializeTokenBuckets(
+  struct TokenBuckets* buckets
+)
+{
+  buckets->bytes_paid_at_ = 0;
+  buckets->messages_paid_at_ = 0;
+}
+
+uint64_t GetTokenBucketsDelay(
+  const struct TokenBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t now
+)
+{
+  uint64_t bytes_delay = GetBucketDelay(buckets->bytes_paid_at_, limits->bytes_per_second_, limits->burst_ns_, now);
+  uint64_t messages_delay =
+    GetBucketDelay(buckets->messages_paid_at_, limits->messages_per_second_, limits->burst_ns_, now);
+  return bytes_delay > messages_delay ? bytes_delay : messages_delay;
+}
+
+void ChargeTokenBuckets(
+  struct TokenBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t bytes,
+  uint64_t messages,
+  uint64_t now
+)
+{
+  buckets->bytes_paid_at_ = ChargeBucket(buckets->bytes_paid_at_, limits->bytes_per_second_, bytes, now);
+  buckets->messages_paid_at_ = ChargeBucket(buckets->messages_paid_at_, limits->messages_per_second_, messages, now);
+}
+
+struct PeerBuckets* AcquirePeerBuckets(
+  uint32_t address
+)
+{
+  // Slots are probed linearly from the hash of the address. Released slots keep their address and debt until an
+  // address with no slot of its own needs one.
+  uint32_t hash = address * kFibonacciMultiplier;
+  size_t home = (size_t) (((uint64_t) hash * RATE_LIMIT_MAX_PEERS) >> kHashBits);
+  struct PeerBuckets* released = NULL;
+  pthread_mutex_lock(&peers_mutex);
+  for (size_t i = 0; i < kPeerProbes; ++i)
+  {
+    struct PeerBuckets* slot = peers + (home + i) % RATE_LIMIT_MAX_PEERS;
+    if (slot->address_ == address)
+    {
+      ++slot->connections_;
+      pthread_mutex_unlock(&peers_mutex);
+      return slot;
+    }
+    if (released == NULL && slot->connections_ == 0)
+    {
+      released = slot;
+    }
+  }
+  if (released == NULL)
+  {
+    // Failing open here would let a peer escape its limit by crowding the slots around its own.
+    ++overflow_peers.connections_;
+    pthread_mutex_unlock(&peers_mutex);
+    return &overflow_peers;
+  }
+  released->address_ = address;
+  released->connections_ = 1;
+  atomic_store_explicit(&released->bytes_paid_at_, 0, memory_order_relaxed);
+  atomic_store_explicit(&released->messages_paid_at_, 0, memory_order_relaxed);
+  pthread_mutex_unlock(&peers_mutex);
+  return released;
+}
+
+bool IsOverflowPeerBuckets(
+  const struct PeerBuckets* buckets
+)
+{
+  return buckets == &overflow_peers;
+}
+
+void ReleasePeerBuckets(
+  struct PeerBuckets* buckets
+)
+{
+  pthread_mutex_lock(&peers_mutex);
+  --buckets->connections_;
+  pthread_mutex_unlock(&peers_mutex);
+}
+
+uint64_t GetPeerBucketsDelay(
+  const struct PeerBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t now
+)
+{
+  uint64_t bytes_delay = GetBucketDelay(
+    atomic_load_explicit(&buckets->bytes_paid_at_, memory_order_relaxed),
+    limits->bytes_per_second_,
+    limits->burst_ns_,
+    now
+  );
+  uint64_t messages_delay = GetBucketDelay(
+    atomic_load_explicit(&buckets->messages_paid_at_, memory_order_relaxed),
+    limits->messages_per_second_,
+    limits->burst_ns_,
+    now
+  );
+  return bytes_delay > messages_delay ? bytes_delay : messages_delay;
+}
+
+uint64_t BookPeerBuckets(
+  struct PeerBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t bytes,
+  uint64_t messages,
+  uint64_t now
+)
+{
+  // The booking waits for the debt charged before it, like a read charged once the buckets allowed it.
+  uint64_t bytes_delay = GetBucketDelay(
+    ChargeSharedBucket(&buckets->bytes_paid_at_, limits->bytes_per_second_, bytes, now),
+    limits->bytes_per_second_,
+    limits->burst_ns_,
+    now
+  );
+  uint64_t messages_delay = GetBucketDelay(
+    ChargeSharedBucket(&buckets->messages_paid_at_, limits->messages_per_second_, messages, now),
+    limits->messages_per_second_,
+    limits->burst_ns_,
+    now
+  );
+  return bytes_delay > messages_delay ? bytes_delay : messages_delay;
+}
+
+void SettlePeerBuckets(
+  struct PeerBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t booked_bytes,
+  uint64_t booked_messages,
+  uint64_t bytes,
+  uint64_t messages,
+  uint64_t now
+)
+{
+  SettleSharedBucket(&buckets->bytes_paid_at_, limits->bytes_per_second_, booked_bytes, bytes, now);
+  SettleSharedBucket(&buckets->messages_paid_at_, limits->messages_per_second_, booked_messages, messages, now);
+}
+
+void ChargePeerBuckets(
+  struct PeerBuckets* buckets,  //
+  const struct RateLimits* limits,
+  uint64_t bytes,
+  uint64_t messages,
+  uint64_t now
+)
+{
+  ChargeSharedBucket(&buckets->bytes_paid_at_, limits->bytes_per_second_, bytes, now);
+  ChargeSharedBucket(&buckets->messages_paid_at_, limits->messages_per_second_, messages, now);
+}
\ No newline at end of file
@@ -0,0 +1,220 @@
+#define _GNU_SOURCE
+
+#include <common/restart/restart.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+const int kRestartFailed = -1;
+const int kNoPredecessor = -2;
+
+static const int kSocketFailed = -1;
+static const int kConnectFailed = -1;
+static const int kBindFailed = -1;
+static const int kListenFailed = -1;
+static const int kAcceptFailed = -1;
+static const ssize_t kIoFailed = -1;
+static const int kDefaultSocketProtocol = 0;
+static const int kPendingSuccessors = 1;
+static const unsigned char kTakeoverConfirmed = 1;
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static int SetControlAddress(
+  struct sockaddr_un* address,  //
+  const char* path
+)  // clang-format on
+{
+  memset(address, 0, sizeof(struct sockaddr_un));
+  address->sun_family = AF_UNIX;
+  size_t path_size = strlen(path);
+  if (path_size >= sizeof(address->sun_path))
+  {
+    errno = ENAMETOOLONG;
+    return kRestartFailed;
+  }
+  memcpy(address->sun_path, path, path_size);
+  return 0;
+}
+
+int TakeOverListeners(
+  const char* path,  //
+  int* listeners,
+  size_t capacity,
+  size_t* count
+)
+{
+  struct sockaddr_un address;
+  if (SetControlAddress(&address, path) == kRestartFailed)
+  {
+    return kRestartFailed;
+  }
+  int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, kDefaultSocketProtocol);
+  if (connection == kSocketFailed)
+  {
+    return kRestartFailed;
+  }
+  if (connect(connection, (struct sockaddr*) &address, sizeof(struct sockaddr_un)) == kConnectFailed)
+  {
+    int error = errno;
+    close(connection);
+    errno = error;
+    // A missing path or a control socket nobody listens on (left by a crashed server) means a cold start.
+    return error == ENOENT || error == ECONNREFUSED ? kNoPredecessor : kRestartFailed;
+  }
+
+  // The payload is the number of the sockets carried by the control message.
+  unsigned char listeners_count;
+  struct iovec data = {&listeners_count, sizeof(listeners_count)};
+  union
+  {
+    char buffer[CMSG_SPACE(RESTART_MAX_LISTENERS * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct msghdr message;
+  memset(&message, 0, sizeof(struct msghdr));
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  message.msg_control = control.buffer;
+  message.msg_controllen = sizeof(control.buffer);
+  ssize_t received_bytes;
+  do
+  {
+    received_bytes = recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+  } while (received_bytes == kIoFailed && errno == EINTR);
+  if (received_bytes != sizeof(listeners_count) || (message.msg_flags & MSG_CTRUNC) != 0)
+  {
+    close(connection);
+    errno = received_bytes == kIoFailed ? errno : EPROTO;
+    return kRestartFailed;
+  }
+
+  *count = 0;
+  struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+  if (header != NULL && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+  {
+    size_t received_count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const unsigned char* fds = CMSG_DATA(header);
+    for (size_t i = 0; i < received_count; ++i)
+    {
+      int fd;
+      memcpy(&fd, fds + i * sizeof(int), sizeof(int));
+      if (*count < capacity && *count < listeners_count)
+      {
+        listeners[(*count)++] = fd;
+      }
+      else
+      {
+        close(fd);
+      }
+    }
+  }
+  return connection;
+}
+
+int ConfirmTakeover(
+  int connection
+)
+{
+  ssize_t sent_bytes = send(connection, &kTakeoverConfirmed, sizeof(kTakeoverConfirmed), MSG_NOSIGNAL);
+  int error = errno;
+  close(connection);
+  errno = error;
+  return sent_bytes == sizeof(kTakeoverConfirmed) ? 0 : kRestartFailed;
+}
+
+int ListenForSuccessor(
+  const char* path
+)
+{
+  struct sockaddr_un address;
+  if (SetControlAddress(&address, path) == kRestartFailed)
+  {
+    return kRestartFailed;
+  }
+  int control_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, kDefaultSocketProtocol);
+  if (control_socket == kSocketFailed)
+  {
+    return kRestartFailed;
+  }
+  unlink(path);
+  if (bind(control_socket, (struct sockaddr*) &address, sizeof(struct sockaddr_un)) == kBindFailed ||
+      listen(control_socket, kPendingSuccessors) == kListenFailed)
+  {
+    int error = errno;
+    close(control_socket);
+    errno = error;
+    return kRestartFailed;
+  }
+  return control_socket;
+}
+
+int HandOverListeners(
+  int control_socket,  //
+  const int* listeners,
+  size_t count
+)
+{
+  if (count > RESTART_MAX_LISTENERS)
+  {
+    errno = EINVAL;
+    return kRestartFailed;
+  }
+  int connection = accept4(control_socket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (connection == kAcceptFailed)
+  {
+    return kRestartFailed;
+  }
+
+  unsigned char listeners_count = (unsigned char) count;
+  struct iovec data = {&listeners_count, sizeof(listeners_count)};
+  union
+  {
+    char buffer[CMSG_SPACE(RESTART_MAX_LISTENERS * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  struct msghdr message;
+  memset(&message, 0, sizeof(struct msghdr));
+  memset(&control, 0, sizeof(control));
+  message.msg_iov = &data;
+  message.msg_iovlen = 1;
+  if (count != 0)
+  {
+    message.msg_control = control.buffer;
+    message.msg_controllen = CMSG_SPACE(count * sizeof(int));
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(count * sizeof(int));
+    memcpy(CMSG_DATA(header), listeners, count * sizeof(int));
+  }
+  // The message is tiny, the send buffer of a fresh connection always takes it.
+  if (sendmsg(connection, &message, MSG_NOSIGNAL) != sizeof(listeners_count))
+  {
+    int error = errno;
+    close(connection);
+    errno = error;
+    return kRestartFailed;
+  }
+  return connection;
+}
+
+int ReceiveTakeover(
+  int connection
+)
+{
+  unsigned char confirmation = 0;
+  ssize_t received_bytes = recv(connection, &confirmation, sizeof(confirmation), 0);
+  int error = errno;
+  close(connection);
+  if (received_bytes != sizeof(confirmation) || confirmation != kTakeoverConfirmed)
+  {
+    errno = received_bytes == kIoFailed ? error : EPIPE;
+    return kRestartFailed;
+  }
+  return 0;
+}
\ No newline at end of file
@@ -6,6 +6,7 @@ enum SystemCallError
   kReadFailed = -1,
   kWriteFailed = -1,
   kPipeFailed = -1,
+  kEventfdFailed = -1,
   kEpollCreateFailed = -1,
   kEpollCtlFailed = -1,
   kEpollWaitFailed = -1,
@@ -14,9 +15,26 @@ enum SystemCallError
   kListenFailed = -1,
   kAcceptFailed = -1,
   kFcntlFailed = -1,
+  kSetsockoptFailed = -1,
+  kOpenFailed = -1,
   kTimerCreateFailed = -1,
-  kTimerSettimeFailed = -1
+  kTimerSettimeFailed = -1,
+  kIoUringSetupFailed = -1,
+  kIoUringEnterFailed = -1,
+  kIoUringRegisterFailed = -1,
+  kGetsocknameFailed = -1,
+  kSignalfdFailed = -1
 };
 
 extern const int kServerSocketInitFailed;
-extern const int kSocketRegistryFailed;
\ No newline at end of file
+extern const int kSocketRegistryFailed;
+extern const int kWorkerPoolStartFailed;
+extern const int kDispatchFailed;
+extern const int kPinWorkerFailed;
+extern const int kEpollBusyPollFailed;
+extern const int kRingInitFailed;
+extern const int kRingSubmitFailed;
+extern const int kBufferRingRegisterFailed;
+extern const int kUringEngineFailed;
+extern const int kUdpEngineFailed;
+extern const int kLeaderFailed;
\ No newline at end of file
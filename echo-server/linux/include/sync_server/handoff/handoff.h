@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HANDOFF_QUEUE_CAPACITY 1024
+
+struct HandoffCell
+{
+  atomic_size_t sequence_;
+  int fd_;
+};
+
+/*
+ * Bounded lock-free queue of the accepted sockets handed off to a worker.
+ * Any thread may push. The owning worker pops and so may the idle workers
+ * stealing the sockets it has not got to yet. Every cell carries a
+ * sequence number telling whether it is free for the push of the current
+ * lap or holds a socket for the pop, so both a push and a pop are a single
+ * compare and swap on the tail or the head.
+ *
+ * The consumer sleeps in epoll on the eventfd of the queue. Producers do
+ * not write the eventfd per socket: a push only reports whether the
+ * consumer has to be woken up, which happens once until the consumer
+ * acknowledges the wakeup, so a burst of handoffs costs a single write
+ * and a single read.
+ */
+struct HandoffQueue
+{
+  _Alignas(64) atomic_size_t tail_;
+  _Alignas(64) atomic_size_t head_;
+  _Alignas(64) atomic_bool signaled_;
+  int eventfd_;
+  struct HandoffCell cells_[HANDOFF_QUEUE_CAPACITY];
+};
+
+extern const int kHandoffQueueInitFailed;
+extern const int kHandoffQueueWakeFailed;
+
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+extern int HandoffQueueInitialize(struct HandoffQueue* queue);
+
+/*
+ * Returns false if the queue is full. On success wakeup is set if the
+ * caller has to wake the consumer up with HandoffQueueWake.
+ */
+// clang-format off
+__attribute__((nonnull(1, 3))) __attribute__((warn_unused_result))
+extern bool HandoffQueuePush(
+  struct HandoffQueue* queue,  //
+  int fd,
+  bool* wakeup
+);  // clang-format on
+
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+extern int HandoffQueueWake(struct HandoffQueue* queue);
+
+/*
+ * Wakes the consumer up without pushing anything unless a wakeup is
+ * already pending.
+ */
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+extern int HandoffQueueNotify(struct HandoffQueue* queue);
+
+/*
+ * Consumes the wakeup before the queue is drained, so sockets pushed
+ * during the drain wake the consumer up again.
+ */
+__attribute__((nonnull(1)))
+extern void HandoffQueueAcknowledge(struct HandoffQueue* queue);
+
+/*
+ * Returns false if the queue is empty. Safe to call from any thread.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2))) __attribute__((warn_unused_result))
+extern bool HandoffQueuePop(
+  struct HandoffQueue* queue,  //
+  int* fd
+);  // clang-format on
+
+/*
+ * Number of sockets waiting in the queue, may be read by any thread.
+ */
+__attribute__((nonnull(1)))
+extern size_t HandoffQueueSize(struct HandoffQueue* queue);
\ No newline at end of file
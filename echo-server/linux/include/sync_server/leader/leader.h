@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sync_server/server/server.h>
+#include <sync_server/worker/worker.h>
+
+#define LEADER_MAX_EVENTS (SERVER_MAX_SOCKETS + 3)
+
+extern const uint64_t kDefaultDrainTimeout;
+extern const int kNoListenersTaken;
+
+struct Leader;
+
+typedef void (*ReloadHandler)(struct Leader* leader, void* context);
+
+/*
+ * With restart_path_ the leader listens for a successor on that Unix
+ * socket path, and a server started with the same path takes the
+ * listening sockets of the running one over instead of binding new ones.
+ * drain_timeout_ms_ bounds how long the connections may take to finish
+ * once the server stops accepting. reload_ runs on the leader thread
+ * when the server receives SIGHUP, the signal is ignored without it.
+ */
+struct LeaderOptions
+{
+  const char* restart_path_;
+  uint64_t drain_timeout_ms_;
+  ReloadHandler reload_;
+  void* reload_context_;
+};
+
+/*
+ * Thread accepting on the listening sockets of the epoll engine (none
+ * with SO_REUSEPORT, the workers accept themselves) and handling the
+ * server lifetime: SIGTERM, SIGINT and SIGHUP are blocked in every
+ * thread and read from a signalfd here, so a termination signal stops
+ * the accepting and drains the workers, and a successor taking the
+ * listeners over does the same. SIGHUP reloads the configuration.
+ * The server exits once the workers have no connections left or the
+ * drain deadline passes; a second signal exits right away.
+ *
+ * With the pause overload action the leader stops watching the listening
+ * sockets while every worker is overloaded and checks the workers again
+ * every few milliseconds until one of them catches up.
+ */
+struct Leader
+{
+  struct LeaderOptions options_;
+  int epfd_;
+  int signal_fd_;
+  int predecessor_;
+  int control_socket_;
+  int successor_;
+  bool draining_;
+  bool accept_paused_;
+  uint64_t drain_deadline_ms_;
+  struct Server* server_;
+  struct WorkerPool* pool_;
+};
+
+/*
+ * Blocks the termination signals in the calling thread, so it has to run
+ * before any other thread starts: the threads inherit the mask.
+ */
+__attribute__((nonnull(1, 2))) __attribute__((warn_unused_result))
+extern int InitializeLeader(
+  struct Leader* leader,  //
+  const struct LeaderOptions* options
+);
+
+/*
+ * Receives the listening sockets of a running server on the restart path
+ * into the server, or just connects to it when the server is NULL (with
+ * SO_REUSEPORT the sockets of both bind side by side). Returns
+ * kNoListenersTaken when the caller has to bind its own sockets, also if
+ * the sockets do not listen on the ports of the options.
+ */
+__attribute__((nonnull(1, 3))) __attribute__((warn_unused_result))
+extern int TakeOverServerSockets(
+  struct Leader* leader,  //
+  struct Server* server,
+  const struct ServerOptions* options
+);
+
+/*
+ * Confirms the takeover to the predecessor and serves until the server is
+ * drained. The server is NULL when the workers accept themselves.
+ */
+__attribute__((nonnull(1, 3))) __attribute__((warn_unused_result))
+extern int RunLeader(
+  struct Leader* leader,  //
+  struct Server* server,
+  struct WorkerPool* pool
+);
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Minimal io_uring wrapper on top of the raw io_uring_setup/enter/register
+ * system calls: submission and completion queues mapped into user space
+ * plus one provided buffer ring.
+ */
+struct Ring
+{
+  int fd_;
+  unsigned flags_;
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_flags_;
+  unsigned sq_entries_;
+  unsigned sqe_tail_;
+  unsigned sqe_submitted_;
+  struct io_uring_sqe* sqes_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  struct io_uring_cqe* cqes_;
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  size_t sqes_size_;
+};
+
+struct BufferRing
+{
+  struct io_uring_buf_ring* ring_;
+  size_t ring_size_;
+  unsigned char* buffers_;
+  unsigned entries_;
+  unsigned buffer_size_;
+  unsigned short group_id_;
+};
+
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+extern int RingInitialize(
+  struct Ring* ring,  //
+  unsigned entries,
+  bool sqpoll
+);
+
+__attribute__((nonnull(1)))
+extern struct io_uring_sqe* RingGetSqe(struct Ring* ring);
+
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+extern int RingSubmitAndWait(
+  struct Ring* ring,  //
+  unsigned wait_count
+);
+
+__attribute__((nonnull(1)))
+extern struct io_uring_cqe* RingPeekCqe(struct Ring* ring);
+
+__attribute__((nonnull(1)))
+extern void RingAdvanceCq(struct Ring* ring);
+
+__attribute__((nonnull(1, 2))) __attribute__((warn_unused_result))
+extern int RingRegisterBufferRing(
+  struct Ring* ring,  //
+  struct BufferRing* buffer_ring,
+  unsigned entries,
+  unsigned buffer_size,
+  unsigned short group_id
+);
+
+__attribute__((nonnull(1)))
+extern unsigned char* BufferRingGet(
+  struct BufferRing* buffer_ring,  //
+  unsigned short buffer_id
+);
+
+__attribute__((nonnull(1)))
+extern void BufferRingRecycle(
+  struct BufferRing* buffer_ring,  //
+  unsigned short buffer_id
+);
\ No newline at end of file
@@ -1,17 +1,106 @@
 #pragma once
 
 #include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-#define SERVER_SOCKETS_COUNT 10
+#define SERVER_MAX_SOCKETS 10
 
+extern const uint16_t kDefaultBasePort;
+extern const int kDefaultPortsCount;
+extern const int kDefaultBacklog;
+extern const uint32_t kNoBusyPoll;
+extern const int kDefaultSocketBuffer;
+extern const int kNoDeferAccept;
+extern const int kSocketsMismatch;
+extern const int kAcceptExhausted;
+
+/*
+ * Address, ports and backlog of the listening sockets: ports_count_
+ * consecutive ports from base_port_, at most SERVER_MAX_SOCKETS. With
+ * reuse_port_ every
+ * socket is opened with SO_REUSEPORT, so each epoll worker can bind its
+ * own set of listeners and the kernel shards the connections among them.
+ *
+ * With busy_poll_us_ the sockets busy poll the device queue for up to
+ * that many microseconds when they have no data (SO_BUSY_POLL and
+ * SO_PREFER_BUSY_POLL); the accepted sockets inherit the setting from the
+ * listener. Values above net.core.busy_read need CAP_NET_ADMIN.
+ *
+ * Nonzero buffer sizes set SO_RCVBUF and SO_SNDBUF of the listeners,
+ * which the accepted sockets inherit, and turn the kernel autotuning of
+ * those buffers off; zero keeps the net.ipv4.tcp_rmem and tcp_wmem
+ * defaults. With defer_accept_s_ a connection is accepted only once its
+ * first data arrives or that many seconds pass (TCP_DEFER_ACCEPT), and
+ * no_delay_ disables Nagle's algorithm on the accepted sockets.
+ */
+struct ServerOptions
+{
+  struct in_addr address_;
+  uint16_t base_port_;
+  int ports_count_;
+  int backlog_;
+  bool reuse_port_;
+  uint32_t busy_poll_us_;
+  int receive_buffer_size_;
+  int send_buffer_size_;
+  int defer_accept_s_;
+  bool no_delay_;
+};
+
+/*
+ * The reserve descriptor is kept open so that the server can still accept
+ * and reset connections when the process runs out of descriptors, instead
+ * of leaving them in the backlog with the listener readable forever.
+ */
 struct Server
 {
-  int sockets_[SERVER_SOCKETS_COUNT];
+  int sockets_[SERVER_MAX_SOCKETS];
+  int sockets_count_;
+  uint16_t base_port_;
+  int reserve_fd_;
   struct sockaddr_in info_;
 };
 
-__attribute__((nonnull(1))) __attribute__((warn_unused_result))
-extern int InitializeServerSockets(struct Server* server);
+typedef void (*ClientHandler)(int clientfd, const struct sockaddr_in* peer, void* context);
+
+__attribute__((nonnull(1, 2))) __attribute__((warn_unused_result))
+extern int InitializeServerSockets(
+  struct Server* server,  //
+  const struct ServerOptions* options
+);
+
+/*
+ * Takes over the listening sockets of a predecessor instead of binding
+ * new ones; the descriptors are expected in port order. Returns
+ * kSocketsMismatch without taking them if they do not listen on the
+ * ports of the options.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2, 3))) __attribute__((warn_unused_result))
+extern int AdoptServerSockets(
+  struct Server* server,  //
+  const struct ServerOptions* options,
+  const int* sockets,
+  size_t sockets_count
+);  // clang-format on
+
+/*
+ * Applies the buffer sizes of the options to a socket.
+ */
+// clang-format off
+__attribute__((nonnull(2))) __attribute__((warn_unused_result))
+extern int SetSocketBuffers(
+  int sockfd,  //
+  const struct ServerOptions* options
+);  // clang-format on
+
+__attribute__((warn_unused_result))
+extern int EnableSocketBusyPoll(
+  int sockfd,  //
+  uint32_t busy_poll_us
+);
 
 __attribute__((nonnull(2))) __attribute__((warn_unused_result))
 extern int RegisterServerSockets(
@@ -22,8 +111,34 @@ extern int RegisterServerSockets(
 __attribute__((nonnull(1)))
 extern void PrintServerInitInfo(struct Server* server);
 
-__attribute__((warn_unused_result))
-extern int ConfigureClientSocket(int clientfd);
+/*
+ * Accepts every connection pending on the nonblocking listening socket
+ * with accept4, so the accepted sockets are nonblocking and close-on-exec,
+ * and passes them to the handler. Transient errors are counted and
+ * skipped; on descriptor exhaustion one pending connection is accepted
+ * with the reserve descriptor and reset, the rest wait for the next call.
+ * Returns kAcceptExhausted when no reserve descriptor is left to do so:
+ * the listener stays readable, so the caller has to stop watching it
+ * until RestoreServerReserve succeeds.
+ */
+__attribute__((nonnull(1, 3)))
+extern int AcceptClients(
+  struct Server* server,  //
+  int listenfd,
+  ClientHandler handler,
+  void* context
+);
 
+/*
+ * Reopens the reserve descriptor if it was lost to descriptor exhaustion.
+ * Returns false while it cannot be reopened.
+ */
 __attribute__((nonnull(1)))
-extern void* ControlBlockFunction(void* arg);
\ No newline at end of file
+extern bool RestoreServerReserve(struct Server* server);
+
+/*
+ * Closes an accepted socket with a reset instead of the orderly shutdown,
+ * so the client learns at once that the server did not take it and the
+ * socket leaves no TIME_WAIT behind. Counted as a rejected connection.
+ */
+extern void RejectClient(int clientfd);
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOTS 64
+
+/*
+ * Timer is embedded into the object it belongs to. The tag is set by the
+ * owner to tell its timers apart in the expiry callback.
+ */
+struct Timer
+{
+  struct Timer* next_;
+  struct Timer** pprev_;
+  uint64_t expires_;
+  unsigned tag_;
+};
+
+/*
+ * Hierarchical timing wheel: every level has TIMER_WHEEL_SLOTS slots and
+ * each slot of a level spans the whole previous level. Timers are inserted
+ * into the level matching their distance from the current tick and are
+ * cascaded into the lower levels as the wheel turns, so scheduling and
+ * cancellation are O(1) regardless of the number of armed timers.
+ *
+ * The wheel has no notion of wall time: ticks are supplied by the caller.
+ * now_ is the next tick to be processed.
+ */
+struct TimerWheel
+{
+  uint64_t now_;
+  size_t armed_timers_;
+  struct Timer* slots_[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+typedef void (*TimerCallback)(struct Timer* timer, void* context);
+
+extern const uint64_t kTimerWheelIdle;
+
+__attribute__((nonnull(1)))
+extern void TimerWheelInitialize(
+  struct TimerWheel* wheel,  //
+  uint64_t now
+);
+
+__attribute__((nonnull(1)))
+extern void TimerInitialize(
+  struct Timer* timer,  //
+  unsigned tag
+);
+
+__attribute__((nonnull(1)))
+extern bool TimerIsArmed(const struct Timer* timer);
+
+/*
+ * Arms the timer to expire at the specified tick, rearming it if it is
+ * already armed. Ticks in the past expire on the next advance.
+ */
+__attribute__((nonnull(1, 2)))
+extern void TimerWheelSchedule(
+  struct TimerWheel* wheel,  //
+  struct Timer* timer,
+  uint64_t expires
+);
+
+__attribute__((nonnull(1, 2)))
+extern void TimerWheelCancel(
+  struct TimerWheel* wheel,  //
+  struct Timer* timer
+);
+
+/*
+ * Turns the wheel up to the specified tick and invokes the callback for
+ * every expired timer. The timer is disarmed before the callback, which
+ * may schedule and cancel any timers of the wheel.
+ */
+__attribute__((nonnull(1, 3)))
+extern void TimerWheelAdvance(
+  struct TimerWheel* wheel,  //
+  uint64_t now,
+  TimerCallback callback,
+  void* context
+);
+
+/*
+ * Returns the tick up to which the caller may sleep before the next
+ * advance or kTimerWheelIdle if no timers are armed.
+ */
+__attribute__((nonnull(1)))
+extern uint64_t TimerWheelNextTick(const struct TimerWheel* wheel);
\ No newline at end of file
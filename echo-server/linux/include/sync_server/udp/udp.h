@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdbool.h>
+#include <sync_server/server/server.h>
+#include <sync_server/worker/worker.h>
+
+/*
+ * Runs the UDP echo engine: every worker binds its own SO_REUSEPORT
+ * socket to each server port, so the kernel spreads the peers over the
+ * workers, and echoes the datagrams in recvmmsg/sendmmsg batches. With
+ * GRO the kernel coalesces the datagrams of a peer into one buffer and
+ * the echo is segmented back with GSO.
+ */
+__attribute__((nonnull(1, 2))) __attribute__((warn_unused_result))
+extern int RunUdpEngine(
+  const struct ServerOptions* server_options,  //
+  const struct WorkerOptions* options,
+  bool gro
+);
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdbool.h>
+#include <sync_server/server/server.h>
+#include <sync_server/worker/worker.h>
+
+__attribute__((nonnull(1, 2))) __attribute__((warn_unused_result))
+extern int RunUringEngine(
+  struct Server* server,  //
+  const struct WorkerOptions* options,
+  bool sqpoll
+);
\ No newline at end of file
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <common/rate_limit/rate_limit.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sync_server/handoff/handoff.h>
+#include <sync_server/server/server.h>
+
+#define WORKER_BUFFER_SIZE (64 * 1024)
+
+/*
+ * Limits and modes shared by the workers of all engines. Every engine
+ * runs workers_count_ workers, by default one per CPU the process may
+ * run on.
+ * Zero byte quota lets the connection echo any amount of data, zero
+ * timeouts disable the corresponding deadline. The idle deadline is
+ * pushed back whenever the connection makes progress, the lifetime one
+ * is fixed at accept.
+ *
+ * The flush threshold (epoll engine) bounds the bytes a worker echoes
+ * from one connection in a single round of back to back reads: while a
+ * read fills its whole limit the chunk is sent with MSG_MORE and the next
+ * one is read right away, zero echoes one read per readiness event.
+ *
+ * The steal threshold (epoll engine) is the number of connections that
+ * have to wait in the handoff queue of a worker before an idle worker
+ * takes half of them over, zero disables stealing.
+ *
+ * A nonzero busy poll time makes the epoll instances of the workers busy
+ * poll the device queues for up to that many microseconds before they
+ * sleep (Linux 6.9+), and the leader steers every connection to the
+ * worker serving the NAPI queue it arrived on. Pinned workers run each on
+ * its own CPU of the process affinity set.
+ *
+ * The rate limits (epoll engine) pace the reads of every connection and
+ * of all connections from one peer address with token buckets, a message
+ * being one read: a connection over its limits is not read from until
+ * its buckets allow it. A nonzero write quantum (epoll engine) replaces
+ * the flush threshold with deficit round robin: every readiness event
+ * gives the connection a turn and adds the quantum to its deficit, and
+ * the turn echoes back to back reads while they fill their limit and the
+ * deficit lasts, so a connection with a lot of input waiting takes the
+ * same share of the worker as the others.
+ *
+ * Admission control (epoll engine) takes a worker as overloaded while
+ * its loop lag, the smoothed time a loop round takes from the return of
+ * epoll_wait to the next call, reaches max_loop_lag_ms_ or while
+ * max_queue_depth_ connections wait in its handoff queue; zero disables
+ * the corresponding threshold. New connections go to the workers that
+ * are not overloaded, and once none is left the overload action applies:
+ * the listeners stop accepting until a worker catches up, the accepted
+ * connections are reset, or each new connection takes the place of the
+ * connection of its worker that has made no progress for the longest
+ * time, at least evict_idle_ms_ (the new one is reset if there is none).
+ */
+enum OverloadAction
+{
+  kOverloadPause,
+  kOverloadReject,
+  kOverloadCloseIdle
+};
+
+struct WorkerOptions
+{
+  size_t byte_quota_;
+  uint64_t idle_timeout_ms_;
+  uint64_t lifetime_ms_;
+  bool zero_copy_;
+  size_t flush_threshold_;
+  unsigned workers_count_;
+  size_t steal_threshold_;
+  uint32_t busy_poll_us_;
+  bool pin_workers_;
+  struct RateLimits rate_limits_;
+  struct RateLimits peer_rate_limits_;
+  size_t write_quantum_;
+  uint64_t max_loop_lag_ms_;
+  size_t max_queue_depth_;
+  enum OverloadAction overload_action_;
+  uint64_t evict_idle_ms_;
+};
+
+extern const size_t kDefaultByteQuota;
+extern const size_t kUnlimitedByteQuota;
+extern const uint64_t kDefaultIdleTimeout;
+extern const uint64_t kDefaultLifetime;
+extern const size_t kNoFlushThreshold;
+extern const size_t kNoWriteQuantum;
+extern const size_t kDefaultStealThreshold;
+extern const size_t kNoStealing;
+extern const uint64_t kNoTimeout;
+extern const uint64_t kTimerTickMilliseconds;
+extern const uint64_t kNoMaxLoopLag;
+extern const size_t kNoMaxQueueDepth;
+extern const uint64_t kDefaultEvictIdle;
+
+struct WorkerPool;
+struct Connection;
+
+/*
+ * Worker receives the connections accepted by the leader through its
+ * handoff queue or, when it is listening, accepts them from its own
+ * SO_REUSEPORT sockets.
+ *
+ * The connections counter covers the connections queued for the worker
+ * and the ones it serves: the leader adds a connection when it hands it
+ * off, the worker removes it when the connection is closed.
+ *
+ * A worker blocked in epoll_wait is sleeping. When the leader hands a
+ * connection off to a worker that has not picked up the previous ones
+ * yet, it wakes a sleeping worker up to steal them.
+ *
+ * All connections of the worker read into its buffer, so an idle
+ * connection holds no receive buffer.
+ *
+ * The loop lag is written by the worker and read by the threads that
+ * dispatch connections to it. An overloaded listening worker pauses its
+ * listeners with the pause overload action.
+ *
+ * Once the pool is draining the worker stops listening and closes every
+ * connection that has neither echo data waiting for the socket nor input
+ * waiting to be read, the others as soon as they get there. A connection
+ * accepted just before has a short grace to send its request first.
+ */
+struct Worker
+{
+  pthread_t thread_;
+  unsigned id_;
+  struct WorkerOptions options_;
+  struct WorkerPool* pool_;
+  int epfd_;
+  _Alignas(64) atomic_uint connections_;
+  atomic_bool sleeping_;
+  _Atomic uint64_t loop_lag_us_;
+  bool listening_;
+  bool accept_paused_;
+  struct Server server_;
+  struct HandoffQueue handoffs_;
+  struct Connection* first_connection_;
+  struct Connection* last_connection_;
+  unsigned options_generation_;
+  unsigned char buffer_[WORKER_BUFFER_SIZE];
+};
+
+/*
+ * options_ holds the limits reloaded by ReconfigureWorkerPool under the
+ * mutex; a worker copies them once it sees a new options generation.
+ */
+struct WorkerPool
+{
+  struct Worker* workers_;
+  unsigned workers_count_;
+  uint32_t random_state_;
+  atomic_bool draining_;
+  pthread_mutex_t options_mutex_;
+  struct WorkerOptions options_;
+  atomic_uint options_generation_;
+};
+
+/*
+ * Returns CLOCK_MONOTONIC in the ticks of the worker timer wheels.
+ */
+extern uint64_t GetTimerTick(void);
+
+extern uint64_t MillisecondsToTicks(uint64_t milliseconds);
+
+/*
+ * Returns the number of CPUs the process may run on.
+ */
+extern unsigned GetDefaultWorkersCount(void);
+
+/*
+ * Pins the calling thread to the CPU of the worker: workers are spread
+ * over the CPUs the process may run on in id order.
+ */
+__attribute__((warn_unused_result))
+extern int PinWorkerThread(unsigned id);
+
+/*
+ * Makes epoll_wait on the instance busy poll the device queues of its
+ * sockets for up to busy_poll_us microseconds before it sleeps.
+ */
+__attribute__((warn_unused_result))
+extern int EnableEpollBusyPoll(
+  int epfd,  //
+  uint32_t busy_poll_us
+);
+
+/*
+ * Starts the epoll workers. With the server options every worker opens
+ * its own SO_REUSEPORT listening sockets instead of waiting for the
+ * handoffs of the leader.
+ */
+__attribute__((nonnull(1, 2))) __attribute__((warn_unused_result))
+extern int StartWorkerPool(
+  struct WorkerPool* pool,  //
+  const struct WorkerOptions* options,
+  const struct ServerOptions* server_options
+);
+
+/*
+ * Hands the connection off to the less loaded of two workers picked at
+ * random, or in busy poll mode to the worker of the NAPI queue the
+ * connection arrived on. Otherwise an overloaded worker is passed over
+ * for the next one that is not, if any. Fails with EAGAIN if the handoff
+ * queue of the worker is full.
+ */
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+extern int DispatchClient(
+  struct WorkerPool* pool,  //
+  int clientfd
+);
+
+/*
+ * Returns true if admission control is on and every worker of the pool
+ * is overloaded.
+ */
+__attribute__((nonnull(1)))
+extern bool IsWorkerPoolOverloaded(struct WorkerPool* pool);
+
+/*
+ * Passes the byte quota, the timeouts, the flush threshold, the rate
+ * limits and the write quantum of the options to the running workers.
+ * They apply to the data and connections the workers handle afterwards,
+ * except that the peer limits do not cover the connections accepted
+ * while they were off; the other options keep their start values.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+extern void ReconfigureWorkerPool(
+  struct WorkerPool* pool,  //
+  const struct WorkerOptions* options
+);  // clang-format on
+
+/*
+ * Makes every worker stop listening and close its connections once they
+ * are idle.
+ */
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+extern int DrainWorkerPool(struct WorkerPool* pool);
+
+/*
+ * Number of connections queued for or served by the workers of the pool.
+ */
+__attribute__((nonnull(1)))
+extern uint64_t CountPoolConnections(struct WorkerPool* pool);
\ No newline at end of file
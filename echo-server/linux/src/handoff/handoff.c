@@ -0,0 +1,150 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sync_server/errors/errors.h>
+#include <sync_server/handoff/handoff.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+const int kHandoffQueueInitFailed = -1;
+const int kHandoffQueueWakeFailed = -1;
+
+static const size_t kCellMask = HANDOFF_QUEUE_CAPACITY - 1;
+static const uint64_t kWakeupValue = 1;
+
+int HandoffQueueInitialize(
+  struct HandoffQueue* queue
+)
+{
+  atomic_init(&queue->tail_, 0);
+  atomic_init(&queue->head_, 0);
+  atomic_init(&queue->signaled_, false);
+  for (size_t i = 0; i < HANDOFF_QUEUE_CAPACITY; ++i)
+  {
+    atomic_init(&queue->cells_[i].sequence_, i);
+  }
+
+  queue->eventfd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (queue->eventfd_ == kEventfdFailed)
+  {
+    return kHandoffQueueInitFailed;
+  }
+  return 0;
+}
+
+bool HandoffQueuePush(
+  struct HandoffQueue* queue,  //
+  int fd,
+  bool* wakeup
+)
+{
+  size_t tail = atomic_load_explicit(&queue->tail_, memory_order_relaxed);
+  struct HandoffCell* cell;
+  while (true)
+  {
+    cell = queue->cells_ + (tail & kCellMask);
+    size_t sequence = atomic_load_explicit(&cell->sequence_, memory_order_acquire);
+    if (sequence == tail)
+    {
+      if (atomic_compare_exchange_weak_explicit(
+            &queue->tail_, &tail, tail + 1, memory_order_relaxed, memory_order_relaxed
+          ))
+      {
+        break;
+      }
+    }
+    else if (sequence < tail)
+    {
+      // The cell still holds the socket pushed a lap ago.
+      return false;
+    }
+    else
+    {
+      tail = atomic_load_explicit(&queue->tail_, memory_order_relaxed);
+    }
+  }
+
+  cell->fd_ = fd;
+  atomic_store_explicit(&cell->sequence_, tail + 1, memory_order_release);
+  *wakeup = !atomic_exchange_explicit(&queue->signaled_, true, memory_order_acq_rel);
+  return true;
+}
+
+int HandoffQueueWake(
+  struct HandoffQueue* queue
+)
+{
+  if (write(queue->eventfd_, &kWakeupValue, sizeof(uint64_t)) == kWriteFailed)
+  {
+    return kHandoffQueueWakeFailed;
+  }
+  return 0;
+}
+
+int HandoffQueueNotify(
+  struct HandoffQueue* queue
+)
+{
+  if (atomic_exchange_explicit(&queue->signaled_, true, memory_order_acq_rel))
+  {
+    return 0;
+  }
+  return HandoffQueueWake(queue);
+}
+
+void HandoffQueueAcknowledge(
+  struct HandoffQueue* queue
+)
+{
+  // EAGAIN only means that the wakeup was consumed along with an earlier one.
+  uint64_t value;
+  ssize_t bytes = read(queue->eventfd_, &value, sizeof(uint64_t));
+  (void) bytes;
+  // Pairs with the exchange of the push: the sockets pushed before it are visible to the drain.
+  atomic_exchange_explicit(&queue->signaled_, false, memory_order_acq_rel);
+}
+
+bool HandoffQueuePop(
+  struct HandoffQueue* queue,  //
+  int* fd
+)
+{
+  size_t head = atomic_load_explicit(&queue->head_, memory_order_relaxed);
+  struct HandoffCell* cell;
+  while (true)
+  {
+    cell = queue->cells_ + (head & kCellMask);
+    size_t sequence = atomic_load_explicit(&cell->sequence_, memory_order_acquire);
+    if (sequence == head + 1)
+    {
+      if (atomic_compare_exchange_weak_explicit(
+            &queue->head_, &head, head + 1, memory_order_relaxed, memory_order_relaxed
+          ))
+      {
+        break;
+      }
+    }
+    else if (sequence < head + 1)
+    {
+      return false;
+    }
+    else
+    {
+      head = atomic_load_explicit(&queue->head_, memory_order_relaxed);
+    }
+  }
+
+  *fd = cell->fd_;
+  atomic_store_explicit(&cell->sequence_, head + HANDOFF_QUEUE_CAPACITY, memory_order_release);
+  return true;
+}
+
+size_t HandoffQueueSize(
+  struct HandoffQueue* queue
+)
+{
+  size_t head = atomic_load_explicit(&queue->head_, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&queue->tail_, memory_order_relaxed);
+  return tail > head ? tail - head : 0;
+}
\ No newline at end of file
@@ -0,0 +1,413 @@
+#define _GNU_SOURCE
+
+#include <common/logger/logger.h>
+#include <common/metrics/metrics.h>
+#include <common/restart/restart.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sync_server/errors/errors.h>
+#include <sync_server/leader/leader.h>
+#include <sync_server/server/server.h>
+#include <sync_server/worker/worker.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+const uint64_t kDefaultDrainTimeout = 10000U;
+const int kLeaderFailed = -1;
+const int kNoListenersTaken = 1;
+
+static const int kNoDescriptor = -1;
+static const int kSigmaskSuccess = 0;
+static const int kInfiniteEpollTimeout = -1;
+static const int kDrainPollInterval = 10;
+static const int kOverloadPollInterval = 10;
+static const uint64_t kMillisecondsPerSecond = 1000U;
+static const uint64_t kNanosecondsPerMillisecond = 1000000U;
+
+static uint64_t GetMonotonicMilliseconds(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * kMillisecondsPerSecond + (uint64_t) now.tv_nsec / kNanosecondsPerMillisecond;
+}
+
+// clang-format off
+__attribute__((nonnull(2, 3)))
+static void HandOffClient(
+  int clientfd,  //
+  const struct sockaddr_in* peer,
+  void* context
+)  // clang-format on
+{
+  (void) peer;
+  struct WorkerPool* pool = (struct WorkerPool*) context;
+  if (pool->options_.overload_action_ == kOverloadReject && IsWorkerPoolOverloaded(pool))
+  {
+    RejectClient(clientfd);
+    return;
+  }
+  int error_code = DispatchClient(pool, clientfd);
+  if (error_code == kDispatchFailed)
+  {
+    if (errno != EAGAIN)
+    {
+      LOG_FATAL("Server received error: client dispatch failed: [%d](%s)", errno, strerror(errno));
+    }
+    else
+    {
+      LOG_WARNING("Server received error: client dispatch failed: [%d](%s)", errno, strerror(errno));
+      AddMetric(kMetricClosedConnections, 1);
+      shutdown(clientfd, SHUT_RDWR);
+      close(clientfd);
+    }
+  }
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static int WatchDescriptor(
+  struct Leader* leader,  //
+  int fd
+)  // clang-format on
+{
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  return epoll_ctl(leader->epfd_, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/*
+ * Stops or resumes watching the listening sockets; while paused the
+ * connections wait in the accept queues of the sockets.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static void PauseAccepting(
+  struct Leader* leader,  //
+  bool paused
+)  // clang-format on
+{
+  for (int i = 0; i < leader->server_->sockets_count_; ++i)
+  {
+    int error_code = paused ? epoll_ctl(leader->epfd_, EPOLL_CTL_DEL, leader->server_->sockets_[i], NULL)
+                            : WatchDescriptor(leader, leader->server_->sockets_[i]);
+    if (error_code == kEpollCtlFailed)
+    {
+      LOG_WARNING("Server received error: epoll failed: [%d](%s)", errno, strerror(errno));
+    }
+  }
+  leader->accept_paused_ = paused;
+  if (paused)
+  {
+    AddMetric(kMetricAcceptPauses, 1);
+    LOG_INFO("Server is overloaded, accepting is paused");
+  }
+  else
+  {
+    LOG_INFO("Server caught up, accepting is resumed");
+  }
+}
+
+/*
+ * Stops accepting and lets the workers close their connections. The
+ * connections queued on the listeners would be reset when they close, so
+ * they are handed off first, unless a successor took the listeners over
+ * and accepts them itself. The control path is removed only if no
+ * successor has replaced it.
+ */
+// clang-format off
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+static int StartDrain(
+  struct Leader* leader,  //
+  bool taken_over
+)  // clang-format on
+{
+  leader->draining_ = true;
+  leader->drain_deadline_ms_ = GetMonotonicMilliseconds() + leader->options_.drain_timeout_ms_;
+  if (leader->server_ != NULL)
+  {
+    for (int i = 0; i < leader->server_->sockets_count_; ++i)
+    {
+      if (!taken_over)
+      {
+        AcceptClients(leader->server_, leader->server_->sockets_[i], &HandOffClient, leader->pool_);
+      }
+      close(leader->server_->sockets_[i]);
+    }
+  }
+  if (leader->control_socket_ != kNoDescriptor)
+  {
+    close(leader->control_socket_);
+    leader->control_socket_ = kNoDescriptor;
+    if (!taken_over)
+    {
+      unlink(leader->options_.restart_path_);
+    }
+  }
+  if (leader->successor_ != kNoDescriptor)
+  {
+    close(leader->successor_);
+    leader->successor_ = kNoDescriptor;
+  }
+  LOG_INFO(
+    "Server is draining %" PRIu64 " connections",  //
+    CountPoolConnections(leader->pool_)
+  );
+  return DrainWorkerPool(leader->pool_);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void ReloadLeader(
+  struct Leader* leader
+)  // clang-format on
+{
+  if (leader->options_.reload_ == NULL || leader->draining_)
+  {
+    LOG_INFO("Server received SIGHUP, nothing to reload");
+    return;
+  }
+  LOG_INFO("Server received SIGHUP, reloading the configuration");
+  leader->options_.reload_(leader, leader->options_.reload_context_);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void HandOverServerSockets(
+  struct Leader* leader
+)  // clang-format on
+{
+  if (leader->successor_ != kNoDescriptor)
+  {
+    // A successor is taking over already, the next one has to wait for it.
+    return;
+  }
+  size_t listeners_count = leader->server_ != NULL ? (size_t) leader->server_->sockets_count_ : 0;
+  const int* listeners = leader->server_ != NULL ? leader->server_->sockets_ : NULL;
+  int successor = HandOverListeners(leader->control_socket_, listeners, listeners_count);
+  if (successor == kRestartFailed)
+  {
+    LOG_WARNING("Server received error: listeners handover failed: [%d](%s)", errno, strerror(errno));
+    return;
+  }
+  if (WatchDescriptor(leader, successor) == kEpollCtlFailed)
+  {
+    LOG_WARNING("Server received error: epoll failed: [%d](%s)", errno, strerror(errno));
+    close(successor);
+    return;
+  }
+  leader->successor_ = successor;
+}
+
+int InitializeLeader(
+  struct Leader* leader,  //
+  const struct LeaderOptions* options
+)
+{
+  leader->options_ = *options;
+  leader->epfd_ = kNoDescriptor;
+  leader->signal_fd_ = kNoDescriptor;
+  leader->predecessor_ = kNoDescriptor;
+  leader->control_socket_ = kNoDescriptor;
+  leader->successor_ = kNoDescriptor;
+  leader->draining_ = false;
+  leader->accept_paused_ = false;
+  leader->drain_deadline_ms_ = 0;
+  leader->server_ = NULL;
+  leader->pool_ = NULL;
+
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGHUP);
+  if (pthread_sigmask(SIG_BLOCK, &signals, NULL) != kSigmaskSuccess)
+  {
+    return kLeaderFailed;
+  }
+  leader->signal_fd_ = signalfd(kNoDescriptor, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (leader->signal_fd_ == kSignalfdFailed)
+  {
+    return kLeaderFailed;
+  }
+  leader->epfd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (leader->epfd_ == kEpollCreateFailed)
+  {
+    return kLeaderFailed;
+  }
+  return WatchDescriptor(leader, leader->signal_fd_);
+}
+
+int TakeOverServerSockets(
+  struct Leader* leader,  //
+  struct Server* server,
+  const struct ServerOptions* options
+)
+{
+  if (leader->options_.restart_path_ == NULL)
+  {
+    return kNoListenersTaken;
+  }
+  int listeners[RESTART_MAX_LISTENERS];
+  size_t listeners_count = 0;
+  int predecessor =
+    TakeOverListeners(leader->options_.restart_path_, listeners, RESTART_MAX_LISTENERS, &listeners_count);
+  if (predecessor == kNoPredecessor)
+  {
+    return kNoListenersTaken;
+  }
+  if (predecessor == kRestartFailed)
+  {
+    return kLeaderFailed;
+  }
+  leader->predecessor_ = predecessor;
+
+  int error_code = server != NULL ? AdoptServerSockets(server, options, listeners, listeners_count) : kSocketsMismatch;
+  if (error_code == kServerSocketInitFailed)
+  {
+    return kLeaderFailed;
+  }
+  if (error_code != kSocketsMismatch)
+  {
+    return 0;
+  }
+  // The predecessor ran with another listening mode or ports, this server binds its own sockets next to its ones.
+  for (size_t i = 0; i < listeners_count; ++i)
+  {
+    close(listeners[i]);
+  }
+  return kNoListenersTaken;
+}
+
+int RunLeader(
+  struct Leader* leader,  //
+  struct Server* server,
+  struct WorkerPool* pool
+)
+{
+  leader->server_ = server;
+  leader->pool_ = pool;
+  if (leader->predecessor_ != kNoDescriptor)
+  {
+    if (ConfirmTakeover(leader->predecessor_) == kRestartFailed)
+    {
+      LOG_WARNING("Server received error: takeover confirmation failed: [%d](%s)", errno, strerror(errno));
+    }
+    leader->predecessor_ = kNoDescriptor;
+  }
+  if (leader->options_.restart_path_ != NULL)
+  {
+    leader->control_socket_ = ListenForSuccessor(leader->options_.restart_path_);
+    if (leader->control_socket_ == kRestartFailed)
+    {
+      return kLeaderFailed;
+    }
+    if (WatchDescriptor(leader, leader->control_socket_) == kEpollCtlFailed)
+    {
+      return kLeaderFailed;
+    }
+  }
+
+  struct epoll_event ep_events[LEADER_MAX_EVENTS];
+  while (true)
+  {
+    int timeout = leader->draining_ ? kDrainPollInterval
+                  : leader->accept_paused_ ? kOverloadPollInterval
+                                           : kInfiniteEpollTimeout;
+    int ready_events = epoll_wait(leader->epfd_, ep_events, LEADER_MAX_EVENTS, timeout);
+    if (ready_events == kEpollWaitFailed)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return kLeaderFailed;
+    }
+
+    for (int i = 0; i < ready_events; ++i)
+    {
+      int fd = ep_events[i].data.fd;
+      if (fd == leader->signal_fd_)
+      {
+        struct signalfd_siginfo signal_info;
+        if (read(leader->signal_fd_, &signal_info, sizeof(signal_info)) != sizeof(signal_info))
+        {
+          continue;
+        }
+        if (signal_info.ssi_signo == SIGHUP)
+        {
+          ReloadLeader(leader);
+          continue;
+        }
+        if (leader->draining_)
+        {
+          LOG_INFO("Server received signal %" PRIu32 " while draining, exiting", signal_info.ssi_signo);
+          return 0;
+        }
+        LOG_INFO("Server received signal %" PRIu32 ", shutting down", signal_info.ssi_signo);
+        if (StartDrain(leader, false) == kDispatchFailed)
+        {
+          return kLeaderFailed;
+        }
+        break;
+      }
+      else if (fd == leader->control_socket_)
+      {
+        HandOverServerSockets(leader);
+      }
+      else if (fd == leader->successor_)
+      {
+        leader->successor_ = kNoDescriptor;
+        if (ReceiveTakeover(fd) == kRestartFailed)
+        {
+          LOG_WARNING("Server received error: successor failed to take over: [%d](%s)", errno, strerror(errno));
+          continue;
+        }
+        LOG_INFO("Server listeners are taken over, shutting down");
+        if (StartDrain(leader, true) == kDispatchFailed)
+        {
+          return kLeaderFailed;
+        }
+        break;
+      }
+      else if (!leader->draining_)
+      {
+        if (pool->options_.overload_action_ == kOverloadPause && IsWorkerPoolOverloaded(pool))
+        {
+          PauseAccepting(leader, true);
+          break;
+        }
+        if (AcceptClients(leader->server_, fd, &HandOffClient, leader->pool_) == kAcceptExhausted)
+        {
+          PauseAccepting(leader, true);
+          break;
+        }
+      }
+    }
+
+    if (leader->accept_paused_ && !leader->draining_ && !IsWorkerPoolOverloaded(pool) &&
+        RestoreServerReserve(leader->server_))
+    {
+      PauseAccepting(leader, false);
+    }
+
+    if (leader->draining_ &&
+        (CountPoolConnections(leader->pool_) == 0 || GetMonotonicMilliseconds() >= leader->drain_deadline_ms_))
+    {
+      LOG_INFO(
+        "Server is drained, %" PRIu64 " connections left",  //
+        CountPoolConnections(leader->pool_)
+      );
+      return 0;
+    }
+  }
+}
\ No newline at end of file
@@ -1,11 +1,15 @@
 #define _GNU_SOURCE
 
 #include <arpa/inet.h>
+#include <common/config/config.h>
+#include <common/logger/logger.h>
+#include <common/memory/memory_budget.h>
+#include <common/metrics/metrics.h>
+#include <common/rate_limit/rate_limit.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <netinet/in.h>
-#include <pthread.h>
-#include <semaphore.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -13,255 +17,762 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sync_server/errors/errors.h>
-#include <sync_server/logger/logger.h>
+#include <sync_server/leader/leader.h>
 #include <sync_server/server/server.h>
-#include <sys/epoll.h>
-#include <unistd.h>
+#include <sync_server/udp/udp.h>
+#include <sync_server/uring/uring.h>
+#include <sync_server/worker/worker.h>
 
-static const int kInfiniteEpollTimeout = -1;
-static const int kPthreadCreateSuccess = 0;
-static const int kSemShareBetweenThreads = 0;
-static const int kSemInitValue = 0;
-static const int kSemInitFailed = -1;
-static const int kSemWaitFailed = -1;
-static const int kSemDestroyFailed = -1;
-static const int kMessageBufferSize = 256;
-static const int kSigEmptysetFailed = -1;
-static const int kSigactionFailed = -1;
+static const char* const kEpollEngineFlag = "--engine=epoll";
+static const char* const kUringEngineFlag = "--engine=uring";
+static const char* const kUdpEngineFlag = "--engine=udp";
+static const char* const kSqpollFlag = "--sqpoll";
+static const char* const kGroFlag = "--gro";
+static const char* const kByteQuotaFlag = "--byte-quota=";
+static const char* const kZeroCopyFlag = "--zero-copy";
+static const char* const kIdleTimeoutFlag = "--idle-timeout=";
+static const char* const kLifetimeFlag = "--lifetime=";
+static const char* const kMetricsPortFlag = "--metrics-port=";
+static const char* const kMetricsAddressFlag = "--metrics-address=";
+static const char* const kFlushThresholdFlag = "--flush-threshold=";
+static const char* const kWriteQuantumFlag = "--write-quantum=";
+static const char* const kRateBytesFlag = "--rate-bytes=";
+static const char* const kRateMessagesFlag = "--rate-messages=";
+static const char* const kPeerRateBytesFlag = "--peer-rate-bytes=";
+static const char* const kPeerRateMessagesFlag = "--peer-rate-messages=";
+static const char* const kRateBurstFlag = "--rate-burst=";
+static const char* const kMaxLoopLagFlag = "--max-loop-lag=";
+static const char* const kMaxQueueDepthFlag = "--max-queue-depth=";
+static const char* const kOverloadActionFlag = "--overload-action=";
+static const char* const kEvictIdleFlag = "--evict-idle=";
+static const char* const kOverloadActionNames[] = {"pause", "reject", "close-idle"};
+static const char* const kAddressFlag = "--address=";
+static const char* const kPortFlag = "--port=";
+static const char* const kPortsFlag = "--ports=";
+static const char* const kBacklogFlag = "--backlog=";
+static const char* const kReceiveBufferFlag = "--rcvbuf=";
+static const char* const kSendBufferFlag = "--sndbuf=";
+static const char* const kDeferAcceptFlag = "--defer-accept=";
+static const char* const kNoDelayFlag = "--no-delay";
+static const char* const kReusePortFlag = "--reuse-port";
+static const char* const kWorkersFlag = "--workers=";
+static const char* const kStealThresholdFlag = "--steal-threshold=";
+static const char* const kBusyPollFlag = "--busy-poll=";
+static const char* const kPinWorkersFlag = "--pin-workers";
+static const char* const kMemoryBudgetFlag = "--memory-budget=";
+static const char* const kRestartPathFlag = "--restart-path=";
+static const char* const kDrainTimeoutFlag = "--drain-timeout=";
+static const int kInetPtonSuccess = 1;
+static const int kSettingsParseFailed = -1;
+static const unsigned long kNoMetricsPort = 0;
+static const unsigned long kMaxPort = UINT16_MAX;
+static const uint64_t kNanosecondsPerMillisecond = 1000000U;
 
-static __thread char message_buffer[kMessageBufferSize];
-sem_t control_semaphore;
+enum Engine
+{
+  kEpollEngine,
+  kUringEngine,
+  kUdpEngine
+};
+
+/*
+ * Everything the command line and the configuration file set. The
+ * strings point into the arguments they were parsed from.
+ */
+struct Settings
+{
+  enum Engine engine_;
+  bool sqpoll_;
+  bool gro_;
+  unsigned long metrics_port_;
+  struct in_addr metrics_address_;
+  uint64_t memory_budget_;
+  struct ServerOptions server_options_;
+  struct WorkerOptions worker_options_;
+  struct LeaderOptions leader_options_;
+};
+
+/*
+ * Command line the configuration file is reloaded with.
+ */
+struct CommandLine
+{
+  int argc_;
+  char** argv_;
+};
 
-static void ConnectionExpiredHandler(
-  __attribute__((unused)) int signal,  //
-  siginfo_t* si,
-  __attribute__((unused)) void* context
+static uint64_t GetMemoryBudgetUsage(
+  void* context
 )
 {
-  int clientfd = *((int*) si->si_value.sival_ptr);
-  shutdown(clientfd, SHUT_RDWR);
-  close(clientfd);
-  snprintf(
-    message_buffer,  //
-    kMessageBufferSize,
-    "[MESSAGE] Connection time expired for: %d",
-    clientfd
-  );
-  LOG_WARNING(message_buffer, gettid());
+  (void) context;
+  return GetReservedMemory();
 }
 
 // clang-format off
-__attribute__((warn_unused_result))
-int SetSignalHandler()  // clang-format on
+__attribute__((nonnull(1)))
+static void PrintUsage(
+  const char* program
+)  // clang-format on
 {
-  struct sigaction sa;
-  sa.sa_flags = SA_SIGINFO;
+  fprintf(
+    stderr,
+    "Usage: %s [%sPATH] [%s | %s [%s] | %s [%s]] [%sIPV4] [%sPORT] [%sN] [%sN] [%sBYTES] [%sBYTES] [%sSEC] [%s] "
+    "[%s] [%sN] [%sN] [%sUSEC] [%s] [%sN] [%sMS] [%sMS] [%s] [%sBYTES] [%sBYTES] [%sN] [%sN] [%sN] [%sN] [%sMS] "
+    "[%sMS] [%sN] [%spause|reject|close-idle] [%sMS] [%sBYTES] [%sPATH] [%sMS] [%sPORT] [%sIPV4]\n",
+    program,
+    kConfigFlag,
+    kEpollEngineFlag,
+    kUringEngineFlag,
+    kSqpollFlag,
+    kUdpEngineFlag,
+    kGroFlag,
+    kAddressFlag,
+    kPortFlag,
+    kPortsFlag,
+    kBacklogFlag,
+    kReceiveBufferFlag,
+    kSendBufferFlag,
+    kDeferAcceptFlag,
+    kNoDelayFlag,
+    kReusePortFlag,
+    kWorkersFlag,
+    kStealThresholdFlag,
+    kBusyPollFlag,
+    kPinWorkersFlag,
+    kByteQuotaFlag,
+    kIdleTimeoutFlag,
+    kLifetimeFlag,
+    kZeroCopyFlag,
+    kFlushThresholdFlag,
+    kWriteQuantumFlag,
+    kRateBytesFlag,
+    kRateMessagesFlag,
+    kPeerRateBytesFlag,
+    kPeerRateMessagesFlag,
+    kRateBurstFlag,
+    kMaxLoopLagFlag,
+    kMaxQueueDepthFlag,
+    kOverloadActionFlag,
+    kEvictIdleFlag,
+    kMemoryBudgetFlag,
+    kRestartPathFlag,
+    kDrainTimeoutFlag,
+    kMetricsPortFlag,
+    kMetricsAddressFlag
+  );
+}
 
-  int error_code = sigemptyset(&sa.sa_mask);
-  if (error_code == kSigEmptysetFailed)
+/*
+ * Parses the value of a numeric flag, see ParseConfigNumber. Prints the
+ * flag to stderr if the value is not a number up to max.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2, 4))) __attribute__((warn_unused_result))
+static bool ParseNumberFlag(
+  const char* argument,  //
+  const char* flag,
+  uint64_t max,
+  uint64_t* number
+)  // clang-format on
+{
+  if (ParseConfigNumber(argument + strlen(flag), max, number) == kConfigNumberInvalid)
   {
-    return kSigEmptysetFailed;
+    fprintf(stderr, "Invalid value: %s\n", argument);
+    return false;
   }
+  return true;
+}
+
+/*
+ * Parses the arguments over the defaults. Prints the reason to stderr
+ * and returns kSettingsParseFailed on an unknown flag or invalid value.
+ */
+// clang-format off
+__attribute__((nonnull(2, 3))) __attribute__((warn_unused_result))
+static int ParseSettings(
+  int argc,  //
+  char* const argv[],
+  struct Settings* settings
+)  // clang-format on
+{
+  settings->engine_ = kEpollEngine;
+  settings->sqpoll_ = false;
+  settings->gro_ = false;
+  settings->metrics_port_ = kNoMetricsPort;
+  settings->metrics_address_.s_addr = htonl(INADDR_LOOPBACK);
+  settings->memory_budget_ = kUnlimitedMemoryBudget;
+  settings->server_options_ = (struct ServerOptions){
+    {htonl(INADDR_LOOPBACK)}, kDefaultBasePort, kDefaultPortsCount, kDefaultBacklog, false, kNoBusyPoll,
+    kDefaultSocketBuffer, kDefaultSocketBuffer, kNoDeferAccept, false
+  };
+  settings->worker_options_ = (struct WorkerOptions){
+    kDefaultByteQuota, kDefaultIdleTimeout, kDefaultLifetime, false, kNoFlushThreshold, GetDefaultWorkersCount(),
+    kDefaultStealThreshold, kNoBusyPoll, false, {kUnlimitedRate, kUnlimitedRate, kDefaultRateBurst},
+    {kUnlimitedRate, kUnlimitedRate, kDefaultRateBurst}, kNoWriteQuantum, kNoMaxLoopLag, kNoMaxQueueDepth,
+    kOverloadPause, kDefaultEvictIdle
+  };
+  settings->leader_options_ = (struct LeaderOptions){NULL, kDefaultDrainTimeout, NULL, NULL};
 
-  sa.sa_sigaction = &ConnectionExpiredHandler;
-  error_code = sigaction(SIGUSR1, &sa, NULL);
-  if (error_code == kSigactionFailed)
+  struct ServerOptions* server_options = &settings->server_options_;
+  struct WorkerOptions* worker_options = &settings->worker_options_;
+  unsigned long base_port = kDefaultBasePort;
+  for (int i = 1; i < argc; ++i)
   {
-    return kSigactionFailed;
+    uint64_t number;
+    if (strcmp(argv[i], kEpollEngineFlag) == 0)
+    {
+      settings->engine_ = kEpollEngine;
+    }
+    else if (strcmp(argv[i], kUringEngineFlag) == 0)
+    {
+      settings->engine_ = kUringEngine;
+    }
+    else if (strcmp(argv[i], kUdpEngineFlag) == 0)
+    {
+      settings->engine_ = kUdpEngine;
+    }
+    else if (strcmp(argv[i], kSqpollFlag) == 0)
+    {
+      settings->sqpoll_ = true;
+    }
+    else if (strcmp(argv[i], kGroFlag) == 0)
+    {
+      settings->gro_ = true;
+    }
+    else if (strncmp(argv[i], kByteQuotaFlag, strlen(kByteQuotaFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kByteQuotaFlag, SIZE_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->byte_quota_ = (size_t) number;
+    }
+    else if (strncmp(argv[i], kIdleTimeoutFlag, strlen(kIdleTimeoutFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kIdleTimeoutFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->idle_timeout_ms_ = number;
+    }
+    else if (strncmp(argv[i], kLifetimeFlag, strlen(kLifetimeFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kLifetimeFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->lifetime_ms_ = number;
+    }
+    else if (strcmp(argv[i], kZeroCopyFlag) == 0)
+    {
+      worker_options->zero_copy_ = true;
+    }
+    else if (strncmp(argv[i], kFlushThresholdFlag, strlen(kFlushThresholdFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kFlushThresholdFlag, SIZE_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->flush_threshold_ = (size_t) number;
+    }
+    else if (strncmp(argv[i], kWriteQuantumFlag, strlen(kWriteQuantumFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kWriteQuantumFlag, SIZE_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->write_quantum_ = (size_t) number;
+    }
+    else if (strncmp(argv[i], kRateBytesFlag, strlen(kRateBytesFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kRateBytesFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->rate_limits_.bytes_per_second_ = number;
+    }
+    else if (strncmp(argv[i], kRateMessagesFlag, strlen(kRateMessagesFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kRateMessagesFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->rate_limits_.messages_per_second_ = number;
+    }
+    else if (strncmp(argv[i], kPeerRateBytesFlag, strlen(kPeerRateBytesFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kPeerRateBytesFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->peer_rate_limits_.bytes_per_second_ = number;
+    }
+    else if (strncmp(argv[i], kPeerRateMessagesFlag, strlen(kPeerRateMessagesFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kPeerRateMessagesFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->peer_rate_limits_.messages_per_second_ = number;
+    }
+    else if (strncmp(argv[i], kRateBurstFlag, strlen(kRateBurstFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kRateBurstFlag, UINT64_MAX / kNanosecondsPerMillisecond, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      uint64_t burst_ns = number * kNanosecondsPerMillisecond;
+      worker_options->rate_limits_.burst_ns_ = burst_ns;
+      worker_options->peer_rate_limits_.burst_ns_ = burst_ns;
+    }
+    else if (strncmp(argv[i], kMaxLoopLagFlag, strlen(kMaxLoopLagFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kMaxLoopLagFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->max_loop_lag_ms_ = number;
+    }
+    else if (strncmp(argv[i], kMaxQueueDepthFlag, strlen(kMaxQueueDepthFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kMaxQueueDepthFlag, SIZE_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->max_queue_depth_ = (size_t) number;
+    }
+    else if (strncmp(argv[i], kOverloadActionFlag, strlen(kOverloadActionFlag)) == 0)
+    {
+      const char* name = argv[i] + strlen(kOverloadActionFlag);
+      size_t action = 0;
+      while (action < sizeof(kOverloadActionNames) / sizeof(kOverloadActionNames[0]) &&
+             strcmp(name, kOverloadActionNames[action]) != 0)
+      {
+        ++action;
+      }
+      if (action == sizeof(kOverloadActionNames) / sizeof(kOverloadActionNames[0]))
+      {
+        fprintf(stderr, "Unknown overload action: %s\n", name);
+        return kSettingsParseFailed;
+      }
+      worker_options->overload_action_ = (enum OverloadAction) action;
+    }
+    else if (strncmp(argv[i], kEvictIdleFlag, strlen(kEvictIdleFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kEvictIdleFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->evict_idle_ms_ = number;
+    }
+    else if (strncmp(argv[i], kAddressFlag, strlen(kAddressFlag)) == 0)
+    {
+      if (inet_pton(AF_INET, argv[i] + strlen(kAddressFlag), &server_options->address_) != kInetPtonSuccess)
+      {
+        fprintf(stderr, "Invalid address: %s\n", argv[i] + strlen(kAddressFlag));
+        return kSettingsParseFailed;
+      }
+    }
+    else if (strncmp(argv[i], kPortFlag, strlen(kPortFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kPortFlag, kMaxPort, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      base_port = (unsigned long) number;
+    }
+    else if (strncmp(argv[i], kPortsFlag, strlen(kPortsFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kPortsFlag, INT_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      server_options->ports_count_ = (int) number;
+    }
+    else if (strncmp(argv[i], kBacklogFlag, strlen(kBacklogFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kBacklogFlag, INT_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      server_options->backlog_ = (int) number;
+    }
+    else if (strncmp(argv[i], kReceiveBufferFlag, strlen(kReceiveBufferFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kReceiveBufferFlag, INT_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      server_options->receive_buffer_size_ = (int) number;
+    }
+    else if (strncmp(argv[i], kSendBufferFlag, strlen(kSendBufferFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kSendBufferFlag, INT_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      server_options->send_buffer_size_ = (int) number;
+    }
+    else if (strncmp(argv[i], kDeferAcceptFlag, strlen(kDeferAcceptFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kDeferAcceptFlag, INT_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      server_options->defer_accept_s_ = (int) number;
+    }
+    else if (strcmp(argv[i], kNoDelayFlag) == 0)
+    {
+      server_options->no_delay_ = true;
+    }
+    else if (strcmp(argv[i], kReusePortFlag) == 0)
+    {
+      server_options->reuse_port_ = true;
+    }
+    else if (strncmp(argv[i], kWorkersFlag, strlen(kWorkersFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kWorkersFlag, UINT_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->workers_count_ = (unsigned) number;
+      if (worker_options->workers_count_ == 0)
+      {
+        worker_options->workers_count_ = GetDefaultWorkersCount();
+      }
+    }
+    else if (strncmp(argv[i], kStealThresholdFlag, strlen(kStealThresholdFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kStealThresholdFlag, SIZE_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->steal_threshold_ = (size_t) number;
+    }
+    else if (strncmp(argv[i], kBusyPollFlag, strlen(kBusyPollFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kBusyPollFlag, UINT32_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      worker_options->busy_poll_us_ = (uint32_t) number;
+      server_options->busy_poll_us_ = worker_options->busy_poll_us_;
+    }
+    else if (strcmp(argv[i], kPinWorkersFlag) == 0)
+    {
+      worker_options->pin_workers_ = true;
+    }
+    else if (strncmp(argv[i], kMemoryBudgetFlag, strlen(kMemoryBudgetFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kMemoryBudgetFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      settings->memory_budget_ = number;
+    }
+    else if (strncmp(argv[i], kRestartPathFlag, strlen(kRestartPathFlag)) == 0)
+    {
+      settings->leader_options_.restart_path_ = argv[i] + strlen(kRestartPathFlag);
+    }
+    else if (strncmp(argv[i], kDrainTimeoutFlag, strlen(kDrainTimeoutFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kDrainTimeoutFlag, UINT64_MAX, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      settings->leader_options_.drain_timeout_ms_ = number;
+    }
+    else if (strncmp(argv[i], kMetricsPortFlag, strlen(kMetricsPortFlag)) == 0)
+    {
+      if (!ParseNumberFlag(argv[i], kMetricsPortFlag, kMaxPort, &number))
+      {
+        return kSettingsParseFailed;
+      }
+      settings->metrics_port_ = (unsigned long) number;
+    }
+    else if (strncmp(argv[i], kMetricsAddressFlag, strlen(kMetricsAddressFlag)) == 0)
+    {
+      if (inet_pton(AF_INET, argv[i] + strlen(kMetricsAddressFlag), &settings->metrics_address_) != kInetPtonSuccess)
+      {
+        fprintf(stderr, "Invalid address: %s\n", argv[i] + strlen(kMetricsAddressFlag));
+        return kSettingsParseFailed;
+      }
+    }
+    else
+    {
+      fprintf(stderr, "Unknown flag: %s\n", argv[i]);
+      PrintUsage(argv[0]);
+      return kSettingsParseFailed;
+    }
   }
 
+  if (server_options->ports_count_ < 1 || server_options->ports_count_ > SERVER_MAX_SOCKETS || base_port == 0 ||
+      base_port + (unsigned long) server_options->ports_count_ - 1 > kMaxPort)
+  {
+    fprintf(
+      stderr,
+      "Invalid ports: %d ports from %lu, at most %d from 1 to %lu\n",
+      server_options->ports_count_,
+      base_port,
+      SERVER_MAX_SOCKETS,
+      kMaxPort
+    );
+    return kSettingsParseFailed;
+  }
+  server_options->base_port_ = (uint16_t) base_port;
   return 0;
 }
 
+/*
+ * Reloads the configuration file on SIGHUP and applies the settings that
+ * can change at runtime: the memory budget, the drain timeout and the
+ * worker limits of ReconfigureWorkerPool, the rate limits included. The others keep their start
+ * values until the server is restarted.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void ReloadSettings(
+  struct Leader* leader,  //
+  void* context
+)  // clang-format on
+{
+  const struct CommandLine* command_line = (const struct CommandLine*) context;
+  struct ConfigArguments arguments;
+  if (LoadConfigArguments(command_line->argc_, command_line->argv_, &arguments) == kConfigLoadFailed)
+  {
+    LOG_WARNING(
+      "Server received error: configuration reload failed at line %zu: [%d](%s)",  //
+      arguments.error_line_,
+      errno,
+      strerror(errno)
+    );
+    return;
+  }
+  struct Settings settings;
+  if (ParseSettings(arguments.argc_, arguments.argv_, &settings) == kSettingsParseFailed)
+  {
+    LOG_WARNING("Server received error: configuration reload failed: invalid settings");
+    FreeConfigArguments(&arguments);
+    return;
+  }
+  SetMemoryBudget(settings.memory_budget_);
+  leader->options_.drain_timeout_ms_ = settings.leader_options_.drain_timeout_ms_;
+  ReconfigureWorkerPool(leader->pool_, &settings.worker_options_);
+  LOG_INFO(
+    "Server configuration reloaded: byte quota %zu, idle timeout %" PRIu64 " ms, lifetime %" PRIu64
+    " ms, memory budget %" PRIu64 ", rate %" PRIu64 " B/s %" PRIu64 " msg/s, peer rate %" PRIu64 " B/s %" PRIu64
+    " msg/s",  //
+    settings.worker_options_.byte_quota_,
+    settings.worker_options_.idle_timeout_ms_,
+    settings.worker_options_.lifetime_ms_,
+    settings.memory_budget_,
+    settings.worker_options_.rate_limits_.bytes_per_second_,
+    settings.worker_options_.rate_limits_.messages_per_second_,
+    settings.worker_options_.peer_rate_limits_.bytes_per_second_,
+    settings.worker_options_.peer_rate_limits_.messages_per_second_
+  );
+  FreeConfigArguments(&arguments);
+}
+
 int main(
-  __attribute__((unused)) int argc,  //
-  __attribute__((unused)) char* argv[]
+  int argc,  //
+  char* argv[]
 )
 {
   int error_code;
-  pid_t leader_id = gettid();
   struct Server server;
+  struct WorkerPool worker_pool;
+  struct Leader leader;
+  struct Settings settings;
+  struct CommandLine command_line = {argc, argv};
+  // Kept for the lifetime of the server, the settings point into them.
+  struct ConfigArguments arguments;
 
-  error_code = SetSignalHandler();
-  if (error_code == -1)
+  error_code = LoadConfigArguments(argc, argv, &arguments);
+  if (error_code == kConfigLoadFailed)
   {
-    snprintf(
-      message_buffer, //
-      kMessageBufferSize,
-      "Server initialization failed: SetSignalHandler failed: [%d](%s)",
+    fprintf(
+      stderr,
+      "Server initialization failed: configuration load failed at line %zu: [%d](%s)\n",
+      arguments.error_line_,
       errno,
       strerror(errno)
     );
-    LOG_FATAL(message_buffer, leader_id);
+    return EXIT_FAILURE;
+  }
+  error_code = ParseSettings(arguments.argc_, arguments.argv_, &settings);
+  if (error_code == kSettingsParseFailed)
+  {
+    return EXIT_FAILURE;
   }
+  struct ServerOptions* server_options = &settings.server_options_;
+  struct WorkerOptions* worker_options = &settings.worker_options_;
+  settings.leader_options_.reload_ = &ReloadSettings;
+  settings.leader_options_.reload_context_ = &command_line;
+
+  SetMemoryBudget(settings.memory_budget_);
 
-  error_code = InitializeServerSockets(&server);
-  if (error_code == kServerSocketInitFailed)
+  // The logger and the metrics threads inherit the blocked signals.
+  if (settings.engine_ == kEpollEngine)
   {
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Server initialization failed: sockets initialization failed: [%d](%s)",
-      errno,
-      strerror(errno)
-    );
-    LOG_FATAL(message_buffer, leader_id);
+    error_code = InitializeLeader(&leader, &settings.leader_options_);
+    if (error_code == kLeaderFailed)
+    {
+      fprintf(stderr, "Server initialization failed: leader initialization failed: [%d](%s)\n", errno, strerror(errno));
+      return EXIT_FAILURE;
+    }
+  }
+  else
+  {
+    // Only the epoll engine reloads its configuration, SIGHUP must not terminate the others.
+    signal(SIGHUP, SIG_IGN);
   }
 
-  int epfd = epoll_create1(EPOLL_CLOEXEC);
-  if (epfd == kEpollCreateFailed)
+  error_code = StartLogger();
+  if (error_code == kLoggerStartFailed)
   {
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Server initialization failed: epoll_create1 failed: [%d](%s)",
-      errno,
-      strerror(errno)
-    );
-    LOG_FATAL(message_buffer, leader_id);
+    fprintf(stderr, "Server initialization failed: logger start failed: [%d](%s)\n", errno, strerror(errno));
+    return EXIT_FAILURE;
   }
 
-  error_code = RegisterServerSockets(epfd, &server);
-  if (error_code == kSocketRegistryFailed)
+  if (settings.metrics_port_ != kNoMetricsPort)
   {
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Server initialization failed: epoll failed: [%d](%s)",
-      errno,
-      strerror(errno)
+    error_code = StartMetricsServer(settings.metrics_address_, (uint16_t) settings.metrics_port_);
+    if (error_code == kMetricsServerStartFailed)
+    {
+      LOG_FATAL(
+        "Server initialization failed: metrics server start failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+    error_code = RegisterMetricGauge(
+      "echo_server_memory_reserved_bytes",  //
+      "Number of bytes of connection buffers reserved from the memory budget.",
+      "",
+      &GetMemoryBudgetUsage,
+      NULL
     );
-    LOG_FATAL(message_buffer, leader_id);
+    if (error_code == kMetricGaugeRegisterFailed)
+    {
+      LOG_WARNING("Server initialization: memory budget gauge is not registered");
+    }
   }
 
-  PrintServerInitInfo(&server);
+  if (settings.engine_ == kUdpEngine)
+  {
+    error_code = RunUdpEngine(server_options, worker_options, settings.gro_);
+    if (error_code == kUdpEngineFailed)
+    {
+      LOG_FATAL(
+        "Server initialization failed: udp engine failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+    return 0;
+  }
 
-  int channels[2];
-  error_code = pipe(channels);
-  if (error_code == kPipeFailed)
+  bool adopted = false;
+  if (settings.engine_ == kEpollEngine)
   {
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Server received error: pipe failed: [%d](%s)",
-      errno,
-      strerror(errno)
-    );
-    LOG_FATAL(message_buffer, leader_id);
+    error_code = TakeOverServerSockets(&leader, server_options->reuse_port_ ? NULL : &server, server_options);
+    if (error_code == kLeaderFailed)
+    {
+      LOG_FATAL(
+        "Server initialization failed: listeners takeover failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+    adopted = error_code != kNoListenersTaken;
+  }
+
+  if (settings.engine_ == kUringEngine || (!server_options->reuse_port_ && !adopted))
+  {
+    error_code = InitializeServerSockets(&server, server_options);
+    if (error_code == kServerSocketInitFailed)
+    {
+      LOG_FATAL(
+        "Server initialization failed: sockets initialization failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
   }
 
-  struct sockaddr_in peer_info;
-  memset(&peer_info, '\0', sizeof(struct sockaddr_in));
-  socklen_t peer_info_size = (socklen_t) sizeof(struct sockaddr_in);
+  if (settings.engine_ == kUringEngine)
+  {
+    PrintServerInitInfo(&server);
+    error_code = RunUringEngine(&server, worker_options, settings.sqpoll_);
+    if (error_code == kUringEngineFailed)
+    {
+      LOG_FATAL(
+        "Server initialization failed: io_uring engine failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+    return 0;
+  }
 
-  struct epoll_event ep_events[SERVER_SOCKETS_COUNT];
+  AttachMetrics("leader");
 
-  error_code = sem_init(&control_semaphore, kSemShareBetweenThreads, kSemInitValue);
-  if (error_code == kSemInitFailed)
+  if (server_options->reuse_port_)
   {
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Server received error: sem_init failed: [%d](%s)",
-      errno,
-      strerror(errno)
-    );
-    LOG_FATAL(message_buffer, leader_id);
+    error_code = StartWorkerPool(&worker_pool, worker_options, server_options);
+    if (error_code == kWorkerPoolStartFailed)
+    {
+      LOG_FATAL(
+        "Server initialization failed: workers initialization failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+    PrintServerInitInfo(&worker_pool.workers_[0].server_);
+    error_code = RunLeader(&leader, NULL, &worker_pool);
+    if (error_code == kLeaderFailed)
+    {
+      LOG_FATAL(
+        "Server received error: leader failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+    return 0;
   }
 
-  pthread_t control_block;
-  error_code = pthread_create(&control_block, NULL, &ControlBlockFunction, (void*) channels[0]);
-  if (error_code != kPthreadCreateSuccess)
+  error_code = RegisterServerSockets(leader.epfd_, &server);
+  if (error_code == kSocketRegistryFailed)
   {
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Server received error: pthread_create failed: [%d](%s)",
+    LOG_FATAL(
+      "Server initialization failed: epoll failed: [%d](%s)",  //
       errno,
       strerror(errno)
     );
-    LOG_FATAL(message_buffer, leader_id);
   }
 
-  error_code = sem_wait(&control_semaphore);
-  if (error_code == kSemWaitFailed)
+  PrintServerInitInfo(&server);
+
+  error_code = StartWorkerPool(&worker_pool, worker_options, NULL);
+  if (error_code == kWorkerPoolStartFailed)
   {
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Server received error: sem_wait failed: [%d](%s)",
+    LOG_FATAL(
+      "Server initialization failed: workers initialization failed: [%d](%s)",  //
       errno,
       strerror(errno)
     );
-    LOG_FATAL(message_buffer, leader_id);
   }
 
-  error_code = sem_destroy(&control_semaphore);
-  if (error_code == kSemDestroyFailed)
+  error_code = RunLeader(&leader, &server, &worker_pool);
+  if (error_code == kLeaderFailed)
   {
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Server received error: sem_destroy failed: [%d](%s)",
+    LOG_FATAL(
+      "Server received error: leader failed: [%d](%s)",  //
       errno,
       strerror(errno)
     );
-    LOG_FATAL(message_buffer, leader_id);
-  }
-
-  while (true)
-  {
-    int ready_sockets = epoll_wait(epfd, ep_events, SERVER_SOCKETS_COUNT, kInfiniteEpollTimeout);
-    if (ready_sockets == kEpollWaitFailed)
-    {
-      snprintf(
-        message_buffer,  //
-        kMessageBufferSize,
-        "Server received error: epoll failed: [%d](%s)",
-        errno,
-        strerror(errno)
-      );
-      LOG_FATAL(message_buffer, leader_id);
-    }
-
-    for (int i = 0; i < ready_sockets; ++i)
-    {
-      int clientfd = accept(ep_events[i].data.fd, (struct sockaddr*) &peer_info, &peer_info_size);
-      if (clientfd == kAcceptFailed)
-      {
-        snprintf(
-          message_buffer,  //
-          kMessageBufferSize,
-          "Server received error: accept failed: [%d](%s)",
-          errno,
-          strerror(errno)
-        );
-        LOG_FATAL(message_buffer, leader_id);
-      }
-
-      snprintf(
-        message_buffer,  //
-        kMessageBufferSize,
-        "Server accepted connection on: %d\n\taddress: %s;\n\tport: %" PRIu16,
-        clientfd,
-        inet_ntoa(peer_info.sin_addr),
-        ntohs(peer_info.sin_port)
-      );
-      LOG_INFO(message_buffer, leader_id);
-
-      ssize_t processed_bytes = write(channels[1], &clientfd, sizeof(int));
-      if (processed_bytes == kWriteFailed)
-      {
-        snprintf(
-          message_buffer,  //
-          kMessageBufferSize,
-          "Server received error: write failed: [%d](%s)",
-          errno,
-          strerror(errno)
-        );
-        LOG_FATAL(message_buffer, leader_id);
-      }
-    }
   }
 
   return 0;
@@ -0,0 +1,262 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sync_server/errors/errors.h>
+#include <sync_server/ring/ring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define MALLOC_FAILED NULL
+
+const int kRingInitFailed = -1;
+const int kRingSubmitFailed = -1;
+const int kBufferRingRegisterFailed = -1;
+
+static const unsigned kSqThreadIdleMilliseconds = 1000U;
+static const unsigned kNoFlags = 0U;
+
+int RingInitialize(
+  struct Ring* ring,  //
+  unsigned entries,
+  bool sqpoll
+)
+{
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(struct io_uring_params));
+  if (sqpoll)
+  {
+    params.flags |= IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = kSqThreadIdleMilliseconds;
+  }
+
+  memset(ring, 0, sizeof(struct Ring));
+  ring->fd_ = (int) syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->fd_ == kIoUringSetupFailed)
+  {
+    return kRingInitFailed;
+  }
+  ring->flags_ = params.flags;
+
+  ring->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (ring->cq_ring_size_ > ring->sq_ring_size_)
+    {
+      ring->sq_ring_size_ = ring->cq_ring_size_;
+    }
+    ring->cq_ring_size_ = ring->sq_ring_size_;
+  }
+
+  ring->sq_ring_ = mmap(
+    NULL,  //
+    ring->sq_ring_size_,
+    PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE,
+    ring->fd_,
+    IORING_OFF_SQ_RING
+  );
+  if (ring->sq_ring_ == MAP_FAILED)
+  {
+    return kRingInitFailed;
+  }
+
+  ring->cq_ring_ = ring->sq_ring_;
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+  {
+    ring->cq_ring_ = mmap(
+      NULL,  //
+      ring->cq_ring_size_,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE,
+      ring->fd_,
+      IORING_OFF_CQ_RING
+    );
+    if (ring->cq_ring_ == MAP_FAILED)
+    {
+      return kRingInitFailed;
+    }
+  }
+
+  ring->sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes_ = mmap(
+    NULL,  //
+    ring->sqes_size_,
+    PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE,
+    ring->fd_,
+    IORING_OFF_SQES
+  );
+  if (ring->sqes_ == MAP_FAILED)
+  {
+    return kRingInitFailed;
+  }
+
+  unsigned char* sq_ring = ring->sq_ring_;
+  ring->sq_head_ = (unsigned*) (sq_ring + params.sq_off.head);
+  ring->sq_tail_ = (unsigned*) (sq_ring + params.sq_off.tail);
+  ring->sq_mask_ = (unsigned*) (sq_ring + params.sq_off.ring_mask);
+  ring->sq_flags_ = (unsigned*) (sq_ring + params.sq_off.flags);
+  ring->sq_entries_ = params.sq_entries;
+  ring->sqe_tail_ = ring->sqe_submitted_ = *ring->sq_tail_;
+
+  // SQEs are always consumed in order, so the index array is an identity mapping set once.
+  unsigned* sq_array = (unsigned*) (sq_ring + params.sq_off.array);
+  for (unsigned i = 0; i < params.sq_entries; ++i)
+  {
+    sq_array[i] = i;
+  }
+
+  unsigned char* cq_ring = ring->cq_ring_;
+  ring->cq_head_ = (unsigned*) (cq_ring + params.cq_off.head);
+  ring->cq_tail_ = (unsigned*) (cq_ring + params.cq_off.tail);
+  ring->cq_mask_ = (unsigned*) (cq_ring + params.cq_off.ring_mask);
+  ring->cqes_ = (struct io_uring_cqe*) (cq_ring + params.cq_off.cqes);
+  return 0;
+}
+
+struct io_uring_sqe* RingGetSqe(
+  struct Ring* ring
+)
+{
+  unsigned head = __atomic_load_n(ring->sq_head_, __ATOMIC_ACQUIRE);
+  if (ring->sqe_tail_ - head == ring->sq_entries_)
+  {
+    return NULL;
+  }
+  struct io_uring_sqe* sqe = ring->sqes_ + (ring->sqe_tail_ & *ring->sq_mask_);
+  ++ring->sqe_tail_;
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  return sqe;
+}
+
+int RingSubmitAndWait(
+  struct Ring* ring,  //
+  unsigned wait_count
+)
+{
+  unsigned to_submit = ring->sqe_tail_ - ring->sqe_submitted_;
+  __atomic_store_n(ring->sq_tail_, ring->sqe_tail_, __ATOMIC_RELEASE);
+  ring->sqe_submitted_ = ring->sqe_tail_;
+
+  unsigned enter_flags = wait_count != 0 ? IORING_ENTER_GETEVENTS : kNoFlags;
+  if (ring->flags_ & IORING_SETUP_SQPOLL)
+  {
+    // The kernel thread polls the submission queue; it only has to be woken up once it went idle.
+    to_submit = 0;
+    if (__atomic_load_n(ring->sq_flags_, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP)
+    {
+      enter_flags |= IORING_ENTER_SQ_WAKEUP;
+    }
+    if (enter_flags == kNoFlags)
+    {
+      return 0;
+    }
+  }
+  else if (to_submit == 0 && wait_count == 0)
+  {
+    return 0;
+  }
+
+  while (syscall(__NR_io_uring_enter, ring->fd_, to_submit, wait_count, enter_flags, NULL, 0) == kIoUringEnterFailed)
+  {
+    if (errno != EINTR)
+    {
+      return kRingSubmitFailed;
+    }
+  }
+  return 0;
+}
+
+struct io_uring_cqe* RingPeekCqe(
+  struct Ring* ring
+)
+{
+  unsigned head = *ring->cq_head_;
+  if (head == __atomic_load_n(ring->cq_tail_, __ATOMIC_ACQUIRE))
+  {
+    return NULL;
+  }
+  return ring->cqes_ + (head & *ring->cq_mask_);
+}
+
+void RingAdvanceCq(
+  struct Ring* ring
+)
+{
+  __atomic_store_n(ring->cq_head_, *ring->cq_head_ + 1, __ATOMIC_RELEASE);
+}
+
+int RingRegisterBufferRing(
+  struct Ring* ring,  //
+  struct BufferRing* buffer_ring,
+  unsigned entries,
+  unsigned buffer_size,
+  unsigned short group_id
+)
+{
+  buffer_ring->ring_size_ = entries * sizeof(struct io_uring_buf);
+  buffer_ring->ring_ = mmap(
+    NULL,  //
+    buffer_ring->ring_size_,
+    PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS,
+    -1,
+    0
+  );
+  if (buffer_ring->ring_ == MAP_FAILED)
+  {
+    return kBufferRingRegisterFailed;
+  }
+
+  buffer_ring->buffers_ = malloc((size_t) entries * buffer_size);
+  if (buffer_ring->buffers_ == MALLOC_FAILED)
+  {
+    return kBufferRingRegisterFailed;
+  }
+  buffer_ring->entries_ = entries;
+  buffer_ring->buffer_size_ = buffer_size;
+  buffer_ring->group_id_ = group_id;
+
+  struct io_uring_buf_reg registration;
+  memset(&registration, 0, sizeof(struct io_uring_buf_reg));
+  registration.ring_addr = (uintptr_t) buffer_ring->ring_;
+  registration.ring_entries = entries;
+  registration.bgid = group_id;
+  int error_code = (int) syscall(__NR_io_uring_register, ring->fd_, IORING_REGISTER_PBUF_RING, &registration, 1);
+  if (error_code == kIoUringRegisterFailed)
+  {
+    return kBufferRingRegisterFailed;
+  }
+
+  for (unsigned i = 0; i < entries; ++i)
+  {
+    BufferRingRecycle(buffer_ring, (unsigned short) i);
+  }
+  return 0;
+}
+
+unsigned char* BufferRingGet(
+  struct BufferRing* buffer_ring,  //
+  unsigned short buffer_id
+)
+{
+  return buffer_ring->buffers_ + (size_t) buffer_id * buffer_ring->buffer_size_;
+}
+
+void BufferRingRecycle(
+  struct BufferRing* buffer_ring,  //
+  unsigned short buffer_id
+)
+{
+  unsigned short tail = buffer_ring->ring_->tail;
+  struct io_uring_buf* buffer = buffer_ring->ring_->bufs + (tail & (buffer_ring->entries_ - 1));
+  buffer->addr = (uintptr_t) BufferRingGet(buffer_ring, buffer_id);
+  buffer->len = buffer_ring->buffer_size_;
+  buffer->bid = buffer_id;
+  __atomic_store_n(&buffer_ring->ring_->tail, (unsigned short) (tail + 1), __ATOMIC_RELEASE);
+}
\ No newline at end of file
@@ -1,89 +1,226 @@
 #define _GNU_SOURCE
 
 #include <arpa/inet.h>
+#include <common/logger/logger.h>
+#include <common/metrics/metrics.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <netinet/in.h>
-#include <pthread.h>
-#include <semaphore.h>
-#include <signal.h>
+#include <netinet/tcp.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sync_server/errors/errors.h>
-#include <sync_server/logger/logger.h>
 #include <sync_server/server/server.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
-#include <time.h>
 #include <unistd.h>
 
-#define MALLOC_FAILED NULL
-
 const int kServerSocketInitFailed = -1;
 const int kSocketRegistryFailed = -1;
+const uint16_t kDefaultBasePort = 10000;
+const int kDefaultPortsCount = SERVER_MAX_SOCKETS;
+const int kDefaultBacklog = SOMAXCONN;
+const uint32_t kNoBusyPoll = 0;
+const int kDefaultSocketBuffer = 0;
+const int kNoDeferAccept = 0;
+const int kSocketsMismatch = 1;
+const int kAcceptExhausted = 1;
 
-static const int kSocketPendingConnections = 5;
-static const int kSocketBufferAllocFailed = -1;
-static const int kConnectionTimeQuota = 3;
-static const int kServerBasePort = 10000;
-static const int kSocketBufferSize = 1024;
-static const unsigned kWorkersCount = 4U;
-static const int kDefaultTimerFlags = 0;
 static const int kDefaultSocketProtocol = 0;
-static const int kSemPostFailed = -1;
-static const int kMessageBufferSize = 256;
-static const int kPthreadCreateSuccess = 0;
-
-extern sem_t control_semaphore;
+static const int kSocketOptionEnabled = 1;
+static const int kNoReserveFd = -1;
+static const char* const kReserveFdPath = "/dev/null";
+static const struct linger kResetLinger = {.l_onoff = 1, .l_linger = 0};
 
 // clang-format off
-__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+__attribute__((nonnull(1, 2))) __attribute__((warn_unused_result))
 static int CreateSocket(
-  struct sockaddr_in* sock_info
+  struct sockaddr_in* sock_info,  //
+  const struct ServerOptions* options
 )  // clang-format on
 {
-  int sockfd = socket(AF_INET, SOCK_STREAM, kDefaultSocketProtocol);
+  int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, kDefaultSocketProtocol);
   if (sockfd == kSocketFailed)
   {
     return kSocketFailed;
   }
-  int error_code = bind(sockfd, (struct sockaddr*) sock_info, sizeof(struct sockaddr_in));
+  // Restarts must not wait for the connections of the previous run to leave TIME_WAIT.
+  int error_code = setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &kSocketOptionEnabled, sizeof(int));
+  if (error_code == kSetsockoptFailed)
+  {
+    close(sockfd);
+    return kSocketFailed;
+  }
+  if (options->reuse_port_)
+  {
+    error_code = setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &kSocketOptionEnabled, sizeof(int));
+    if (error_code == kSetsockoptFailed)
+    {
+      close(sockfd);
+      return kSocketFailed;
+    }
+  }
+  if (options->busy_poll_us_ != kNoBusyPoll)
+  {
+    error_code = EnableSocketBusyPoll(sockfd, options->busy_poll_us_);
+    if (error_code == kSetsockoptFailed)
+    {
+      close(sockfd);
+      return kSocketFailed;
+    }
+  }
+  // The accepted sockets inherit the buffer sizes and TCP_NODELAY from the listener.
+  error_code = SetSocketBuffers(sockfd, options);
+  if (error_code == kSetsockoptFailed)
+  {
+    close(sockfd);
+    return kSocketFailed;
+  }
+  if (options->no_delay_)
+  {
+    error_code = setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &kSocketOptionEnabled, sizeof(int));
+    if (error_code == kSetsockoptFailed)
+    {
+      close(sockfd);
+      return kSocketFailed;
+    }
+  }
+  if (options->defer_accept_s_ != kNoDeferAccept)
+  {
+    error_code = setsockopt(sockfd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &options->defer_accept_s_, sizeof(int));
+    if (error_code == kSetsockoptFailed)
+    {
+      close(sockfd);
+      return kSocketFailed;
+    }
+  }
+  error_code = bind(sockfd, (struct sockaddr*) sock_info, sizeof(struct sockaddr_in));
   if (error_code == kBindFailed)
   {
+    close(sockfd);
     return kBindFailed;
   }
-  error_code = listen(sockfd, kSocketPendingConnections);
+  error_code = listen(sockfd, options->backlog_);
   if (error_code == kListenFailed)
   {
+    close(sockfd);
     return kListenFailed;
   }
   return sockfd;
 }
 
+int SetSocketBuffers(
+  int sockfd,  //
+  const struct ServerOptions* options
+)
+{
+  if (options->receive_buffer_size_ != kDefaultSocketBuffer)
+  {
+    int error_code = setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &options->receive_buffer_size_, sizeof(int));
+    if (error_code == kSetsockoptFailed)
+    {
+      return kSetsockoptFailed;
+    }
+  }
+  if (options->send_buffer_size_ != kDefaultSocketBuffer)
+  {
+    return setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &options->send_buffer_size_, sizeof(int));
+  }
+  return 0;
+}
+
+int EnableSocketBusyPoll(
+  int sockfd,  //
+  uint32_t busy_poll_us
+)
+{
+  int value = (int) busy_poll_us;
+  int error_code = setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(int));
+  if (error_code == kSetsockoptFailed)
+  {
+    return kSetsockoptFailed;
+  }
+  // Lets the busy polling sockets keep the device interrupts masked (Linux 5.11+).
+  return setsockopt(sockfd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &kSocketOptionEnabled, sizeof(int));
+}
+
 int InitializeServerSockets(
-  struct Server* server
+  struct Server* server,  //
+  const struct ServerOptions* options
 )
 {
-  LOG_DEBUG("InitializeServerSockets[1]: start sockets initialization", gettid());
+  LOG_DEBUG("InitializeServerSockets[1]: start sockets initialization");
 
   struct sockaddr_in server_addr;
-  server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  memset(&server_addr, '\0', sizeof(struct sockaddr_in));
+  server_addr.sin_addr = options->address_;
   server_addr.sin_family = AF_INET;
+  server->info_ = server_addr;
+  server->base_port_ = options->base_port_;
+  server->sockets_count_ = 0;
 
-  for (int i = 0; i < SERVER_SOCKETS_COUNT; ++i)
+  for (int i = 0; i < options->ports_count_; ++i)
   {
-    server_addr.sin_port = htons(kServerBasePort + i);
-    server->sockets_[i] = CreateSocket(&server_addr);
+    server_addr.sin_port = htons((uint16_t) (options->base_port_ + i));
+    server->sockets_[i] = CreateSocket(&server_addr, options);
     if (server->sockets_[i] == kSocketFailed)
     {
       return kSocketFailed;
     }
+    ++server->sockets_count_;
   }
 
-  LOG_DEBUG("InitializeServerSockets[2]: end sockets initialization", gettid());
+  server->reserve_fd_ = open(kReserveFdPath, O_RDONLY | O_CLOEXEC);
+  if (server->reserve_fd_ == kOpenFailed)
+  {
+    return kServerSocketInitFailed;
+  }
+
+  LOG_DEBUG("InitializeServerSockets[2]: end sockets initialization");
+  return 0;
+}
+
+int AdoptServerSockets(
+  struct Server* server,  //
+  const struct ServerOptions* options,
+  const int* sockets,
+  size_t sockets_count
+)
+{
+  if (sockets_count != (size_t) options->ports_count_)
+  {
+    return kSocketsMismatch;
+  }
+  for (size_t i = 0; i < sockets_count; ++i)
+  {
+    struct sockaddr_in socket_info;
+    socklen_t info_size = (socklen_t) sizeof(struct sockaddr_in);
+    if (getsockname(sockets[i], (struct sockaddr*) &socket_info, &info_size) == kGetsocknameFailed)
+    {
+      return kServerSocketInitFailed;
+    }
+    if (socket_info.sin_addr.s_addr != options->address_.s_addr ||
+        ntohs(socket_info.sin_port) != options->base_port_ + i)
+    {
+      return kSocketsMismatch;
+    }
+  }
+  memset(&server->info_, '\0', sizeof(struct sockaddr_in));
+  server->info_.sin_family = AF_INET;
+  server->info_.sin_addr = options->address_;
+  server->base_port_ = options->base_port_;
+  server->sockets_count_ = (int) sockets_count;
+  memcpy(server->sockets_, sockets, sockets_count * sizeof(int));
+
+  server->reserve_fd_ = open(kReserveFdPath, O_RDONLY | O_CLOEXEC);
+  if (server->reserve_fd_ == kOpenFailed)
+  {
+    return kServerSocketInitFailed;
+  }
   return 0;
 }
 
@@ -92,11 +229,11 @@ int RegisterServerSockets(
   struct Server* server
 )
 {
-  LOG_DEBUG("RegisterServerSockets[1]: start sockets registration", gettid());
+  LOG_DEBUG("RegisterServerSockets[1]: start sockets registration");
 
   struct epoll_event ev;
   ev.events = EPOLLIN;
-  for (int i = 0; i < SERVER_SOCKETS_COUNT; ++i)
+  for (int i = 0; i < server->sockets_count_; ++i)
   {
     ev.data.fd = server->sockets_[i];
     int error_code = epoll_ctl(epfd, EPOLL_CTL_ADD, server->sockets_[i], &ev);
@@ -106,7 +243,7 @@ int RegisterServerSockets(
     }
   }
 
-  LOG_DEBUG("RegisterServerSockets[2]: end sockets registration", gettid());
+  LOG_DEBUG("RegisterServerSockets[2]: end sockets registration");
   return 0;
 }
 
@@ -120,9 +257,9 @@ void PrintServerInitInfo(
     "\tports:\n",
     inet_ntoa(server->info_.sin_addr)
   );
-  for (int i = 0; i < SERVER_SOCKETS_COUNT; ++i)
+  for (int i = 0; i < server->sockets_count_; ++i)
   {
-    printf("\t\t- %hd;\n", kServerBasePort + i);
+    printf("\t\t- %d;\n", server->base_port_ + i);
   }
   puts(
     "\tsocket type: SOCK_STREAM\n"
@@ -130,291 +267,117 @@ void PrintServerInitInfo(
   );
 }
 
-int ConfigureClientSocket(
-  int clientfd
+bool RestoreServerReserve(
+  struct Server* server
 )
 {
-  LOG_DEBUG("ConfigureClientSocket[1]: start configurating flags", gettid());
-
-  int fd_flags = fcntl(clientfd, F_GETFL);
-  if (fd_flags == kFcntlFailed)
+  if (server->reserve_fd_ == kNoReserveFd)
   {
-    return kFcntlFailed;
+    server->reserve_fd_ = open(kReserveFdPath, O_RDONLY | O_CLOEXEC);
   }
-  fd_flags |= O_NONBLOCK;
-  int error_code = fcntl(clientfd, F_SETFL, fd_flags);
-  if (error_code == kFcntlFailed)
-  {
-    return kFcntlFailed;
-  }
-
-  LOG_DEBUG("ConfigureClientSocket[2]: end configurating flags", gettid());
-  return 0;
+  return server->reserve_fd_ != kNoReserveFd;
 }
 
-struct WorkerInfo
-{
-  pthread_t control_block_id_;
-  int input_channel_;
-};
-
-static __thread char message_buffer[kMessageBufferSize];
-static const int kWorkerBufferSize = 16;
-
 // clang-format off
-__attribute__((nonnull(1)))
-static void* WorkerFunction(
-  void* arg
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+static int DropClient(
+  struct Server* server,  //
+  int listenfd
 )  // clang-format on
 {
-  int error_code;
-  unsigned char buffer[kWorkerBufferSize];
-  struct WorkerInfo* worker_info = (struct WorkerInfo*) arg;
-  pid_t worker_id = gettid();
-  int clientfd;
-
-  timer_t connection_timer;
-  struct sigevent se;
-  se.sigev_notify = SIGEV_THREAD_ID;
-  se.sigev_signo = SIGUSR1;
-  se.sigev_value.sival_ptr = &clientfd;
-
-#if defined(sigev_notify_thread_id)
-  #pragma push_macro("sigev_notify_thread_id")
-  #undef sigev_notify_thread_id
-  #define SIGEV_NOTIFY_THREAD_ID_DEFINED
-#endif
-#define sigev_notify_thread_id _sigev_un._tid
-
-  se.sigev_notify_thread_id = worker_id;
-
-#undef sigev_notify_thread_id
-#if defined(SIGEV_NOTIFY_THREAD_ID_DEFINED)
-  #pragma pop_macro("sigev_notify_thread_id")
-  #undef SIGEV_NOTIFY_THREAD_ID_DEFINED
-#endif
-
-  error_code = timer_create(CLOCK_REALTIME, &se, &connection_timer);
-  if (error_code == kTimerCreateFailed)
+  if (!RestoreServerReserve(server))
   {
-    exit(EXIT_FAILURE);
+    return kAcceptExhausted;
   }
+  close(server->reserve_fd_);
+  server->reserve_fd_ = kNoReserveFd;
+  // One connection per call. The level-triggered listener is reported again right away while its backlog is not
+  // empty, so this resets the backlog one connection per epoll round rather than backing off.
+  int clientfd = accept4(listenfd, NULL, NULL, SOCK_CLOEXEC);
+  if (clientfd != kAcceptFailed)
+  {
+    AddMetric(kMetricAcceptedConnections, 1);
+    RejectClient(clientfd);
+  }
+  // Another thread may have taken the freed descriptor meanwhile.
+  return RestoreServerReserve(server) ? 0 : kAcceptExhausted;
+}
 
-  struct itimerspec connection_limit = {
-    .it_interval.tv_nsec = 0,  //
-    .it_interval.tv_sec = 0,
-    .it_value.tv_nsec = 0,
-    .it_value.tv_sec = kConnectionTimeQuota
-  };
-  struct itimerspec empty_time = {{0, 0}, {0, 0}};
-
+int AcceptClients(
+  struct Server* server,  //
+  int listenfd,
+  ClientHandler handler,
+  void* context
+)
+{
   while (true)
   {
-  NEXT_CLIENT:
-    ssize_t processed_bytes = read(worker_info->input_channel_, &clientfd, sizeof(int));
-    if (processed_bytes == kReadFailed)
-    {
-      snprintf(
-        message_buffer,  //
-        kMessageBufferSize,
-        "Worker received error: read[1] failed: [%d](%s)",
-        errno,
-        strerror(errno)
-      );
-      LOG_FATAL(message_buffer, worker_id);
-    }
-
-    error_code = timer_settime(connection_timer, kDefaultTimerFlags, &connection_limit, NULL);
-    if (error_code == kTimerSettimeFailed)
+    struct sockaddr_in peer_info;
+    socklen_t peer_info_size = (socklen_t) sizeof(struct sockaddr_in);
+    int clientfd =
+      accept4(listenfd, (struct sockaddr*) &peer_info, &peer_info_size, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (clientfd != kAcceptFailed)
     {
-      snprintf(
-        message_buffer,  //
-        kMessageBufferSize,
-        "Worker received error: timer_settime[1] failed: [%d](%s)",
-        errno,
-        strerror(errno)
+      AddMetric(kMetricAcceptedConnections, 1);
+      LOG_INFO(
+        "Server accepted connection on: %d\n\taddress: %s;\n\tport: %" PRIu16,  //
+        clientfd,
+        inet_ntoa(peer_info.sin_addr),
+        ntohs(peer_info.sin_port)
       );
-      LOG_FATAL(message_buffer, worker_id);
+      handler(clientfd, &peer_info, context);
+      continue;
     }
 
-    processed_bytes = 0;
-    while (processed_bytes != kWorkerBufferSize)
+    switch (errno)
     {
-      ssize_t bytes = read(clientfd, buffer, kWorkerBufferSize - processed_bytes);
-      if (bytes == kReadFailed)
+      case EAGAIN :
+      {
+        return 0;
+      }
+      case EINTR :
+      case ECONNABORTED :
+      case EPROTO :
+      case EPERM :
+      {
+        AddMetric(kMetricAcceptErrors, 1);
+        continue;
+      }
+      case EMFILE :
+      case ENFILE :
       {
-        if (errno == EINTR)
-        {
-          goto NEXT_CLIENT;
-        }
-        snprintf(
-          message_buffer,  //
-          kMessageBufferSize,
-          "Worker received error: read[2] failed: [%d](%s)",
+        AddMetric(kMetricAcceptErrors, 1);
+        LOG_WARNING(
+          "Server received error: accept failed: [%d](%s), resetting a pending connection",  //
           errno,
           strerror(errno)
         );
-        LOG_FATAL(message_buffer, worker_id);
+        return DropClient(server, listenfd);
       }
-      else if (bytes == 0)
+      default :
       {
-        break;
-      }
-
-      processed_bytes += bytes;
-      bytes = write(clientfd, buffer, bytes);
-      if (bytes == kWriteFailed)
-      {
-        if (errno == EINTR)
-        {
-          goto NEXT_CLIENT;
-        }
-        snprintf(
-          message_buffer,  //
-          kMessageBufferSize,
-          "Worker received error: write failed: [%d](%s)",
+        AddMetric(kMetricAcceptErrors, 1);
+        LOG_WARNING(
+          "Server received error: accept failed: [%d](%s)",  //
           errno,
           strerror(errno)
         );
-        LOG_FATAL(message_buffer, worker_id);
+        return 0;
       }
     }
-
-    error_code = timer_settime(connection_timer, 0, &empty_time, NULL);
-    if (error_code == kTimerSettimeFailed)
-    {
-      exit(EXIT_FAILURE);
-    }
-
-    shutdown(clientfd, SHUT_RDWR);
-    close(clientfd);
-
-    if (errno)
-    {
-      errno = 0;
-      continue;
-    }
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Worker: client qouta exceded. [%d] bytes processed.",
-      kWorkerBufferSize
-    );
-    LOG_INFO(message_buffer, worker_id);
   }
-
-  return NULL;
 }
 
-void* ControlBlockFunction(
-  void* arg
+void RejectClient(
+  int clientfd
 )
 {
-  pid_t control_block_id = gettid();
-  int channels[kWorkersCount][2];
-  for (int i = 0; i < kWorkersCount; ++i)
-  {
-    int error_code = pipe(channels[i]);
-    if (error_code == kPipeFailed)
-    {
-      snprintf(
-        message_buffer,
-        kMessageBufferSize,
-        "Control block received error: pipe failed: [%d](%s)",
-        errno,
-        strerror(errno)
-      );
-      LOG_FATAL(message_buffer, control_block_id);
-    }
-  }
-
-  pthread_t workers[kWorkersCount];
-  for (int i = 0; i < kWorkersCount; ++i)
-  {
-    struct WorkerInfo* worker_info = malloc(sizeof(struct WorkerInfo));
-    if (worker_info == MALLOC_FAILED)
-    {
-      snprintf(
-        message_buffer,
-        kMessageBufferSize,
-        "Control block received error: malloc failed: [%d](%s)",
-        errno,
-        strerror(errno)
-      );
-      LOG_FATAL(message_buffer, control_block_id);
-    }
-
-    worker_info->control_block_id_ = control_block_id;
-    worker_info->input_channel_ = channels[i][0];
-
-    int error_code = pthread_create(workers + i, NULL, &WorkerFunction, worker_info);
-    if (error_code != kPthreadCreateSuccess)
-    {
-      snprintf(
-        message_buffer,  //
-        kMessageBufferSize,
-        "Control block received error: pthread_create failed: [%d](%s)",
-        errno,
-        strerror(errno)
-      );
-      LOG_FATAL(message_buffer, control_block_id);
-    }
-  }
-
-  int error_code = sem_post(&control_semaphore);
-  if (error_code == kSemPostFailed)
+  AddMetric(kMetricRejectedConnections, 1);
+  AddMetric(kMetricClosedConnections, 1);
+  // A zero linger time makes the close send RST, even if the client already sent data.
+  if (setsockopt(clientfd, SOL_SOCKET, SO_LINGER, &kResetLinger, sizeof(kResetLinger)) == kSetsockoptFailed)
   {
-    snprintf(
-      message_buffer,  //
-      kMessageBufferSize,
-      "Control block received error: sem_post failed: [%d](%s)",
-      errno,
-      strerror(errno)
-    );
-    LOG_FATAL(message_buffer, control_block_id);
-  }
-
-  int input_channel = (int) arg;
-  unsigned current_worker_id = 0U;
-
-  while (true)
-  {
-    int clientfd;
-    ssize_t processed_bytes = read(input_channel, &clientfd, sizeof(int));
-    if (processed_bytes == kReadFailed)
-    {
-      snprintf(
-        message_buffer,  //
-        kMessageBufferSize,
-        "Control block received error: read failed: [%d](%s)",
-        errno,
-        strerror(errno)
-      );
-      LOG_FATAL(message_buffer, control_block_id);
-    }
-    processed_bytes = write(channels[current_worker_id++ & 3][1], &clientfd, sizeof(int));
-    if (processed_bytes == kWriteFailed)
-    {
-      snprintf(
-        message_buffer,  //
-        kMessageBufferSize,
-        "Control block received error: write failed: [%d](%s)",
-        errno,
-        strerror(errno)
-      );
-
-      if (errno != EAGAIN)
-      {
-        LOG_FATAL(message_buffer, control_block_id);
-      }
-      else
-      {
-        LOG_WARNING(message_buffer, control_block_id);
-        shutdown(clientfd, SHUT_RDWR);
-        close(clientfd);
-      }
-    }
+    shutdown(clientfd, SHUT_RDWR);
   }
-
-  return NULL;
+  close(clientfd);
 }
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sync_server/timer_wheel/timer_wheel.h>
+
+#define TIMER_WHEEL_SLOT_BITS 6
+
+const uint64_t kTimerWheelIdle = UINT64_MAX;
+
+static const uint64_t kSlotMask = TIMER_WHEEL_SLOTS - 1;
+static const uint64_t kMaxDistance = (1ULL << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void LinkTimer(
+  struct Timer** slot,  //
+  struct Timer* timer
+)  // clang-format on
+{
+  timer->next_ = *slot;
+  if (*slot != NULL)
+  {
+    (*slot)->pprev_ = &timer->next_;
+  }
+  timer->pprev_ = slot;
+  *slot = timer;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void UnlinkTimer(
+  struct Timer* timer
+)  // clang-format on
+{
+  *timer->pprev_ = timer->next_;
+  if (timer->next_ != NULL)
+  {
+    timer->next_->pprev_ = timer->pprev_;
+  }
+  timer->next_ = NULL;
+  timer->pprev_ = NULL;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void InsertTimer(
+  struct TimerWheel* wheel,  //
+  struct Timer* timer
+)  // clang-format on
+{
+  uint64_t expires = timer->expires_ < wheel->now_ ? wheel->now_ : timer->expires_;
+  uint64_t distance = expires - wheel->now_;
+  if (distance > kMaxDistance)
+  {
+    // Parked in the last level, the timer is cascaded there again until it is in range.
+    distance = kMaxDistance;
+    expires = wheel->now_ + kMaxDistance;
+  }
+
+  int level = 0;
+  while ((distance >> (TIMER_WHEEL_SLOT_BITS * (level + 1))) != 0)
+  {
+    ++level;
+  }
+  uint64_t index = (expires >> (TIMER_WHEEL_SLOT_BITS * level)) & kSlotMask;
+  LinkTimer(&wheel->slots_[level][index], timer);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void CascadeTimers(
+  struct TimerWheel* wheel
+)  // clang-format on
+{
+  for (int level = 1; level < TIMER_WHEEL_LEVELS; ++level)
+  {
+    uint64_t index = (wheel->now_ >> (TIMER_WHEEL_SLOT_BITS * level)) & kSlotMask;
+    struct Timer* timers = wheel->slots_[level][index];
+    wheel->slots_[level][index] = NULL;
+    while (timers != NULL)
+    {
+      struct Timer* timer = timers;
+      timers = timer->next_;
+      InsertTimer(wheel, timer);
+    }
+    if (index != 0)
+    {
+      break;
+    }
+  }
+}
+
+void TimerWheelInitialize(
+  struct TimerWheel* wheel,  //
+  uint64_t now
+)
+{
+  memset(wheel, 0, sizeof(struct TimerWheel));
+  wheel->now_ = now;
+}
+
+void TimerInitialize(
+  struct Timer* timer,  //
+  unsigned tag
+)
+{
+  timer->next_ = NULL;
+  timer->pprev_ = NULL;
+  timer->expires_ = 0;
+  timer->tag_ = tag;
+}
+
+bool TimerIsArmed(
+  const struct Timer* timer
+)
+{
+  return timer->pprev_ != NULL;
+}
+
+void TimerWheelSchedule(
+  struct TimerWheel* wheel,  //
+  struct Timer* timer,
+  uint64_t expires
+)
+{
+  if (TimerIsArmed(timer))
+  {
+    UnlinkTimer(timer);
+  }
+  else
+  {
+    ++wheel->armed_timers_;
+  }
+  timer->expires_ = expires;
+  InsertTimer(wheel, timer);
+}
+
+void TimerWheelCancel(
+  struct TimerWheel* wheel,  //
+  struct Timer* timer
+)
+{
+  if (TimerIsArmed(timer))
+  {
+    UnlinkTimer(timer);
+    --wheel->armed_timers_;
+  }
+}
+
+void TimerWheelAdvance(
+  struct TimerWheel* wheel,  //
+  uint64_t now,
+  TimerCallback callback,
+  void* context
+)
+{
+  if (wheel->armed_timers_ == 0)
+  {
+    if (now >= wheel->now_)
+    {
+      wheel->now_ = now + 1;
+    }
+    return;
+  }
+
+  while (wheel->now_ <= now)
+  {
+    uint64_t index = wheel->now_ & kSlotMask;
+    if (index == 0)
+    {
+      CascadeTimers(wheel);
+    }
+
+    // Detached list keeps the links valid if the callback cancels the timers expiring on the same tick.
+    struct Timer* expired = wheel->slots_[0][index];
+    wheel->slots_[0][index] = NULL;
+    if (expired != NULL)
+    {
+      expired->pprev_ = &expired;
+    }
+    ++wheel->now_;
+
+    while (expired != NULL)
+    {
+      struct Timer* timer = expired;
+      UnlinkTimer(timer);
+      --wheel->armed_timers_;
+      callback(timer, context);
+    }
+  }
+}
+
+uint64_t TimerWheelNextTick(
+  const struct TimerWheel* wheel
+)
+{
+  if (wheel->armed_timers_ == 0)
+  {
+    return kTimerWheelIdle;
+  }
+
+  // Either a level 0 slot is due or the next cascade has to be run, both are within one turn.
+  uint64_t tick = wheel->now_;
+  while (wheel->slots_[0][tick & kSlotMask] == NULL && (tick & kSlotMask) != 0)
+  {
+    ++tick;
+  }
+  return tick;
+}
\ No newline at end of file
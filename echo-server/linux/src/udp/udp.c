@@ -0,0 +1,581 @@
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <common/logger/logger.h>
+#include <common/metrics/metrics.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sync_server/errors/errors.h>
+#include <sync_server/server/server.h>
+#include <sync_server/timer_wheel/timer_wheel.h>
+#include <sync_server/udp/udp.h>
+#include <sync_server/worker/worker.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define MALLOC_FAILED NULL
+#define UDP_BATCH_SIZE 64
+#define UDP_FLOW_BUCKETS 1024
+#define UDP_FLOWS_COUNT 4096
+
+const int kUdpEngineFailed = -1;
+
+static const size_t kDatagramBufferSize = 2048;
+static const size_t kGroBufferSize = 64 * 1024;
+static const int kSocketOptionEnabled = 1;
+static const int kInfiniteEpollTimeout = -1;
+static const int kPthreadCreateSuccess = 0;
+static const uint32_t kFlowHashMultiplier = 2654435761U;
+
+/*
+ * Peer of the echo service identified by its address and the server port
+ * it sends to. UDP has no connections, so a flow stands in for one: it is
+ * accepted with the first datagram of the peer, it expires by the idle
+ * timeout and the lifetime, and it is reported by the same connection
+ * metrics as the TCP engines. The byte quota does not apply.
+ */
+struct UdpFlow
+{
+  struct UdpFlow* next_;
+  struct sockaddr_in peer_;
+  int port_index_;
+  uint64_t accepted_at_;
+  struct Timer idle_timer_;
+  struct Timer lifetime_timer_;
+};
+
+enum UdpFlowTimer
+{
+  kIdleTimer,
+  kLifetimeTimer
+};
+
+union UdpControl
+{
+  struct cmsghdr header_;
+  char buffer_[CMSG_SPACE(sizeof(int))];
+};
+
+struct UdpWorker
+{
+  pthread_t thread_;
+  unsigned id_;
+  struct WorkerOptions options_;
+  bool gro_;
+  int epfd_;
+  int sockets_[SERVER_MAX_SOCKETS];
+  size_t buffer_size_;
+  unsigned char* buffers_;
+  struct TimerWheel timers_;
+  struct UdpFlow* buckets_[UDP_FLOW_BUCKETS];
+  struct UdpFlow* free_flows_;
+  struct UdpFlow flows_[UDP_FLOWS_COUNT];
+  struct mmsghdr received_[UDP_BATCH_SIZE];
+  struct mmsghdr echoed_[UDP_BATCH_SIZE];
+  struct iovec iovecs_[UDP_BATCH_SIZE];
+  struct sockaddr_in peers_[UDP_BATCH_SIZE];
+  union UdpControl received_controls_[UDP_BATCH_SIZE];
+  union UdpControl echoed_controls_[UDP_BATCH_SIZE];
+};
+
+// clang-format off
+__attribute__((nonnull(1)))
+static int ComputeEpollTimeout(
+  const struct TimerWheel* timers
+)  // clang-format on
+{
+  uint64_t next_tick = TimerWheelNextTick(timers);
+  if (next_tick == kTimerWheelIdle)
+  {
+    return kInfiniteEpollTimeout;
+  }
+
+  uint64_t now = GetTimerTick();
+  if (next_tick <= now)
+  {
+    return 0;
+  }
+  return (int) ((next_tick - now) * kTimerTickMilliseconds);
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static struct UdpFlow** GetFlowBucket(
+  struct UdpWorker* worker,  //
+  const struct sockaddr_in* peer,
+  int port_index
+)  // clang-format on
+{
+  uint32_t hash = (peer->sin_addr.s_addr ^ ((uint32_t) peer->sin_port << 16) ^ (uint32_t) port_index) *
+                  kFlowHashMultiplier;
+  return worker->buckets_ + (hash >> 22) % UDP_FLOW_BUCKETS;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void CloseFlow(
+  struct UdpWorker* worker,  //
+  struct UdpFlow* flow
+)  // clang-format on
+{
+  struct UdpFlow** link = GetFlowBucket(worker, &flow->peer_, flow->port_index_);
+  while (*link != flow)
+  {
+    link = &(*link)->next_;
+  }
+  *link = flow->next_;
+
+  TimerWheelCancel(&worker->timers_, &flow->idle_timer_);
+  TimerWheelCancel(&worker->timers_, &flow->lifetime_timer_);
+  AddMetric(kMetricClosedConnections, 1);
+  RecordMetric(kMetricConnectionDuration, GetMetricsTimestamp() - flow->accepted_at_);
+  flow->next_ = worker->free_flows_;
+  worker->free_flows_ = flow;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void ExpireFlow(
+  struct Timer* timer,  //
+  void* context
+)  // clang-format on
+{
+  struct UdpWorker* worker = (struct UdpWorker*) context;
+  struct UdpFlow* flow;
+  if (timer->tag_ == kIdleTimer)
+  {
+    flow = (struct UdpFlow*) ((unsigned char*) timer - offsetof(struct UdpFlow, idle_timer_));
+  }
+  else
+  {
+    flow = (struct UdpFlow*) ((unsigned char*) timer - offsetof(struct UdpFlow, lifetime_timer_));
+  }
+
+  LOG_WARNING(
+    timer->tag_ == kIdleTimer ? "[MESSAGE] Flow idle time expired for: %s:%hu"  //
+                              : "[MESSAGE] Flow time expired for: %s:%hu",
+    inet_ntoa(flow->peer_.sin_addr),
+    ntohs(flow->peer_.sin_port)
+  );
+  AddMetric(kMetricExpiredConnections, 1);
+  CloseFlow(worker, flow);
+}
+
+/*
+ * Finds the flow of the peer or accepts a new one and pushes back its
+ * idle deadline. Peers over the capacity of the flow table are echoed
+ * without being tracked.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void TouchFlow(
+  struct UdpWorker* worker,  //
+  const struct sockaddr_in* peer,
+  int port_index
+)  // clang-format on
+{
+  struct UdpFlow** bucket = GetFlowBucket(worker, peer, port_index);
+  struct UdpFlow* flow = *bucket;
+  while (flow != NULL &&
+         (flow->port_index_ != port_index || flow->peer_.sin_addr.s_addr != peer->sin_addr.s_addr ||
+          flow->peer_.sin_port != peer->sin_port))
+  {
+    flow = flow->next_;
+  }
+
+  if (flow == NULL)
+  {
+    flow = worker->free_flows_;
+    if (flow == NULL)
+    {
+      return;
+    }
+    worker->free_flows_ = flow->next_;
+    flow->next_ = *bucket;
+    *bucket = flow;
+    flow->peer_ = *peer;
+    flow->port_index_ = port_index;
+    flow->accepted_at_ = GetMetricsTimestamp();
+    AddMetric(kMetricAcceptedConnections, 1);
+    if (worker->options_.lifetime_ms_ != kNoTimeout)
+    {
+      TimerWheelSchedule(
+        &worker->timers_,  //
+        &flow->lifetime_timer_,
+        GetTimerTick() + MillisecondsToTicks(worker->options_.lifetime_ms_)
+      );
+    }
+  }
+
+  if (worker->options_.idle_timeout_ms_ != kNoTimeout)
+  {
+    TimerWheelSchedule(
+      &worker->timers_,  //
+      &flow->idle_timer_,
+      GetTimerTick() + MillisecondsToTicks(worker->options_.idle_timeout_ms_)
+    );
+  }
+}
+
+/*
+ * Returns the segment size of the datagrams the kernel coalesced into
+ * the message with GRO, 0 if the message holds a single datagram.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static int GetGroSegmentSize(
+  struct msghdr* message
+)  // clang-format on
+{
+  for (struct cmsghdr* header = CMSG_FIRSTHDR(message); header != NULL; header = CMSG_NXTHDR(message, header))
+  {
+    if (header->cmsg_level == SOL_UDP && header->cmsg_type == UDP_GRO)
+    {
+      int segment_size;
+      memcpy(&segment_size, CMSG_DATA(header), sizeof(int));
+      return segment_size;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Receives one batch of datagrams from the socket and echoes it with a
+ * single sendmmsg. The socket stays readable in the level-triggered
+ * epoll while more datagrams are queued, so a busy port does not starve
+ * the others. Datagrams the kernel cannot take right away are dropped,
+ * as the network would do.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static void EchoDatagrams(
+  struct UdpWorker* worker,  //
+  int port_index
+)  // clang-format on
+{
+  int sockfd = worker->sockets_[port_index];
+  for (int i = 0; i < UDP_BATCH_SIZE; ++i)
+  {
+    worker->iovecs_[i].iov_base = worker->buffers_ + (size_t) i * worker->buffer_size_;
+    worker->iovecs_[i].iov_len = worker->buffer_size_;
+    struct msghdr* message = &worker->received_[i].msg_hdr;
+    message->msg_name = worker->peers_ + i;
+    message->msg_namelen = sizeof(struct sockaddr_in);
+    message->msg_iov = worker->iovecs_ + i;
+    message->msg_iovlen = 1;
+    message->msg_control = worker->gro_ ? worker->received_controls_[i].buffer_ : NULL;
+    message->msg_controllen = worker->gro_ ? sizeof(union UdpControl) : 0;
+    message->msg_flags = 0;
+  }
+
+  int received = recvmmsg(sockfd, worker->received_, UDP_BATCH_SIZE, MSG_DONTWAIT, NULL);
+  if (received == kReadFailed)
+  {
+    if (errno != EAGAIN && errno != EINTR)
+    {
+      LOG_WARNING(
+        "Udp worker received error: recvmmsg failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+    return;
+  }
+
+  unsigned echoed = 0;
+  uint64_t echoed_packets = 0;
+  for (int i = 0; i < received; ++i)
+  {
+    struct msghdr* message = &worker->received_[i].msg_hdr;
+    size_t length = worker->received_[i].msg_len;
+    if (message->msg_flags & MSG_TRUNC)
+    {
+      continue;
+    }
+
+    int segment_size = worker->gro_ ? GetGroSegmentSize(message) : 0;
+    uint64_t packets = segment_size == 0 ? 1U : (length + (size_t) segment_size - 1) / (size_t) segment_size;
+    AddMetric(kMetricReceivedPackets, packets);
+    AddMetric(kMetricReceivedBytes, length);
+    RecordMetric(kMetricReadSize, length);
+    TouchFlow(worker, worker->peers_ + i, port_index);
+
+    worker->iovecs_[i].iov_len = length;
+    struct msghdr* echo = &worker->echoed_[echoed].msg_hdr;
+    *echo = *message;
+    echo->msg_control = NULL;
+    echo->msg_controllen = 0;
+    echo->msg_flags = 0;
+    if (segment_size != 0 && length > (size_t) segment_size)
+    {
+      echo->msg_control = worker->echoed_controls_[echoed].buffer_;
+      echo->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+      struct cmsghdr* header = CMSG_FIRSTHDR(echo);
+      header->cmsg_level = SOL_UDP;
+      header->cmsg_type = UDP_SEGMENT;
+      header->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+      uint16_t gso_size = (uint16_t) segment_size;
+      memcpy(CMSG_DATA(header), &gso_size, sizeof(uint16_t));
+    }
+    ++echoed;
+    echoed_packets += packets;
+  }
+
+  unsigned sent = 0;
+  while (sent < echoed)
+  {
+    int batch_sent = sendmmsg(sockfd, worker->echoed_ + sent, echoed - sent, MSG_DONTWAIT);
+    if (batch_sent == kWriteFailed)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if (errno != EAGAIN)
+      {
+        LOG_WARNING(
+          "Udp worker received error: sendmmsg failed: [%d](%s)",  //
+          errno,
+          strerror(errno)
+        );
+      }
+      // The datagram is dropped, the rest of the batch is still echoed.
+      ++sent;
+      continue;
+    }
+    for (int i = 0; i < batch_sent; ++i)
+    {
+      AddMetric(kMetricSentBytes, worker->echoed_[sent + (unsigned) i].msg_len);
+    }
+    sent += (unsigned) batch_sent;
+  }
+  AddMetric(kMetricSentPackets, echoed_packets);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void* UdpWorkerFunction(
+  void* arg
+)  // clang-format on
+{
+  struct UdpWorker* worker = (struct UdpWorker*) arg;
+  struct epoll_event ep_events[SERVER_MAX_SOCKETS];
+
+  char thread_name[METRICS_THREAD_NAME_SIZE];
+  snprintf(thread_name, sizeof(thread_name), "worker-%u", worker->id_);
+  AttachMetrics(thread_name);
+  if (worker->options_.pin_workers_ && PinWorkerThread(worker->id_) == kPinWorkerFailed)
+  {
+    LOG_WARNING("Worker %u is not pinned: [%d](%s)", worker->id_, errno, strerror(errno));
+  }
+
+  while (true)
+  {
+    int ready_events =
+      epoll_wait(worker->epfd_, ep_events, SERVER_MAX_SOCKETS, ComputeEpollTimeout(&worker->timers_));
+    if (ready_events == kEpollWaitFailed)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      LOG_FATAL(
+        "Udp worker received error: epoll failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+
+    for (int i = 0; i < ready_events; ++i)
+    {
+      EchoDatagrams(worker, ep_events[i].data.u32);
+    }
+
+    TimerWheelAdvance(&worker->timers_, GetTimerTick(), &ExpireFlow, worker);
+  }
+
+  return NULL;
+}
+
+// clang-format off
+__attribute__((nonnull(1))) __attribute__((warn_unused_result))
+static int CreateUdpSocket(
+  const struct ServerOptions* server_options,  //
+  int port,
+  bool gro
+)  // clang-format on
+{
+  int sockfd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (sockfd == kSocketFailed)
+  {
+    return kSocketFailed;
+  }
+  int error_code = setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &kSocketOptionEnabled, sizeof(int));
+  if (error_code == kSetsockoptFailed)
+  {
+    close(sockfd);
+    return kSocketFailed;
+  }
+  if (gro)
+  {
+    error_code = setsockopt(sockfd, SOL_UDP, UDP_GRO, &kSocketOptionEnabled, sizeof(int));
+    if (error_code == kSetsockoptFailed)
+    {
+      close(sockfd);
+      return kSocketFailed;
+    }
+  }
+  if (server_options->busy_poll_us_ != kNoBusyPoll)
+  {
+    error_code = EnableSocketBusyPoll(sockfd, server_options->busy_poll_us_);
+    if (error_code == kSetsockoptFailed)
+    {
+      close(sockfd);
+      return kSocketFailed;
+    }
+  }
+  error_code = SetSocketBuffers(sockfd, server_options);
+  if (error_code == kSetsockoptFailed)
+  {
+    close(sockfd);
+    return kSocketFailed;
+  }
+
+  struct sockaddr_in server_addr;
+  memset(&server_addr, '\0', sizeof(struct sockaddr_in));
+  server_addr.sin_addr = server_options->address_;
+  server_addr.sin_family = AF_INET;
+  server_addr.sin_port = htons((uint16_t) port);
+  error_code = bind(sockfd, (struct sockaddr*) &server_addr, sizeof(struct sockaddr_in));
+  if (error_code == kBindFailed)
+  {
+    close(sockfd);
+    return kSocketFailed;
+  }
+  return sockfd;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void PrintUdpEngineInfo(
+  const struct ServerOptions* server_options,  //
+  bool gro
+)  // clang-format on
+{
+  puts("Server initialized with:");
+  printf(
+    "\taddress: %s;\n"
+    "\tports:\n",
+    inet_ntoa(server_options->address_)
+  );
+  for (int i = 0; i < server_options->ports_count_; ++i)
+  {
+    printf("\t\t- %d;\n", server_options->base_port_ + i);
+  }
+  printf(
+    "\tsocket type: SOCK_DGRAM\n"
+    "\tprotocol: UDP/IP%s\n",
+    gro ? " (GRO/GSO)" : ""
+  );
+}
+
+int RunUdpEngine(
+  const struct ServerOptions* server_options,  //
+  const struct WorkerOptions* options,
+  bool gro
+)
+{
+  LOG_DEBUG("RunUdpEngine[1]: start sockets initialization");
+
+  struct UdpWorker* workers = calloc(options->workers_count_, sizeof(struct UdpWorker));
+  if (workers == MALLOC_FAILED)
+  {
+    return kUdpEngineFailed;
+  }
+
+  for (unsigned i = 0; i < options->workers_count_; ++i)
+  {
+    struct UdpWorker* worker = workers + i;
+    worker->id_ = i;
+    worker->options_ = *options;
+    worker->gro_ = gro;
+    worker->buffer_size_ = gro ? kGroBufferSize : kDatagramBufferSize;
+    worker->buffers_ = malloc(UDP_BATCH_SIZE * worker->buffer_size_);
+    if (worker->buffers_ == MALLOC_FAILED)
+    {
+      return kUdpEngineFailed;
+    }
+    TimerWheelInitialize(&worker->timers_, GetTimerTick());
+    worker->free_flows_ = NULL;
+    for (int j = UDP_FLOWS_COUNT - 1; j >= 0; --j)
+    {
+      struct UdpFlow* flow = worker->flows_ + j;
+      TimerInitialize(&flow->idle_timer_, kIdleTimer);
+      TimerInitialize(&flow->lifetime_timer_, kLifetimeTimer);
+      flow->next_ = worker->free_flows_;
+      worker->free_flows_ = flow;
+    }
+
+    worker->epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (worker->epfd_ == kEpollCreateFailed)
+    {
+      return kUdpEngineFailed;
+    }
+    if (options->busy_poll_us_ != kNoBusyPoll &&
+        EnableEpollBusyPoll(worker->epfd_, options->busy_poll_us_) == kEpollBusyPollFailed)
+    {
+      LOG_WARNING(
+        "RunUdpEngine: epoll busy polling of worker %u is not enabled: [%d](%s)",  //
+        i,
+        errno,
+        strerror(errno)
+      );
+    }
+    for (int j = 0; j < server_options->ports_count_; ++j)
+    {
+      worker->sockets_[j] = CreateUdpSocket(server_options, server_options->base_port_ + j, gro);
+      if (worker->sockets_[j] == kSocketFailed)
+      {
+        return kUdpEngineFailed;
+      }
+      struct epoll_event ev;
+      ev.events = EPOLLIN;
+      ev.data.u32 = (uint32_t) j;
+      int error_code = epoll_ctl(worker->epfd_, EPOLL_CTL_ADD, worker->sockets_[j], &ev);
+      if (error_code == kEpollCtlFailed)
+      {
+        return kUdpEngineFailed;
+      }
+    }
+  }
+
+  PrintUdpEngineInfo(server_options, gro);
+
+  for (unsigned i = 0; i < options->workers_count_; ++i)
+  {
+    int error_code = pthread_create(&workers[i].thread_, NULL, &UdpWorkerFunction, workers + i);
+    if (error_code != kPthreadCreateSuccess)
+    {
+      errno = error_code;
+      return kUdpEngineFailed;
+    }
+  }
+
+  LOG_DEBUG("RunUdpEngine[2]: end sockets initialization");
+
+  for (unsigned i = 0; i < options->workers_count_; ++i)
+  {
+    pthread_join(workers[i].thread_, NULL);
+  }
+  return 0;
+}
\ No newline at end of file
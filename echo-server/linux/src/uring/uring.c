@@ -0,0 +1,572 @@
+#define _GNU_SOURCE
+
+#include <common/logger/logger.h>
+#include <common/metrics/metrics.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sync_server/errors/errors.h>
+#include <sync_server/ring/ring.h>
+#include <sync_server/server/server.h>
+#include <sync_server/timer_wheel/timer_wheel.h>
+#include <sync_server/uring/uring.h>
+#include <sync_server/worker/worker.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MALLOC_FAILED NULL
+#define URING_ENTRIES 1024
+#define URING_BUFFERS_COUNT 512
+#define URING_BUFFER_SIZE 2048
+
+const int kUringEngineFailed = -1;
+
+static const long kTickNanoseconds = 100000000L;
+static const unsigned short kBufferGroupId = 0;
+static const int kPthreadCreateSuccess = 0;
+static const uint64_t kUserDataKindMask = 7U;
+static const int kUserDataListenerShift = 3;
+static const int kUserDataBufferShift = 48;
+
+/*
+ * Kind of the operation is kept in the low bits of the SQE user data,
+ * the rest holds the connection pointer (or the listening socket) and,
+ * for sends, the id of the provided buffer being echoed.
+ */
+enum UringOperation
+{
+  kAcceptOperation,
+  kRecvOperation,
+  kSendOperation,
+  kTickOperation
+};
+
+struct UringConnection
+{
+  int fd_;
+  size_t processed_bytes_;
+  uint64_t accepted_at_;
+  unsigned inflight_sends_;
+  bool recv_armed_;
+  bool closing_;
+  bool shut_down_;
+  struct Timer idle_timer_;
+  struct Timer lifetime_timer_;
+};
+
+enum UringConnectionTimer
+{
+  kIdleTimer,
+  kLifetimeTimer
+};
+
+struct UringWorker
+{
+  pthread_t thread_;
+  unsigned id_;
+  struct Server* server_;
+  struct WorkerOptions options_;
+  struct Ring ring_;
+  struct BufferRing buffers_;
+  struct TimerWheel timers_;
+  struct __kernel_timespec tick_;
+  int suspended_accepts_[SERVER_MAX_SOCKETS];
+  int suspended_accepts_count_;
+  unsigned send_offsets_[URING_BUFFERS_COUNT];
+  unsigned send_lengths_[URING_BUFFERS_COUNT];
+};
+
+// clang-format off
+__attribute__((nonnull(1)))
+static struct io_uring_sqe* GetSqe(
+  struct UringWorker* worker
+)  // clang-format on
+{
+  struct io_uring_sqe* sqe;
+  while ((sqe = RingGetSqe(&worker->ring_)) == NULL)
+  {
+    if (RingSubmitAndWait(&worker->ring_, 0) == kRingSubmitFailed)
+    {
+      LOG_FATAL(
+        "Uring worker received error: io_uring_enter failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+  }
+  return sqe;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void PrepareMultishotAccept(
+  struct UringWorker* worker,  //
+  int listenfd
+)  // clang-format on
+{
+  struct io_uring_sqe* sqe = GetSqe(worker);
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = listenfd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_CLOEXEC;
+  sqe->user_data = ((uint64_t) listenfd << kUserDataListenerShift) | kAcceptOperation;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void PrepareMultishotRecv(
+  struct UringWorker* worker,  //
+  struct UringConnection* connection
+)  // clang-format on
+{
+  struct io_uring_sqe* sqe = GetSqe(worker);
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = connection->fd_;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kBufferGroupId;
+  sqe->user_data = (uint64_t) (uintptr_t) connection | kRecvOperation;
+  connection->recv_armed_ = true;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void PrepareSend(
+  struct UringWorker* worker,  //
+  struct UringConnection* connection,
+  unsigned short buffer_id
+)  // clang-format on
+{
+  struct io_uring_sqe* sqe = GetSqe(worker);
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = connection->fd_;
+  sqe->addr = (uintptr_t) (BufferRingGet(&worker->buffers_, buffer_id) + worker->send_offsets_[buffer_id]);
+  sqe->len = worker->send_lengths_[buffer_id] - worker->send_offsets_[buffer_id];
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = ((uint64_t) buffer_id << kUserDataBufferShift) | (uint64_t) (uintptr_t) connection | kSendOperation;
+  ++connection->inflight_sends_;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void PrepareTick(
+  struct UringWorker* worker
+)  // clang-format on
+{
+  struct io_uring_sqe* sqe = GetSqe(worker);
+  sqe->opcode = IORING_OP_TIMEOUT;
+  sqe->addr = (uintptr_t) &worker->tick_;
+  sqe->len = 1;
+  sqe->user_data = kTickOperation;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void TouchConnection(
+  struct UringWorker* worker,  //
+  struct UringConnection* connection
+)  // clang-format on
+{
+  if (worker->options_.idle_timeout_ms_ != kNoTimeout)
+  {
+    TimerWheelSchedule(
+      &worker->timers_,  //
+      &connection->idle_timer_,
+      GetTimerTick() + MillisecondsToTicks(worker->options_.idle_timeout_ms_)
+    );
+  }
+}
+
+/*
+ * The connection is released only once the kernel holds no references to
+ * it: all sends are completed and the multishot recv is terminated, which
+ * the shutdown of the socket guarantees.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static void TryReleaseConnection(
+  struct UringConnection* connection
+)  // clang-format on
+{
+  if (!connection->closing_ || connection->inflight_sends_ != 0)
+  {
+    return;
+  }
+  if (connection->recv_armed_)
+  {
+    if (!connection->shut_down_)
+    {
+      shutdown(connection->fd_, SHUT_RDWR);
+      connection->shut_down_ = true;
+    }
+    return;
+  }
+  AddMetric(kMetricClosedConnections, 1);
+  RecordMetric(kMetricConnectionDuration, GetMetricsTimestamp() - connection->accepted_at_);
+  close(connection->fd_);
+  free(connection);
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void StartClosing(
+  struct UringWorker* worker,  //
+  struct UringConnection* connection,
+  bool force
+)  // clang-format on
+{
+  if (connection->closing_)
+  {
+    return;
+  }
+  connection->closing_ = true;
+  TimerWheelCancel(&worker->timers_, &connection->idle_timer_);
+  TimerWheelCancel(&worker->timers_, &connection->lifetime_timer_);
+  if (force)
+  {
+    shutdown(connection->fd_, SHUT_RDWR);
+    connection->shut_down_ = true;
+  }
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void HandleAccept(
+  struct UringWorker* worker,  //
+  int listenfd,
+  int result,
+  unsigned flags
+)  // clang-format on
+{
+  if (!(flags & IORING_CQE_F_MORE))
+  {
+    if (result == -EMFILE || result == -ENFILE)
+    {
+      // Re-armed right away the accept would fail again at once, it waits for the next tick to let descriptors free.
+      worker->suspended_accepts_[worker->suspended_accepts_count_++] = listenfd;
+    }
+    else
+    {
+      PrepareMultishotAccept(worker, listenfd);
+    }
+  }
+  if (result < 0)
+  {
+    AddMetric(kMetricAcceptErrors, 1);
+    LOG_WARNING(
+      "Uring worker received error: accept failed: [%d](%s)",  //
+      -result,
+      strerror(-result)
+    );
+    return;
+  }
+
+  AddMetric(kMetricAcceptedConnections, 1);
+  struct UringConnection* connection = malloc(sizeof(struct UringConnection));
+  if (connection == MALLOC_FAILED)
+  {
+    AddMetric(kMetricClosedConnections, 1);
+    close(result);
+    return;
+  }
+  memset(connection, 0, sizeof(struct UringConnection));
+  connection->fd_ = result;
+  connection->accepted_at_ = GetMetricsTimestamp();
+  TimerInitialize(&connection->idle_timer_, kIdleTimer);
+  TimerInitialize(&connection->lifetime_timer_, kLifetimeTimer);
+  TouchConnection(worker, connection);
+  if (worker->options_.lifetime_ms_ != kNoTimeout)
+  {
+    TimerWheelSchedule(
+      &worker->timers_,  //
+      &connection->lifetime_timer_,
+      GetTimerTick() + MillisecondsToTicks(worker->options_.lifetime_ms_)
+    );
+  }
+
+  LOG_INFO(
+    "Server accepted connection on: %d",  //
+    result
+  );
+
+  PrepareMultishotRecv(worker, connection);
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void HandleRecv(
+  struct UringWorker* worker,  //
+  struct UringConnection* connection,
+  int result,
+  unsigned flags
+)  // clang-format on
+{
+  if (result > 0)
+  {
+    AddMetric(kMetricReceivedBytes, (uint64_t) result);
+    RecordMetric(kMetricReadSize, (uint64_t) result);
+    unsigned short buffer_id = (unsigned short) (flags >> IORING_CQE_BUFFER_SHIFT);
+    size_t bytes = (size_t) result;
+    size_t byte_quota = worker->options_.byte_quota_;
+    if (byte_quota != kUnlimitedByteQuota && bytes > byte_quota - connection->processed_bytes_)
+    {
+      bytes = byte_quota - connection->processed_bytes_;
+    }
+
+    if (connection->closing_ || bytes == 0)
+    {
+      BufferRingRecycle(&worker->buffers_, buffer_id);
+    }
+    else
+    {
+      connection->processed_bytes_ += bytes;
+      TouchConnection(worker, connection);
+      worker->send_offsets_[buffer_id] = 0;
+      worker->send_lengths_[buffer_id] = (unsigned) bytes;
+      PrepareSend(worker, connection, buffer_id);
+
+      if (byte_quota != kUnlimitedByteQuota && connection->processed_bytes_ == byte_quota)
+      {
+        LOG_INFO(
+          "Worker: client qouta exceded. [%zu] bytes processed.",  //
+          byte_quota
+        );
+        StartClosing(worker, connection, false);
+      }
+    }
+  }
+
+  if (!(flags & IORING_CQE_F_MORE))
+  {
+    connection->recv_armed_ = false;
+    if (!connection->closing_ && (result > 0 || result == -ENOBUFS))
+    {
+      PrepareMultishotRecv(worker, connection);
+    }
+    else
+    {
+      StartClosing(worker, connection, false);
+    }
+  }
+  TryReleaseConnection(connection);
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void HandleSend(
+  struct UringWorker* worker,  //
+  struct UringConnection* connection,
+  unsigned short buffer_id,
+  int result
+)  // clang-format on
+{
+  --connection->inflight_sends_;
+  if (result < 0)
+  {
+    BufferRingRecycle(&worker->buffers_, buffer_id);
+    StartClosing(worker, connection, true);
+  }
+  else
+  {
+    AddMetric(kMetricSentBytes, (uint64_t) result);
+    worker->send_offsets_[buffer_id] += (unsigned) result;
+    if (worker->send_offsets_[buffer_id] < worker->send_lengths_[buffer_id] && !connection->shut_down_)
+    {
+      PrepareSend(worker, connection, buffer_id);
+    }
+    else
+    {
+      BufferRingRecycle(&worker->buffers_, buffer_id);
+    }
+  }
+  TryReleaseConnection(connection);
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void ExpireConnection(
+  struct Timer* timer,  //
+  void* context
+)  // clang-format on
+{
+  struct UringWorker* worker = (struct UringWorker*) context;
+  struct UringConnection* connection;
+  if (timer->tag_ == kIdleTimer)
+  {
+    connection = (struct UringConnection*) ((unsigned char*) timer - offsetof(struct UringConnection, idle_timer_));
+  }
+  else
+  {
+    connection =
+      (struct UringConnection*) ((unsigned char*) timer - offsetof(struct UringConnection, lifetime_timer_));
+  }
+
+  LOG_WARNING(
+    timer->tag_ == kIdleTimer ? "[MESSAGE] Connection idle time expired for: %d"  //
+                              : "[MESSAGE] Connection time expired for: %d",
+    connection->fd_
+  );
+  AddMetric(kMetricExpiredConnections, 1);
+  StartClosing(worker, connection, true);
+  TryReleaseConnection(connection);
+}
+
+/*
+ * Advances the timers and re-arms the accepts suspended by descriptor
+ * exhaustion, so a full descriptor table costs one failed accept per
+ * listener and tick.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static void HandleTick(
+  struct UringWorker* worker
+)  // clang-format on
+{
+  TimerWheelAdvance(&worker->timers_, GetTimerTick(), &ExpireConnection, worker);
+  for (int i = 0; i < worker->suspended_accepts_count_; ++i)
+  {
+    PrepareMultishotAccept(worker, worker->suspended_accepts_[i]);
+  }
+  worker->suspended_accepts_count_ = 0;
+  PrepareTick(worker);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void* UringWorkerFunction(
+  void* arg
+)  // clang-format on
+{
+  struct UringWorker* worker = (struct UringWorker*) arg;
+
+  char thread_name[METRICS_THREAD_NAME_SIZE];
+  snprintf(thread_name, sizeof(thread_name), "worker-%u", worker->id_);
+  AttachMetrics(thread_name);
+  if (worker->options_.pin_workers_ && PinWorkerThread(worker->id_) == kPinWorkerFailed)
+  {
+    LOG_WARNING("Worker %u is not pinned: [%d](%s)", worker->id_, errno, strerror(errno));
+  }
+
+  for (int i = 0; i < worker->server_->sockets_count_; ++i)
+  {
+    PrepareMultishotAccept(worker, worker->server_->sockets_[i]);
+  }
+  PrepareTick(worker);
+
+  while (true)
+  {
+    int error_code = RingSubmitAndWait(&worker->ring_, 1);
+    if (error_code == kRingSubmitFailed)
+    {
+      LOG_FATAL(
+        "Uring worker received error: io_uring_enter failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+
+    struct io_uring_cqe* cqe;
+    while ((cqe = RingPeekCqe(&worker->ring_)) != NULL)
+    {
+      uint64_t user_data = cqe->user_data;
+      int result = cqe->res;
+      unsigned flags = cqe->flags;
+      RingAdvanceCq(&worker->ring_);
+
+      struct UringConnection* connection =
+        (struct UringConnection*) (uintptr_t) (user_data & ((1ULL << kUserDataBufferShift) - 1) & ~kUserDataKindMask);
+      switch (user_data & kUserDataKindMask)
+      {
+        case kAcceptOperation :
+        {
+          HandleAccept(worker, (int) (user_data >> kUserDataListenerShift), result, flags);
+          break;
+        }
+        case kRecvOperation :
+        {
+          HandleRecv(worker, connection, result, flags);
+          break;
+        }
+        case kSendOperation :
+        {
+          HandleSend(worker, connection, (unsigned short) (user_data >> kUserDataBufferShift), result);
+          break;
+        }
+        case kTickOperation :
+        {
+          HandleTick(worker);
+          break;
+        }
+      }
+    }
+  }
+
+  return NULL;
+}
+
+int RunUringEngine(
+  struct Server* server,  //
+  const struct WorkerOptions* options,
+  bool sqpoll
+)
+{
+  LOG_DEBUG("RunUringEngine[1]: start rings initialization");
+
+  struct UringWorker* workers = calloc(options->workers_count_, sizeof(struct UringWorker));
+  if (workers == MALLOC_FAILED)
+  {
+    return kUringEngineFailed;
+  }
+
+  for (unsigned i = 0; i < options->workers_count_; ++i)
+  {
+    struct UringWorker* worker = workers + i;
+    worker->id_ = i;
+    worker->server_ = server;
+    worker->options_ = *options;
+    TimerWheelInitialize(&worker->timers_, GetTimerTick());
+    worker->tick_.tv_sec = 0;
+    worker->tick_.tv_nsec = kTickNanoseconds;
+
+    int error_code = RingInitialize(&worker->ring_, URING_ENTRIES, sqpoll);
+    if (error_code == kRingInitFailed)
+    {
+      return kUringEngineFailed;
+    }
+    error_code = RingRegisterBufferRing(
+      &worker->ring_,  //
+      &worker->buffers_,
+      URING_BUFFERS_COUNT,
+      URING_BUFFER_SIZE,
+      kBufferGroupId
+    );
+    if (error_code == kBufferRingRegisterFailed)
+    {
+      return kUringEngineFailed;
+    }
+  }
+
+  for (unsigned i = 0; i < options->workers_count_; ++i)
+  {
+    int error_code = pthread_create(&workers[i].thread_, NULL, &UringWorkerFunction, workers + i);
+    if (error_code != kPthreadCreateSuccess)
+    {
+      errno = error_code;
+      return kUringEngineFailed;
+    }
+  }
+
+  LOG_DEBUG("RunUringEngine[2]: end rings initialization");
+
+  for (unsigned i = 0; i < options->workers_count_; ++i)
+  {
+    pthread_join(workers[i].thread_, NULL);
+  }
+  return 0;
+}
\ No newline at end of file
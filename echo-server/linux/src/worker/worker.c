@@ -0,0 +1,1648 @@
+#define _GNU_SOURCE
+
+#include <common/logger/logger.h>
+#include <common/memory/memory_budget.h>
+#include <common/metrics/metrics.h>
+#include <common/rate_limit/rate_limit.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sync_server/errors/errors.h>
+#include <sync_server/handoff/handoff.h>
+#include <sync_server/server/server.h>
+#include <sync_server/timer_wheel/timer_wheel.h>
+#include <sync_server/worker/worker.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MALLOC_FAILED NULL
+#define WORKER_MAX_EVENTS 256
+
+#ifndef EPIOCSPARAMS
+// Per instance busy polling of epoll (Linux 6.9+), missing from older headers.
+struct epoll_params
+{
+  uint32_t busy_poll_usecs;
+  uint16_t busy_poll_budget;
+  uint8_t prefer_busy_poll;
+  uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+
+const int kWorkerPoolStartFailed = -1;
+const int kDispatchFailed = -1;
+const int kPinWorkerFailed = -1;
+const int kEpollBusyPollFailed = -1;
+const size_t kDefaultByteQuota = 16;
+const size_t kUnlimitedByteQuota = 0;
+const uint64_t kDefaultIdleTimeout = 0;
+const uint64_t kDefaultLifetime = 3000;
+const size_t kNoFlushThreshold = 0;
+const size_t kNoWriteQuantum = 0;
+const size_t kDefaultStealThreshold = 2;
+const size_t kNoStealing = 0;
+const uint64_t kNoTimeout = 0;
+const uint64_t kTimerTickMilliseconds = 10;
+const uint64_t kNoMaxLoopLag = 0;
+const size_t kNoMaxQueueDepth = 0;
+const uint64_t kDefaultEvictIdle = 1000;
+
+static const int kNoPipe = -1;
+static const int kIoctlFailed = -1;
+static const int kTcpNoDelay = 1;
+static const size_t kSpliceThreshold = 16 * 1024;
+static const size_t kSpliceChunkSize = 64 * 1024;
+static const size_t kMinReadSize = 4096;
+static const int kInfiniteEpollTimeout = -1;
+static const int kPthreadCreateSuccess = 0;
+static const int kSchedGetaffinityFailed = -1;
+static const int kPthreadSetaffinitySuccess = 0;
+static const int kGetsockoptFailed = -1;
+static const int kGetpeernameFailed = -1;
+static const int kPthreadMutexInitSuccess = 0;
+static const unsigned kNoNapiId = 0;
+static const uint16_t kEpollBusyPollBudget = 64;
+static const uint32_t kRandomSeed = 2463534242U;
+static const uint64_t kMillisecondsPerSecond = 1000U;
+static const uint64_t kNanosecondsPerMillisecond = 1000000U;
+static const uint64_t kMicrosecondsPerMillisecond = 1000U;
+static const uint64_t kLoopLagWeight = 4;
+static const int kOverloadPollInterval = 10;
+static const uint64_t kDrainGraceMilliseconds = 100;
+
+/*
+ * Connection is owned by the worker that registered it in its epoll
+ * instance. Its idle and lifetime deadlines are armed in the worker
+ * timer wheel.
+ *
+ * Connections read into the buffer of the worker and echo the data
+ * right away, so they hold no buffer of their own: only the part of the
+ * echo the socket did not take is copied into a pending buffer reserved
+ * from the memory budget, which is freed once the socket drains it. The
+ * read size doubles while the reads fill it, up to the size of the worker
+ * buffer, and halves when they use less than a quarter of it or the
+ * socket is full.
+ *
+ * The connections of a worker are linked into its list, which is walked
+ * when the pool drains. When the overload action closes idle connections
+ * a connection moves to the front of the list whenever it makes progress,
+ * so the one at the back has been idle for the longest time.
+ *
+ * A connection over its rate limits stops watching its input, and its
+ * throttle timer turns the input back on once the token buckets allow the
+ * next read, so waiting costs nothing but a slot in the timer wheel. The
+ * peer buckets are shared with the other connections from its address;
+ * the booked bytes are the next read booked in them while it waits.
+ * The deficit is what is left of the write quantum for its turn.
+ *
+ * In zero-copy mode large reads are spliced from the socket into the
+ * connection pipe and from the pipe back into the socket, so the echoed
+ * data never crosses into user space. The pipe is created on the first
+ * such read.
+ */
+struct Connection
+{
+  struct Connection* prev_;
+  struct Connection* next_;
+  int fd_;
+  int pipe_[2];
+  unsigned char* pending_;
+  size_t pending_begin_;
+  size_t pending_end_;
+  size_t read_size_;
+  size_t piped_bytes_;
+  size_t processed_bytes_;
+  size_t deficit_;
+  uint64_t accepted_at_;
+  uint64_t active_at_;
+  struct TokenBuckets buckets_;
+  struct PeerBuckets* peer_buckets_;
+  size_t peer_booked_bytes_;
+  struct Timer idle_timer_;
+  struct Timer lifetime_timer_;
+  struct Timer throttle_timer_;
+};
+
+enum ConnectionTimer
+{
+  kIdleTimer,
+  kLifetimeTimer,
+  kThrottleTimer
+};
+
+struct WorkerContext
+{
+  struct Worker* worker_;
+  struct TimerWheel* timers_;
+};
+
+uint64_t GetTimerTick(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t) now.tv_sec * kMillisecondsPerSecond + (uint64_t) now.tv_nsec / kNanosecondsPerMillisecond) /
+         kTimerTickMilliseconds;
+}
+
+uint64_t MillisecondsToTicks(
+  uint64_t milliseconds
+)
+{
+  return (milliseconds + kTimerTickMilliseconds - 1) / kTimerTickMilliseconds;
+}
+
+unsigned GetDefaultWorkersCount(void)
+{
+  cpu_set_t cpus;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpus) == kSchedGetaffinityFailed || CPU_COUNT(&cpus) == 0)
+  {
+    long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return online_cpus > 0 ? (unsigned) online_cpus : 1U;
+  }
+  return (unsigned) CPU_COUNT(&cpus);
+}
+
+int PinWorkerThread(
+  unsigned id
+)
+{
+  cpu_set_t cpus;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpus) == kSchedGetaffinityFailed || CPU_COUNT(&cpus) == 0)
+  {
+    return kPinWorkerFailed;
+  }
+  // The id-th CPU of the affinity set, workers beyond its size wrap around.
+  unsigned skipped_cpus = id % (unsigned) CPU_COUNT(&cpus);
+  int cpu = 0;
+  for (; cpu < CPU_SETSIZE; ++cpu)
+  {
+    if (CPU_ISSET(cpu, &cpus) && skipped_cpus-- == 0)
+    {
+      break;
+    }
+  }
+  cpu_set_t worker_cpu;
+  CPU_ZERO(&worker_cpu);
+  CPU_SET(cpu, &worker_cpu);
+  int error_code = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &worker_cpu);
+  if (error_code != kPthreadSetaffinitySuccess)
+  {
+    errno = error_code;
+    return kPinWorkerFailed;
+  }
+  return 0;
+}
+
+int EnableEpollBusyPoll(
+  int epfd,  //
+  uint32_t busy_poll_us
+)
+{
+  struct epoll_params params;
+  memset(&params, 0, sizeof(params));
+  params.busy_poll_usecs = busy_poll_us;
+  params.busy_poll_budget = kEpollBusyPollBudget;
+  params.prefer_busy_poll = 1;
+  return ioctl(epfd, EPIOCSPARAMS, &params) == kIoctlFailed ? kEpollBusyPollFailed : 0;
+}
+
+/*
+ * Leaves the connection out of the load the pool balances the handoffs by.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static void UnassignConnection(
+  struct Worker* worker
+)  // clang-format on
+{
+  atomic_fetch_sub_explicit(&worker->connections_, 1, memory_order_relaxed);
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void LinkConnection(
+  struct Worker* worker,  //
+  struct Connection* connection
+)  // clang-format on
+{
+  connection->prev_ = NULL;
+  connection->next_ = worker->first_connection_;
+  if (worker->first_connection_ != NULL)
+  {
+    worker->first_connection_->prev_ = connection;
+  }
+  else
+  {
+    worker->last_connection_ = connection;
+  }
+  worker->first_connection_ = connection;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void UnlinkConnection(
+  struct Worker* worker,  //
+  struct Connection* connection
+)  // clang-format on
+{
+  if (connection->prev_ != NULL)
+  {
+    connection->prev_->next_ = connection->next_;
+  }
+  else
+  {
+    worker->first_connection_ = connection->next_;
+  }
+  if (connection->next_ != NULL)
+  {
+    connection->next_->prev_ = connection->prev_;
+  }
+  else
+  {
+    worker->last_connection_ = connection->prev_;
+  }
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static bool IsAdmissionControlled(
+  const struct WorkerOptions* options
+)  // clang-format on
+{
+  return options->max_loop_lag_ms_ != kNoMaxLoopLag || options->max_queue_depth_ != kNoMaxQueueDepth;
+}
+
+/*
+ * Safe to call from any thread. A sleeping worker is waiting for events,
+ * so whatever lag it had is gone.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static bool IsWorkerOverloaded(
+  struct Worker* worker
+)  // clang-format on
+{
+  const struct WorkerOptions* options = &worker->options_;
+  if (options->max_queue_depth_ != kNoMaxQueueDepth && HandoffQueueSize(&worker->handoffs_) >= options->max_queue_depth_)
+  {
+    return true;
+  }
+  return options->max_loop_lag_ms_ != kNoMaxLoopLag && !atomic_load_explicit(&worker->sleeping_, memory_order_relaxed) &&
+         atomic_load_explicit(&worker->loop_lag_us_, memory_order_relaxed) >=
+           options->max_loop_lag_ms_ * kMicrosecondsPerMillisecond;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static bool EvictsIdleConnections(
+  const struct WorkerOptions* options
+)  // clang-format on
+{
+  return options->overload_action_ == kOverloadCloseIdle && IsAdmissionControlled(options);
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2, 3)))
+static void TouchConnection(
+  struct Worker* worker,  //
+  struct TimerWheel* timers,
+  struct Connection* connection
+)  // clang-format on
+{
+  if (EvictsIdleConnections(&worker->options_))
+  {
+    connection->active_at_ = GetTimerTick();
+    if (connection != worker->first_connection_)
+    {
+      UnlinkConnection(worker, connection);
+      LinkConnection(worker, connection);
+    }
+  }
+  if (worker->options_.idle_timeout_ms_ != kNoTimeout)
+  {
+    TimerWheelSchedule(
+      timers,  //
+      &connection->idle_timer_,
+      GetTimerTick() + MillisecondsToTicks(worker->options_.idle_timeout_ms_)
+    );
+  }
+}
+
+/*
+ * Frees the pending buffer once the socket took all of it.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void ReleasePending(
+  const struct Worker* worker,  //
+  struct Connection* connection
+)  // clang-format on
+{
+  if (connection->pending_ != NULL && connection->pending_ != worker->buffer_)
+  {
+    ReleaseMemory(connection->pending_end_);
+    free(connection->pending_);
+  }
+  connection->pending_ = NULL;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2, 3)))
+static void CloseConnection(
+  struct Worker* worker,  //
+  struct TimerWheel* timers,
+  struct Connection* connection
+)  // clang-format on
+{
+  UnlinkConnection(worker, connection);
+  UnassignConnection(worker);
+  ReleasePending(worker, connection);
+  TimerWheelCancel(timers, &connection->idle_timer_);
+  TimerWheelCancel(timers, &connection->lifetime_timer_);
+  TimerWheelCancel(timers, &connection->throttle_timer_);
+  if (connection->peer_buckets_ != NULL)
+  {
+    if (connection->peer_booked_bytes_ != 0)
+    {
+      SettlePeerBuckets(
+        connection->peer_buckets_,  //
+        &worker->options_.peer_rate_limits_,
+        connection->peer_booked_bytes_,
+        1,
+        0,
+        0,
+        GetRateLimitClock()
+      );
+    }
+    ReleasePeerBuckets(connection->peer_buckets_);
+  }
+  AddMetric(kMetricClosedConnections, 1);
+  RecordMetric(kMetricConnectionDuration, GetMetricsTimestamp() - connection->accepted_at_);
+  shutdown(connection->fd_, SHUT_RDWR);
+  close(connection->fd_);
+  if (connection->pipe_[0] != kNoPipe)
+  {
+    close(connection->pipe_[0]);
+    close(connection->pipe_[1]);
+  }
+  free(connection);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static int ComputeEpollTimeout(
+  const struct TimerWheel* timers
+)  // clang-format on
+{
+  uint64_t next_tick = TimerWheelNextTick(timers);
+  if (next_tick == kTimerWheelIdle)
+  {
+    return kInfiniteEpollTimeout;
+  }
+
+  uint64_t now = GetTimerTick();
+  if (next_tick <= now)
+  {
+    return 0;
+  }
+  return (int) ((next_tick - now) * kTimerTickMilliseconds);
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static bool WatchConnection(
+  const struct Worker* worker,  //
+  struct Connection* connection,
+  uint32_t events
+)  // clang-format on
+{
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.ptr = connection;
+  return epoll_ctl(worker->epfd_, EPOLL_CTL_MOD, connection->fd_, &ev) != kEpollCtlFailed;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void ExpireConnection(
+  struct Timer* timer,  //
+  void* context
+)  // clang-format on
+{
+  struct WorkerContext* worker_context = (struct WorkerContext*) context;
+  struct Connection* connection;
+  if (timer->tag_ == kThrottleTimer)
+  {
+    connection = (struct Connection*) ((unsigned char*) timer - offsetof(struct Connection, throttle_timer_));
+    if (!WatchConnection(worker_context->worker_, connection, EPOLLIN | EPOLLRDHUP))
+    {
+      CloseConnection(worker_context->worker_, worker_context->timers_, connection);
+    }
+    return;
+  }
+  if (timer->tag_ == kIdleTimer)
+  {
+    connection = (struct Connection*) ((unsigned char*) timer - offsetof(struct Connection, idle_timer_));
+  }
+  else
+  {
+    connection = (struct Connection*) ((unsigned char*) timer - offsetof(struct Connection, lifetime_timer_));
+  }
+
+  LOG_WARNING(
+    timer->tag_ == kIdleTimer ? "[MESSAGE] Connection idle time expired for: %d"  //
+                              : "[MESSAGE] Connection time expired for: %d",
+    connection->fd_
+  );
+  AddMetric(kMetricExpiredConnections, 1);
+  CloseConnection(worker_context->worker_, worker_context->timers_, connection);
+}
+
+/*
+ * Closes the connection that has made no progress for the longest time
+ * if that is at least the evict idle time. Returns false if there is no
+ * such connection.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static bool EvictIdleConnection(
+  struct Worker* worker,  //
+  struct TimerWheel* timers
+)  // clang-format on
+{
+  struct Connection* connection = worker->last_connection_;
+  if (connection == NULL ||
+      GetTimerTick() - connection->active_at_ < MillisecondsToTicks(worker->options_.evict_idle_ms_))
+  {
+    return false;
+  }
+  LOG_INFO("[MESSAGE] Connection evicted to admit a new one: %d", connection->fd_);
+  AddMetric(kMetricEvictedConnections, 1);
+  CloseConnection(worker, timers, connection);
+  return true;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void RegisterConnection(
+  struct Worker* worker,  //
+  struct TimerWheel* timers,
+  int clientfd
+)  // clang-format on
+{
+  if (IsMemoryBudgetExhausted())
+  {
+    AddMetric(kMetricShedConnections, 1);
+    AddMetric(kMetricClosedConnections, 1);
+    UnassignConnection(worker);
+    close(clientfd);
+    return;
+  }
+  if (EvictsIdleConnections(&worker->options_) && IsWorkerOverloaded(worker) && !EvictIdleConnection(worker, timers))
+  {
+    UnassignConnection(worker);
+    RejectClient(clientfd);
+    return;
+  }
+
+  struct Connection* connection = malloc(sizeof(struct Connection));
+  if (connection == MALLOC_FAILED)
+  {
+    LOG_WARNING(
+      "Worker received error: malloc failed: [%d](%s)",  //
+      errno,
+      strerror(errno)
+    );
+    AddMetric(kMetricClosedConnections, 1);
+    UnassignConnection(worker);
+    close(clientfd);
+    return;
+  }
+  connection->fd_ = clientfd;
+  connection->pipe_[0] = connection->pipe_[1] = kNoPipe;
+  connection->pending_ = NULL;
+  connection->pending_begin_ = 0;
+  connection->pending_end_ = 0;
+  connection->read_size_ = kMinReadSize;
+  connection->piped_bytes_ = 0;
+  connection->processed_bytes_ = 0;
+  connection->deficit_ = 0;
+  connection->accepted_at_ = GetMetricsTimestamp();
+  connection->active_at_ = 0;
+  InitializeTokenBuckets(&connection->buckets_);
+  connection->peer_buckets_ = NULL;
+  connection->peer_booked_bytes_ = 0;
+  TimerInitialize(&connection->idle_timer_, kIdleTimer);
+  TimerInitialize(&connection->lifetime_timer_, kLifetimeTimer);
+  TimerInitialize(&connection->throttle_timer_, kThrottleTimer);
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN | EPOLLRDHUP;
+  ev.data.ptr = connection;
+  int error_code = epoll_ctl(worker->epfd_, EPOLL_CTL_ADD, clientfd, &ev);
+  if (error_code == kEpollCtlFailed)
+  {
+    LOG_WARNING(
+      "Worker received error: epoll_ctl failed: [%d](%s)",  //
+      errno,
+      strerror(errno)
+    );
+    AddMetric(kMetricClosedConnections, 1);
+    UnassignConnection(worker);
+    close(clientfd);
+    free(connection);
+    return;
+  }
+  LinkConnection(worker, connection);
+
+  struct sockaddr_in peer;
+  socklen_t peer_size = sizeof(peer);
+  if (IsRateLimited(&worker->options_.peer_rate_limits_) &&
+      getpeername(clientfd, (struct sockaddr*) &peer, &peer_size) != kGetpeernameFailed)
+  {
+    connection->peer_buckets_ = AcquirePeerBuckets(peer.sin_addr.s_addr);
+    if (IsOverflowPeerBuckets(connection->peer_buckets_))
+    {
+      AddMetric(kMetricOverflowPeerConnections, 1);
+    }
+  }
+  TouchConnection(worker, timers, connection);
+  if (worker->options_.lifetime_ms_ != kNoTimeout)
+  {
+    TimerWheelSchedule(
+      timers,  //
+      &connection->lifetime_timer_,
+      GetTimerTick() + MillisecondsToTicks(worker->options_.lifetime_ms_)
+    );
+  }
+}
+
+/*
+ * The leader accepts the connections with accept4, so the handed off
+ * sockets are already nonblocking.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void AcceptHandoffs(
+  struct Worker* worker,  //
+  struct TimerWheel* timers
+)  // clang-format on
+{
+  HandoffQueueAcknowledge(&worker->handoffs_);
+  int clientfd;
+  while (HandoffQueuePop(&worker->handoffs_, &clientfd))
+  {
+    RegisterConnection(worker, timers, clientfd);
+  }
+}
+
+/*
+ * Takes over half of the connections waiting for every other worker that
+ * has at least steal threshold of them queued. The connections have not
+ * been registered by their worker yet, so they move with nothing but the
+ * descriptor.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void StealHandoffs(
+  struct Worker* worker,  //
+  struct TimerWheel* timers
+)  // clang-format on
+{
+  struct WorkerPool* pool = worker->pool_;
+  for (unsigned i = 1; i < pool->workers_count_; ++i)
+  {
+    struct Worker* victim = pool->workers_ + (worker->id_ + i) % pool->workers_count_;
+    size_t queued_connections = HandoffQueueSize(&victim->handoffs_);
+    if (queued_connections < worker->options_.steal_threshold_)
+    {
+      continue;
+    }
+    int clientfd;
+    for (size_t j = 0; j < (queued_connections + 1) / 2 && HandoffQueuePop(&victim->handoffs_, &clientfd); ++j)
+    {
+      UnassignConnection(victim);
+      atomic_fetch_add_explicit(&worker->connections_, 1, memory_order_relaxed);
+      AddMetric(kMetricStolenConnections, 1);
+      RegisterConnection(worker, timers, clientfd);
+    }
+  }
+}
+
+// clang-format off
+__attribute__((nonnull(2, 3)))
+static void RegisterAcceptedClient(
+  int clientfd,  //
+  const struct sockaddr_in* peer,
+  void* context
+)  // clang-format on
+{
+  (void) peer;
+  struct WorkerContext* worker_context = (struct WorkerContext*) context;
+  if (worker_context->worker_->options_.overload_action_ == kOverloadReject && IsWorkerOverloaded(worker_context->worker_))
+  {
+    RejectClient(clientfd);
+    return;
+  }
+  atomic_fetch_add_explicit(&worker_context->worker_->connections_, 1, memory_order_relaxed);
+  RegisterConnection(worker_context->worker_, worker_context->timers_, clientfd);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static int* GetListener(
+  struct Worker* worker,  //
+  void* data
+)  // clang-format on
+{
+  int* listener = (int*) data;
+  if (!worker->listening_ || listener < worker->server_.sockets_ ||
+      listener >= worker->server_.sockets_ + worker->server_.sockets_count_)
+  {
+    return NULL;
+  }
+  return listener;
+}
+
+/*
+ * Moves the part of the echo the socket did not take out of the worker
+ * buffer. Fails if it does not fit into the memory budget.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static bool RetainPending(
+  const struct Worker* worker,  //
+  struct Connection* connection
+)  // clang-format on
+{
+  connection->read_size_ = kMinReadSize;
+  if (connection->pending_ != worker->buffer_)
+  {
+    return true;
+  }
+
+  size_t pending_bytes = connection->pending_end_ - connection->pending_begin_;
+  if (!ReserveMemory(pending_bytes))
+  {
+    AddMetric(kMetricShedConnections, 1);
+    return false;
+  }
+  unsigned char* pending = malloc(pending_bytes);
+  if (pending == MALLOC_FAILED)
+  {
+    ReleaseMemory(pending_bytes);
+    return false;
+  }
+  memcpy(pending, connection->pending_ + connection->pending_begin_, pending_bytes);
+  connection->pending_ = pending;
+  connection->pending_begin_ = 0;
+  connection->pending_end_ = pending_bytes;
+  return true;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static bool FlushConnection(
+  struct Worker* worker,  //
+  struct Connection* connection,
+  bool more
+)  // clang-format on
+{
+  while (connection->pending_begin_ != connection->pending_end_ || connection->piped_bytes_ != 0)
+  {
+    ssize_t bytes;
+    if (connection->pending_begin_ != connection->pending_end_)
+    {
+      bytes = send(
+        connection->fd_,  //
+        connection->pending_ + connection->pending_begin_,
+        connection->pending_end_ - connection->pending_begin_,
+        MSG_NOSIGNAL | (more ? MSG_MORE : 0)
+      );
+    }
+    else
+    {
+      bytes = splice(
+        connection->pipe_[0],  //
+        NULL,
+        connection->fd_,
+        NULL,
+        connection->piped_bytes_,
+        SPLICE_F_MOVE | SPLICE_F_NONBLOCK | (more ? SPLICE_F_MORE : 0)
+      );
+    }
+    if (bytes == kWriteFailed)
+    {
+      if (errno != EAGAIN || !RetainPending(worker, connection))
+      {
+        return false;
+      }
+      return WatchConnection(worker, connection, EPOLLOUT | EPOLLRDHUP);
+    }
+    AddMetric(kMetricSentBytes, (uint64_t) bytes);
+    if (connection->pending_begin_ != connection->pending_end_)
+    {
+      connection->pending_begin_ += (size_t) bytes;
+    }
+    else
+    {
+      connection->piped_bytes_ -= (size_t) bytes;
+    }
+  }
+
+  ReleasePending(worker, connection);
+  connection->pending_begin_ = connection->pending_end_ = 0;
+  return true;
+}
+
+/*
+ * Sends the tail held back by the last MSG_MORE send: enabling
+ * TCP_NODELAY pushes the pending segments out.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static void PushConnection(
+  const struct Connection* connection
+)  // clang-format on
+{
+  setsockopt(connection->fd_, IPPROTO_TCP, TCP_NODELAY, &kTcpNoDelay, sizeof(int));
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static size_t GetReadLimit(
+  const struct Worker* worker,  //
+  const struct Connection* connection,
+  size_t capacity
+)  // clang-format on
+{
+  size_t byte_quota = worker->options_.byte_quota_;
+  if (byte_quota != kUnlimitedByteQuota)
+  {
+    // A quota lowered by a reload may already be exceeded, the connection gets no more input.
+    size_t quota_left = connection->processed_bytes_ < byte_quota ? byte_quota - connection->processed_bytes_ : 0;
+    capacity = quota_left < capacity ? quota_left : capacity;
+  }
+  if (worker->options_.write_quantum_ != kNoWriteQuantum && connection->deficit_ < capacity)
+  {
+    capacity = connection->deficit_;
+  }
+  if (connection->peer_booked_bytes_ != 0 && connection->peer_booked_bytes_ < capacity)
+  {
+    capacity = connection->peer_booked_bytes_;
+  }
+  return capacity;
+}
+
+/*
+ * Returns the nanoseconds the connection has to wait before its token
+ * buckets and the ones of its peer allow a read of read_limit bytes. If
+ * the peer buckets are in debt the read is booked in them, and once the
+ * booking is due the peer buckets are not looked at again.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static uint64_t CheckRateLimits(
+  const struct Worker* worker,  //
+  struct Connection* connection,
+  size_t read_limit
+)  // clang-format on
+{
+  if (!IsRateLimited(&worker->options_.rate_limits_) && connection->peer_buckets_ == NULL)
+  {
+    return 0;
+  }
+  uint64_t now = GetRateLimitClock();
+  uint64_t delay = GetTokenBucketsDelay(&connection->buckets_, &worker->options_.rate_limits_, now);
+  if (delay != 0 || connection->peer_buckets_ == NULL || connection->peer_booked_bytes_ != 0)
+  {
+    return delay;
+  }
+  const struct RateLimits* peer_limits = &worker->options_.peer_rate_limits_;
+  if (GetPeerBucketsDelay(connection->peer_buckets_, peer_limits, now) == 0)
+  {
+    return 0;
+  }
+  connection->peer_booked_bytes_ = read_limit;
+  return BookPeerBuckets(connection->peer_buckets_, peer_limits, read_limit, 1, now);
+}
+
+/*
+ * Charges the read to the token buckets, the echo is unframed so every
+ * read counts as one message.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static void ChargeConnection(
+  const struct Worker* worker,  //
+  struct Connection* connection,
+  size_t bytes
+)  // clang-format on
+{
+  if (!IsRateLimited(&worker->options_.rate_limits_) && connection->peer_buckets_ == NULL)
+  {
+    return;
+  }
+  uint64_t now = GetRateLimitClock();
+  ChargeTokenBuckets(&connection->buckets_, &worker->options_.rate_limits_, bytes, 1, now);
+  if (connection->peer_buckets_ == NULL)
+  {
+    return;
+  }
+  if (connection->peer_booked_bytes_ != 0)
+  {
+    SettlePeerBuckets(
+      connection->peer_buckets_,  //
+      &worker->options_.peer_rate_limits_,
+      connection->peer_booked_bytes_,
+      1,
+      bytes,
+      1,
+      now
+    );
+    connection->peer_booked_bytes_ = 0;
+  }
+  else
+  {
+    ChargePeerBuckets(connection->peer_buckets_, &worker->options_.peer_rate_limits_, bytes, 1, now);
+  }
+}
+
+/*
+ * Stops watching the input of the connection until the buckets allow the
+ * next read; hang-ups and errors are still reported. The throttle timer
+ * turns the input back on.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2, 3)))
+static bool ThrottleConnection(
+  struct Worker* worker,  //
+  struct TimerWheel* timers,
+  struct Connection* connection,
+  uint64_t delay_ns
+)  // clang-format on
+{
+  if (!WatchConnection(worker, connection, 0))
+  {
+    return false;
+  }
+  AddMetric(kMetricThrottledReads, 1);
+  TimerWheelSchedule(
+    timers,  //
+    &connection->throttle_timer_,
+    GetTimerTick() + MillisecondsToTicks((delay_ns + kNanosecondsPerMillisecond - 1) / kNanosecondsPerMillisecond)
+  );
+  return true;
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void AdaptReadSize(
+  struct Connection* connection,  //
+  size_t bytes
+)  // clang-format on
+{
+  if (bytes == connection->read_size_ && connection->read_size_ < WORKER_BUFFER_SIZE)
+  {
+    connection->read_size_ *= 2;
+  }
+  else if (bytes < connection->read_size_ / 4 && connection->read_size_ > kMinReadSize)
+  {
+    connection->read_size_ /= 2;
+  }
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static bool ShouldSplice(
+  const struct Worker* worker,  //
+  struct Connection* connection
+)  // clang-format on
+{
+  if (!worker->options_.zero_copy_)
+  {
+    return false;
+  }
+
+  // Small reads are cheaper to copy than to move through the pipe with two splices.
+  int available_bytes;
+  if (ioctl(connection->fd_, FIONREAD, &available_bytes) == kIoctlFailed ||
+      (size_t) available_bytes < kSpliceThreshold)
+  {
+    return false;
+  }
+  if (connection->pipe_[0] == kNoPipe && pipe2(connection->pipe_, O_NONBLOCK | O_CLOEXEC) == kPipeFailed)
+  {
+    connection->pipe_[0] = connection->pipe_[1] = kNoPipe;
+    return false;
+  }
+  return true;
+}
+
+// clang-format off
+__attribute__((nonnull(1, 2, 3)))
+static void HandleConnection(
+  struct Worker* worker,  //
+  struct TimerWheel* timers,
+  struct Connection* connection,
+  uint32_t events
+)  // clang-format on
+{
+  if (events & EPOLLOUT)
+  {
+    if (!FlushConnection(worker, connection, false))
+    {
+      CloseConnection(worker, timers, connection);
+      return;
+    }
+    TouchConnection(worker, timers, connection);
+    if (connection->pending_begin_ != connection->pending_end_ || connection->piped_bytes_ != 0)
+    {
+      return;
+    }
+    if (!WatchConnection(worker, connection, EPOLLIN | EPOLLRDHUP))
+    {
+      CloseConnection(worker, timers, connection);
+      return;
+    }
+  }
+  else if (events & EPOLLIN)
+  {
+    size_t round_bytes = 0;
+    bool more;
+    size_t write_quantum = worker->options_.write_quantum_;
+    if (write_quantum != kNoWriteQuantum)
+    {
+      // The deficit left by the turns cut short by a full socket or the rate limits is kept up to one quantum.
+      connection->deficit_ =
+        (connection->deficit_ < write_quantum ? connection->deficit_ : write_quantum) + write_quantum;
+    }
+    do
+    {
+      bool spliced = ShouldSplice(worker, connection);
+      size_t read_limit = GetReadLimit(worker, connection, spliced ? kSpliceChunkSize : connection->read_size_);
+      if (read_limit == 0)
+      {
+        // Only the byte quota leaves nothing to read at the start of a round, the connection is closed below.
+        break;
+      }
+      uint64_t delay_ns = CheckRateLimits(worker, connection, read_limit);
+      if (delay_ns != 0)
+      {
+        if (round_bytes != 0)
+        {
+          PushConnection(connection);
+        }
+        if (!ThrottleConnection(worker, timers, connection, delay_ns))
+        {
+          CloseConnection(worker, timers, connection);
+        }
+        return;
+      }
+      ssize_t bytes;
+      if (spliced)
+      {
+        bytes = splice(
+          connection->fd_,  //
+          NULL,
+          connection->pipe_[1],
+          NULL,
+          read_limit,
+          SPLICE_F_MOVE | SPLICE_F_NONBLOCK
+        );
+      }
+      else
+      {
+        bytes = read(connection->fd_, worker->buffer_, read_limit);
+      }
+      if (bytes == kReadFailed && errno == EAGAIN)
+      {
+        connection->deficit_ = 0;
+        if (round_bytes != 0)
+        {
+          PushConnection(connection);
+        }
+        return;
+      }
+      if (bytes == kReadFailed || bytes == 0)
+      {
+        CloseConnection(worker, timers, connection);
+        return;
+      }
+
+      connection->processed_bytes_ += (size_t) bytes;
+      round_bytes += (size_t) bytes;
+      if (write_quantum != kNoWriteQuantum)
+      {
+        // A read short of its limit drained the socket: like a flow whose queue ran empty in deficit round robin,
+        // the connection does not keep the rest of its deficit.
+        connection->deficit_ = (size_t) bytes < read_limit ? 0 : connection->deficit_ - (size_t) bytes;
+      }
+      ChargeConnection(worker, connection, (size_t) bytes);
+      AddMetric(kMetricReceivedBytes, (uint64_t) bytes);
+      RecordMetric(kMetricReadSize, (uint64_t) bytes);
+      TouchConnection(worker, timers, connection);
+      if (spliced)
+      {
+        connection->piped_bytes_ = (size_t) bytes;
+      }
+      else
+      {
+        connection->pending_ = worker->buffer_;
+        connection->pending_end_ = (size_t) bytes;
+        AdaptReadSize(connection, (size_t) bytes);
+      }
+      // A read that filled its limit most likely left more input in the socket: the chunk is sent with MSG_MORE,
+      // so its tail is merged with the next chunk instead of going out as a short segment.
+      // With a write quantum the deficit bounds the round instead of the flush threshold.
+      more = (size_t) bytes == read_limit &&
+             (write_quantum != kNoWriteQuantum || round_bytes < worker->options_.flush_threshold_) &&
+             GetReadLimit(worker, connection, 1) != 0;
+      if (!FlushConnection(worker, connection, more))
+      {
+        CloseConnection(worker, timers, connection);
+        return;
+      }
+      if (connection->pending_begin_ != connection->pending_end_ || connection->piped_bytes_ != 0)
+      {
+        return;
+      }
+    } while (more);
+  }
+  else if (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+  {
+    CloseConnection(worker, timers, connection);
+    return;
+  }
+
+  size_t byte_quota = worker->options_.byte_quota_;
+  if (byte_quota != kUnlimitedByteQuota && connection->processed_bytes_ >= byte_quota)
+  {
+    LOG_INFO(
+      "Worker: client qouta exceded. [%zu] bytes processed.",  //
+      byte_quota
+    );
+    CloseConnection(worker, timers, connection);
+  }
+}
+
+/*
+ * Closes the listening sockets of the worker and the connections that
+ * have no echo data waiting for the socket nor input waiting to be read.
+ * The others are left to finish their echo and are closed by a later
+ * pass, the worker wakes up for them anyway.
+ *
+ * The connections queued on a SO_REUSEPORT listener would be reset when
+ * it closes, so they are accepted first. A connection accepted less than
+ * kDrainGraceMilliseconds ago that has not sent anything yet is given
+ * the grace period to send its request before it counts as idle. Returns
+ * true while such connections are left, the worker has to wake up to
+ * close them.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static bool DrainWorker(
+  struct WorkerContext* worker_context
+)  // clang-format on
+{
+  struct Worker* worker = worker_context->worker_;
+  struct TimerWheel* timers = worker_context->timers_;
+  if (worker->listening_)
+  {
+    for (int i = 0; i < worker->server_.sockets_count_; ++i)
+    {
+      AcceptClients(&worker->server_, worker->server_.sockets_[i], &RegisterAcceptedClient, worker_context);
+      close(worker->server_.sockets_[i]);
+    }
+    worker->listening_ = false;
+    worker->accept_paused_ = false;
+  }
+
+  bool in_grace = false;
+  uint64_t grace_start = GetMetricsTimestamp() - kDrainGraceMilliseconds * kMicrosecondsPerMillisecond;
+  struct Connection* connection = worker->first_connection_;
+  while (connection != NULL)
+  {
+    struct Connection* next = connection->next_;
+    int available_bytes;
+    if (connection->pending_begin_ == connection->pending_end_ && connection->piped_bytes_ == 0 &&
+        ioctl(connection->fd_, FIONREAD, &available_bytes) != kIoctlFailed && available_bytes == 0)
+    {
+      if (connection->processed_bytes_ == 0 && connection->accepted_at_ > grace_start)
+      {
+        in_grace = true;
+      }
+      else
+      {
+        CloseConnection(worker, timers, connection);
+      }
+    }
+    connection = next;
+  }
+  return in_grace;
+}
+
+/*
+ * Number of accepted connections handed off to the worker but not yet
+ * registered in its epoll instance.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static uint64_t GetWorkerQueueDepth(
+  void* context
+)  // clang-format on
+{
+  return HandoffQueueSize(&((struct Worker*) context)->handoffs_);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static uint64_t GetWorkerConnections(
+  void* context
+)  // clang-format on
+{
+  return atomic_load_explicit(&((struct Worker*) context)->connections_, memory_order_relaxed);
+}
+
+/*
+ * Turns the events of the listening sockets off or back on; the
+ * connections keep queueing in their accept queues meanwhile.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static void PauseListeners(
+  struct Worker* worker,  //
+  bool paused
+)  // clang-format on
+{
+  for (int i = 0; i < worker->server_.sockets_count_; ++i)
+  {
+    struct epoll_event ev;
+    ev.events = paused ? 0 : EPOLLIN;
+    ev.data.ptr = worker->server_.sockets_ + i;
+    if (epoll_ctl(worker->epfd_, EPOLL_CTL_MOD, worker->server_.sockets_[i], &ev) == kEpollCtlFailed)
+    {
+      LOG_WARNING("Worker received error: epoll_ctl failed: [%d](%s)", errno, strerror(errno));
+    }
+  }
+  worker->accept_paused_ = paused;
+  if (paused)
+  {
+    AddMetric(kMetricAcceptPauses, 1);
+  }
+}
+
+/*
+ * The lag of a round is how long an event that arrived right after
+ * epoll_wait returned waited for the worker to look at it. A worker that
+ * waited for events for longer than its lag has caught up, so the lag of
+ * its earlier rounds does not count anymore.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static void UpdateLoopLag(
+  struct Worker* worker,  //
+  uint64_t round_us,
+  uint64_t waited_us
+)  // clang-format on
+{
+  RecordMetric(kMetricLoopLag, round_us);
+  uint64_t loop_lag_us = atomic_load_explicit(&worker->loop_lag_us_, memory_order_relaxed);
+  if (waited_us >= loop_lag_us)
+  {
+    loop_lag_us = 0;
+  }
+  loop_lag_us = loop_lag_us - loop_lag_us / kLoopLagWeight + round_us / kLoopLagWeight;
+  atomic_store_explicit(&worker->loop_lag_us_, loop_lag_us, memory_order_relaxed);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void ReloadWorkerOptions(
+  struct Worker* worker
+)  // clang-format on
+{
+  struct WorkerPool* pool = worker->pool_;
+  pthread_mutex_lock(&pool->options_mutex_);
+  worker->options_.byte_quota_ = pool->options_.byte_quota_;
+  worker->options_.idle_timeout_ms_ = pool->options_.idle_timeout_ms_;
+  worker->options_.lifetime_ms_ = pool->options_.lifetime_ms_;
+  worker->options_.flush_threshold_ = pool->options_.flush_threshold_;
+  worker->options_.rate_limits_ = pool->options_.rate_limits_;
+  worker->options_.peer_rate_limits_ = pool->options_.peer_rate_limits_;
+  worker->options_.write_quantum_ = pool->options_.write_quantum_;
+  worker->options_generation_ = atomic_load_explicit(&pool->options_generation_, memory_order_relaxed);
+  pthread_mutex_unlock(&pool->options_mutex_);
+}
+
+// clang-format off
+__attribute__((nonnull(1)))
+static void* WorkerFunction(
+  void* arg
+)  // clang-format on
+{
+  struct Worker* worker = (struct Worker*) arg;
+  struct TimerWheel timers;
+  struct epoll_event ep_events[WORKER_MAX_EVENTS];
+  TimerWheelInitialize(&timers, GetTimerTick());
+  struct WorkerContext worker_context = {worker, &timers};
+
+  char thread_name[METRICS_THREAD_NAME_SIZE];
+  snprintf(thread_name, sizeof(thread_name), "worker-%u", worker->id_);
+  AttachMetrics(thread_name);
+  if (worker->options_.pin_workers_ && PinWorkerThread(worker->id_) == kPinWorkerFailed)
+  {
+    LOG_WARNING("Worker %u is not pinned: [%d](%s)", worker->id_, errno, strerror(errno));
+  }
+
+  uint64_t waiting_since = GetMetricsTimestamp();
+  bool drain_grace = false;
+  while (true)
+  {
+    int timeout = ComputeEpollTimeout(&timers);
+    if ((worker->accept_paused_ || drain_grace) &&
+        (timeout == kInfiniteEpollTimeout || timeout > kOverloadPollInterval))
+    {
+      // A paused worker has to wake up to see its lag drop even with nothing else to do, a draining one to see the
+      // grace of its new connections run out.
+      timeout = kOverloadPollInterval;
+    }
+    atomic_store_explicit(&worker->sleeping_, true, memory_order_relaxed);
+    int ready_events = epoll_wait(worker->epfd_, ep_events, WORKER_MAX_EVENTS, timeout);
+    atomic_store_explicit(&worker->sleeping_, false, memory_order_relaxed);
+    uint64_t woken_at = GetMetricsTimestamp();
+    if (ready_events == kEpollWaitFailed)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      LOG_FATAL(
+        "Worker received error: epoll failed: [%d](%s)",  //
+        errno,
+        strerror(errno)
+      );
+    }
+
+    for (int i = 0; i < ready_events; ++i)
+    {
+      int* listener = GetListener(worker, ep_events[i].data.ptr);
+      if (ep_events[i].data.ptr == NULL)
+      {
+        AcceptHandoffs(worker, &timers);
+        if (worker->options_.steal_threshold_ != kNoStealing)
+        {
+          StealHandoffs(worker, &timers);
+        }
+      }
+      else if (listener != NULL)
+      {
+        if (worker->options_.overload_action_ == kOverloadPause && IsWorkerOverloaded(worker))
+        {
+          PauseListeners(worker, true);
+          continue;
+        }
+        if (AcceptClients(&worker->server_, *listener, &RegisterAcceptedClient, &worker_context) == kAcceptExhausted)
+        {
+          PauseListeners(worker, true);
+        }
+      }
+      else
+      {
+        HandleConnection(worker, &timers, ep_events[i].data.ptr, ep_events[i].events);
+      }
+    }
+
+    TimerWheelAdvance(&timers, GetTimerTick(), &ExpireConnection, &worker_context);
+    if (atomic_load_explicit(&worker->pool_->options_generation_, memory_order_acquire) != worker->options_generation_)
+    {
+      ReloadWorkerOptions(worker);
+    }
+    if (atomic_load_explicit(&worker->pool_->draining_, memory_order_relaxed))
+    {
+      drain_grace = DrainWorker(&worker_context);
+    }
+    uint64_t round_end = GetMetricsTimestamp();
+    UpdateLoopLag(worker, round_end - woken_at, woken_at - waiting_since);
+    waiting_since = round_end;
+    if (worker->accept_paused_ && worker->listening_ && !IsWorkerOverloaded(worker) &&
+        RestoreServerReserve(&worker->server_))
+    {
+      PauseListeners(worker, false);
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Xorshift generator of the worker choices, only the dispatching thread
+ * advances it.
+ */
+// clang-format off
+__attribute__((nonnull(1)))
+static uint32_t NextRandom(
+  struct WorkerPool* pool
+)  // clang-format on
+{
+  uint32_t state = pool->random_state_;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  pool->random_state_ = state;
+  return state;
+}
+
+int StartWorkerPool(
+  struct WorkerPool* pool,  //
+  const struct WorkerOptions* options,
+  const struct ServerOptions* server_options
+)
+{
+  LOG_DEBUG("StartWorkerPool[1]: start workers initialization");
+
+  pool->workers_count_ = options->workers_count_;
+  pool->random_state_ = kRandomSeed;
+  atomic_init(&pool->draining_, false);
+  pool->options_ = *options;
+  atomic_init(&pool->options_generation_, 0);
+  if (pthread_mutex_init(&pool->options_mutex_, NULL) != kPthreadMutexInitSuccess)
+  {
+    return kWorkerPoolStartFailed;
+  }
+  pool->workers_ = aligned_alloc(_Alignof(struct Worker), options->workers_count_ * sizeof(struct Worker));
+  if (pool->workers_ == MALLOC_FAILED)
+  {
+    return kWorkerPoolStartFailed;
+  }
+
+  for (unsigned i = 0; i < pool->workers_count_; ++i)
+  {
+    struct Worker* worker = pool->workers_ + i;
+    worker->id_ = i;
+    worker->options_ = *options;
+    worker->pool_ = pool;
+    atomic_init(&worker->connections_, 0);
+    atomic_init(&worker->sleeping_, false);
+    atomic_init(&worker->loop_lag_us_, 0);
+    worker->accept_paused_ = false;
+    worker->first_connection_ = NULL;
+    worker->last_connection_ = NULL;
+    worker->options_generation_ = 0;
+    int error_code = HandoffQueueInitialize(&worker->handoffs_);
+    if (error_code == kHandoffQueueInitFailed)
+    {
+      return kWorkerPoolStartFailed;
+    }
+
+    char labels[32];
+    snprintf(labels, sizeof(labels), "worker=\"%u\"", i);
+    error_code = RegisterMetricGauge(
+      "echo_server_worker_queue_depth",  //
+      "Number of accepted connections waiting in the handoff queue of the worker.",
+      labels,
+      &GetWorkerQueueDepth,
+      worker
+    );
+    if (error_code == kMetricGaugeRegisterFailed)
+    {
+      LOG_WARNING("StartWorkerPool: queue depth gauge of worker %u is not registered", i);
+    }
+    error_code = RegisterMetricGauge(
+      "echo_server_worker_connections",  //
+      "Number of connections handed off to or accepted by the worker and not closed yet.",
+      labels,
+      &GetWorkerConnections,
+      worker
+    );
+    if (error_code == kMetricGaugeRegisterFailed)
+    {
+      LOG_WARNING("StartWorkerPool: connections gauge of worker %u is not registered", i);
+    }
+
+    worker->epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (worker->epfd_ == kEpollCreateFailed)
+    {
+      return kWorkerPoolStartFailed;
+    }
+    if (options->busy_poll_us_ != kNoBusyPoll &&
+        EnableEpollBusyPoll(worker->epfd_, options->busy_poll_us_) == kEpollBusyPollFailed)
+    {
+      // Older kernels only busy poll epoll with the net.core.busy_poll sysctl.
+      LOG_WARNING(
+        "StartWorkerPool: epoll busy polling of worker %u is not enabled: [%d](%s)",  //
+        i,
+        errno,
+        strerror(errno)
+      );
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    error_code = epoll_ctl(worker->epfd_, EPOLL_CTL_ADD, worker->handoffs_.eventfd_, &ev);
+    if (error_code == kEpollCtlFailed)
+    {
+      return kWorkerPoolStartFailed;
+    }
+
+    worker->listening_ = server_options != NULL;
+    if (worker->listening_)
+    {
+      error_code = InitializeServerSockets(&worker->server_, server_options);
+      if (error_code == kServerSocketInitFailed)
+      {
+        return kWorkerPoolStartFailed;
+      }
+      for (int j = 0; j < worker->server_.sockets_count_; ++j)
+      {
+        ev.events = EPOLLIN;
+        ev.data.ptr = worker->server_.sockets_ + j;
+        error_code = epoll_ctl(worker->epfd_, EPOLL_CTL_ADD, worker->server_.sockets_[j], &ev);
+        if (error_code == kEpollCtlFailed)
+        {
+          return kWorkerPoolStartFailed;
+        }
+      }
+    }
+
+    error_code = pthread_create(&worker->thread_, NULL, &WorkerFunction, worker);
+    if (error_code != kPthreadCreateSuccess)
+    {
+      errno = error_code;
+      return kWorkerPoolStartFailed;
+    }
+  }
+
+  LOG_DEBUG("StartWorkerPool[2]: end workers initialization");
+  return 0;
+}
+
+/*
+ * Wakes a sleeping worker up to steal the connections queued for the
+ * busy one.
+ */
+// clang-format off
+__attribute__((nonnull(1, 2)))
+static int WakeThief(
+  struct WorkerPool* pool,  //
+  const struct Worker* busy_worker
+)  // clang-format on
+{
+  for (unsigned i = 1; i < pool->workers_count_; ++i)
+  {
+    struct Worker* worker = pool->workers_ + (busy_worker->id_ + i) % pool->workers_count_;
+    if (atomic_load_explicit(&worker->sleeping_, memory_order_relaxed))
+    {
+      return HandoffQueueNotify(&worker->handoffs_);
+    }
+  }
+  return 0;
+}
+
+int DispatchClient(
+  struct WorkerPool* pool,  //
+  int clientfd
+)
+{
+  // Power of two choices: the less loaded of two random workers keeps the load even without scanning the pool.
+  struct Worker* worker = pool->workers_;
+  unsigned napi_id = kNoNapiId;
+  if (pool->workers_count_ > 1 && pool->workers_->options_.busy_poll_us_ != kNoBusyPoll)
+  {
+    // A busy polling worker only polls the queues of its own connections: keeping every queue on one worker lets
+    // it find the data of all of them.
+    socklen_t napi_id_size = sizeof(napi_id);
+    if (getsockopt(clientfd, SOL_SOCKET, SO_INCOMING_NAPI_ID, &napi_id, &napi_id_size) == kGetsockoptFailed)
+    {
+      napi_id = kNoNapiId;
+    }
+  }
+  if (napi_id != kNoNapiId)
+  {
+    worker = pool->workers_ + napi_id % pool->workers_count_;
+  }
+  else if (pool->workers_count_ > 1)
+  {
+    uint32_t random = NextRandom(pool);
+    unsigned first = random % pool->workers_count_;
+    unsigned second = (first + 1 + (random / pool->workers_count_) % (pool->workers_count_ - 1)) % pool->workers_count_;
+    worker = pool->workers_ + first;
+    if (atomic_load_explicit(&pool->workers_[second].connections_, memory_order_relaxed) <
+        atomic_load_explicit(&worker->connections_, memory_order_relaxed))
+    {
+      worker = pool->workers_ + second;
+    }
+  }
+
+  if (napi_id == kNoNapiId && IsWorkerOverloaded(worker))
+  {
+    // Only under overload: the first worker that keeps up takes the connection.
+    for (unsigned i = 1; i < pool->workers_count_; ++i)
+    {
+      struct Worker* candidate = pool->workers_ + (worker->id_ + i) % pool->workers_count_;
+      if (!IsWorkerOverloaded(candidate))
+      {
+        worker = candidate;
+        break;
+      }
+    }
+  }
+
+  bool wakeup;
+  atomic_fetch_add_explicit(&worker->connections_, 1, memory_order_relaxed);
+  if (!HandoffQueuePush(&worker->handoffs_, clientfd, &wakeup))
+  {
+    UnassignConnection(worker);
+    errno = EAGAIN;
+    return kDispatchFailed;
+  }
+  if (wakeup)
+  {
+    return HandoffQueueWake(&worker->handoffs_) == kHandoffQueueWakeFailed ? kDispatchFailed : 0;
+  }
+  // The worker has not picked up the previous handoffs, it is busy with its connections.
+  if (worker->options_.steal_threshold_ != kNoStealing &&
+      HandoffQueueSize(&worker->handoffs_) >= worker->options_.steal_threshold_ &&
+      WakeThief(pool, worker) == kHandoffQueueWakeFailed)
+  {
+    return kDispatchFailed;
+  }
+  return 0;
+}
+
+void ReconfigureWorkerPool(
+  struct WorkerPool* pool,  //
+  const struct WorkerOptions* options
+)
+{
+  pthread_mutex_lock(&pool->options_mutex_);
+  pool->options_.byte_quota_ = options->byte_quota_;
+  pool->options_.idle_timeout_ms_ = options->idle_timeout_ms_;
+  pool->options_.lifetime_ms_ = options->lifetime_ms_;
+  pool->options_.flush_threshold_ = options->flush_threshold_;
+  pool->options_.rate_limits_ = options->rate_limits_;
+  pool->options_.peer_rate_limits_ = options->peer_rate_limits_;
+  pool->options_.write_quantum_ = options->write_quantum_;
+  atomic_fetch_add_explicit(&pool->options_generation_, 1, memory_order_release);
+  pthread_mutex_unlock(&pool->options_mutex_);
+}
+
+bool IsWorkerPoolOverloaded(
+  struct WorkerPool* pool
+)
+{
+  if (!IsAdmissionControlled(&pool->options_))
+  {
+    return false;
+  }
+  for (unsigned i = 0; i < pool->workers_count_; ++i)
+  {
+    if (!IsWorkerOverloaded(pool->workers_ + i))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+int DrainWorkerPool(
+  struct WorkerPool* pool
+)
+{
+  atomic_store_explicit(&pool->draining_, true, memory_order_relaxed);
+  for (unsigned i = 0; i < pool->workers_count_; ++i)
+  {
+    if (HandoffQueueNotify(&pool->workers_[i].handoffs_) == kHandoffQueueWakeFailed)
+    {
+      return kDispatchFailed;
+    }
+  }
+  return 0;
+}
+
+uint64_t CountPoolConnections(
+  struct WorkerPool* pool
+)
+{
+  uint64_t connections = 0;
+  for (unsigned i = 0; i < pool->workers_count_; ++i)
+  {
+    connections += atomic_load_explicit(&pool->workers_[i].connections_, memory_order_relaxed);
+  }
+  return connections;
+}
\ No newline at end of file
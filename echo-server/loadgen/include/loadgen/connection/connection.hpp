@@ -0,0 +1,206 @@
+#pragma once
+
+#include <array>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <client/framing/codecs.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <loadgen/histogram/histogram.hpp>
+#include <vector>
+
+/**
+ * @namespace loadgen
+ */
+namespace loadgen
+{
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @struct Workload
+ * @brief Parameters of the load every Connection puts on the server.
+ */
+struct Workload
+{
+  /**
+   * @brief Framing of the requests, has to match the framing of the server.
+   */
+  tcp::Framing framing{tcp::Framing::kNewline};
+
+  /**
+   * @brief Size of every request in bytes, including the newline or the length header.
+   */
+  std::size_t message_size{64};
+
+  /**
+   * @brief Maximal number of requests sent without waiting for their echo.
+   */
+  std::size_t pipeline_depth{1};
+
+  /**
+   * @brief Requests per second sent by a single connection, 0 for the closed loop.
+   * @details In the closed loop a connection sends the next request as soon as
+   *          an echo arrives. In the open loop requests are due on a fixed
+   *          schedule and their latency is measured from the moment they were
+   *          due, so a stalled server is charged for the requests it delayed
+   *          (coordinated omission correction).
+   */
+  double rate{0};
+
+  /**
+   * @brief Requests after which a connection reconnects, 0 to keep the connection.
+   * @details The first request on a new connection also waits for the server
+   *          to accept and start serving it, so churning connections puts
+   *          the accept path into the measured latency.
+   */
+  std::size_t requests_per_connection{0};
+
+  /**
+   * @brief Samples completed before this moment are not recorded (warm-up).
+   */
+  Clock::time_point measure_start;
+};
+
+/**
+ * @struct Statistics
+ * @brief Results recorded by the connections of a single thread.
+ */
+struct alignas(64) Statistics
+{
+  Statistics();
+
+  Histogram latency;
+  std::uint64_t requests;
+  std::uint64_t bytes;
+  std::uint64_t errors;
+  std::uint64_t rejected;
+};
+
+/**
+ * @class Connection
+ * @brief Client connection sending framed requests and timing their echo.
+ * @details Requests are written back to back (up to the pipeline depth in a
+ *          single write) and matched with the echo in FIFO order, so the
+ *          connection works with any echo server regardless of how it splits
+ *          the stream.
+ *
+ *          A connection the server refuses, resets or closes before it has
+ *          echoed anything counts as rejected and connects again after a
+ *          backoff that doubles up to kMaxReconnectDelay. The requests that
+ *          were due in the meantime are dropped instead of being charged to
+ *          the next connection, so the latency covers the admitted load only.
+ */
+class Connection final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for Connection class.
+   *
+   * @param[in] context Context the connection runs on.
+   * @param[in] workload Load to put on the server.
+   * @param[in] statistics Statistics of the thread running the context.
+   * @param[in] schedule_offset Offset of the open loop schedule, spreads the requests of the connections.
+   */
+  Connection(
+    boost::asio::io_context& context,  //
+    const Workload& workload,
+    Statistics& statistics,
+    Clock::duration schedule_offset
+  );
+
+  Connection(const Connection&) = delete;
+  auto operator=(const Connection&) -> Connection& = delete;
+
+  /**
+   * @public
+   * @brief Connects to the server and starts sending requests.
+   *
+   * @param[in] endpoint Address of the server.
+   */
+  auto Start(const boost::asio::ip::tcp::endpoint& endpoint) -> void;
+
+ private:
+  /**
+   * @private
+   * @brief Connects to the endpoint and starts reading the echo.
+   */
+  auto AsyncConnect() -> void;
+
+  /**
+   * @private
+   * @brief Returns true if the connection has completed its requests and has nothing left to write.
+   */
+  auto Exhausted() const -> bool;
+
+  /**
+   * @private
+   * @brief Closes the connection that has completed its requests and connects again.
+   */
+  auto Reconnect() -> void;
+
+  /**
+   * @private
+   * @brief Records the rejection and connects again after the backoff.
+   */
+  auto Retry() -> void;
+
+  /**
+   * @private
+   * @brief Queues every request that is due and fits into the pipeline.
+   */
+  auto Issue() -> void;
+
+  /**
+   * @private
+   * @brief Writes the requests queued by Issue.
+   */
+  auto AsyncWrite() -> void;
+
+  /**
+   * @private
+   * @brief Waits until the next request of the open loop schedule is due.
+   */
+  auto AsyncWaitSchedule() -> void;
+
+  /**
+   * @private
+   * @brief Reads the echo and completes the requests it contains.
+   */
+  auto AsyncRead() -> void;
+
+  /**
+   * @private
+   * @brief Records the error and closes the connection, retries if the server rejected it.
+   */
+  auto Fail() -> void;
+
+  boost::asio::ip::tcp::socket socket_;
+  boost::asio::steady_timer timer_;
+  boost::asio::ip::tcp::endpoint endpoint_;
+  const Workload& workload_;
+  Statistics& statistics_;
+  std::vector<char> requests_;
+  std::array<char, 64 * 1024> read_buffer_;
+  std::vector<Clock::time_point> send_times_;
+  std::size_t send_times_head_;
+  std::size_t in_flight_;
+  std::size_t unwritten_;
+  std::size_t received_bytes_;
+  std::uint64_t issued_;
+  std::size_t connection_requests_;
+  Clock::time_point schedule_start_;
+  Clock::duration schedule_offset_;
+  Clock::duration interval_;
+  Clock::duration reconnect_delay_;
+  bool connected_;
+  bool echoed_;
+  bool rejected_;
+  bool retrying_;
+  bool writing_;
+  bool waiting_schedule_;
+  bool failed_;
+};
+
+}  // namespace loadgen
\ No newline at end of file
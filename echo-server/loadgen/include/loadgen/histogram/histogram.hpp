@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @namespace loadgen
+ */
+namespace loadgen
+{
+
+/**
+ * @class Histogram
+ * @brief High dynamic range histogram of the latency samples.
+ * @details Values are kept in log-linear buckets (the HdrHistogram layout):
+ *          every power of two range is split into the same number of linear
+ *          sub-buckets, so any recorded value is reproduced with the
+ *          requested number of significant decimal digits while the memory
+ *          stays constant no matter how many values are recorded.
+ */
+class Histogram final
+{
+ public:
+  /**
+   * @public
+   * @brief Parameterized constructor for Histogram class.
+   *
+   * @param[in] highest_trackable_value Largest value the histogram tracks; larger ones are clamped.
+   * @param[in] significant_figures Number of significant decimal digits kept for every value [1, 5].
+   */
+  Histogram(
+    std::uint64_t highest_trackable_value,  //
+    int significant_figures
+  );
+
+  /**
+   * @public
+   * @brief Records a single value.
+   *
+   * @param[in] value Value to record.
+   */
+  auto Record(std::uint64_t value) noexcept -> void;
+
+  /**
+   * @public
+   * @brief Adds all the values recorded by another histogram with the same layout.
+   *
+   * @param[in] other Histogram to merge.
+   */
+  auto Add(const Histogram& other) noexcept -> void;
+
+  /**
+   * @public
+   * @brief Returns the value below or equal to which the specified percentage of the values lie.
+   *
+   * @param[in] percentile Percentile in range [0, 100].
+   */
+  auto ValueAtPercentile(double percentile) const noexcept -> std::uint64_t;
+
+  /**
+   * @public
+   * @brief Returns the number of the recorded values.
+   */
+  auto TotalCount() const noexcept -> std::uint64_t;
+
+  /**
+   * @public
+   * @brief Returns the smallest recorded value (0 if nothing was recorded).
+   */
+  auto Min() const noexcept -> std::uint64_t;
+
+  /**
+   * @public
+   * @brief Returns the largest recorded value (0 if nothing was recorded).
+   */
+  auto Max() const noexcept -> std::uint64_t;
+
+  /**
+   * @public
+   * @brief Returns the mean of the recorded values.
+   */
+  auto Mean() const noexcept -> double;
+
+ private:
+  /**
+   * @private
+   * @brief Returns the index of the counter of the value.
+   */
+  auto CountsIndex(std::uint64_t value) const noexcept -> std::size_t;
+
+  /**
+   * @private
+   * @brief Returns the largest value that is counted by the counter with the specified index.
+   */
+  auto HighestEquivalentValue(std::size_t index) const noexcept -> std::uint64_t;
+
+  std::vector<std::uint64_t> counts_;
+  std::uint64_t highest_trackable_value_;
+  std::uint64_t total_count_;
+  std::uint64_t min_;
+  std::uint64_t max_;
+  double sum_;
+  std::uint64_t sub_bucket_mask_;
+  int sub_bucket_half_count_magnitude_;
+  std::size_t sub_bucket_half_count_;
+};
+
+}  // namespace loadgen
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <array>
+#include <boost/asio.hpp>
+#include <fmt/core.h>
+#include <chrono>
+#include <cstdlib>
+#include <loadgen/connection/connection.hpp>
+#include <loadgen/histogram/histogram.hpp>
+#include <memory>
+#include <server/context_pool/context_pool.hpp>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace net = boost::asio;
+
+namespace
+{
+
+constexpr std::string_view kConnectionsFlag{"--connections="};
+constexpr std::string_view kThreadsFlag{"--threads="};
+constexpr std::string_view kFramingFlag{"--framing="};
+constexpr std::string_view kSizeFlag{"--size="};
+constexpr std::string_view kDepthFlag{"--depth="};
+constexpr std::string_view kRateFlag{"--rate="};
+constexpr std::string_view kRequestsPerConnectionFlag{"--requests-per-connection="};
+constexpr std::string_view kDurationFlag{"--duration="};
+constexpr std::string_view kWarmupFlag{"--warmup="};
+constexpr std::string_view kLabelFlag{"--label="};
+constexpr std::string_view kPinThreadsFlag{"--pin-threads"};
+constexpr std::string_view kCsvFlag{"--csv"};
+constexpr std::array<std::pair<std::string_view, tcp::Framing>, 5> kFramings{
+  {{"newline", tcp::Framing::kNewline},
+   {"u16", tcp::Framing::kU16Length},
+   {"u32", tcp::Framing::kU32Length},
+   {"varint", tcp::Framing::kVarintLength},
+   {"fixed", tcp::Framing::kFixedSize}}
+};
+constexpr std::size_t kMaxU16LengthMessageSize{2 + 0xFFFF};
+constexpr double kNanosecondsPerMicrosecond{1000.0};
+constexpr double kBytesPerMebibyte{1024.0 * 1024.0};
+
+auto ToDuration(double seconds) -> loadgen::Clock::duration
+{
+  return std::chrono::duration_cast<loadgen::Clock::duration>(std::chrono::duration<double>{seconds});
+}
+
+auto Microseconds(std::uint64_t nanoseconds) -> double
+{
+  return static_cast<double>(nanoseconds) / kNanosecondsPerMicrosecond;
+}
+
+}
+
+auto main(
+  int argc,  //
+  char* argv[]
+) -> int
+{
+  if (argc < 3 || std::string_view{argv[1]} == "--help")
+  {
+    fmt::print(
+      stderr,
+      "Usage: {} <address> <port> [{}N] [{}N] [{}newline|u16|u32|varint|fixed] [{}BYTES] [{}N] "
+      "[{}REQUESTS_PER_SECOND] [{}N] [{}SECONDS] [{}SECONDS] [{}] [{}] [{}NAME]\n",
+      argv[0],
+      kConnectionsFlag,
+      kThreadsFlag,
+      kFramingFlag,
+      kSizeFlag,
+      kDepthFlag,
+      kRateFlag,
+      kRequestsPerConnectionFlag,
+      kDurationFlag,
+      kWarmupFlag,
+      kPinThreadsFlag,
+      kCsvFlag,
+      kLabelFlag
+    );
+    return 1;
+  }
+  boost::system::error_code error_code;
+  const net::ip::address address{net::ip::make_address(argv[1], error_code)};
+  if (error_code)
+  {
+    fmt::print(stderr, "Load generator initialization failed: invalid address: {}\n", argv[1]);
+    return 1;
+  }
+  const net::ip::tcp::endpoint endpoint{address, static_cast<net::ip::port_type>(atoi(argv[2]))};
+  std::size_t connections_count{64};
+  std::size_t threads_count{std::max(std::thread::hardware_concurrency(), 1U)};
+  double rate{0};
+  double duration_seconds{10};
+  double warmup_seconds{1};
+  bool pin_threads{false};
+  bool csv{false};
+  std::string_view label{"echo-server"};
+  loadgen::Workload workload;
+  for (int i = 3; i < argc; ++i)
+  {
+    std::string_view argument{argv[i]};
+    if (argument.starts_with(kConnectionsFlag))
+    {
+      connections_count = std::strtoull(argv[i] + kConnectionsFlag.size(), nullptr, 10);
+    }
+    else if (argument.starts_with(kThreadsFlag))
+    {
+      threads_count = std::strtoull(argv[i] + kThreadsFlag.size(), nullptr, 10);
+    }
+    else if (argument.starts_with(kFramingFlag))
+    {
+      const std::string_view name{argument.substr(kFramingFlag.size())};
+      const auto framing{std::ranges::find_if(
+        kFramings,
+        [name](const std::pair<std::string_view, tcp::Framing>& entry) -> bool
+        {
+          return entry.first == name;
+        }
+      )};
+      if (framing == kFramings.end())
+      {
+        fmt::print(stderr, "Load generator initialization failed: unknown framing: {}\n", name);
+        return 1;
+      }
+      workload.framing = framing->second;
+    }
+    else if (argument.starts_with(kSizeFlag))
+    {
+      workload.message_size = std::strtoull(argv[i] + kSizeFlag.size(), nullptr, 10);
+    }
+    else if (argument.starts_with(kDepthFlag))
+    {
+      workload.pipeline_depth = std::strtoull(argv[i] + kDepthFlag.size(), nullptr, 10);
+    }
+    else if (argument.starts_with(kRateFlag))
+    {
+      rate = std::strtod(argv[i] + kRateFlag.size(), nullptr);
+    }
+    else if (argument.starts_with(kRequestsPerConnectionFlag))
+    {
+      workload.requests_per_connection = std::strtoull(argv[i] + kRequestsPerConnectionFlag.size(), nullptr, 10);
+    }
+    else if (argument.starts_with(kDurationFlag))
+    {
+      duration_seconds = std::strtod(argv[i] + kDurationFlag.size(), nullptr);
+    }
+    else if (argument.starts_with(kWarmupFlag))
+    {
+      warmup_seconds = std::strtod(argv[i] + kWarmupFlag.size(), nullptr);
+    }
+    else if (argument.starts_with(kLabelFlag))
+    {
+      label = argument.substr(kLabelFlag.size());
+    }
+    else if (argument == kPinThreadsFlag)
+    {
+      pin_threads = true;
+    }
+    else if (argument == kCsvFlag)
+    {
+      csv = true;
+    }
+    else
+    {
+      fmt::print(stderr, "Load generator initialization failed: unknown argument: {}\n", argument);
+      return 1;
+    }
+  }
+  // Every request carries at least one byte besides the newline or the header, so the asio server does not see
+  // empty lines or frames.
+  workload.message_size = std::max<std::size_t>(
+    workload.message_size,
+    workload.framing == tcp::Framing::kU32Length ? 5 : workload.framing == tcp::Framing::kU16Length ? 3 : 2
+  );
+  if (workload.framing == tcp::Framing::kU16Length && workload.message_size > kMaxU16LengthMessageSize)
+  {
+    fmt::print(
+      stderr,
+      "Load generator initialization failed: u16 framing limits requests to {} bytes\n",
+      kMaxU16LengthMessageSize
+    );
+    return 1;
+  }
+  workload.pipeline_depth = std::max<std::size_t>(workload.pipeline_depth, 1);
+  connections_count = std::max<std::size_t>(connections_count, 1);
+  duration_seconds = std::max(duration_seconds, 0.001);
+  warmup_seconds = std::max(warmup_seconds, 0.0);
+  workload.rate = rate / static_cast<double>(connections_count);
+
+  tcp::ContextPool pool{threads_count, pin_threads};
+  std::vector<loadgen::Statistics> statistics(pool.Size());
+  const loadgen::Clock::time_point start{loadgen::Clock::now()};
+  workload.measure_start = start + ToDuration(warmup_seconds);
+  const loadgen::Clock::time_point end{workload.measure_start + ToDuration(duration_seconds)};
+
+  // Schedules of the open loop are shifted against each other so the connections do not send in bursts.
+  const loadgen::Clock::duration interval{
+    workload.rate > 0 ? ToDuration(1.0 / workload.rate) : loadgen::Clock::duration::zero()
+  };
+  std::vector<std::unique_ptr<loadgen::Connection>> connections;
+  connections.reserve(connections_count);
+  for (std::size_t i = 0; i < connections_count; ++i)
+  {
+    const std::size_t index{i % pool.Size()};
+    connections.push_back(
+      std::make_unique<loadgen::Connection>(
+        pool.Context(index),
+        workload,
+        statistics[index],
+        interval * static_cast<loadgen::Clock::rep>(i) / static_cast<loadgen::Clock::rep>(connections_count)
+      )
+    );
+    connections.back()->Start(endpoint);
+  }
+  net::steady_timer deadline{pool.Context(0), end};
+  deadline.async_wait(
+    [&pool](boost::system::error_code) -> void
+    {
+      pool.Stop();
+    }
+  );
+  pool.Run();
+
+  loadgen::Statistics total;
+  for (const loadgen::Statistics& thread_statistics : statistics)
+  {
+    total.latency.Add(thread_statistics.latency);
+    total.requests += thread_statistics.requests;
+    total.bytes += thread_statistics.bytes;
+    total.errors += thread_statistics.errors;
+    total.rejected += thread_statistics.rejected;
+  }
+  const double requests_per_second{static_cast<double>(total.requests) / duration_seconds};
+  const double mebibytes_per_second{static_cast<double>(total.bytes) / kBytesPerMebibyte / duration_seconds};
+  if (csv)
+  {
+    fmt::print(
+      "{},{},{},{},{:.0f},{},{:.0f},{:.2f},{:.1f},{:.1f},{:.1f},{:.1f},{:.1f},{},{}\n",
+      label,
+      connections_count,
+      workload.message_size,
+      workload.pipeline_depth,
+      rate,
+      total.requests,
+      requests_per_second,
+      mebibytes_per_second,
+      Microseconds(total.latency.ValueAtPercentile(50.0)),
+      Microseconds(total.latency.ValueAtPercentile(90.0)),
+      Microseconds(total.latency.ValueAtPercentile(99.0)),
+      Microseconds(total.latency.ValueAtPercentile(99.9)),
+      Microseconds(total.latency.Max()),
+      total.errors,
+      total.rejected
+    );
+  }
+  else
+  {
+    fmt::print(
+      "{}: {} connections on {} threads, {} byte requests, pipeline depth {}, {}\n",
+      label,
+      connections_count,
+      pool.Size(),
+      workload.message_size,
+      workload.pipeline_depth,
+      rate > 0 ? fmt::format("open loop at {:.0f} requests/s", rate) : std::string{"closed loop"}
+    );
+    fmt::print(
+      "  requests: {} in {:.1f}s ({:.0f} requests/s, {:.2f} MiB/s), connection errors: {}, "
+      "rejected connections: {}\n",
+      total.requests,
+      duration_seconds,
+      requests_per_second,
+      mebibytes_per_second,
+      total.errors,
+      total.rejected
+    );
+    fmt::print(
+      "  latency (us): min {:.1f}, mean {:.1f}, p50 {:.1f}, p90 {:.1f}, p99 {:.1f}, p99.9 {:.1f}, p99.99 {:.1f}, "
+      "max {:.1f}\n",
+      Microseconds(total.latency.Min()),
+      total.latency.Mean() / kNanosecondsPerMicrosecond,
+      Microseconds(total.latency.ValueAtPercentile(50.0)),
+      Microseconds(total.latency.ValueAtPercentile(90.0)),
+      Microseconds(total.latency.ValueAtPercentile(99.0)),
+      Microseconds(total.latency.ValueAtPercentile(99.9)),
+      Microseconds(total.latency.ValueAtPercentile(99.99)),
+      Microseconds(total.latency.Max())
+    );
+  }
+  return total.requests == 0 ? 1 : 0;
+}
\ No newline at end of file
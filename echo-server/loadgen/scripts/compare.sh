@@ -0,0 +1,68 @@
+#!/usr/bin/env bash
+#
+# Runs the same load generator workload against both servers on localhost
+# and prints the results as a single table.
+#
+# Usage: compare.sh <asio-server> <linux-server> <loadgen> [loadgen options...]
+# Environment: ASIO_PORT (default 9000), LINUX_PORT (default 10000).
+
+set -euo pipefail
+
+if [[ $# -lt 3 ]]; then
+  echo "Usage: $0 <asio-server> <linux-server> <loadgen> [loadgen options...]" >&2
+  exit 1
+fi
+
+asio_server=$1
+linux_server=$2
+loadgen=$3
+shift 3
+
+asio_port=${ASIO_PORT:-9000}
+linux_port=${LINUX_PORT:-10000}
+server_pid=
+
+stop_server() {
+  if [[ -n $server_pid ]]; then
+    kill "$server_pid" 2>/dev/null || true
+    wait "$server_pid" 2>/dev/null || true
+    server_pid=
+  fi
+}
+trap stop_server EXIT
+
+wait_for_port() {
+  for _ in $(seq 50); do
+    if (exec 3<>"/dev/tcp/127.0.0.1/$1") 2>/dev/null; then
+      return 0
+    fi
+    sleep 0.1
+  done
+  echo "Server did not start listening on port $1" >&2
+  return 1
+}
+
+# Runs the server given by the remaining arguments and measures it.
+run() {
+  local label=$1
+  local port=$2
+  shift 2
+  "$@" >/dev/null 2>&1 &
+  server_pid=$!
+  wait_for_port "$port"
+  rows+=("$("$loadgen" 127.0.0.1 "$port" --csv "--label=$label" "${load_options[@]}" || true)")
+  stop_server
+}
+
+load_options=("$@")
+rows=("server,connections,size,depth,rate,requests,requests/s,MiB/s,p50(us),p90(us),p99(us),p99.9(us),max(us),errors,rejected")
+
+run asio "$asio_port" "$asio_server" "$asio_port"
+# The quota and the lifetime limit of the linux server would close the connections in the middle of the run.
+run linux "$linux_port" "$linux_server" --byte-quota=0 --lifetime=0
+
+if command -v column >/dev/null; then
+  printf '%s\n' "${rows[@]}" | column -t -s,
+else
+  printf '%s\n' "${rows[@]}"
+fi
@@ -0,0 +1,87 @@
+#!/usr/bin/env bash
+#
+# Sweeps the offered load of open loop clients past the saturation of both
+# servers, with and without the admission control, and prints the results
+# as a single table.
+#
+# The clients reconnect every few requests, so new connections keep
+# arriving at the offered rate. Without the admission control the latency
+# grows with the queues once the server saturates; with it the server sheds
+# the connections it cannot serve (the rejected column) and the latency of
+# the admitted ones stays flat. The load generator has to outrun the server
+# for that, give it more threads or cores than the server has.
+#
+# Usage: saturation.sh <asio-server> <linux-server> <loadgen> [loadgen options...]
+# Environment: ASIO_PORT (default 9000), LINUX_PORT (default 10000),
+#              RATES (default "20000 40000 80000 160000 320000"), DURATION (default 5),
+#              MAX_LOOP_LAG (default 5), OVERLOAD_ACTION (default reject).
+
+set -euo pipefail
+
+if [[ $# -lt 3 ]]; then
+  echo "Usage: $0 <asio-server> <linux-server> <loadgen> [loadgen options...]" >&2
+  exit 1
+fi
+
+asio_server=$1
+linux_server=$2
+loadgen=$3
+shift 3
+
+asio_port=${ASIO_PORT:-9000}
+linux_port=${LINUX_PORT:-10000}
+duration=${DURATION:-5}
+max_loop_lag=${MAX_LOOP_LAG:-5}
+overload_action=${OVERLOAD_ACTION:-reject}
+server_pid=
+
+stop_server() {
+  if [[ -n $server_pid ]]; then
+    kill "$server_pid" 2>/dev/null || true
+    wait "$server_pid" 2>/dev/null || true
+    server_pid=
+  fi
+}
+trap stop_server EXIT
+
+wait_for_port() {
+  for _ in $(seq 50); do
+    if (exec 3<>"/dev/tcp/127.0.0.1/$1") 2>/dev/null; then
+      return 0
+    fi
+    sleep 0.1
+  done
+  echo "Server did not start listening on port $1" >&2
+  return 1
+}
+
+# Runs the server given by the remaining arguments and measures it at every rate.
+sweep() {
+  local label=$1
+  local port=$2
+  shift 2
+  "$@" >/dev/null 2>&1 &
+  server_pid=$!
+  wait_for_port "$port"
+  for rate in ${RATES:-20000 40000 80000 160000 320000}; do
+    rows+=("$("$loadgen" 127.0.0.1 "$port" --csv "--label=$label" "--rate=$rate" "--duration=$duration" \
+      "${load_options[@]}" || true)")
+  done
+  stop_server
+}
+
+load_options=(--connections=64 --requests-per-connection=10 "$@")
+admission_options=("--max-loop-lag=$max_loop_lag" "--overload-action=$overload_action")
+rows=("server,connections,size,depth,rate,requests,requests/s,MiB/s,p50(us),p90(us),p99(us),p99.9(us),max(us),errors,rejected")
+
+sweep asio "$asio_port" "$asio_server" "$asio_port"
+sweep "asio-$overload_action" "$asio_port" "$asio_server" "$asio_port" "${admission_options[@]}"
+# The quota and the lifetime limit of the linux server would close the connections in the middle of the run.
+sweep linux "$linux_port" "$linux_server" --byte-quota=0 --lifetime=0
+sweep "linux-$overload_action" "$linux_port" "$linux_server" --byte-quota=0 --lifetime=0 "${admission_options[@]}"
+
+if command -v column >/dev/null; then
+  printf '%s\n' "${rows[@]}" | column -t -s,
+else
+  printf '%s\n' "${rows[@]}"
+fi
\ No newline at end of file
@@ -0,0 +1,76 @@
+#!/usr/bin/env bash
+#
+# Runs the same load generator workload against the Boost.Asio server with
+# the callback sessions and with the coroutine sessions and prints the
+# results as a single table.
+#
+# Usage: sessions.sh <asio-server> <loadgen> [loadgen options...]
+# Environment: ASIO_PORT (default 9000), CONNECTIONS (default 10000).
+# Both the server and the load generator keep a descriptor per connection,
+# so the limit of open files has to be raised above CONNECTIONS.
+
+set -euo pipefail
+
+if [[ $# -lt 2 ]]; then
+  echo "Usage: $0 <asio-server> <loadgen> [loadgen options...]" >&2
+  exit 1
+fi
+
+asio_server=$1
+loadgen=$2
+shift 2
+
+asio_port=${ASIO_PORT:-9000}
+connections=${CONNECTIONS:-10000}
+server_pid=
+
+stop_server() {
+  if [[ -n $server_pid ]]; then
+    kill "$server_pid" 2>/dev/null || true
+    wait "$server_pid" 2>/dev/null || true
+    server_pid=
+  fi
+}
+trap stop_server EXIT
+
+wait_for_port() {
+  for _ in $(seq 50); do
+    if (exec 3<>"/dev/tcp/127.0.0.1/$1") 2>/dev/null; then
+      return 0
+    fi
+    sleep 0.1
+  done
+  echo "Server did not start listening on port $1" >&2
+  return 1
+}
+
+if [[ $(ulimit -n) != unlimited && $(ulimit -n) -le $((connections + 64)) ]]; then
+  ulimit -n $((connections + 1024)) 2>/dev/null || {
+    echo "The limit of open files is below $connections connections" >&2
+    exit 1
+  }
+fi
+
+# Runs the server with the session flags given by the remaining arguments and measures it.
+run() {
+  local label=$1
+  shift
+  "$asio_server" "$asio_port" "$@" >/dev/null 2>&1 &
+  server_pid=$!
+  wait_for_port "$asio_port"
+  rows+=("$("$loadgen" 127.0.0.1 "$asio_port" --csv "--label=$label" "--connections=$connections" \
+    "${load_options[@]}" || true)")
+  stop_server
+}
+
+load_options=("$@")
+rows=("server,connections,size,depth,rate,requests,requests/s,MiB/s,p50(us),p90(us),p99(us),p99.9(us),max(us),errors,rejected")
+
+run callback
+run coroutine --coroutines
+
+if command -v column >/dev/null; then
+  printf '%s\n' "${rows[@]}" | column -t -s,
+else
+  printf '%s\n' "${rows[@]}"
+fi
\ No newline at end of file
@@ -0,0 +1,81 @@
+#!/usr/bin/env bash
+#
+# Measures the latency of short-lived clients while a few heavy clients
+# keep some of the workers of the linux server busy, with and without
+# work stealing, and prints the results as a single table.
+#
+# The light clients reconnect every few requests, so the latency of the
+# first request on a connection includes the wait for a worker to pick
+# the connection up.
+#
+# Usage: skewed.sh <linux-server> <loadgen> [light client loadgen options...]
+# Environment: LINUX_PORT (default 10000), WORKERS (default: the server default),
+#              HEAVY_CONNECTIONS (default 2), HEAVY_SIZE (default 65536), HEAVY_DEPTH (default 16),
+#              DURATION (default 10), STEAL_THRESHOLDS (default "0 2").
+
+set -euo pipefail
+
+if [[ $# -lt 2 ]]; then
+  echo "Usage: $0 <linux-server> <loadgen> [light client loadgen options...]" >&2
+  exit 1
+fi
+
+linux_server=$1
+loadgen=$2
+shift 2
+
+linux_port=${LINUX_PORT:-10000}
+heavy_connections=${HEAVY_CONNECTIONS:-2}
+heavy_size=${HEAVY_SIZE:-65536}
+heavy_depth=${HEAVY_DEPTH:-16}
+duration=${DURATION:-10}
+server_pid=
+heavy_pid=
+
+stop_server() {
+  for pid in $heavy_pid $server_pid; do
+    kill "$pid" 2>/dev/null || true
+    wait "$pid" 2>/dev/null || true
+  done
+  server_pid=
+  heavy_pid=
+}
+trap stop_server EXIT
+
+wait_for_port() {
+  for _ in $(seq 50); do
+    if (exec 3<>"/dev/tcp/127.0.0.1/$1") 2>/dev/null; then
+      return 0
+    fi
+    sleep 0.1
+  done
+  echo "Server did not start listening on port $1" >&2
+  return 1
+}
+
+server_options=(--byte-quota=0 --lifetime=0)
+if [[ -n ${WORKERS:-} ]]; then
+  server_options+=("--workers=$WORKERS")
+fi
+light_options=(--connections=32 --rate=2000 --requests-per-connection=10 "$@")
+rows=("server,connections,size,depth,rate,requests,requests/s,MiB/s,p50(us),p90(us),p99(us),p99.9(us),max(us),errors,rejected")
+
+for steal_threshold in ${STEAL_THRESHOLDS:-0 2}; do
+  "$linux_server" "${server_options[@]}" "--steal-threshold=$steal_threshold" >/dev/null 2>&1 &
+  server_pid=$!
+  wait_for_port "$linux_port"
+  # The heavy clients connect first and outlive the measured run.
+  "$loadgen" 127.0.0.1 "$linux_port" --threads=1 "--connections=$heavy_connections" "--size=$heavy_size" \
+    "--depth=$heavy_depth" "--duration=$((duration + 5))" --warmup=0 >/dev/null 2>&1 &
+  heavy_pid=$!
+  sleep 1
+  rows+=("$("$loadgen" 127.0.0.1 "$linux_port" --csv "--label=steal-threshold=$steal_threshold" \
+    "--duration=$duration" "${light_options[@]}" || true)")
+  stop_server
+done
+
+if command -v column >/dev/null; then
+  printf '%s\n' "${rows[@]}" | column -t -s,
+else
+  printf '%s\n' "${rows[@]}"
+fi
\ No newline at end of file
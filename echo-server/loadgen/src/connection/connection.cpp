@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <loadgen/connection/connection.hpp>
+
+#define func auto
+
+namespace net = boost::asio;
+
+namespace
+{
+
+constexpr std::uint64_t kHighestTrackableLatency{std::chrono::nanoseconds{std::chrono::minutes{1}}.count()};
+constexpr int kSignificantFigures{3};
+constexpr std::chrono::milliseconds kMinReconnectDelay{10};
+constexpr std::chrono::milliseconds kMaxReconnectDelay{1000};
+
+func VarintSize(std::size_t value) -> std::size_t
+{
+  std::size_t size{1};
+  for (; value >= 0x80; value >>= 7)
+  {
+    ++size;
+  }
+  return size;
+}
+
+// Fills the request with the header or the terminator of the framing and 'x' payload. The varint header takes as
+// many bytes as the message size would need and pads the shorter payload length with continuation bytes, so every
+// message size has an encoding.
+func EncodeRequest(
+  tcp::Framing framing,  //
+  char* request,
+  std::size_t size
+) -> void
+{
+  std::fill_n(request, size, 'x');
+  switch (framing)
+  {
+    case tcp::Framing::kNewline:
+      request[size - 1] = '\n';
+      break;
+    case tcp::Framing::kU16Length:
+    case tcp::Framing::kU32Length:
+    {
+      const std::size_t header_size{framing == tcp::Framing::kU16Length ? 2U : 4U};
+      const std::size_t length{size - header_size};
+      for (std::size_t i = 0; i < header_size; ++i)
+      {
+        request[i] = static_cast<char>(length >> (8 * (header_size - 1 - i)));
+      }
+      break;
+    }
+    case tcp::Framing::kVarintLength:
+    {
+      const std::size_t header_size{VarintSize(size)};
+      std::size_t length{size - header_size};
+      for (std::size_t i = 0; i < header_size; ++i, length >>= 7)
+      {
+        request[i] = static_cast<char>((length & 0x7F) | (i + 1 < header_size ? 0x80 : 0));
+      }
+      break;
+    }
+    case tcp::Framing::kFixedSize:
+      break;
+  }
+}
+
+}  // namespace
+
+namespace loadgen
+{
+
+Statistics::Statistics()
+  : latency{kHighestTrackableLatency, kSignificantFigures}  //
+  , requests{0}
+  , bytes{0}
+  , errors{0}
+  , rejected{0}
+{ }
+
+Connection::Connection(
+  net::io_context& context,  //
+  const Workload& workload,
+  Statistics& statistics,
+  Clock::duration schedule_offset
+)
+  : socket_{context}  //
+  , timer_{context}
+  , workload_{workload}
+  , statistics_{statistics}
+  , requests_(workload.pipeline_depth * workload.message_size, 'x')
+  , read_buffer_{}
+  , send_times_(workload.pipeline_depth)
+  , send_times_head_{0}
+  , in_flight_{0}
+  , unwritten_{0}
+  , received_bytes_{0}
+  , issued_{0}
+  , connection_requests_{0}
+  , schedule_offset_{schedule_offset}
+  , interval_{
+      workload.rate > 0
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{1.0 / workload.rate})
+        : Clock::duration::zero()
+    }
+  , reconnect_delay_{kMinReconnectDelay}
+  , connected_{false}
+  , echoed_{false}
+  , rejected_{false}
+  , retrying_{false}
+  , writing_{false}
+  , waiting_schedule_{false}
+  , failed_{false}
+{
+  for (std::size_t i = 0; i < requests_.size(); i += workload.message_size)
+  {
+    EncodeRequest(workload.framing, requests_.data() + i, workload.message_size);
+  }
+}
+
+func Connection::Start(const net::ip::tcp::endpoint& endpoint) -> void
+{
+  endpoint_ = endpoint;
+  schedule_start_ = Clock::now() + schedule_offset_;
+  AsyncConnect();
+}
+
+func Connection::AsyncConnect() -> void
+{
+  socket_.async_connect(
+    endpoint_,
+    [this](boost::system::error_code error_code) -> void
+    {
+      if (error_code)
+      {
+        Retry();
+        return;
+      }
+      socket_.set_option(net::ip::tcp::no_delay{true}, error_code);
+      connected_ = true;
+      if (rejected_ && interval_ != Clock::duration::zero())
+      {
+        // The requests due while the server turned the connection away are dropped.
+        const Clock::time_point now{Clock::now()};
+        if (now > schedule_start_)
+        {
+          issued_ = std::max(issued_, static_cast<std::uint64_t>((now - schedule_start_) / interval_));
+        }
+      }
+      rejected_ = false;
+      AsyncRead();
+      Issue();
+    }
+  );
+}
+
+func Connection::Exhausted() const -> bool
+{
+  return workload_.requests_per_connection != 0 && connection_requests_ >= workload_.requests_per_connection;
+}
+
+func Connection::Reconnect() -> void
+{
+  boost::system::error_code error_code;
+  socket_.close(error_code);
+  connected_ = false;
+  connection_requests_ = 0;
+  send_times_head_ = 0;
+  received_bytes_ = 0;
+  echoed_ = false;
+  AsyncConnect();
+}
+
+func Connection::Retry() -> void
+{
+  if (retrying_)
+  {
+    // The read and the write of the same connection both fail.
+    return;
+  }
+  retrying_ = true;
+  rejected_ = true;
+  if (Clock::now() >= workload_.measure_start)
+  {
+    ++statistics_.rejected;
+  }
+  boost::system::error_code error_code;
+  socket_.close(error_code);
+  connected_ = false;
+  connection_requests_ = 0;
+  send_times_head_ = 0;
+  in_flight_ = 0;
+  unwritten_ = 0;
+  received_bytes_ = 0;
+  echoed_ = false;
+  timer_.expires_after(reconnect_delay_);
+  reconnect_delay_ = std::min<Clock::duration>(reconnect_delay_ * 2, kMaxReconnectDelay);
+  timer_.async_wait(
+    [this](boost::system::error_code error_code) -> void
+    {
+      retrying_ = false;
+      if (!error_code)
+      {
+        AsyncConnect();
+      }
+    }
+  );
+}
+
+func Connection::Issue() -> void
+{
+  if (failed_ || !connected_)
+  {
+    return;
+  }
+  const Clock::time_point now{Clock::now()};
+  while (in_flight_ < workload_.pipeline_depth && !Exhausted())
+  {
+    Clock::time_point send_time{now};
+    if (interval_ != Clock::duration::zero())
+    {
+      // Requests that fell behind the schedule keep the time they were due at.
+      send_time = schedule_start_ + interval_ * static_cast<Clock::rep>(issued_);
+      if (send_time > now)
+      {
+        break;
+      }
+    }
+    send_times_[(send_times_head_ + in_flight_) % send_times_.size()] = send_time;
+    ++in_flight_;
+    ++unwritten_;
+    ++issued_;
+    ++connection_requests_;
+  }
+  if (unwritten_ != 0 && !writing_)
+  {
+    AsyncWrite();
+  }
+  if (interval_ != Clock::duration::zero() && in_flight_ < workload_.pipeline_depth && !Exhausted())
+  {
+    AsyncWaitSchedule();
+  }
+}
+
+func Connection::AsyncWrite() -> void
+{
+  writing_ = true;
+  const std::size_t count{unwritten_};
+  net::async_write(
+    socket_,
+    net::buffer(requests_.data(), count * workload_.message_size),
+    [this, count](boost::system::error_code error_code, std::size_t) -> void
+    {
+      writing_ = false;
+      if (retrying_)
+      {
+        // Completed before the rejected connection was closed, its requests are dropped.
+        return;
+      }
+      if (error_code)
+      {
+        Fail();
+        return;
+      }
+      unwritten_ -= count;
+      if (unwritten_ != 0)
+      {
+        AsyncWrite();
+      }
+      else if (Exhausted() && in_flight_ == 0)
+      {
+        Reconnect();
+      }
+    }
+  );
+}
+
+func Connection::AsyncWaitSchedule() -> void
+{
+  if (waiting_schedule_)
+  {
+    return;
+  }
+  waiting_schedule_ = true;
+  timer_.expires_at(schedule_start_ + interval_ * static_cast<Clock::rep>(issued_));
+  timer_.async_wait(
+    [this](boost::system::error_code error_code) -> void
+    {
+      waiting_schedule_ = false;
+      if (!error_code)
+      {
+        Issue();
+      }
+    }
+  );
+}
+
+func Connection::AsyncRead() -> void
+{
+  socket_.async_read_some(
+    net::buffer(read_buffer_),
+    [this](boost::system::error_code error_code, std::size_t bytes_transferred) -> void
+    {
+      if (retrying_)
+      {
+        return;
+      }
+      if (error_code)
+      {
+        Fail();
+        return;
+      }
+      if (!echoed_)
+      {
+        echoed_ = true;
+        reconnect_delay_ = kMinReconnectDelay;
+      }
+      const Clock::time_point now{Clock::now()};
+      const bool measured{now >= workload_.measure_start};
+      if (measured)
+      {
+        statistics_.bytes += bytes_transferred;
+      }
+      received_bytes_ += bytes_transferred;
+      while (received_bytes_ >= workload_.message_size && in_flight_ != 0)
+      {
+        received_bytes_ -= workload_.message_size;
+        const Clock::time_point send_time{send_times_[send_times_head_]};
+        send_times_head_ = (send_times_head_ + 1) % send_times_.size();
+        --in_flight_;
+        if (measured)
+        {
+          statistics_.latency.Record(
+            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - send_time).count())
+          );
+          ++statistics_.requests;
+        }
+      }
+      // Echo of the last request may arrive before the write completes, the write handler reconnects then.
+      if (Exhausted() && in_flight_ == 0)
+      {
+        if (!writing_)
+        {
+          Reconnect();
+        }
+        return;
+      }
+      Issue();
+      AsyncRead();
+    }
+  );
+}
+
+func Connection::Fail() -> void
+{
+  if (failed_ || retrying_)
+  {
+    return;
+  }
+  if (!echoed_)
+  {
+    Retry();
+    return;
+  }
+  failed_ = true;
+  ++statistics_.errors;
+  boost::system::error_code error_code;
+  socket_.close(error_code);
+  timer_.cancel();
+}
+
+}  // namespace loadgen
\ No newline at end of file
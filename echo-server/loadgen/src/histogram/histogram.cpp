@@ -0,0 +1,142 @@
+#include <loadgen/histogram/histogram.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#define func auto
+
+namespace loadgen
+{
+
+Histogram::Histogram(
+  std::uint64_t highest_trackable_value,  //
+  int significant_figures
+)
+  : highest_trackable_value_{std::max<std::uint64_t>(highest_trackable_value, 2)}  //
+  , total_count_{0}
+  , min_{std::numeric_limits<std::uint64_t>::max()}
+  , max_{0}
+  , sum_{0}
+{
+  significant_figures = std::clamp(significant_figures, 1, 5);
+  std::uint64_t largest_value_with_single_unit_resolution{2};
+  for (int i = 0; i < significant_figures; ++i)
+  {
+    largest_value_with_single_unit_resolution *= 10;
+  }
+  int sub_bucket_count_magnitude{0};
+  while ((std::uint64_t{1} << sub_bucket_count_magnitude) < largest_value_with_single_unit_resolution)
+  {
+    ++sub_bucket_count_magnitude;
+  }
+  const std::uint64_t sub_bucket_count{std::uint64_t{1} << sub_bucket_count_magnitude};
+  sub_bucket_half_count_magnitude_ = sub_bucket_count_magnitude - 1;
+  sub_bucket_half_count_ = static_cast<std::size_t>(sub_bucket_count / 2);
+  sub_bucket_mask_ = sub_bucket_count - 1;
+
+  // Every bucket after the first one doubles the range of the tracked values.
+  std::size_t buckets_count{1};
+  std::uint64_t smallest_untrackable_value{sub_bucket_count};
+  while (smallest_untrackable_value <= highest_trackable_value_)
+  {
+    ++buckets_count;
+    if (smallest_untrackable_value > std::numeric_limits<std::uint64_t>::max() / 2)
+    {
+      break;
+    }
+    smallest_untrackable_value <<= 1;
+  }
+  counts_.resize((buckets_count + 1) * sub_bucket_half_count_, 0);
+}
+
+func Histogram::Record(std::uint64_t value) noexcept -> void
+{
+  value = std::min(value, highest_trackable_value_);
+  ++counts_[CountsIndex(value)];
+  ++total_count_;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += static_cast<double>(value);
+}
+
+func Histogram::Add(const Histogram& other) noexcept -> void
+{
+  const std::size_t size{std::min(counts_.size(), other.counts_.size())};
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    counts_[i] += other.counts_[i];
+  }
+  total_count_ += other.total_count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+func Histogram::ValueAtPercentile(double percentile) const noexcept -> std::uint64_t
+{
+  if (total_count_ == 0)
+  {
+    return 0;
+  }
+  percentile = std::clamp(percentile, 0.0, 100.0);
+  std::uint64_t count_at_percentile{
+    static_cast<std::uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total_count_)))
+  };
+  count_at_percentile = std::max<std::uint64_t>(count_at_percentile, 1);
+  std::uint64_t count{0};
+  for (std::size_t i = 0; i < counts_.size(); ++i)
+  {
+    count += counts_[i];
+    if (count >= count_at_percentile)
+    {
+      return std::min(HighestEquivalentValue(i), max_);
+    }
+  }
+  return max_;
+}
+
+func Histogram::TotalCount() const noexcept -> std::uint64_t
+{
+  return total_count_;
+}
+
+func Histogram::Min() const noexcept -> std::uint64_t
+{
+  return total_count_ == 0 ? 0 : min_;
+}
+
+func Histogram::Max() const noexcept -> std::uint64_t
+{
+  return max_;
+}
+
+func Histogram::Mean() const noexcept -> double
+{
+  return total_count_ == 0 ? 0.0 : sum_ / static_cast<double>(total_count_);
+}
+
+func Histogram::CountsIndex(std::uint64_t value) const noexcept -> std::size_t
+{
+  const int pow2_ceiling{64 - __builtin_clzll(value | sub_bucket_mask_)};
+  const int bucket_index{pow2_ceiling - (sub_bucket_half_count_magnitude_ + 1)};
+  const std::uint64_t sub_bucket_index{value >> bucket_index};
+  const std::size_t index{
+    (static_cast<std::size_t>(bucket_index + 1) << sub_bucket_half_count_magnitude_) +
+    static_cast<std::size_t>(sub_bucket_index - sub_bucket_half_count_)
+  };
+  return std::min(index, counts_.size() - 1);
+}
+
+func Histogram::HighestEquivalentValue(std::size_t index) const noexcept -> std::uint64_t
+{
+  int bucket_index{static_cast<int>(index >> sub_bucket_half_count_magnitude_) - 1};
+  std::uint64_t sub_bucket_index{(index & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_};
+  if (bucket_index < 0)
+  {
+    sub_bucket_index -= sub_bucket_half_count_;
+    bucket_index = 0;
+  }
+  return (sub_bucket_index << bucket_index) + (std::uint64_t{1} << bucket_index) - 1;
+}
+
+}  // namespace loadgen
\ No newline at end of file